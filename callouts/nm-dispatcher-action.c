@@ -40,9 +40,15 @@
 #include "nm-dispatcher-utils.h"
 
 #define NMD_SCRIPT_DIR NMCONFDIR "/dispatcher.d"
+#define NMD_CONFIG_FILE NMCONFDIR "/NetworkManager.conf"
 
 static GMainLoop *loop = NULL;
 static gboolean debug = FALSE;
+static gint max_parallel = 1;
+static gboolean coalesce = FALSE;
+
+/* Interface name -> GQueue of Requests; the head is the running one */
+static GHashTable *iface_queues = NULL;
 
 typedef struct {
 	GObject parent;
@@ -94,8 +100,6 @@ handler_class_init (HandlerClass *h_class)
 
 typedef struct Request Request;
 
-static void dispatch_one_script (Request *request);
-
 typedef struct {
 	Request *request;
 
@@ -103,6 +107,11 @@ typedef struct {
 	GPid pid;
 	DispatchResult result;
 	char *error;
+	GTimer *timer;
+	guint elapsed;       /* wall time in milliseconds */
+
+	guint watch_id;
+	guint timeout_id;
 } ScriptInfo;
 
 struct Request {
@@ -113,10 +122,9 @@ struct Request {
 	char *iface;
 	char **envp;
 	GPtrArray *scripts;  /* list of ScriptInfo */
-	guint idx;
-
-	guint script_watch_id;
-	guint script_timeout_id;
+	guint idx;           /* next script to start */
+	guint group_end;     /* first script past the current group */
+	guint num_running;
 };
 
 static void
@@ -124,6 +132,8 @@ script_info_free (ScriptInfo *info)
 {
 	g_free (info->script);
 	g_free (info->error);
+	if (info->timer)
+		g_timer_destroy (info->timer);
 	g_free (info);
 }
 
@@ -136,6 +146,7 @@ request_free (Request *request)
 	if (request->scripts)
 		g_ptr_array_foreach (request->scripts, (GFunc) script_info_free, NULL);
 	g_ptr_array_free (request->scripts, TRUE);
+	g_free (request);
 }
 
 static gboolean
@@ -154,29 +165,41 @@ quit_timeout_reschedule (Handler *h)
 		h->quit_id = g_timeout_add_seconds (10, quit_timeout_cb, NULL);
 }
 
+static gboolean dispatch_one_script (ScriptInfo *script);
+static void request_start (Request *request);
+
 static gboolean
-next_script (gpointer user_data)
+script_same_group (ScriptInfo *a, ScriptInfo *b)
 {
-	Request *request = user_data;
-	GPtrArray *results;
-	GValueArray *item;
-	guint i;
+	return nm_dispatcher_utils_script_same_group (a->script, b->script);
+}
 
-	quit_timeout_reschedule (request->handler);
+static guint
+script_group_end (Request *request, guint start)
+{
+	ScriptInfo *first = g_ptr_array_index (request->scripts, start);
+	guint i;
 
-	request->idx++;
-	if (request->idx < request->scripts->len) {
-		dispatch_one_script (request);
-		return FALSE;
+	for (i = start + 1; i < request->scripts->len; i++) {
+		if (!script_same_group (first, g_ptr_array_index (request->scripts, i)))
+			break;
 	}
+	return i;
+}
+
+static GPtrArray *
+request_build_results (Request *request)
+{
+	GPtrArray *results;
+	GValueArray *item;
+	guint i;
 
-	/* All done */
 	results = g_ptr_array_sized_new (request->scripts->len);
 	for (i = 0; i < request->scripts->len; i++) {
 		ScriptInfo *script = g_ptr_array_index (request->scripts, i);
 		GValue elt = {0, };
 
-		item = g_value_array_new (3);
+		item = g_value_array_new (4);
 
 		/* Script path */
 		g_value_init (&elt, G_TYPE_STRING);
@@ -196,13 +219,99 @@ next_script (gpointer user_data)
 		g_value_array_append (item, &elt);
 		g_value_unset (&elt);
 
+		/* Wall time */
+		g_value_init (&elt, G_TYPE_UINT);
+		g_value_set_uint (&elt, script->elapsed);
+		g_value_array_append (item, &elt);
+		g_value_unset (&elt);
+
 		g_ptr_array_add (results, item);
 	}
 
+	return results;
+}
+
+static void
+results_free (GPtrArray *results)
+{
+	g_ptr_array_foreach (results, (GFunc) g_value_array_free, NULL);
+	g_ptr_array_free (results, TRUE);
+}
+
+static void
+request_complete (Request *request)
+{
+	GPtrArray *results;
+	GQueue *queue = NULL;
+	Request *next = NULL;
+
+	results = request_build_results (request);
 	dbus_g_method_return (request->context, results);
+	results_free (results);
+
+	if (iface_queues && request->iface)
+		queue = g_hash_table_lookup (iface_queues, request->iface);
+	if (queue) {
+		g_warn_if_fail (g_queue_peek_head (queue) == request);
+		g_queue_pop_head (queue);
+		next = g_queue_peek_head (queue);
+		if (!next)
+			g_hash_table_remove (iface_queues, request->iface);
+	}
 
 	request_free (request);
-	return FALSE;
+
+	/* Run the next event queued for this interface */
+	if (next)
+		request_start (next);
+}
+
+static void
+next_script (Request *request)
+{
+	ScriptInfo *script;
+
+	quit_timeout_reschedule (request->handler);
+
+	while (TRUE) {
+		if (request->idx == request->group_end) {
+			/* Wait for the rest of the current group */
+			if (request->num_running)
+				return;
+
+			if (request->idx >= request->scripts->len)
+				break;
+			request->group_end = max_parallel > 1 ?
+			                     script_group_end (request, request->idx) :
+			                     request->idx + 1;
+		}
+
+		if (request->num_running >= (guint) max_parallel)
+			return;
+
+		script = g_ptr_array_index (request->scripts, request->idx++);
+		if (dispatch_one_script (script))
+			request->num_running++;
+	}
+
+	/* All done */
+	request_complete (request);
+}
+
+static void
+script_finished (ScriptInfo *script)
+{
+	Request *request = script->request;
+
+	script->elapsed = (guint) (g_timer_elapsed (script->timer, NULL) * 1000.0);
+	if (debug)
+		g_message ("Script '%s' finished in %u ms", script->script, script->elapsed);
+
+	g_spawn_close_pid (script->pid);
+
+	g_assert (request->num_running > 0);
+	request->num_running--;
+	next_script (request);
 }
 
 static void
@@ -213,9 +322,9 @@ script_watch_cb (GPid pid, gint status, gpointer user_data)
 
 	g_assert (pid == script->pid);
 
-	script->request->script_watch_id = 0;
-	g_source_remove (script->request->script_timeout_id);
-	script->request->script_timeout_id = 0;
+	script->watch_id = 0;
+	g_source_remove (script->timeout_id);
+	script->timeout_id = 0;
 
 	if (WIFEXITED (status)) {
 		err = WEXITSTATUS (status);
@@ -241,8 +350,7 @@ script_watch_cb (GPid pid, gint status, gpointer user_data)
 		g_warning ("%s", script->error);
 	}
 
-	g_spawn_close_pid (script->pid);
-	next_script (script->request);
+	script_finished (script);
 }
 
 static gboolean
@@ -250,9 +358,9 @@ script_timeout_cb (gpointer user_data)
 {
 	ScriptInfo *script = user_data;
 
-	g_source_remove (script->request->script_watch_id);
-	script->request->script_watch_id = 0;
-	script->request->script_timeout_id = 0;
+	g_source_remove (script->watch_id);
+	script->watch_id = 0;
+	script->timeout_id = 0;
 
 	g_warning ("Script '%s' took too long; killing it.", script->script);
 
@@ -263,8 +371,7 @@ script_timeout_cb (gpointer user_data)
 	script->error = g_strdup_printf ("Script '%s' timed out.", script->script);
 	script->result = DISPATCH_RESULT_TIMEOUT;
 
-	g_spawn_close_pid (script->pid);
-	g_idle_add (next_script, script->request);
+	script_finished (script);
 	return FALSE;
 }
 
@@ -332,12 +439,12 @@ child_setup (gpointer user_data G_GNUC_UNUSED)
 	setpgid (pid, pid);
 }
 
-static void
-dispatch_one_script (Request *request)
+static gboolean
+dispatch_one_script (ScriptInfo *script)
 {
+	Request *request = script->request;
 	GError *error = NULL;
 	gchar *argv[4];
-	ScriptInfo *script = g_ptr_array_index (request->scripts, request->idx);
 
 	argv[0] = script->script;
 	argv[1] = request->iface ? request->iface : "none";
@@ -347,19 +454,19 @@ dispatch_one_script (Request *request)
 	if (debug)
 		g_message ("Script: %s %s %s", script->script, request->iface ? request->iface : "(none)", request->action);
 
+	script->timer = g_timer_new ();
 	if (g_spawn_async ("/", argv, request->envp, G_SPAWN_DO_NOT_REAP_CHILD, child_setup, request, &script->pid, &error)) {
-		request->script_watch_id = g_child_watch_add (script->pid, (GChildWatchFunc) script_watch_cb, script);
-		request->script_timeout_id = g_timeout_add_seconds (3, script_timeout_cb, script);
-	} else {
-		g_warning ("Failed to execute script '%s': (%d) %s",
-		           script->script, error->code, error->message);
-		script->result = DISPATCH_RESULT_EXEC_FAILED;
-		script->error = g_strdup (error->message);
-		g_clear_error (&error);
-
-		/* Try the next script */
-		g_idle_add (next_script, request);
+		script->watch_id = g_child_watch_add (script->pid, (GChildWatchFunc) script_watch_cb, script);
+		script->timeout_id = g_timeout_add_seconds (3, script_timeout_cb, script);
+		return TRUE;
 	}
+
+	g_warning ("Failed to execute script '%s': (%d) %s",
+	           script->script, error->code, error->message);
+	script->result = DISPATCH_RESULT_EXEC_FAILED;
+	script->error = g_strdup (error->message);
+	g_clear_error (&error);
+	return FALSE;
 }
 
 static GSList *
@@ -403,6 +510,68 @@ find_scripts (void)
 	return sorted;
 }
 
+static void
+request_start (Request *request)
+{
+	request->idx = 0;
+	request->group_end = 0;
+	next_script (request);
+}
+
+static gboolean
+request_supersedes (Request *newer, Request *older)
+{
+	return nm_dispatcher_utils_action_supersedes (newer->action, older->action);
+}
+
+/* Returns TRUE if the request was queued behind another one for the same
+ * interface and must not be started yet.
+ */
+static gboolean
+request_enqueue (Request *request)
+{
+	GQueue *queue;
+	GList *iter, *next;
+
+	if (!coalesce || !request->iface)
+		return FALSE;
+
+	if (!iface_queues) {
+		iface_queues = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                      g_free, (GDestroyNotify) g_queue_free);
+	}
+
+	queue = g_hash_table_lookup (iface_queues, request->iface);
+	if (!queue) {
+		queue = g_queue_new ();
+		g_hash_table_insert (iface_queues, g_strdup (request->iface), queue);
+		g_queue_push_tail (queue, request);
+		return FALSE;
+	}
+
+	/* Drop waiting events this one supersedes; the running one is left alone */
+	for (iter = queue->head->next; iter; iter = next) {
+		Request *older = iter->data;
+
+		next = iter->next;
+		if (request_supersedes (request, older)) {
+			GPtrArray *results = g_ptr_array_new ();
+
+			if (debug) {
+				g_message ("Dropping superseded '%s' event for %s",
+				           older->action, older->iface);
+			}
+			dbus_g_method_return (older->context, results);
+			g_ptr_array_free (results, TRUE);
+			g_queue_delete_link (queue, iter);
+			request_free (older);
+		}
+	}
+
+	g_queue_push_tail (queue, request);
+	return TRUE;
+}
+
 static void
 impl_dispatch (Handler *h,
                const char *str_action,
@@ -470,8 +639,11 @@ impl_dispatch (Handler *h,
 	}
 	g_slist_free (sorted_scripts);
 
-	/* start dispatching scripts */
-	dispatch_one_script (request);
+	/* start dispatching scripts, unless an earlier event for the
+	 * interface is still being handled
+	 */
+	if (!request_enqueue (request))
+		request_start (request);
 }
 
 static void
@@ -617,6 +789,35 @@ setup_signals (void)
 	sigaction (SIGINT,  &action, NULL);
 }
 
+/* Defaults from the [dispatcher] section of NetworkManager.conf; since we're
+ * D-Bus activated this is the only way to set them without editing the
+ * service file.  Command-line options still take precedence.
+ */
+static void
+read_config (void)
+{
+	GKeyFile *kf;
+	GError *error = NULL;
+	gint val;
+
+	kf = g_key_file_new ();
+	if (!g_key_file_load_from_file (kf, NMD_CONFIG_FILE, G_KEY_FILE_NONE, NULL))
+		goto out;
+
+	val = g_key_file_get_integer (kf, "dispatcher", "max-parallel", &error);
+	if (!error)
+		max_parallel = val;
+	g_clear_error (&error);
+
+	val = g_key_file_get_boolean (kf, "dispatcher", "coalesce", &error);
+	if (!error)
+		coalesce = val;
+	g_clear_error (&error);
+
+out:
+	g_key_file_free (kf);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -629,9 +830,13 @@ main (int argc, char **argv)
 	GOptionEntry entries[] = {
 		{ "debug", 0, 0, G_OPTION_ARG_NONE, &debug, "Output to console rather than syslog", NULL },
 		{ "persist", 0, 0, G_OPTION_ARG_NONE, &persist, "Don't quit after a short timeout", NULL },
+		{ "max-parallel", 0, 0, G_OPTION_ARG_INT, &max_parallel, "Run up to N scripts of the same numeric group at once (default 1)", "N" },
+		{ "coalesce", 0, 0, G_OPTION_ARG_NONE, &coalesce, "Serialize events per interface and drop superseded up/down events", NULL },
 		{ NULL }
 	};
 
+	read_config ();
+
 	opt_ctx = g_option_context_new (NULL);
 	g_option_context_set_summary (opt_ctx, "Executes scripts upon actions by NetworkManager.");
 	g_option_context_add_main_entries (opt_ctx, entries, NULL);
@@ -644,6 +849,9 @@ main (int argc, char **argv)
 
 	g_option_context_free (opt_ctx);
 
+	if (max_parallel < 1)
+		max_parallel = 1;
+
 	g_type_init ();
 	setup_signals ();
 
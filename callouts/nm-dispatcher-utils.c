@@ -515,3 +515,58 @@ nm_dispatcher_utils_construct_envp (const char *action,
 	return envp;
 }
 
+/* Scripts whose names start with the same digits (or that all lack a
+ * numeric prefix) form a group and may run concurrently; a group only
+ * starts once every script of the previous group has finished.
+ */
+static gsize
+script_group_prefix (const char *name)
+{
+	gsize len = 0;
+
+	while (g_ascii_isdigit (name[len]))
+		len++;
+	return len;
+}
+
+gboolean
+nm_dispatcher_utils_script_same_group (const char *a, const char *b)
+{
+	const char *name_a = strrchr (a, '/');
+	const char *name_b = strrchr (b, '/');
+	gsize len;
+
+	name_a = name_a ? name_a + 1 : a;
+	name_b = name_b ? name_b + 1 : b;
+	len = script_group_prefix (name_a);
+	return len == script_group_prefix (name_b) && !strncmp (name_a, name_b, len);
+}
+
+static gboolean
+action_is_link_event (const char *action, gboolean *out_vpn)
+{
+	if (!strcmp (action, "up") || !strcmp (action, "down")) {
+		*out_vpn = FALSE;
+		return TRUE;
+	}
+	if (!strcmp (action, "vpn-up") || !strcmp (action, "vpn-down")) {
+		*out_vpn = TRUE;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/* A queued up/down event for an interface is superseded by a newer one of
+ * the same kind; only the latest state of the link matters to the scripts.
+ */
+gboolean
+nm_dispatcher_utils_action_supersedes (const char *newer, const char *older)
+{
+	gboolean newer_vpn, older_vpn;
+
+	if (!action_is_link_event (newer, &newer_vpn))
+		return FALSE;
+	if (!action_is_link_event (older, &older_vpn))
+		return FALSE;
+	return newer_vpn == older_vpn;
+}
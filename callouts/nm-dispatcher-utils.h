@@ -37,5 +37,9 @@ nm_dispatcher_utils_construct_envp (const char *action,
                                     GHashTable *vpn_ip6_props,
                                     char **out_iface);
 
+gboolean nm_dispatcher_utils_script_same_group (const char *a, const char *b);
+
+gboolean nm_dispatcher_utils_action_supersedes (const char *newer, const char *older);
+
 #endif  /* NM_DISPATCHER_UTILS_H */
 
@@ -630,6 +630,71 @@ test_up_empty_vpn_iface (const char *path)
 
 /*******************************************/
 
+static void
+test_script_groups (void)
+{
+	/* Sorted the way find_scripts() returns them */
+	const char *scripts[] = {
+		"/etc/NetworkManager/dispatcher.d/01-ifupdown",
+		"/etc/NetworkManager/dispatcher.d/10-a",
+		"/etc/NetworkManager/dispatcher.d/10-b",
+		"/etc/NetworkManager/dispatcher.d/10foo",
+		"/etc/NetworkManager/dispatcher.d/100-c",
+		"/etc/NetworkManager/dispatcher.d/20-d",
+		"/etc/NetworkManager/dispatcher.d/chrony",
+		"/etc/NetworkManager/dispatcher.d/ntp",
+		NULL
+	};
+	/* Index of the first script of each script's group */
+	const guint group_start[] = { 0, 1, 1, 1, 4, 5, 6, 6 };
+	guint i, start = 0;
+
+	for (i = 0; scripts[i]; i++) {
+		if (!nm_dispatcher_utils_script_same_group (scripts[start], scripts[i]))
+			start = i;
+		g_assert_cmpuint (start, ==, group_start[i]);
+	}
+
+	/* Only the digits count, and prefixes must be equal, not just match */
+	g_assert (nm_dispatcher_utils_script_same_group ("10-a", "10_b"));
+	g_assert (!nm_dispatcher_utils_script_same_group ("10-a", "100-a"));
+	g_assert (!nm_dispatcher_utils_script_same_group ("010-a", "10-a"));
+
+	/* Unnumbered scripts form one group, apart from numbered ones */
+	g_assert (nm_dispatcher_utils_script_same_group ("/a/chrony", "/b/ntp"));
+	g_assert (!nm_dispatcher_utils_script_same_group ("/a/chrony", "/a/99-last"));
+	g_assert (!nm_dispatcher_utils_script_same_group ("/a/99-last", "/a/chrony"));
+
+	/* Digits in the directory name don't matter */
+	g_assert (nm_dispatcher_utils_script_same_group ("/etc/10/a", "/etc/20/b"));
+}
+
+static void
+test_action_supersedes (void)
+{
+	/* up and down supersede each other */
+	g_assert (nm_dispatcher_utils_action_supersedes ("up", "down"));
+	g_assert (nm_dispatcher_utils_action_supersedes ("down", "up"));
+	g_assert (nm_dispatcher_utils_action_supersedes ("up", "up"));
+
+	/* so do vpn-up and vpn-down */
+	g_assert (nm_dispatcher_utils_action_supersedes ("vpn-up", "vpn-down"));
+	g_assert (nm_dispatcher_utils_action_supersedes ("vpn-down", "vpn-up"));
+
+	/* but device and VPN events never supersede each other */
+	g_assert (!nm_dispatcher_utils_action_supersedes ("up", "vpn-up"));
+	g_assert (!nm_dispatcher_utils_action_supersedes ("down", "vpn-down"));
+	g_assert (!nm_dispatcher_utils_action_supersedes ("vpn-down", "down"));
+
+	/* and other events are never dropped, nor do they drop anything */
+	g_assert (!nm_dispatcher_utils_action_supersedes ("up", "hostname"));
+	g_assert (!nm_dispatcher_utils_action_supersedes ("hostname", "hostname"));
+	g_assert (!nm_dispatcher_utils_action_supersedes ("dhcp4-change", "up"));
+	g_assert (!nm_dispatcher_utils_action_supersedes ("down", "dhcp6-change"));
+}
+
+/*******************************************/
+
 #if GLIB_CHECK_VERSION(2,25,12)
 typedef GTestFixtureFunc TCFunc;
 #else
@@ -656,6 +721,9 @@ int main (int argc, char **argv)
 
 	g_test_suite_add (suite, TESTCASE (test_up_empty_vpn_iface, argv[1]));
 
+	g_test_suite_add (suite, TESTCASE (test_script_groups, NULL));
+	g_test_suite_add (suite, TESTCASE (test_action_supersedes, NULL));
+
 	return g_test_run ();
 }
 
@@ -26,6 +26,7 @@
 #include "NetworkManager.h"
 #include "nm-active-connection.h"
 #include "nm-object-private.h"
+#include "nm-object-cache.h"
 #include "nm-types-private.h"
 #include "nm-device.h"
 #include "nm-device-private.h"
@@ -113,6 +114,11 @@ _nm_active_connection_type_for_path (DBusGConnection *connection,
 	GError *error = NULL;
 	GValue value = {0,};
 	GType type;
+	const GValue *cached;
+
+	cached = _nm_object_cache_get_snapshot_value (path, "Vpn");
+	if (cached && G_VALUE_HOLDS_BOOLEAN (cached))
+		return g_value_get_boolean (cached) ? NM_TYPE_VPN_CONNECTION : NM_TYPE_ACTIVE_CONNECTION;
 
 	proxy = dbus_g_proxy_new_for_name (connection,
 	                                   NM_DBUS_SERVICE,
@@ -188,6 +194,14 @@ _nm_active_connection_type_for_path_async (DBusGConnection *connection,
 {
 	NMActiveConnectionAsyncData *async_data;
 	DBusGProxy *proxy;
+	const GValue *cached;
+
+	cached = _nm_object_cache_get_snapshot_value (path, "Vpn");
+	if (cached && G_VALUE_HOLDS_BOOLEAN (cached)) {
+		callback (g_value_get_boolean (cached) ? NM_TYPE_VPN_CONNECTION : NM_TYPE_ACTIVE_CONNECTION,
+		          user_data);
+		return;
+	}
 
 	async_data = g_slice_new (NMActiveConnectionAsyncData);
 	async_data->connection = connection;
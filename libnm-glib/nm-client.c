@@ -22,6 +22,7 @@
  */
 
 #include <dbus/dbus-glib.h>
+#include <dbus/dbus-glib-lowlevel.h>
 #include <string.h>
 #include <nm-utils.h>
 
@@ -1525,14 +1526,39 @@ constructed (GObject *object)
 	                  G_CALLBACK (object_creation_failed_cb), NULL);
 }
 
+/* Listen for property changes on every NM object while bootstrapping from
+ * the GetObjects() snapshot, so that changes made between the snapshot and
+ * the creation of each object's own proxy aren't lost.
+ */
+#define SNAPSHOT_MATCH_RULE \
+	"type='signal',sender='" NM_DBUS_SERVICE "',member='PropertiesChanged'"
+
+static void
+snapshot_begin (NMClient *client)
+{
+	DBusGConnection *connection = nm_object_get_connection (NM_OBJECT (client));
+
+	dbus_bus_add_match (dbus_g_connection_get_connection (connection),
+	                    SNAPSHOT_MATCH_RULE, NULL);
+}
+
+static void
+snapshot_end (NMClient *client)
+{
+	DBusGConnection *connection = nm_object_get_connection (NM_OBJECT (client));
+
+	_nm_object_cache_clear_snapshot ();
+	dbus_bus_remove_match (dbus_g_connection_get_connection (connection),
+	                       SNAPSHOT_MATCH_RULE, NULL);
+}
+
 static gboolean
 init_sync (GInitable *initable, GCancellable *cancellable, GError **error)
 {
 	NMClient *client = NM_CLIENT (initable);
 	NMClientPrivate *priv = NM_CLIENT_GET_PRIVATE (client);
-
-	if (!nm_client_parent_initable_iface->init (initable, cancellable, error))
-		return FALSE;
+	GHashTable *objects = NULL;
+	gboolean success;
 
 	if (!dbus_g_proxy_call (priv->bus_proxy,
 	                        "NameHasOwner", error,
@@ -1542,6 +1568,26 @@ init_sync (GInitable *initable, GCancellable *cancellable, GError **error)
 	                        G_TYPE_INVALID))
 		return FALSE;
 
+	/* Fetch every object's properties in one call; older daemons don't
+	 * have GetObjects() and objects just read their own properties.
+	 */
+	if (priv->manager_running) {
+		snapshot_begin (client);
+		if (dbus_g_proxy_call (priv->client_proxy, "GetObjects", NULL,
+		                       G_TYPE_INVALID,
+		                       DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT, &objects,
+		                       G_TYPE_INVALID))
+			_nm_object_cache_set_snapshot (objects);
+	}
+
+	success = nm_client_parent_initable_iface->init (initable, cancellable, error);
+
+	if (priv->manager_running)
+		snapshot_end (client);
+
+	if (!success)
+		return FALSE;
+
 	if (priv->manager_running && !get_permissions_sync (client, error))
 		return FALSE;
 
@@ -1589,6 +1635,9 @@ init_async_got_properties (GObject *source, GAsyncResult *result, gpointer user_
 	NMClientInitData *init_data = user_data;
 	GError *error = NULL;
 
+	/* All objects have been created by now */
+	snapshot_end (init_data->client);
+
 	if (!nm_client_parent_async_initable_iface->init_finish (G_ASYNC_INITABLE (source), result, &error))
 		g_simple_async_result_take_error (init_data->result, error);
 
@@ -1596,6 +1645,23 @@ init_async_got_properties (GObject *source, GAsyncResult *result, gpointer user_
 	init_async_complete (init_data);
 }
 
+static void
+init_async_got_objects (DBusGProxy *proxy, DBusGProxyCall *call, gpointer user_data)
+{
+	NMClientInitData *init_data = user_data;
+	GHashTable *objects = NULL;
+
+	/* Older daemons don't have GetObjects(); just read properties per object */
+	if (dbus_g_proxy_end_call (proxy, call, NULL,
+	                           DBUS_TYPE_G_MAP_OF_MAP_OF_VARIANT, &objects,
+	                           G_TYPE_INVALID))
+		_nm_object_cache_set_snapshot (objects);
+
+	nm_client_parent_async_initable_iface->init_async (G_ASYNC_INITABLE (init_data->client),
+	                                                   G_PRIORITY_DEFAULT, NULL, /* FIXME cancellable */
+	                                                   init_async_got_properties, init_data);
+}
+
 static void
 init_async_got_manager_running (DBusGProxy *proxy, DBusGProxyCall *call,
                                 gpointer user_data)
@@ -1617,9 +1683,10 @@ init_async_got_manager_running (DBusGProxy *proxy, DBusGProxyCall *call,
 		return;
 	}
 
-	nm_client_parent_async_initable_iface->init_async (G_ASYNC_INITABLE (init_data->client),
-	                                                   G_PRIORITY_DEFAULT, NULL, /* FIXME cancellable */
-	                                                   init_async_got_properties, init_data);
+	snapshot_begin (init_data->client);
+	dbus_g_proxy_begin_call (priv->client_proxy, "GetObjects",
+	                         init_async_got_objects, init_data, NULL,
+	                         G_TYPE_INVALID);
 	init_data->properties_pending = TRUE;
 
 	dbus_g_proxy_begin_call (priv->client_proxy, "GetPermissions",
@@ -828,6 +828,11 @@ _nm_device_type_for_path (DBusGConnection *connection,
 	GError *err = NULL;
 	GValue value = {0,};
 	NMDeviceType nm_dtype;
+	const GValue *cached;
+
+	cached = _nm_object_cache_get_snapshot_value (path, "DeviceType");
+	if (cached && G_VALUE_HOLDS_UINT (cached))
+		return _nm_device_gtype_from_dtype (g_value_get_uint (cached));
 
 	proxy = dbus_g_proxy_new_for_name (connection,
 									   NM_DBUS_SERVICE,
@@ -925,6 +930,13 @@ _nm_device_type_for_path_async (DBusGConnection *connection,
 {
 	NMDeviceAsyncData *async_data;
 	DBusGProxy *proxy;
+	const GValue *cached;
+
+	cached = _nm_object_cache_get_snapshot_value (path, "DeviceType");
+	if (cached && G_VALUE_HOLDS_UINT (cached)) {
+		callback (_nm_device_gtype_from_dtype (g_value_get_uint (cached)), user_data);
+		return;
+	}
 
 	async_data = g_slice_new (NMDeviceAsyncData);
 	async_data->connection = connection;
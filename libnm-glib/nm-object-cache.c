@@ -27,6 +27,11 @@
 
 static GHashTable *cache = NULL;
 
+/* Object path -> property hash from the manager's GetObjects() call, used
+ * while bootstrapping to avoid one GetAll() round trip per object.
+ */
+static GHashTable *snapshot = NULL;
+
 static void
 _init_cache (void)
 {
@@ -89,3 +94,50 @@ _nm_object_cache_clear (NMObject *except)
 	}
 }
 
+
+void
+_nm_object_cache_set_snapshot (GHashTable *objects)
+{
+	_nm_object_cache_clear_snapshot ();
+	snapshot = objects;
+}
+
+void
+_nm_object_cache_clear_snapshot (void)
+{
+	if (snapshot) {
+		g_hash_table_destroy (snapshot);
+		snapshot = NULL;
+	}
+}
+
+/* Returns a reference to the snapshotted properties of @path and drops them
+ * from the snapshot, since they go stale once the object tracks changes.
+ */
+GHashTable *
+_nm_object_cache_take_snapshot (const char *path)
+{
+	GHashTable *props;
+
+	if (!snapshot || !path)
+		return NULL;
+
+	props = g_hash_table_lookup (snapshot, path);
+	if (props) {
+		g_hash_table_ref (props);
+		g_hash_table_remove (snapshot, path);
+	}
+	return props;
+}
+
+const GValue *
+_nm_object_cache_get_snapshot_value (const char *path, const char *property)
+{
+	GHashTable *props;
+
+	if (!snapshot || !path)
+		return NULL;
+
+	props = g_hash_table_lookup (snapshot, path);
+	return props ? g_hash_table_lookup (props, property) : NULL;
+}
@@ -34,6 +34,13 @@ NMObject *_nm_object_cache_get (const char *path);
 void _nm_object_cache_add (NMObject *object);
 void _nm_object_cache_clear (NMObject *except);
 
+/* Bulk property snapshot used while bootstrapping */
+void _nm_object_cache_set_snapshot (GHashTable *objects);
+void _nm_object_cache_clear_snapshot (void);
+GHashTable *_nm_object_cache_take_snapshot (const char *path);
+const GValue *_nm_object_cache_get_snapshot_value (const char *path,
+                                                   const char *property);
+
 G_END_DECLS
 
 #endif /* NM_OBJECT_CACHE_H */
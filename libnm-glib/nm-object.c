@@ -55,6 +55,7 @@ typedef struct {
 } PropertyInfo;
 
 static void reload_complete (NMObject *object);
+static gboolean reload_from_snapshot (NMObject *object, gboolean synchronously);
 
 typedef struct {
 	PropertyInfo pi;
@@ -1036,6 +1037,9 @@ _nm_object_reload_properties (NMObject *object, GError **error)
 	if (!priv->property_interfaces)
 		return TRUE;
 
+	if (reload_from_snapshot (object, TRUE))
+		return TRUE;
+
 	for (p = priv->property_interfaces; p; p = p->next) {
 		if (!dbus_g_proxy_call (priv->properties_proxy, "GetAll", error,
 		                        G_TYPE_STRING, p->data,
@@ -1387,6 +1391,48 @@ reload_got_pseudo_property (DBusGProxy *proxy, DBusGProxyCall *call,
 		reload_complete (object);
 }
 
+/* Applies the object's properties from the bootstrap snapshot instead of
+ * calling GetAll() on each interface.  Returns FALSE if there was none.
+ */
+static gboolean
+reload_from_snapshot (NMObject *object, gboolean synchronously)
+{
+	NMObjectPrivate *priv = NM_OBJECT_GET_PRIVATE (object);
+	GHashTable *props;
+	GHashTableIter iter;
+	gpointer name, info;
+	GValue *value;
+	PseudoPropertyInfo *ppi;
+
+	props = _nm_object_cache_take_snapshot (priv->path);
+	if (!props)
+		return FALSE;
+
+	process_properties_changed (object, props, synchronously);
+
+	if (priv->pseudo_properties) {
+		g_hash_table_iter_init (&iter, priv->pseudo_properties);
+		while (g_hash_table_iter_next (&iter, &name, &info)) {
+			ppi = info;
+			value = g_hash_table_lookup (props, name);
+			if (value && G_VALUE_HOLDS (value, DBUS_TYPE_G_ARRAY_OF_OBJECT_PATH)) {
+				if (!priv->suppress_property_updates)
+					handle_object_array_property (object, NULL, value, &ppi->pi, synchronously);
+			} else if (synchronously)
+				_nm_object_reload_pseudo_property (object, name);
+			else {
+				priv->reload_remaining++;
+				dbus_g_proxy_begin_call (ppi->proxy, ppi->get_method,
+				                         reload_got_pseudo_property, ppi, NULL,
+				                         G_TYPE_INVALID);
+			}
+		}
+	}
+
+	g_hash_table_unref (props);
+	return TRUE;
+}
+
 void
 _nm_object_reload_properties_async (NMObject *object, GAsyncReadyCallback callback, gpointer user_data)
 {
@@ -1412,28 +1458,38 @@ _nm_object_reload_properties_async (NMObject *object, GAsyncReadyCallback callba
 	if (priv->reload_results->next)
 		return;
 
-	for (p = priv->property_interfaces; p; p = p->next) {
-		priv->reload_remaining++;
-		dbus_g_proxy_begin_call (priv->properties_proxy, "GetAll",
-		                         reload_got_properties, object, NULL,
-		                         G_TYPE_STRING, p->data,
-		                         G_TYPE_INVALID);
-	}
-
-	if (priv->pseudo_properties) {
-		GHashTableIter iter;
-		gpointer key, value;
-		PseudoPropertyInfo *ppi;
+	/* Hold a count so objects created from the snapshot, which may already
+	 * be cached, can't complete the reload while it's still being set up.
+	 */
+	priv->reload_remaining++;
 
-		g_hash_table_iter_init (&iter, priv->pseudo_properties);
-		while (g_hash_table_iter_next (&iter, &key, &value)) {
-			ppi = value;
+	if (!reload_from_snapshot (object, FALSE)) {
+		for (p = priv->property_interfaces; p; p = p->next) {
 			priv->reload_remaining++;
-			dbus_g_proxy_begin_call (ppi->proxy, ppi->get_method,
-			                         reload_got_pseudo_property, ppi, NULL,
+			dbus_g_proxy_begin_call (priv->properties_proxy, "GetAll",
+			                         reload_got_properties, object, NULL,
+			                         G_TYPE_STRING, p->data,
 			                         G_TYPE_INVALID);
 		}
+
+		if (priv->pseudo_properties) {
+			GHashTableIter iter;
+			gpointer key, value;
+			PseudoPropertyInfo *ppi;
+
+			g_hash_table_iter_init (&iter, priv->pseudo_properties);
+			while (g_hash_table_iter_next (&iter, &key, &value)) {
+				ppi = value;
+				priv->reload_remaining++;
+				dbus_g_proxy_begin_call (ppi->proxy, ppi->get_method,
+				                         reload_got_pseudo_property, ppi, NULL,
+				                         G_TYPE_INVALID);
+			}
+		}
 	}
+
+	if (--priv->reload_remaining == 0)
+		reload_complete (object);
 }
 
 gboolean
@@ -128,8 +128,36 @@ _ensure_registered (void)
 {
 	g_type_init ();
 	_nm_utils_register_value_transformations ();
-	if (G_UNLIKELY (registered_settings == NULL))
+	if (G_UNLIKELY (registered_settings == NULL)) {
 		registered_settings = g_hash_table_new (g_str_hash, g_str_equal);
+
+		/* Register every setting type while the library is loaded, so that
+		 * the table is never written to once other threads may be creating
+		 * settings (eg, when connections are parsed in parallel).
+		 */
+		(void) NM_TYPE_SETTING_802_1X;
+		(void) NM_TYPE_SETTING_ADSL;
+		(void) NM_TYPE_SETTING_BLUETOOTH;
+		(void) NM_TYPE_SETTING_BOND;
+		(void) NM_TYPE_SETTING_BRIDGE;
+		(void) NM_TYPE_SETTING_BRIDGE_PORT;
+		(void) NM_TYPE_SETTING_CDMA;
+		(void) NM_TYPE_SETTING_CONNECTION;
+		(void) NM_TYPE_SETTING_GSM;
+		(void) NM_TYPE_SETTING_INFINIBAND;
+		(void) NM_TYPE_SETTING_IP4_CONFIG;
+		(void) NM_TYPE_SETTING_IP6_CONFIG;
+		(void) NM_TYPE_SETTING_OLPC_MESH;
+		(void) NM_TYPE_SETTING_PPP;
+		(void) NM_TYPE_SETTING_PPPOE;
+		(void) NM_TYPE_SETTING_SERIAL;
+		(void) NM_TYPE_SETTING_VLAN;
+		(void) NM_TYPE_SETTING_VPN;
+		(void) NM_TYPE_SETTING_WIMAX;
+		(void) NM_TYPE_SETTING_WIRED;
+		(void) NM_TYPE_SETTING_WIRELESS;
+		(void) NM_TYPE_SETTING_WIRELESS_SECURITY;
+	}
 }
 
 typedef struct {
@@ -302,6 +330,73 @@ nm_connection_create_setting (const char *name)
 	return setting;
 }
 
+/* Settings are shared between a connection and its duplicates for as long
+ * as none of them changes the setting or hands it out to a caller; then that
+ * connection gets its own copy first.  See nm_connection_duplicate().
+ */
+
+static void
+release_setting (gpointer data)
+{
+	_nm_setting_unshare (NM_SETTING (data));
+	g_object_unref (data);
+}
+
+static void
+add_setting (NMConnection *connection, NMSetting *setting)
+{
+	g_hash_table_insert (NM_CONNECTION_GET_PRIVATE (connection)->settings,
+	                     g_strdup (G_OBJECT_TYPE_NAME (setting)), setting);
+}
+
+/* Returns the setting without unsharing it, for read-only use */
+static NMSetting *
+get_setting (NMConnection *connection, GType setting_type)
+{
+	return (NMSetting *) g_hash_table_lookup (NM_CONNECTION_GET_PRIVATE (connection)->settings,
+	                                          g_type_name (setting_type));
+}
+
+static NMSetting *
+get_setting_by_name (NMConnection *connection, const char *name)
+{
+	GType type;
+
+	type = nm_connection_lookup_setting_type (name);
+	return type ? get_setting (connection, type) : NULL;
+}
+
+/* Returns a setting of @connection that may be changed */
+static NMSetting *
+unshare_setting (NMConnection *connection, NMSetting *setting)
+{
+	NMSetting *copy;
+
+	if (!_nm_setting_is_shared (setting))
+		return setting;
+
+	copy = nm_setting_duplicate (setting);
+	add_setting (connection, copy);
+	return copy;
+}
+
+static GSList *
+unshare_all_settings (NMConnection *connection)
+{
+	GHashTableIter iter;
+	NMSetting *setting;
+	GSList *settings = NULL, *l;
+
+	g_hash_table_iter_init (&iter, NM_CONNECTION_GET_PRIVATE (connection)->settings);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &setting))
+		settings = g_slist_prepend (settings, setting);
+
+	/* Can't replace hash table values while iterating */
+	for (l = settings; l; l = g_slist_next (l))
+		l->data = unshare_setting (connection, NM_SETTING (l->data));
+	return settings;
+}
+
 static void
 parse_one_setting (gpointer key, gpointer value, gpointer user_data)
 {
@@ -313,7 +408,7 @@ parse_one_setting (gpointer key, gpointer value, gpointer user_data)
 	if (type)
 		setting = nm_setting_new_from_hash (type, (GHashTable *) value);
 	if (setting)
-		nm_connection_add_setting (connection, setting);
+		add_setting (connection, setting);
 }
 
 /**
@@ -332,8 +427,9 @@ nm_connection_add_setting (NMConnection *connection, NMSetting *setting)
 	g_return_if_fail (NM_IS_CONNECTION (connection));
 	g_return_if_fail (NM_IS_SETTING (setting));
 
-	g_hash_table_insert (NM_CONNECTION_GET_PRIVATE (connection)->settings,
-					 g_strdup (G_OBJECT_TYPE_NAME (setting)), setting);
+	/* The caller keeps a pointer to the setting */
+	_nm_setting_expose (setting);
+	add_setting (connection, setting);
 }
 
 /**
@@ -367,11 +463,18 @@ nm_connection_remove_setting (NMConnection *connection, GType setting_type)
 NMSetting *
 nm_connection_get_setting (NMConnection *connection, GType setting_type)
 {
+	NMSetting *setting;
+
 	g_return_val_if_fail (NM_IS_CONNECTION (connection), NULL);
 	g_return_val_if_fail (g_type_is_a (setting_type, NM_TYPE_SETTING), NULL);
 
-	return (NMSetting *) g_hash_table_lookup (NM_CONNECTION_GET_PRIVATE (connection)->settings,
-									  g_type_name (setting_type));
+	setting = get_setting (connection, setting_type);
+	if (setting) {
+		/* The caller may change the setting */
+		setting = unshare_setting (connection, setting);
+		_nm_setting_expose (setting);
+	}
+	return setting;
 }
 
 /**
@@ -408,13 +511,13 @@ _get_type_setting (NMConnection *connection)
 
 	g_return_val_if_fail (NM_IS_CONNECTION (connection), NULL);
 
-	s_con = nm_connection_get_setting_connection (connection);
+	s_con = (NMSettingConnection *) get_setting (connection, NM_TYPE_SETTING_CONNECTION);
 	g_assert (s_con);
 
 	type = nm_setting_connection_get_connection_type (s_con);
 	g_assert (type);
 
-	base = nm_connection_get_setting_by_name (connection, type);
+	base = get_setting_by_name (connection, type);
 	g_assert (base);
 
 	return base;
@@ -492,7 +595,7 @@ compare_one_setting (gpointer key, gpointer value, gpointer user_data)
 	if (info->failed)
 		return;
 
-	other_setting = nm_connection_get_setting (info->other, G_OBJECT_TYPE (setting));
+	other_setting = get_setting (info->other, G_OBJECT_TYPE (setting));
 	if (other_setting)
 		info->failed = nm_setting_compare (setting, other_setting, info->flags) ? FALSE : TRUE;
 	else
@@ -560,7 +663,7 @@ diff_one_connection (NMConnection *a,
 		gboolean new_results = TRUE;
 
 		if (b)
-			b_setting = nm_connection_get_setting (b, G_OBJECT_TYPE (a_setting));
+			b_setting = get_setting (b, G_OBJECT_TYPE (a_setting));
 
 		results = g_hash_table_lookup (diffs, setting_name);
 		if (results)
@@ -668,7 +771,7 @@ nm_connection_verify (NMConnection *connection, GError **error)
 	priv = NM_CONNECTION_GET_PRIVATE (connection);
 
 	/* First, make sure there's at least 'connection' setting */
-	s_con = nm_connection_get_setting_connection (connection);
+	s_con = (NMSettingConnection *) get_setting (connection, NM_TYPE_SETTING_CONNECTION);
 	if (!s_con) {
 		g_set_error_literal (error,
 		                     NM_CONNECTION_ERROR,
@@ -703,7 +806,7 @@ nm_connection_verify (NMConnection *connection, GError **error)
 		return FALSE;
 	}
 
-	base = nm_connection_get_setting_by_name (connection, ctype);
+	base = get_setting_by_name (connection, ctype);
 	if (!base) {
 		g_set_error_literal (error,
 		                     NM_CONNECTION_ERROR,
@@ -760,7 +863,7 @@ nm_connection_update_secrets (NMConnection *connection,
 
 	if (setting_name) {
 		/* Update just one setting */
-		setting = nm_connection_get_setting_by_name (connection, setting_name);
+		setting = get_setting_by_name (connection, setting_name);
 		if (!setting) {
 			g_set_error_literal (error,
 				                 NM_CONNECTION_ERROR,
@@ -768,6 +871,7 @@ nm_connection_update_secrets (NMConnection *connection,
 				                 setting_name);
 			return FALSE;
 		}
+		setting = unshare_setting (connection, setting);
 
 		/* Check if this is a hash of hashes, ie a full deserialized connection,
 		 * not just a single hashed setting.
@@ -783,7 +887,7 @@ nm_connection_update_secrets (NMConnection *connection,
 		/* Try as a serialized connection (GHashTable of GHashTables) */
 		g_hash_table_iter_init (&iter, secrets);
 		while (g_hash_table_iter_next (&iter, (gpointer) &name, (gpointer) &tmp)) {
-			setting = nm_connection_get_setting_by_name (connection, name);
+			setting = get_setting_by_name (connection, name);
 			if (!setting) {
 				g_set_error_literal (error,
 						             NM_CONNECTION_ERROR,
@@ -791,6 +895,7 @@ nm_connection_update_secrets (NMConnection *connection,
 						             name);
 				return FALSE;
 			}
+			setting = unshare_setting (connection, setting);
 
 			/* Update the secrets for this setting */
 			success = nm_setting_update_secrets (setting, tmp, error);
@@ -890,14 +995,14 @@ nm_connection_need_secrets (NMConnection *connection,
 void
 nm_connection_clear_secrets (NMConnection *connection)
 {
-	GHashTableIter iter;
-	NMSetting *setting;
+	GSList *settings, *iter;
 
 	g_return_if_fail (NM_IS_CONNECTION (connection));
 
-	g_hash_table_iter_init (&iter, NM_CONNECTION_GET_PRIVATE (connection)->settings);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &setting))
-		nm_setting_clear_secrets (setting);
+	settings = unshare_all_settings (connection);
+	for (iter = settings; iter; iter = g_slist_next (iter))
+		nm_setting_clear_secrets (NM_SETTING (iter->data));
+	g_slist_free (settings);
 
 	g_signal_emit (connection, signals[SECRETS_CLEARED], 0);
 }
@@ -916,14 +1021,14 @@ nm_connection_clear_secrets_with_flags (NMConnection *connection,
                                         NMSettingClearSecretsWithFlagsFn func,
                                         gpointer user_data)
 {
-	GHashTableIter iter;
-	NMSetting *setting;
+	GSList *settings, *iter;
 
 	g_return_if_fail (NM_IS_CONNECTION (connection));
 
-	g_hash_table_iter_init (&iter, NM_CONNECTION_GET_PRIVATE (connection)->settings);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &setting))
-		nm_setting_clear_secrets_with_flags (setting, func, user_data);
+	settings = unshare_all_settings (connection);
+	for (iter = settings; iter; iter = g_slist_next (iter))
+		nm_setting_clear_secrets_with_flags (NM_SETTING (iter->data), func, user_data);
+	g_slist_free (settings);
 
 	g_signal_emit (connection, signals[SECRETS_CLEARED], 0);
 }
@@ -1002,7 +1107,7 @@ nm_connection_is_type (NMConnection *connection, const char *type)
 	g_return_val_if_fail (NM_IS_CONNECTION (connection), FALSE);
 	g_return_val_if_fail (type != NULL, FALSE);
 
-	s_con = nm_connection_get_setting_connection (connection);
+	s_con = (NMSettingConnection *) get_setting (connection, NM_TYPE_SETTING_CONNECTION);
 	g_assert (s_con);
 
 	type2 = nm_setting_connection_get_connection_type (s_con);
@@ -1025,15 +1130,18 @@ nm_connection_for_each_setting_value (NMConnection *connection,
                                       NMSettingValueIterFn func,
                                       gpointer user_data)
 {
-	GHashTableIter iter;
-	gpointer value;
+	GSList *settings, *iter;
 
 	g_return_if_fail (NM_IS_CONNECTION (connection));
 	g_return_if_fail (func != NULL);
 
-	g_hash_table_iter_init (&iter, NM_CONNECTION_GET_PRIVATE (connection)->settings);
-	while (g_hash_table_iter_next (&iter, NULL, &value))
-		nm_setting_enumerate_values (NM_SETTING (value), func, user_data);
+	/* @func gets the settings themselves */
+	settings = unshare_all_settings (connection);
+	for (iter = settings; iter; iter = g_slist_next (iter)) {
+		_nm_setting_expose (NM_SETTING (iter->data));
+		nm_setting_enumerate_values (NM_SETTING (iter->data), func, user_data);
+	}
+	g_slist_free (settings);
 }
 
 static void
@@ -1179,14 +1287,22 @@ nm_connection_new_from_hash (GHashTable *hash, GError **error)
 static void
 duplicate_cb (gpointer key, gpointer value, gpointer user_data)
 {
-	nm_connection_add_setting (NM_CONNECTION (user_data), nm_setting_duplicate (NM_SETTING (value)));
+	NMSetting *setting = NM_SETTING (value);
+
+	if (_nm_setting_share (setting))
+		add_setting (NM_CONNECTION (user_data), g_object_ref (setting));
+	else
+		add_setting (NM_CONNECTION (user_data), nm_setting_duplicate (setting));
 }
 
 /**
  * nm_connection_duplicate:
  * @connection: the #NMConnection to duplicate
  *
- * Duplicates a #NMConnection.
+ * Duplicates a #NMConnection.  Settings that were never returned to a caller
+ * are not copied until either connection needs to change them or return them,
+ * so this is cheap for connections created by nm_connection_duplicate() or
+ * nm_connection_new_from_hash() that have not been accessed yet.
  *
  * Returns: (transfer full): a new #NMConnection containing the same settings and properties
  * as the source #NMConnection
@@ -1221,7 +1337,7 @@ nm_connection_get_uuid (NMConnection *connection)
 	g_return_val_if_fail (connection != NULL, NULL);
 	g_return_val_if_fail (NM_IS_CONNECTION (connection), NULL);
 
-	s_con = nm_connection_get_setting_connection (connection);
+	s_con = (NMSettingConnection *) get_setting (connection, NM_TYPE_SETTING_CONNECTION);
 	g_return_val_if_fail (s_con != NULL, NULL);
 
 	return nm_setting_connection_get_uuid (s_con);
@@ -1243,7 +1359,7 @@ nm_connection_get_id (NMConnection *connection)
 	g_return_val_if_fail (connection != NULL, NULL);
 	g_return_val_if_fail (NM_IS_CONNECTION (connection), NULL);
 
-	s_con = nm_connection_get_setting_connection (connection);
+	s_con = (NMSettingConnection *) get_setting (connection, NM_TYPE_SETTING_CONNECTION);
 	g_return_val_if_fail (s_con != NULL, NULL);
 
 	return nm_setting_connection_get_id (s_con);
@@ -1632,7 +1748,7 @@ nm_connection_init (NMConnection *connection)
 {
 	NMConnectionPrivate *priv = NM_CONNECTION_GET_PRIVATE (connection);
 
-	priv->settings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	priv->settings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, release_setting);
 }
 
 static void
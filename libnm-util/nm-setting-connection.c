@@ -1153,4 +1153,24 @@ nm_setting_connection_class_init (NMSettingConnectionClass *setting_class)
 		                             "when the base connection itself is activated.",
 		                             DBUS_TYPE_G_LIST_OF_STRING,
 		                             G_PARAM_READWRITE | NM_SETTING_PARAM_SERIALIZE | NM_SETTING_PARAM_FUZZY_IGNORE));
+
+	/* Properties read straight from the private struct */
+	_nm_setting_class_add_field (parent_class, NM_SETTING_CONNECTION_ID,
+	                             G_STRUCT_OFFSET (NMSettingConnectionPrivate, id));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_CONNECTION_UUID,
+	                             G_STRUCT_OFFSET (NMSettingConnectionPrivate, uuid));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_CONNECTION_TYPE,
+	                             G_STRUCT_OFFSET (NMSettingConnectionPrivate, type));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_CONNECTION_AUTOCONNECT,
+	                             G_STRUCT_OFFSET (NMSettingConnectionPrivate, autoconnect));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_CONNECTION_TIMESTAMP,
+	                             G_STRUCT_OFFSET (NMSettingConnectionPrivate, timestamp));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_CONNECTION_READ_ONLY,
+	                             G_STRUCT_OFFSET (NMSettingConnectionPrivate, read_only));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_CONNECTION_ZONE,
+	                             G_STRUCT_OFFSET (NMSettingConnectionPrivate, zone));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_CONNECTION_MASTER,
+	                             G_STRUCT_OFFSET (NMSettingConnectionPrivate, master));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_CONNECTION_SLAVE_TYPE,
+	                             G_STRUCT_OFFSET (NMSettingConnectionPrivate, slave_type));
 }
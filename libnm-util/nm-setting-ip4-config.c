@@ -1241,6 +1241,24 @@ nm_setting_ip4_config_class_init (NMSettingIP4ConfigClass *setting_class)
 						   "fails but IPv6 configuration completes successfully.",
 						   TRUE,
 						   G_PARAM_READWRITE | G_PARAM_CONSTRUCT | NM_SETTING_PARAM_SERIALIZE));
+
+	/* Properties read straight from the private struct */
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP4_CONFIG_METHOD,
+	                             G_STRUCT_OFFSET (NMSettingIP4ConfigPrivate, method));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP4_CONFIG_IGNORE_AUTO_ROUTES,
+	                             G_STRUCT_OFFSET (NMSettingIP4ConfigPrivate, ignore_auto_routes));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP4_CONFIG_IGNORE_AUTO_DNS,
+	                             G_STRUCT_OFFSET (NMSettingIP4ConfigPrivate, ignore_auto_dns));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP4_CONFIG_DHCP_CLIENT_ID,
+	                             G_STRUCT_OFFSET (NMSettingIP4ConfigPrivate, dhcp_client_id));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP4_CONFIG_DHCP_SEND_HOSTNAME,
+	                             G_STRUCT_OFFSET (NMSettingIP4ConfigPrivate, dhcp_send_hostname));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP4_CONFIG_DHCP_HOSTNAME,
+	                             G_STRUCT_OFFSET (NMSettingIP4ConfigPrivate, dhcp_hostname));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP4_CONFIG_NEVER_DEFAULT,
+	                             G_STRUCT_OFFSET (NMSettingIP4ConfigPrivate, never_default));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP4_CONFIG_MAY_FAIL,
+	                             G_STRUCT_OFFSET (NMSettingIP4ConfigPrivate, may_fail));
 }
 
 
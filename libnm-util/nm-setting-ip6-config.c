@@ -1149,6 +1149,19 @@ nm_setting_ip6_config_class_init (NMSettingIP6ConfigClass *setting_class)
 		                   NM_SETTING_IP6_CONFIG_PRIVACY_UNKNOWN,
 		                   G_PARAM_READWRITE | G_PARAM_CONSTRUCT | NM_SETTING_PARAM_SERIALIZE));
 
+	/* Properties read straight from the private struct */
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP6_CONFIG_METHOD,
+	                             G_STRUCT_OFFSET (NMSettingIP6ConfigPrivate, method));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP6_CONFIG_DHCP_HOSTNAME,
+	                             G_STRUCT_OFFSET (NMSettingIP6ConfigPrivate, dhcp_hostname));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP6_CONFIG_IGNORE_AUTO_ROUTES,
+	                             G_STRUCT_OFFSET (NMSettingIP6ConfigPrivate, ignore_auto_routes));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP6_CONFIG_IGNORE_AUTO_DNS,
+	                             G_STRUCT_OFFSET (NMSettingIP6ConfigPrivate, ignore_auto_dns));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP6_CONFIG_NEVER_DEFAULT,
+	                             G_STRUCT_OFFSET (NMSettingIP6ConfigPrivate, never_default));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_IP6_CONFIG_MAY_FAIL,
+	                             G_STRUCT_OFFSET (NMSettingIP6ConfigPrivate, may_fail));
 }
 
 /********************************************************************/
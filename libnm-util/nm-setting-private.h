@@ -21,6 +21,7 @@
 #ifndef NM_SETTING_PRIVATE_H
 #define NM_SETTING_PRIVATE_H
 
+#include "nm-setting.h"
 #include "nm-glib-compat.h"
 
 #define NM_SETTING_SECRET_FLAGS_ALL \
@@ -34,6 +35,16 @@ void _nm_register_setting (const char *name,
                            const guint32 priority,
                            const GQuark error_quark);
 
+void _nm_setting_class_add_field (NMSettingClass *setting_class,
+                                  const char *property_name,
+                                  gsize private_offset);
+
+/* Copy-on-write sharing of settings between duplicated connections */
+gboolean _nm_setting_share (NMSetting *setting);
+void     _nm_setting_unshare (NMSetting *setting);
+gboolean _nm_setting_is_shared (NMSetting *setting);
+void     _nm_setting_expose (NMSetting *setting);
+
 /* Ensure the setting's GType is registered at library load time */
 #define NM_SETTING_REGISTER_TYPE(x) \
 static void __attribute__((constructor)) register_setting (void) \
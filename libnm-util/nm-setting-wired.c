@@ -874,5 +874,23 @@ nm_setting_wired_class_init (NMSettingWiredClass *setting_class)
 							   "'layer2', 'portname', 'protocol', among others.",
 							   DBUS_TYPE_G_MAP_OF_STRING,
 							   G_PARAM_READWRITE | NM_SETTING_PARAM_SERIALIZE));
+
+	/* Properties read straight from the private struct */
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRED_PORT,
+	                             G_STRUCT_OFFSET (NMSettingWiredPrivate, port));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRED_SPEED,
+	                             G_STRUCT_OFFSET (NMSettingWiredPrivate, speed));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRED_DUPLEX,
+	                             G_STRUCT_OFFSET (NMSettingWiredPrivate, duplex));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRED_AUTO_NEGOTIATE,
+	                             G_STRUCT_OFFSET (NMSettingWiredPrivate, auto_negotiate));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRED_MAC_ADDRESS,
+	                             G_STRUCT_OFFSET (NMSettingWiredPrivate, device_mac_address));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRED_CLONED_MAC_ADDRESS,
+	                             G_STRUCT_OFFSET (NMSettingWiredPrivate, cloned_mac_address));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRED_MTU,
+	                             G_STRUCT_OFFSET (NMSettingWiredPrivate, mtu));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRED_S390_NETTYPE,
+	                             G_STRUCT_OFFSET (NMSettingWiredPrivate, s390_nettype));
 }
 
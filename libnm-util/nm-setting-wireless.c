@@ -1145,4 +1145,30 @@ nm_setting_wireless_class_init (NMSettingWirelessClass *setting_class)
 		                       "hidden SSID networks should be used with caution.",
 		                       FALSE,
 		                       G_PARAM_READWRITE | NM_SETTING_PARAM_SERIALIZE));
+
+	/* Properties read straight from the private struct */
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_SSID,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, ssid));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_MODE,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, mode));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_BAND,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, band));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_CHANNEL,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, channel));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_BSSID,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, bssid));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_RATE,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, rate));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_TX_POWER,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, tx_power));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_MAC_ADDRESS,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, device_mac_address));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_CLONED_MAC_ADDRESS,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, cloned_mac_address));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_MTU,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, mtu));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_SEC,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, security));
+	_nm_setting_class_add_field (parent_class, NM_SETTING_WIRELESS_HIDDEN,
+	                             G_STRUCT_OFFSET (NMSettingWirelessPrivate, hidden));
 }
@@ -24,11 +24,13 @@
  */
 
 #include <string.h>
+#include <dbus/dbus-glib.h>
 
 #include "nm-setting.h"
 #include "nm-setting-private.h"
 #include "nm-setting-connection.h"
 #include "nm-utils.h"
+#include "nm-dbus-glib-types.h"
 
 /**
  * SECTION:nm-setting
@@ -66,6 +68,11 @@ G_DEFINE_ABSTRACT_TYPE (NMSetting, nm_setting, G_TYPE_OBJECT)
 
 typedef struct {
 	char *name;
+
+	/* Number of extra connections holding the setting; see _nm_setting_share() */
+	volatile gint share_count;
+	/* Whether a pointer to the setting was ever handed out to a caller */
+	gboolean exposed;
 } NMSettingPrivate;
 
 enum {
@@ -75,6 +82,227 @@ enum {
 	PROP_LAST
 };
 
+/*****************************************************************************/
+/* Property tables
+ *
+ * Walking a class's properties with g_object_class_list_properties() and
+ * reading each one through g_object_get_property() is what most of the
+ * generic NMSetting code used to do on every call.  Instead, each setting
+ * type gets a table of its properties built on first use, and subclasses
+ * can tell us where the plain scalar, string and byte-array properties are
+ * stored in their private struct with _nm_setting_class_add_field(), so
+ * those can be compared and serialized without going through GValues.
+ */
+
+typedef enum {
+	FIELD_STRING,
+	FIELD_BOOLEAN,
+	FIELD_UINT,
+	FIELD_INT,
+	FIELD_UINT64,
+	FIELD_BYTES,
+} FieldType;
+
+typedef struct {
+	FieldType type;
+	GType owner_type;
+	gsize offset;
+} FieldInfo;
+
+typedef struct {
+	GParamSpec *pspec;
+	const FieldInfo *field;  /* NULL if only reachable as a GObject property */
+} PropertyInfo;
+
+typedef struct {
+	guint n_properties;
+	PropertyInfo *properties;
+} PropertyTable;
+
+static GQuark property_table_quark;
+static GQuark field_info_quark;
+
+G_LOCK_DEFINE_STATIC (property_tables);
+
+static const PropertyTable *
+get_property_table (NMSetting *setting)
+{
+	GType type = G_OBJECT_TYPE (setting);
+	PropertyTable *table;
+
+	table = g_type_get_qdata (type, property_table_quark);
+	if (G_LIKELY (table))
+		return table;
+
+	/* Settings may be created and serialized from several threads */
+	G_LOCK (property_tables);
+	table = g_type_get_qdata (type, property_table_quark);
+	if (!table) {
+		GParamSpec **property_specs;
+		guint i;
+
+		table = g_new0 (PropertyTable, 1);
+		property_specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (setting),
+		                                                 &table->n_properties);
+		table->properties = g_new0 (PropertyInfo, table->n_properties);
+		for (i = 0; i < table->n_properties; i++) {
+			table->properties[i].pspec = property_specs[i];
+			table->properties[i].field = g_param_spec_get_qdata (property_specs[i], field_info_quark);
+		}
+		g_free (property_specs);
+
+		/* Never freed; setting classes are never unloaded */
+		g_type_set_qdata (type, property_table_quark, table);
+	}
+	G_UNLOCK (property_tables);
+
+	return table;
+}
+
+/**
+ * _nm_setting_class_add_field:
+ * @setting_class: the setting class, from its class_init function
+ * @property_name: a property already installed on @setting_class
+ * @private_offset: offset of the property's value in the class's private
+ *   struct, eg G_STRUCT_OFFSET (NMSettingFooPrivate, bar)
+ *
+ * Registers where a property's value is stored so generic code can read it
+ * directly.  Only valid for string, boolean, (u)int, uint64 and
+ * DBUS_TYPE_G_UCHAR_ARRAY properties whose getter returns that field as is.
+ */
+void
+_nm_setting_class_add_field (NMSettingClass *setting_class,
+                             const char *property_name,
+                             gsize private_offset)
+{
+	GParamSpec *pspec;
+	FieldInfo *field;
+
+	pspec = g_object_class_find_property (G_OBJECT_CLASS (setting_class), property_name);
+	g_return_if_fail (pspec != NULL);
+
+	field = g_slice_new0 (FieldInfo);
+	field->owner_type = pspec->owner_type;
+	field->offset = private_offset;
+
+	if (pspec->value_type == G_TYPE_STRING)
+		field->type = FIELD_STRING;
+	else if (pspec->value_type == G_TYPE_BOOLEAN)
+		field->type = FIELD_BOOLEAN;
+	else if (pspec->value_type == G_TYPE_UINT)
+		field->type = FIELD_UINT;
+	else if (pspec->value_type == G_TYPE_INT)
+		field->type = FIELD_INT;
+	else if (pspec->value_type == G_TYPE_UINT64)
+		field->type = FIELD_UINT64;
+	else if (pspec->value_type == DBUS_TYPE_G_UCHAR_ARRAY)
+		field->type = FIELD_BYTES;
+	else {
+		g_warning ("%s: property '%s' of type '%s' can't be a field",
+		           __func__, property_name, g_type_name (pspec->value_type));
+		g_slice_free (FieldInfo, field);
+		return;
+	}
+
+	g_param_spec_set_qdata (pspec, field_info_quark, field);
+}
+
+#define FIELD_P(setting, field) \
+	G_STRUCT_MEMBER_P (g_type_instance_get_private ((GTypeInstance *) (setting), (field)->owner_type), \
+	                   (field)->offset)
+
+static gboolean
+field_equal (NMSetting *a, NMSetting *b, const FieldInfo *field)
+{
+	gpointer pa = FIELD_P (a, field);
+	gpointer pb = FIELD_P (b, field);
+
+	switch (field->type) {
+	case FIELD_STRING:
+		return g_strcmp0 (*(char **) pa, *(char **) pb) == 0;
+	case FIELD_BOOLEAN:
+		return !*(gboolean *) pa == !*(gboolean *) pb;
+	case FIELD_UINT:
+		return *(guint *) pa == *(guint *) pb;
+	case FIELD_INT:
+		return *(gint *) pa == *(gint *) pb;
+	case FIELD_UINT64:
+		return *(guint64 *) pa == *(guint64 *) pb;
+	case FIELD_BYTES: {
+		GByteArray *ba = *(GByteArray **) pa;
+		GByteArray *bb = *(GByteArray **) pb;
+
+		if (ba == bb)
+			return TRUE;
+		if (!ba || !bb || ba->len != bb->len)
+			return FALSE;
+		return memcmp (ba->data, bb->data, ba->len) == 0;
+	}
+	}
+	g_assert_not_reached ();
+	return FALSE;
+}
+
+static gboolean
+field_is_default (NMSetting *setting, const GParamSpec *pspec, const FieldInfo *field)
+{
+	gpointer p = FIELD_P (setting, field);
+
+	switch (field->type) {
+	case FIELD_STRING:
+		return g_strcmp0 (*(char **) p, G_PARAM_SPEC_STRING (pspec)->default_value) == 0;
+	case FIELD_BOOLEAN:
+		return !*(gboolean *) p == !G_PARAM_SPEC_BOOLEAN (pspec)->default_value;
+	case FIELD_UINT:
+		return *(guint *) p == G_PARAM_SPEC_UINT (pspec)->default_value;
+	case FIELD_INT:
+		return *(gint *) p == G_PARAM_SPEC_INT (pspec)->default_value;
+	case FIELD_UINT64:
+		return *(guint64 *) p == G_PARAM_SPEC_UINT64 (pspec)->default_value;
+	case FIELD_BYTES:
+		return *(GByteArray **) p == NULL;
+	}
+	g_assert_not_reached ();
+	return FALSE;
+}
+
+/* Like g_object_get_property(); @value must be initialized */
+static void
+get_property_value (NMSetting *setting, const PropertyInfo *info, GValue *value)
+{
+	const FieldInfo *field = info->field;
+	gpointer p;
+
+	if (!field) {
+		g_object_get_property (G_OBJECT (setting), info->pspec->name, value);
+		return;
+	}
+
+	p = FIELD_P (setting, field);
+	switch (field->type) {
+	case FIELD_STRING:
+		g_value_set_string (value, *(char **) p);
+		break;
+	case FIELD_BOOLEAN:
+		g_value_set_boolean (value, *(gboolean *) p);
+		break;
+	case FIELD_UINT:
+		g_value_set_uint (value, *(guint *) p);
+		break;
+	case FIELD_INT:
+		g_value_set_int (value, *(gint *) p);
+		break;
+	case FIELD_UINT64:
+		g_value_set_uint64 (value, *(guint64 *) p);
+		break;
+	case FIELD_BYTES:
+		g_value_set_boxed (value, *(GByteArray **) p);
+		break;
+	}
+}
+
+/*****************************************************************************/
+
 static void
 destroy_gvalue (gpointer data)
 {
@@ -100,15 +328,14 @@ GHashTable *
 nm_setting_to_hash (NMSetting *setting, NMSettingHashFlags flags)
 {
 	GHashTable *hash;
-	GParamSpec **property_specs;
-	guint n_property_specs;
+	const PropertyTable *table;
 	guint i;
 
 	g_return_val_if_fail (setting != NULL, NULL);
 	g_return_val_if_fail (NM_IS_SETTING (setting), NULL);
 
-	property_specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (setting), &n_property_specs);
-	if (!property_specs) {
+	table = get_property_table (setting);
+	if (!table->n_properties) {
 		g_warning ("%s: couldn't find property specs for object of type '%s'",
 		           __func__, g_type_name (G_OBJECT_TYPE (setting)));
 		return NULL;
@@ -117,8 +344,9 @@ nm_setting_to_hash (NMSetting *setting, NMSettingHashFlags flags)
 	hash = g_hash_table_new_full (g_str_hash, g_str_equal,
 	                              (GDestroyNotify) g_free, destroy_gvalue);
 
-	for (i = 0; i < n_property_specs; i++) {
-		GParamSpec *prop_spec = property_specs[i];
+	for (i = 0; i < table->n_properties; i++) {
+		const PropertyInfo *info = &table->properties[i];
+		GParamSpec *prop_spec = info->pspec;
 		GValue *value;
 
 		if (!(prop_spec->flags & NM_SETTING_PARAM_SERIALIZE))
@@ -132,17 +360,19 @@ nm_setting_to_hash (NMSetting *setting, NMSettingHashFlags flags)
 		    && !(prop_spec->flags & NM_SETTING_PARAM_SECRET))
 			continue;
 
+		/* Don't serialize values with default values */
+		if (info->field && field_is_default (setting, prop_spec, info->field))
+			continue;
+
 		value = g_slice_new0 (GValue);
 		g_value_init (value, prop_spec->value_type);
-		g_object_get_property (G_OBJECT (setting), prop_spec->name, value);
+		get_property_value (setting, info, value);
 
-		/* Don't serialize values with default values */
-		if (!g_param_value_defaults (prop_spec, value))
+		if (info->field || !g_param_value_defaults (prop_spec, value))
 			g_hash_table_insert (hash, g_strdup (prop_spec->name), value);
 		else
 			destroy_gvalue (value);
 	}
-	g_free (property_specs);
 
 	/* Don't return empty hashes */
 	if (g_hash_table_size (hash) < 1) {
@@ -267,6 +497,68 @@ nm_setting_duplicate (NMSetting *setting)
 	return NM_SETTING (dup);
 }
 
+/**
+ * _nm_setting_share:
+ * @setting: the #NMSetting
+ *
+ * Lets one more connection hold @setting, as long as nobody outside of
+ * #NMConnection could have a pointer to it and change it behind the
+ * connections' backs.  Each holder must call _nm_setting_unshare() when it
+ * drops the setting, and must replace the setting with a private copy
+ * before changing it or handing it out while _nm_setting_is_shared().
+ *
+ * Returns: %TRUE if @setting may be shared, %FALSE if it must be copied
+ **/
+gboolean
+_nm_setting_share (NMSetting *setting)
+{
+	NMSettingPrivate *priv = NM_SETTING_GET_PRIVATE (setting);
+
+	if (priv->exposed)
+		return FALSE;
+	g_atomic_int_inc (&priv->share_count);
+	return TRUE;
+}
+
+/**
+ * _nm_setting_unshare:
+ * @setting: the #NMSetting
+ *
+ * Called by a connection that drops its reference to @setting.
+ **/
+void
+_nm_setting_unshare (NMSetting *setting)
+{
+	NMSettingPrivate *priv = NM_SETTING_GET_PRIVATE (setting);
+	gint count;
+
+	do {
+		count = g_atomic_int_get (&priv->share_count);
+		if (count == 0)
+			return;
+	} while (!g_atomic_int_compare_and_exchange (&priv->share_count, count, count - 1));
+}
+
+gboolean
+_nm_setting_is_shared (NMSetting *setting)
+{
+	return g_atomic_int_get (&NM_SETTING_GET_PRIVATE (setting)->share_count) > 0;
+}
+
+/**
+ * _nm_setting_expose:
+ * @setting: the #NMSetting
+ *
+ * Marks @setting as known to callers, who may change it at any time, so it
+ * can no longer be shared.  @setting must not be shared.
+ **/
+void
+_nm_setting_expose (NMSetting *setting)
+{
+	g_warn_if_fail (!_nm_setting_is_shared (setting));
+	NM_SETTING_GET_PRIVATE (setting)->exposed = TRUE;
+}
+
 /**
  * nm_setting_get_name:
  * @setting: the #NMSetting
@@ -317,6 +609,7 @@ compare_property (NMSetting *setting,
 	              const GParamSpec *prop_spec,
 	              NMSettingCompareFlags flags)
 {
+	const FieldInfo *field;
 	GValue value1 = { 0 };
 	GValue value2 = { 0 };
 	gboolean different;
@@ -345,6 +638,10 @@ compare_property (NMSetting *setting,
 			return TRUE;
 	}
 
+	field = g_param_spec_get_qdata ((GParamSpec *) prop_spec, field_info_quark);
+	if (field)
+		return field_equal (setting, other, field);
+
 	g_value_init (&value1, prop_spec->value_type);
 	g_object_get_property (G_OBJECT (setting), prop_spec->name, &value1);
 
@@ -376,8 +673,7 @@ nm_setting_compare (NMSetting *a,
                     NMSetting *b,
                     NMSettingCompareFlags flags)
 {
-	GParamSpec **property_specs;
-	guint n_property_specs;
+	const PropertyTable *table;
 	gint same = TRUE;
 	guint i;
 
@@ -388,10 +684,13 @@ nm_setting_compare (NMSetting *a,
 	if (G_OBJECT_TYPE (a) != G_OBJECT_TYPE (b))
 		return FALSE;
 
+	if (a == b)
+		return TRUE;
+
 	/* And now all properties */
-	property_specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (a), &n_property_specs);
-	for (i = 0; i < n_property_specs && same; i++) {
-		GParamSpec *prop_spec = property_specs[i];
+	table = get_property_table (a);
+	for (i = 0; i < table->n_properties && same; i++) {
+		GParamSpec *prop_spec = table->properties[i].pspec;
 
 		/* Fuzzy compare ignores secrets and properties defined with the FUZZY_IGNORE flag */
 		if (   (flags & NM_SETTING_COMPARE_FLAG_FUZZY)
@@ -404,7 +703,6 @@ nm_setting_compare (NMSetting *a,
 
 		same = NM_SETTING_GET_CLASS (a)->compare_property (a, b, prop_spec, flags);
 	}
-	g_free (property_specs);
 
 	return same;
 }
@@ -473,8 +771,7 @@ nm_setting_diff (NMSetting *a,
                  gboolean invert_results,
                  GHashTable **results)
 {
-	GParamSpec **property_specs;
-	guint n_property_specs;
+	const PropertyTable *table;
 	guint i;
 	NMSettingDiffResult a_result = NM_SETTING_DIFF_RESULT_IN_A;
 	NMSettingDiffResult b_result = NM_SETTING_DIFF_RESULT_IN_B;
@@ -508,10 +805,11 @@ nm_setting_diff (NMSetting *a,
 	}
 
 	/* And now all properties */
-	property_specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (a), &n_property_specs);
+	table = get_property_table (a);
 
-	for (i = 0; i < n_property_specs; i++) {
-		GParamSpec *prop_spec = property_specs[i];
+	for (i = 0; i < table->n_properties; i++) {
+		const PropertyInfo *info = &table->properties[i];
+		GParamSpec *prop_spec = info->pspec;
 		GValue a_value = { 0 }, b_value = { 0 };
 		NMSettingDiffResult r = NM_SETTING_DIFF_RESULT_UNKNOWN, tmp;
 		gboolean different = TRUE;
@@ -522,7 +820,15 @@ nm_setting_diff (NMSetting *a,
 		if (strcmp (prop_spec->name, NM_SETTING_NAME) == 0)
 			continue;
 
-		if (b) {
+		if (b && info->field) {
+			different = !field_equal (a, b, info->field);
+			if (different) {
+				if (!field_is_default (a, prop_spec, info->field))
+					r |= a_result;
+				if (!field_is_default (b, prop_spec, info->field))
+					r |= b_result;
+			}
+		} else if (b) {
 			g_value_init (&a_value, prop_spec->value_type);
 			g_object_get_property (G_OBJECT (a), prop_spec->name, &a_value);
 
@@ -547,7 +853,6 @@ nm_setting_diff (NMSetting *a,
 			g_hash_table_insert (*results, g_strdup (prop_spec->name), GUINT_TO_POINTER (tmp | r));
 		}
 	}
-	g_free (property_specs);
 
 	/* Don't return an empty hash table */
 	if (results_created && !g_hash_table_size (*results)) {
@@ -572,25 +877,22 @@ nm_setting_enumerate_values (NMSetting *setting,
 					    NMSettingValueIterFn func,
 					    gpointer user_data)
 {
-	GParamSpec **property_specs;
-	guint n_property_specs;
-	int i;
+	const PropertyTable *table;
+	guint i;
 
 	g_return_if_fail (NM_IS_SETTING (setting));
 	g_return_if_fail (func != NULL);
 
-	property_specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (setting), &n_property_specs);
-	for (i = 0; i < n_property_specs; i++) {
-		GParamSpec *prop_spec = property_specs[i];
+	table = get_property_table (setting);
+	for (i = 0; i < table->n_properties; i++) {
+		const PropertyInfo *info = &table->properties[i];
 		GValue value = { 0 };
 
-		g_value_init (&value, G_PARAM_SPEC_VALUE_TYPE (prop_spec));
-		g_object_get_property (G_OBJECT (setting), prop_spec->name, &value);
-		func (setting, prop_spec->name, &value, prop_spec->flags, user_data);
+		g_value_init (&value, G_PARAM_SPEC_VALUE_TYPE (info->pspec));
+		get_property_value (setting, info, &value);
+		func (setting, info->pspec->name, &value, info->pspec->flags, user_data);
 		g_value_unset (&value);
 	}
-
-	g_free (property_specs);
 }
 
 /**
@@ -604,16 +906,15 @@ nm_setting_enumerate_values (NMSetting *setting,
 void
 nm_setting_clear_secrets (NMSetting *setting)
 {
-	GParamSpec **property_specs;
-	guint n_property_specs;
+	const PropertyTable *table;
 	guint i;
 
 	g_return_if_fail (NM_IS_SETTING (setting));
 
-	property_specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (setting), &n_property_specs);
+	table = get_property_table (setting);
 
-	for (i = 0; i < n_property_specs; i++) {
-		GParamSpec *prop_spec = property_specs[i];
+	for (i = 0; i < table->n_properties; i++) {
+		GParamSpec *prop_spec = table->properties[i].pspec;
 		GValue value = { 0 };
 
 		if (prop_spec->flags & NM_SETTING_PARAM_SECRET) {
@@ -623,8 +924,6 @@ nm_setting_clear_secrets (NMSetting *setting)
 			g_value_unset (&value);
 		}
 	}
-
-	g_free (property_specs);
 }
 
 static void
@@ -660,25 +959,24 @@ nm_setting_clear_secrets_with_flags (NMSetting *setting,
                                      NMSettingClearSecretsWithFlagsFn func,
                                      gpointer user_data)
 {
-	GParamSpec **property_specs;
-	guint n_property_specs;
+	const PropertyTable *table;
 	guint i;
 
 	g_return_if_fail (setting);
 	g_return_if_fail (NM_IS_SETTING (setting));
 	g_return_if_fail (func != NULL);
 
-	property_specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (setting), &n_property_specs);
-	for (i = 0; i < n_property_specs; i++) {
-		if (property_specs[i]->flags & NM_SETTING_PARAM_SECRET) {
+	table = get_property_table (setting);
+	for (i = 0; i < table->n_properties; i++) {
+		GParamSpec *prop_spec = table->properties[i].pspec;
+
+		if (prop_spec->flags & NM_SETTING_PARAM_SECRET) {
 			NM_SETTING_GET_CLASS (setting)->clear_secrets_with_flags (setting,
-			                                                          property_specs[i],
+			                                                          prop_spec,
 			                                                          func,
 			                                                          user_data);
 		}
 	}
-
-	g_free (property_specs);
 }
 
 /**
@@ -919,28 +1217,28 @@ char *
 nm_setting_to_string (NMSetting *setting)
 {
 	GString *string;
-	GParamSpec **property_specs;
-	guint n_property_specs;
+	const PropertyTable *table;
 	guint i;
 
 	g_return_val_if_fail (NM_IS_SETTING (setting), NULL);
 
-	property_specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (setting), &n_property_specs);
-	if (!property_specs)
+	table = get_property_table (setting);
+	if (!table->n_properties)
 		return NULL;
 
 	string = g_string_new (nm_setting_get_name (setting));
 	g_string_append_c (string, '\n');
 
-	for (i = 0; i < n_property_specs; i++) {
-		GParamSpec *prop_spec = property_specs[i];
+	for (i = 0; i < table->n_properties; i++) {
+		const PropertyInfo *info = &table->properties[i];
+		GParamSpec *prop_spec = info->pspec;
 		GValue value = { 0 };
 		char *value_str;
 		gboolean is_serializable;
 		gboolean is_default;
 
 		g_value_init (&value, prop_spec->value_type);
-		g_object_get_property (G_OBJECT (setting), prop_spec->name, &value);
+		get_property_value (setting, info, &value);
 
 		value_str = g_strdup_value_contents (&value);
 		g_string_append_printf (string, "\t%s : %s", prop_spec->name, value_str);
@@ -965,7 +1263,6 @@ nm_setting_to_string (NMSetting *setting)
 		g_string_append_c (string, '\n');
 	}
 
-	g_free (property_specs);
 	g_string_append_c (string, '\n');
 
 	return g_string_free (string, FALSE);
@@ -1073,6 +1370,9 @@ nm_setting_class_init (NMSettingClass *setting_class)
 
 	g_type_class_add_private (setting_class, sizeof (NMSettingPrivate));
 
+	property_table_quark = g_quark_from_static_string ("nm-setting-property-table");
+	field_info_quark = g_quark_from_static_string ("nm-setting-field-info");
+
 	/* virtual methods */
 	object_class->constructor  = constructor;
 	object_class->set_property = set_property;
@@ -1017,6 +1017,102 @@ test_connection_diff_no_secrets (void)
 	g_object_unref (b);
 }
 
+static NMConnection *
+new_shared_test_connection (void)
+{
+	NMConnection *connection, *tmp;
+	NMSetting *s_pppoe;
+	GHashTable *hash;
+	GError *error = NULL;
+
+	tmp = new_test_connection ();
+	s_pppoe = nm_setting_pppoe_new ();
+	g_object_set (G_OBJECT (s_pppoe),
+	              NM_SETTING_PPPOE_USERNAME, "thomas",
+	              NM_SETTING_PPPOE_PASSWORD, "secretpassword",
+	              NULL);
+	nm_connection_add_setting (tmp, s_pppoe);
+
+	/* Nobody has looked at the settings of a deserialized connection yet,
+	 * so its duplicates can share them.
+	 */
+	hash = nm_connection_to_hash (tmp, NM_SETTING_HASH_FLAG_ALL);
+	connection = nm_connection_new_from_hash (hash, &error);
+	g_assert_no_error (error);
+	g_assert (connection);
+
+	g_hash_table_destroy (hash);
+	g_object_unref (tmp);
+	return connection;
+}
+
+static const char *
+get_pppoe_password (NMConnection *connection)
+{
+	NMSettingPPPOE *s_pppoe;
+
+	s_pppoe = nm_connection_get_setting_pppoe (connection);
+	g_assert (s_pppoe);
+	return nm_setting_pppoe_get_password (s_pppoe);
+}
+
+static void
+test_connection_duplicate_shared (void)
+{
+	NMConnection *a, *b, *c;
+	NMSettingWired *s_wired_a, *s_wired_b;
+	NMSettingIP4Config *s_ip4;
+	GHashTable *secrets;
+	GError *error = NULL;
+	gboolean success;
+
+	a = new_shared_test_connection ();
+	b = nm_connection_duplicate (a);
+	g_assert (nm_connection_compare (a, b, NM_SETTING_COMPARE_FLAG_EXACT));
+	g_assert (nm_connection_verify (b, &error));
+	g_assert_no_error (error);
+	g_assert_cmpstr (nm_connection_get_uuid (a), ==, nm_connection_get_uuid (b));
+
+	/* Changing a duplicate's setting must not change the original */
+	s_wired_b = nm_connection_get_setting_wired (b);
+	g_object_set (G_OBJECT (s_wired_b), NM_SETTING_WIRED_MTU, 1400, NULL);
+	s_wired_a = nm_connection_get_setting_wired (a);
+	g_assert (s_wired_a != s_wired_b);
+	g_assert_cmpint (nm_setting_wired_get_mtu (s_wired_a), ==, 1592);
+	g_assert_cmpint (nm_setting_wired_get_mtu (s_wired_b), ==, 1400);
+	g_assert (!nm_connection_compare (a, b, NM_SETTING_COMPARE_FLAG_EXACT));
+
+	/* Nor must changing a setting the caller got before duplicating */
+	s_ip4 = nm_connection_get_setting_ip4_config (a);
+	c = nm_connection_duplicate (a);
+	g_object_set (G_OBJECT (s_ip4), NM_SETTING_IP4_CONFIG_DHCP_HOSTNAME, "changed", NULL);
+	g_assert_cmpstr (nm_setting_ip4_config_get_dhcp_hostname (nm_connection_get_setting_ip4_config (c)),
+	                 ==, "eyeofthetiger");
+	g_object_unref (c);
+
+	/* Secrets are cleared and updated separately */
+	c = nm_connection_duplicate (b);
+	nm_connection_clear_secrets (c);
+	g_assert_cmpstr (get_pppoe_password (c), ==, NULL);
+	g_assert_cmpstr (get_pppoe_password (b), ==, "secretpassword");
+
+	secrets = nm_connection_to_hash (b, NM_SETTING_HASH_FLAG_ONLY_SECRETS);
+	g_assert (secrets);
+	success = nm_connection_update_secrets (c, NULL, secrets, &error);
+	g_assert_no_error (error);
+	g_assert (success);
+	g_hash_table_destroy (secrets);
+	g_assert_cmpstr (get_pppoe_password (c), ==, "secretpassword");
+
+	/* Duplicates stay valid after the original goes away */
+	g_object_unref (a);
+	g_object_unref (b);
+	g_assert (nm_connection_verify (c, &error));
+	g_assert_no_error (error);
+	g_assert_cmpint (nm_setting_wired_get_mtu (nm_connection_get_setting_wired (c)), ==, 1400);
+	g_object_unref (c);
+}
+
 static void
 add_generic_settings (NMConnection *connection, const char *ctype)
 {
@@ -1401,6 +1497,7 @@ int main (int argc, char **argv)
 	test_connection_diff_same ();
 	test_connection_diff_different ();
 	test_connection_diff_no_secrets ();
+	test_connection_duplicate_shared ();
 	test_connection_good_base_types ();
 	test_connection_bad_base_types ();
 
@@ -0,0 +1,262 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ */
+
+/* Microbenchmark for the generic NMSetting code the daemon runs on every
+ * settings update and GetSettings call: times comparing, hashing and
+ * duplicating typical wired and wireless connections.
+ * Usage: test-setting-benchmark [ITERATIONS]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/ether.h>
+
+#include <glib.h>
+#include <dbus/dbus-glib.h>
+
+#include "nm-test-helpers.h"
+#include <nm-utils.h>
+
+#include "nm-setting-connection.h"
+#include "nm-setting-wired.h"
+#include "nm-setting-wireless.h"
+#include "nm-setting-ip4-config.h"
+#include "nm-setting-ip6-config.h"
+
+#define DEFAULT_ITERATIONS 20000
+
+static GByteArray *
+mac_to_array (const char *mac)
+{
+	struct ether_addr *addr;
+	GByteArray *array;
+
+	addr = ether_aton (mac);
+	ASSERT (addr != NULL, "setting-benchmark", "invalid MAC address %s", mac);
+	array = g_byte_array_sized_new (ETH_ALEN);
+	g_byte_array_append (array, (guint8 *) addr->ether_addr_octet, ETH_ALEN);
+	return array;
+}
+
+static void
+add_ip_settings (NMConnection *connection)
+{
+	NMSettingIP4Config *s_ip4;
+	NMSettingIP6Config *s_ip6;
+	NMIP4Address *addr4;
+	NMIP6Address *addr6;
+	struct in6_addr in6;
+	guint32 in4;
+
+	s_ip4 = (NMSettingIP4Config *) nm_setting_ip4_config_new ();
+	g_object_set (G_OBJECT (s_ip4),
+	              NM_SETTING_IP4_CONFIG_METHOD, NM_SETTING_IP4_CONFIG_METHOD_MANUAL,
+	              NM_SETTING_IP4_CONFIG_DHCP_HOSTNAME, "benchmark",
+	              NM_SETTING_IP4_CONFIG_IGNORE_AUTO_DNS, TRUE,
+	              NM_SETTING_IP4_CONFIG_MAY_FAIL, FALSE,
+	              NULL);
+	addr4 = nm_ip4_address_new ();
+	inet_pton (AF_INET, "192.168.1.5", &in4);
+	nm_ip4_address_set_address (addr4, in4);
+	nm_ip4_address_set_prefix (addr4, 24);
+	inet_pton (AF_INET, "192.168.1.1", &in4);
+	nm_ip4_address_set_gateway (addr4, in4);
+	nm_setting_ip4_config_add_address (s_ip4, addr4);
+	nm_ip4_address_unref (addr4);
+	inet_pton (AF_INET, "192.168.1.53", &in4);
+	nm_setting_ip4_config_add_dns (s_ip4, in4);
+	nm_setting_ip4_config_add_dns_search (s_ip4, "example.com");
+	nm_connection_add_setting (connection, NM_SETTING (s_ip4));
+
+	s_ip6 = (NMSettingIP6Config *) nm_setting_ip6_config_new ();
+	g_object_set (G_OBJECT (s_ip6),
+	              NM_SETTING_IP6_CONFIG_METHOD, NM_SETTING_IP6_CONFIG_METHOD_MANUAL,
+	              NM_SETTING_IP6_CONFIG_NEVER_DEFAULT, TRUE,
+	              NULL);
+	addr6 = nm_ip6_address_new ();
+	inet_pton (AF_INET6, "2001:db8::5", &in6);
+	nm_ip6_address_set_address (addr6, &in6);
+	nm_ip6_address_set_prefix (addr6, 64);
+	nm_setting_ip6_config_add_address (s_ip6, addr6);
+	nm_ip6_address_unref (addr6);
+	nm_connection_add_setting (connection, NM_SETTING (s_ip6));
+}
+
+static NMConnection *
+new_connection (const char *type, const char *id)
+{
+	NMConnection *connection;
+	NMSettingConnection *s_con;
+	char *uuid;
+
+	connection = nm_connection_new ();
+
+	s_con = (NMSettingConnection *) nm_setting_connection_new ();
+	uuid = nm_utils_uuid_generate ();
+	g_object_set (G_OBJECT (s_con),
+	              NM_SETTING_CONNECTION_ID, id,
+	              NM_SETTING_CONNECTION_UUID, uuid,
+	              NM_SETTING_CONNECTION_TYPE, type,
+	              NM_SETTING_CONNECTION_TIMESTAMP, (guint64) 1234567890,
+	              NM_SETTING_CONNECTION_ZONE, "work",
+	              NULL);
+	g_free (uuid);
+	nm_connection_add_setting (connection, NM_SETTING (s_con));
+
+	return connection;
+}
+
+static NMConnection *
+new_wired (void)
+{
+	NMConnection *connection;
+	NMSettingWired *s_wired;
+	GByteArray *mac;
+
+	connection = new_connection (NM_SETTING_WIRED_SETTING_NAME, "Wired benchmark");
+
+	s_wired = (NMSettingWired *) nm_setting_wired_new ();
+	mac = mac_to_array ("00:11:22:33:44:55");
+	g_object_set (G_OBJECT (s_wired),
+	              NM_SETTING_WIRED_MAC_ADDRESS, mac,
+	              NM_SETTING_WIRED_MTU, 1500,
+	              NM_SETTING_WIRED_DUPLEX, "full",
+	              NM_SETTING_WIRED_SPEED, 1000,
+	              NULL);
+	g_byte_array_free (mac, TRUE);
+	nm_connection_add_setting (connection, NM_SETTING (s_wired));
+
+	add_ip_settings (connection);
+	return connection;
+}
+
+static NMConnection *
+new_wireless (void)
+{
+	NMConnection *connection;
+	NMSettingWireless *s_wifi;
+	GByteArray *ssid, *mac;
+
+	connection = new_connection (NM_SETTING_WIRELESS_SETTING_NAME, "Wireless benchmark");
+
+	s_wifi = (NMSettingWireless *) nm_setting_wireless_new ();
+	ssid = g_byte_array_new ();
+	g_byte_array_append (ssid, (const guint8 *) "benchmark-ssid", strlen ("benchmark-ssid"));
+	mac = mac_to_array ("00:11:22:33:44:66");
+	g_object_set (G_OBJECT (s_wifi),
+	              NM_SETTING_WIRELESS_SSID, ssid,
+	              NM_SETTING_WIRELESS_MODE, NM_SETTING_WIRELESS_MODE_INFRA,
+	              NM_SETTING_WIRELESS_MAC_ADDRESS, mac,
+	              NM_SETTING_WIRELESS_BAND, "a",
+	              NM_SETTING_WIRELESS_CHANNEL, 36,
+	              NULL);
+	g_byte_array_free (ssid, TRUE);
+	g_byte_array_free (mac, TRUE);
+	nm_connection_add_setting (connection, NM_SETTING (s_wifi));
+
+	add_ip_settings (connection);
+	return connection;
+}
+
+static void
+report (const char *base, const char *what, GTimer *timer, guint iterations)
+{
+	fprintf (stdout, "%s: %-10s %u iterations in %.3f s (%.2f us/iteration)\n",
+	         base, what, iterations, g_timer_elapsed (timer, NULL),
+	         iterations ? g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC / iterations : 0.0);
+}
+
+static void
+benchmark_connection (const char *base, const char *name, NMConnection *connection, guint iterations)
+{
+	NMConnection *copy;
+	GHashTable *hash;
+	GTimer *timer;
+	char *what;
+	guint i;
+
+	copy = nm_connection_duplicate (connection);
+	ASSERT (nm_connection_compare (connection, copy, NM_SETTING_COMPARE_FLAG_EXACT) == TRUE,
+	        "setting-benchmark", "%s: duplicate doesn't compare equal", name);
+
+	timer = g_timer_new ();
+
+	g_timer_start (timer);
+	for (i = 0; i < iterations; i++)
+		nm_connection_compare (connection, copy, NM_SETTING_COMPARE_FLAG_EXACT);
+	g_timer_stop (timer);
+	what = g_strdup_printf ("%s compare", name);
+	report (base, what, timer, iterations);
+	g_free (what);
+
+	g_timer_start (timer);
+	for (i = 0; i < iterations; i++) {
+		hash = nm_connection_to_hash (connection, NM_SETTING_HASH_FLAG_ALL);
+		g_hash_table_destroy (hash);
+	}
+	g_timer_stop (timer);
+	what = g_strdup_printf ("%s to_hash", name);
+	report (base, what, timer, iterations);
+	g_free (what);
+
+	g_timer_start (timer);
+	for (i = 0; i < iterations; i++)
+		g_object_unref (nm_connection_duplicate (connection));
+	g_timer_stop (timer);
+	what = g_strdup_printf ("%s duplicate", name);
+	report (base, what, timer, iterations);
+	g_free (what);
+
+	g_timer_destroy (timer);
+	g_object_unref (copy);
+}
+
+int main (int argc, char **argv)
+{
+	GError *error = NULL;
+	NMConnection *connection;
+	guint iterations = DEFAULT_ITERATIONS;
+	char *base;
+
+	g_type_init ();
+
+	if (!nm_utils_init (&error))
+		FAIL ("nm-utils-init", "failed to initialize libnm-util: %s", error->message);
+
+	if (argc > 1)
+		iterations = strtoul (argv[1], NULL, 10);
+
+	base = g_path_get_basename (argv[0]);
+
+	connection = new_wired ();
+	benchmark_connection (base, "wired", connection, iterations);
+	g_object_unref (connection);
+
+	connection = new_wireless ();
+	benchmark_connection (base, "wireless", connection, iterations);
+	g_object_unref (connection);
+
+	fprintf (stdout, "%s: SUCCESS\n", base);
+	g_free (base);
+	return 0;
+}
@@ -208,42 +208,24 @@ nm_utils_merge_ip4_config (NMIP4Config *ip4_config, NMSettingIP4Config *setting)
 	/* IPv4 addresses */
 	for (i = 0; i < nm_setting_ip4_config_get_num_addresses (setting); i++) {
 		NMIP4Address *setting_addr = nm_setting_ip4_config_get_address (setting, i);
-		guint32 num;
 
-		num = nm_ip4_config_get_num_addresses (ip4_config);
-		for (j = 0; j < num; j++) {
-			NMIP4Address *cfg_addr = nm_ip4_config_get_address (ip4_config, j);
-
-			/* Dupe, override with user-specified address */
-			if (nm_ip4_address_get_address (cfg_addr) == nm_ip4_address_get_address (setting_addr)) {
-				nm_ip4_config_replace_address (ip4_config, j, setting_addr);
-				break;
-			}
-		}
-
-		if (j == num)
+		/* Dupe, override with user-specified address */
+		j = nm_ip4_config_find_address (ip4_config, setting_addr);
+		if (j >= 0)
+			nm_ip4_config_replace_address (ip4_config, j, setting_addr);
+		else
 			nm_ip4_config_add_address (ip4_config, setting_addr);
 	}
 
 	/* IPv4 routes */
 	for (i = 0; i < nm_setting_ip4_config_get_num_routes (setting); i++) {
 		NMIP4Route *setting_route = nm_setting_ip4_config_get_route (setting, i);
-		guint32 num;
 
-		num = nm_ip4_config_get_num_routes (ip4_config);
-		for (j = 0; j < num; j++) {
-			NMIP4Route *cfg_route = nm_ip4_config_get_route (ip4_config, j);
-
-			/* Dupe, override with user-specified route */
-			if (   (nm_ip4_route_get_dest (cfg_route) == nm_ip4_route_get_dest (setting_route))
-			    && (nm_ip4_route_get_prefix (cfg_route) == nm_ip4_route_get_prefix (setting_route))
-			    && (nm_ip4_route_get_next_hop (cfg_route) == nm_ip4_route_get_next_hop (setting_route))) {
-				nm_ip4_config_replace_route (ip4_config, j, setting_route);
-				break;
-			}
-		}
-
-		if (j == num)
+		/* Dupe, override with user-specified route */
+		j = nm_ip4_config_find_route (ip4_config, setting_route);
+		if (j >= 0)
+			nm_ip4_config_replace_route (ip4_config, j, setting_route);
+		else
 			nm_ip4_config_add_route (ip4_config, setting_route);
 	}
 
@@ -320,42 +302,24 @@ nm_utils_merge_ip6_config (NMIP6Config *ip6_config, NMSettingIP6Config *setting)
 	/* IPv6 addresses */
 	for (i = 0; i < nm_setting_ip6_config_get_num_addresses (setting); i++) {
 		NMIP6Address *setting_addr = nm_setting_ip6_config_get_address (setting, i);
-		guint32 num;
 
-		num = nm_ip6_config_get_num_addresses (ip6_config);
-		for (j = 0; j < num; j++) {
-			NMIP6Address *cfg_addr = nm_ip6_config_get_address (ip6_config, j);
-
-			/* Dupe, override with user-specified address */
-			if (ip6_addresses_equal (nm_ip6_address_get_address (cfg_addr), nm_ip6_address_get_address (setting_addr))) {
-				nm_ip6_config_replace_address (ip6_config, j, setting_addr);
-				break;
-			}
-		}
-
-		if (j == num)
+		/* Dupe, override with user-specified address */
+		j = nm_ip6_config_find_address (ip6_config, setting_addr);
+		if (j >= 0)
+			nm_ip6_config_replace_address (ip6_config, j, setting_addr);
+		else
 			nm_ip6_config_add_address (ip6_config, setting_addr);
 	}
 
 	/* IPv6 routes */
 	for (i = 0; i < nm_setting_ip6_config_get_num_routes (setting); i++) {
 		NMIP6Route *setting_route = nm_setting_ip6_config_get_route (setting, i);
-		guint32 num;
 
-		num = nm_ip6_config_get_num_routes (ip6_config);
-		for (j = 0; j < num; j++) {
-			NMIP6Route *cfg_route = nm_ip6_config_get_route (ip6_config, j);
-
-			/* Dupe, override with user-specified route */
-			if (   ip6_addresses_equal (nm_ip6_route_get_dest (cfg_route), nm_ip6_route_get_dest (setting_route))
-			    && (nm_ip6_route_get_prefix (cfg_route) == nm_ip6_route_get_prefix (setting_route))
-				&& ip6_addresses_equal (nm_ip6_route_get_next_hop (cfg_route), nm_ip6_route_get_next_hop (setting_route))) {
-				nm_ip6_config_replace_route (ip6_config, j, setting_route);
-				break;
-			}
-		}
-
-		if (j == num)
+		/* Dupe, override with user-specified route */
+		j = nm_ip6_config_find_route (ip6_config, setting_route);
+		if (j >= 0)
+			nm_ip6_config_replace_route (ip6_config, j, setting_route);
+		else
 			nm_ip6_config_add_route (ip6_config, setting_route);
 	}
 
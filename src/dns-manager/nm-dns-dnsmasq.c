@@ -25,11 +25,14 @@
 #include <sys/wait.h>
 #include <arpa/inet.h>
 #include <sys/stat.h>
+#include <string.h>
 
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <dbus/dbus.h>
 
 #include "nm-dns-dnsmasq.h"
+#include "nm-dbus-manager.h"
 #include "nm-logging.h"
 #include "nm-ip4-config.h"
 #include "nm-ip6-config.h"
@@ -43,8 +46,47 @@ G_DEFINE_TYPE (NMDnsDnsmasq, nm_dns_dnsmasq, NM_TYPE_DNS_PLUGIN)
 #define CONFFILE NMRUNDIR "/dnsmasq.conf"
 #define CONFDIR NMCONFDIR "/dnsmasq.d"
 
+#define DNSMASQ_DBUS_SERVICE   "org.freedesktop.NetworkManager.dnsmasq"
+#define DNSMASQ_DBUS_PATH      "/uk/org/thekelleys/dnsmasq"
+#define DNSMASQ_DBUS_INTERFACE "uk.org.thekelleys.dnsmasq"
+
+/* Seconds a fresh dnsmasq gets to accept its servers over D-Bus */
+#define READY_TIMEOUT 5
+
 typedef struct {
-	guint32 foo;
+	NMDBusManager *dbus_mgr;
+	guint name_owner_id;
+	gboolean on_bus;
+
+	/* Replacements for the dnsmasq binary, its files and the system bus;
+	 * only the tests set 'binary' and 'bus'.
+	 */
+	char *binary;
+	char *conffile;
+	char *pidfile;
+	DBusConnection *bus;
+
+	/* Whether the dnsmasq binary was built with D-Bus support */
+	gboolean dbus_probed;
+	gboolean have_dbus;
+
+	/* TRUE if the running dnsmasq was started with --enable-dbus and gets
+	 * its servers through SetServers; FALSE if it reads them from CONFFILE.
+	 */
+	gboolean use_dbus;
+
+	/* TRUE once the running dnsmasq has upstream servers to forward to */
+	gboolean ready;
+
+	/* Server configuration last handed to the running dnsmasq */
+	char *conf;
+
+	/* SetServers call waiting for dnsmasq to show up on the bus */
+	DBusMessage *pending;
+	DBusPendingCall *call;
+
+	guint ready_timeout_id;
+	guint fallback_id;
 } NMDnsDnsmasqPrivate;
 
 /*******************************************/
@@ -68,73 +110,42 @@ find_dnsmasq (void)
 	return NULL;
 }
 
-static gboolean
-add_ip4_config (GString *str, NMIP4Config *ip4, gboolean split)
+static const char *
+get_binary (NMDnsDnsmasq *self)
 {
-	char buf[INET_ADDRSTRLEN + 1];
-	struct in_addr addr;
-	int n, i;
-	gboolean added = FALSE;
-
-	if (split) {
-		char **domains, **iter;
-
-		if (nm_ip4_config_get_num_nameservers (ip4) == 0)
-			return FALSE;
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
 
-		/* FIXME: it appears that dnsmasq can only handle one nameserver
-		 * per domain (and the manpage says this too) so only use the first
-		 * nameserver here.
-		 */
-		addr.s_addr = nm_ip4_config_get_nameserver (ip4, 0);
-		memset (&buf[0], 0, sizeof (buf));
-		if (!inet_ntop (AF_INET, &addr, buf, sizeof (buf)))
-			return FALSE;
-
-		/* searches are preferred over domains */
-		n = nm_ip4_config_get_num_searches (ip4);
-		for (i = 0; i < n; i++) {
-			g_string_append_printf (str, "server=/%s/%s\n",
-				                    nm_ip4_config_get_search (ip4, i),
-				                    buf);
-			added = TRUE;
-		}
-
-		if (n == 0) {
-			/* If not searches, use any domains */
-			n = nm_ip4_config_get_num_domains (ip4);
-			for (i = 0; i < n; i++) {
-				g_string_append_printf (str, "server=/%s/%s\n",
-							            nm_ip4_config_get_domain (ip4, i),
-							            buf);
-				added = TRUE;
-			}
-		}
-
-		/* Ensure reverse-DNS works by directing queries for in-addr.arpa
-		 * domains to the split domain's nameserver.
-		 */
-		domains = nm_dns_utils_get_ip4_rdns_domains (ip4);
-		if (domains) {
-			for (iter = domains; iter && *iter; iter++)
-				g_string_append_printf (str, "server=/%s/%s\n", *iter, buf);
-			g_strfreev (domains);
-			added = TRUE;
-		}
-	}
+	return priv->binary ? priv->binary : find_dnsmasq ();
+}
 
-	/* If no searches or domains, just add the namservers */
-	if (!added) {
-		n = nm_ip4_config_get_num_nameservers (ip4);
-		for (i = 0; i < n; i++) {
-			memset (&buf[0], 0, sizeof (buf));
-			addr.s_addr = nm_ip4_config_get_nameserver (ip4, i);
-			if (inet_ntop (AF_INET, &addr, buf, sizeof (buf)))
-				g_string_append_printf (str, "server=%s\n", buf);
-		}
+static gboolean
+dnsmasq_has_dbus (const char *dm_binary)
+{
+	const char *argv[] = { dm_binary, "--version", NULL };
+	char *output = NULL, **options, **iter;
+	const char *p;
+	gboolean found = FALSE;
+	int status;
+
+	if (!dm_binary)
+		return FALSE;
+
+	if (!g_spawn_sync (NULL, (char **) argv, NULL, G_SPAWN_STDERR_TO_DEV_NULL,
+	                   NULL, NULL, &output, NULL, &status, NULL))
+		return FALSE;
+
+	/* dnsmasq lists "DBus" among its compile time options, or "no-DBus" */
+	p = output ? strstr (output, "Compile time options:") : NULL;
+	if (WIFEXITED (status) && WEXITSTATUS (status) == 0 && p) {
+		p += strlen ("Compile time options:");
+		options = g_strsplit_set (p, " \t\n", -1);
+		for (iter = options; *iter && !found; iter++)
+			found = !strcmp (*iter, "DBus");
+		g_strfreev (options);
 	}
 
-	return TRUE;
+	g_free (output);
+	return found;
 }
 
 #define IP6_ADDR_BUFLEN (INET6_ADDRSTRLEN + 50)
@@ -182,144 +193,311 @@ error:
 	return NULL;
 }
 
-static gboolean
-add_ip6_config (GString *str, NMIP6Config *ip6, gboolean split)
+/* Each server is written both as dnsmasq.conf "server=" lines and as
+ * arguments of dnsmasq's D-Bus SetServers method: an address (a UINT32 for
+ * IPv4, 16 bytes for IPv6) followed by the domains it should be used for.
+ */
+typedef struct {
+	GString *conf;
+	DBusMessage *msg;
+	DBusMessageIter iter;
+	gboolean need_conf;
+} Servers;
+
+static void
+add_server (Servers *servers,
+            int family,
+            gconstpointer addr,
+            const char *iface,
+            GPtrArray *domains)
 {
-	const struct in6_addr *addr;
-	char *buf;
+	char *str = NULL;
+	guint i;
+
+	if (family == AF_INET6 && IN6_IS_ADDR_V4MAPPED ((const struct in6_addr *) addr)) {
+		family = AF_INET;
+		addr = &((const struct in6_addr *) addr)->s6_addr32[3];
+	}
+
+	if (family == AF_INET) {
+		guint32 addr4;
+
+		str = g_malloc0 (INET_ADDRSTRLEN + 1);
+		if (!inet_ntop (AF_INET, addr, str, INET_ADDRSTRLEN)) {
+			g_free (str);
+			return;
+		}
+
+		/* dnsmasq converts the address with ntohl() */
+		addr4 = ntohl (*(const guint32 *) addr);
+		dbus_message_iter_append_basic (&servers->iter, DBUS_TYPE_UINT32, &addr4);
+	} else {
+		const struct in6_addr *addr6 = addr;
+		guint8 byte;
+		int j;
+
+		str = ip6_addr_to_string (addr6, iface);
+		if (!str)
+			return;
+
+		/* SetServers has no way to pass the scope of link-local servers */
+		if (IN6_IS_ADDR_LINKLOCAL (addr6))
+			servers->need_conf = TRUE;
+
+		/* dnsmasq wants the address as 16 consecutive BYTE arguments */
+		for (j = 0; j < 16; j++) {
+			byte = addr6->s6_addr[j];
+			dbus_message_iter_append_basic (&servers->iter, DBUS_TYPE_BYTE, &byte);
+		}
+	}
+
+	for (i = 0; domains && i < domains->len; i++) {
+		const char *domain = g_ptr_array_index (domains, i);
+
+		g_string_append_printf (servers->conf, "server=/%s/%s\n", domain, str);
+		dbus_message_iter_append_basic (&servers->iter, DBUS_TYPE_STRING, &domain);
+	}
+	if (!domains || !domains->len)
+		g_string_append_printf (servers->conf, "server=%s\n", str);
+
+	g_free (str);
+}
+
+static void
+add_ip4_config (Servers *servers, NMIP4Config *ip4, gboolean split)
+{
+	GPtrArray *domains;
+	char **rdns, **iter;
+	guint32 addr;
 	int n, i;
-	gboolean added = FALSE;
+
+	if (split) {
+		if (nm_ip4_config_get_num_nameservers (ip4) == 0)
+			return;
+
+		domains = g_ptr_array_sized_new (5);
+
+		/* searches are preferred over domains */
+		n = nm_ip4_config_get_num_searches (ip4);
+		for (i = 0; i < n; i++)
+			g_ptr_array_add (domains, (gpointer) nm_ip4_config_get_search (ip4, i));
+
+		if (n == 0) {
+			/* If not searches, use any domains */
+			n = nm_ip4_config_get_num_domains (ip4);
+			for (i = 0; i < n; i++)
+				g_ptr_array_add (domains, (gpointer) nm_ip4_config_get_domain (ip4, i));
+		}
+
+		/* Ensure reverse-DNS works by directing queries for in-addr.arpa
+		 * domains to the split domain's nameserver.
+		 */
+		rdns = nm_dns_utils_get_ip4_rdns_domains (ip4);
+		for (iter = rdns; iter && *iter; iter++)
+			g_ptr_array_add (domains, *iter);
+
+		/* FIXME: it appears that dnsmasq can only handle one nameserver
+		 * per domain (and the manpage says this too) so only use the first
+		 * nameserver here.
+		 */
+		if (domains->len) {
+			addr = nm_ip4_config_get_nameserver (ip4, 0);
+			add_server (servers, AF_INET, &addr, NULL, domains);
+		}
+
+		n = domains->len;
+		g_ptr_array_free (domains, TRUE);
+		g_strfreev (rdns);
+		if (n)
+			return;
+	}
+
+	/* If no searches or domains, just add the namservers */
+	n = nm_ip4_config_get_num_nameservers (ip4);
+	for (i = 0; i < n; i++) {
+		addr = nm_ip4_config_get_nameserver (ip4, i);
+		add_server (servers, AF_INET, &addr, NULL, NULL);
+	}
+}
+
+static void
+add_ip6_config (Servers *servers, NMIP6Config *ip6, gboolean split)
+{
+	GPtrArray *domains;
 	const char *iface;
+	int n, i;
 
 	iface = g_object_get_data (G_OBJECT (ip6), IP_CONFIG_IFACE_TAG);
 	g_assert (iface);
 
 	if (split) {
 		if (nm_ip6_config_get_num_nameservers (ip6) == 0)
-			return FALSE;
+			return;
 
-		/* FIXME: it appears that dnsmasq can only handle one nameserver
-		 * per domain (at least the manpage seems to indicate that) so only use
-		 * the first nameserver here.
-		 */
-		addr = nm_ip6_config_get_nameserver (ip6, 0);
-		buf = ip6_addr_to_string (addr, iface);
-		if (!buf)
-			return FALSE;
+		domains = g_ptr_array_sized_new (5);
 
 		/* searches are preferred over domains */
 		n = nm_ip6_config_get_num_searches (ip6);
-		for (i = 0; i < n; i++) {
-			g_string_append_printf (str, "server=/%s/%s\n",
-				                    nm_ip6_config_get_search (ip6, i),
-				                    buf);
-			added = TRUE;
-		}
+		for (i = 0; i < n; i++)
+			g_ptr_array_add (domains, (gpointer) nm_ip6_config_get_search (ip6, i));
 
 		if (n == 0) {
 			/* If not searches, use any domains */
 			n = nm_ip6_config_get_num_domains (ip6);
-			for (i = 0; i < n; i++) {
-				g_string_append_printf (str, "server=/%s/%s\n",
-							            nm_ip6_config_get_domain (ip6, i),
-							            buf);
-				added = TRUE;
-			}
+			for (i = 0; i < n; i++)
+				g_ptr_array_add (domains, (gpointer) nm_ip6_config_get_domain (ip6, i));
 		}
 
-		g_free (buf);
-	}
+		/* FIXME: it appears that dnsmasq can only handle one nameserver
+		 * per domain (at least the manpage seems to indicate that) so only use
+		 * the first nameserver here.
+		 */
+		if (domains->len)
+			add_server (servers, AF_INET6, nm_ip6_config_get_nameserver (ip6, 0), iface, domains);
 
-	/* If no searches or domains, just add the namservers */
-	if (!added) {
-		n = nm_ip6_config_get_num_nameservers (ip6);
-		for (i = 0; i < n; i++) {
-			addr = nm_ip6_config_get_nameserver (ip6, i);
-			buf = ip6_addr_to_string (addr, iface);
-			if (buf) {
-				g_string_append_printf (str, "server=%s\n", buf);
-				g_free (buf);
-			}
-		}
+		n = domains->len;
+		g_ptr_array_free (domains, TRUE);
+		if (n)
+			return;
 	}
 
-	return TRUE;
+	/* If no searches or domains, just add the namservers */
+	n = nm_ip6_config_get_num_nameservers (ip6);
+	for (i = 0; i < n; i++)
+		add_server (servers, AF_INET6, nm_ip6_config_get_nameserver (ip6, i), iface, NULL);
 }
 
-static gboolean
-update (NMDnsPlugin *plugin,
-        const GSList *vpn_configs,
-        const GSList *dev_configs,
-        const GSList *other_configs,
-        const char *hostname)
+static void
+add_configs (Servers *servers, const GSList *configs, gboolean split)
 {
-	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (plugin);
-	GString *conf;
-	GSList *iter;
-	const char *argv[15];
-	GError *error = NULL;
-	int ignored;
-	GPid pid = 0;
-	guint idx = 0;
-
-	/* Kill the old dnsmasq; there doesn't appear to be a way to get dnsmasq
-	 * to reread the config file using SIGHUP or similar.  This is a small race
-	 * here when restarting dnsmasq when DNS requests could go to the upstream
-	 * servers instead of to dnsmasq.
-	 */
-	nm_dns_plugin_child_kill (plugin);
-
-	/* Build up the new dnsmasq config file */
-	conf = g_string_sized_new (150);
+	const GSList *iter;
 
-	/* Use split DNS for VPN configs */
-	for (iter = (GSList *) vpn_configs; iter; iter = g_slist_next (iter)) {
+	for (iter = configs; iter; iter = g_slist_next (iter)) {
 		if (NM_IS_IP4_CONFIG (iter->data))
-			add_ip4_config (conf, NM_IP4_CONFIG (iter->data), TRUE);
+			add_ip4_config (servers, NM_IP4_CONFIG (iter->data), split);
 		else if (NM_IS_IP6_CONFIG (iter->data))
-			add_ip6_config (conf, NM_IP6_CONFIG (iter->data), TRUE);
+			add_ip6_config (servers, NM_IP6_CONFIG (iter->data), split);
 	}
+}
+
+static void
+build_servers (Servers *servers,
+               const GSList *vpn_configs,
+               const GSList *dev_configs,
+               const GSList *other_configs)
+{
+	memset (servers, 0, sizeof (*servers));
+	servers->conf = g_string_sized_new (150);
+	servers->msg = dbus_message_new_method_call (DNSMASQ_DBUS_SERVICE,
+	                                             DNSMASQ_DBUS_PATH,
+	                                             DNSMASQ_DBUS_INTERFACE,
+	                                             "SetServers");
+	dbus_message_iter_init_append (servers->msg, &servers->iter);
+
+	/* Use split DNS for VPN configs */
+	add_configs (servers, vpn_configs, TRUE);
 
 	/* Now add interface configs without split DNS */
-	for (iter = (GSList *) dev_configs; iter; iter = g_slist_next (iter)) {
-		if (NM_IS_IP4_CONFIG (iter->data))
-			add_ip4_config (conf, NM_IP4_CONFIG (iter->data), FALSE);
-		else if (NM_IS_IP6_CONFIG (iter->data))
-			add_ip6_config (conf, NM_IP6_CONFIG (iter->data), FALSE);
-	}
+	add_configs (servers, dev_configs, FALSE);
 
 	/* And any other random configs */
-	for (iter = (GSList *) other_configs; iter; iter = g_slist_next (iter)) {
-		if (NM_IS_IP4_CONFIG (iter->data))
-			add_ip4_config (conf, NM_IP4_CONFIG (iter->data), FALSE);
-		else if (NM_IS_IP6_CONFIG (iter->data))
-			add_ip6_config (conf, NM_IP6_CONFIG (iter->data), FALSE);
+	add_configs (servers, other_configs, FALSE);
+}
+
+DBusMessage *
+nm_dns_dnsmasq_test_build_set_servers (const GSList *vpn_configs,
+                                       const GSList *dev_configs,
+                                       const GSList *other_configs)
+{
+	Servers servers;
+
+	build_servers (&servers, vpn_configs, dev_configs, other_configs);
+	g_string_free (servers.conf, TRUE);
+	return servers.msg;
+}
+
+static void
+clear_pending (NMDnsDnsmasq *self)
+{
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+
+	if (priv->call) {
+		dbus_pending_call_cancel (priv->call);
+		dbus_pending_call_unref (priv->call);
+		priv->call = NULL;
 	}
+	if (priv->pending) {
+		dbus_message_unref (priv->pending);
+		priv->pending = NULL;
+	}
+}
+
+static void
+clear_ready_timeout (NMDnsDnsmasq *self)
+{
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+
+	if (priv->ready_timeout_id) {
+		g_source_remove (priv->ready_timeout_id);
+		priv->ready_timeout_id = 0;
+	}
+}
+
+static void fall_back_to_conf (NMDnsDnsmasq *self);
 
-	/* Write out the config file */
-	if (!g_file_set_contents (CONFFILE, conf->str, -1, &error)) {
+static gboolean
+ready_timeout_cb (gpointer user_data)
+{
+	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (user_data);
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+
+	priv->ready_timeout_id = 0;
+
+	nm_log_warn (LOGD_DNS, "dnsmasq: servers not accepted over D-Bus after %d seconds; not using D-Bus",
+	             READY_TIMEOUT);
+	fall_back_to_conf (self);
+	return FALSE;
+}
+
+static gboolean
+start_dnsmasq (NMDnsDnsmasq *self)
+{
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+	const char *argv[16];
+	char *pidfile_arg, *conffile_arg;
+	GError *error = NULL;
+	int ignored;
+	GPid pid;
+	guint idx = 0;
+
+	/* Servers from the config file can't be replaced over D-Bus later, so
+	 * they only go there when dnsmasq doesn't take them over D-Bus.
+	 */
+	if (!g_file_set_contents (priv->conffile, priv->use_dbus ? "" : priv->conf, -1, &error)) {
 		nm_log_warn (LOGD_DNS, "Failed to write dnsmasq config file %s: (%d) %s",
-		             CONFFILE,
+		             priv->conffile,
 		             error ? error->code : -1,
 		             error && error->message ? error->message : "(unknown)");
 		g_clear_error (&error);
-		goto out;
+		return FALSE;
 	}
-	ignored = chmod (CONFFILE, 0644);
+	ignored = chmod (priv->conffile, 0644);
 
-	nm_log_dbg (LOGD_DNS, "dnsmasq local caching DNS configuration:");
-	nm_log_dbg (LOGD_DNS, "%s", conf->str);
+	pidfile_arg = g_strdup_printf ("--pid-file=%s", priv->pidfile);
+	conffile_arg = g_strdup_printf ("--conf-file=%s", priv->conffile);
 
-	argv[idx++] = find_dnsmasq ();
+	argv[idx++] = get_binary (self);
 	argv[idx++] = "--no-resolv";  /* Use only commandline */
 	argv[idx++] = "--keep-in-foreground";
 	argv[idx++] = "--no-hosts"; /* don't use /etc/hosts to resolve */
 	argv[idx++] = "--bind-interfaces";
-	argv[idx++] = "--pid-file=" PIDFILE;
+	argv[idx++] = pidfile_arg;
 	argv[idx++] = "--listen-address=127.0.0.1"; /* Should work for both 4 and 6 */
-	argv[idx++] = "--conf-file=" CONFFILE;
+	argv[idx++] = conffile_arg;
 	argv[idx++] = "--cache-size=400";
 	argv[idx++] = "--proxy-dnssec"; /* Allow DNSSEC to pass through */
+	if (priv->use_dbus)
+		argv[idx++] = "--enable-dbus=" DNSMASQ_DBUS_SERVICE;
 
 	/* dnsmasq exits if the conf dir is not present */
 	if (g_file_test (CONFDIR, G_FILE_TEST_IS_DIR))
@@ -328,14 +506,220 @@ update (NMDnsPlugin *plugin,
 	argv[idx++] = NULL;
 	g_warn_if_fail (idx <= G_N_ELEMENTS (argv));
 
-	/* And finally spawn dnsmasq */
-	pid = nm_dns_plugin_child_spawn (NM_DNS_PLUGIN (self), argv, PIDFILE, "bin/dnsmasq");
+	/* And finally spawn dnsmasq.  Over D-Bus it has no servers until
+	 * SetServers succeeds, so it isn't used until then.
+	 */
+	priv->on_bus = FALSE;
+	priv->ready = !priv->use_dbus;
+	pid = nm_dns_plugin_child_spawn (NM_DNS_PLUGIN (self), argv, priv->pidfile, "bin/dnsmasq");
+
+	g_free (pidfile_arg);
+	g_free (conffile_arg);
+
+	if (pid && priv->use_dbus)
+		priv->ready_timeout_id = g_timeout_add_seconds (READY_TIMEOUT, ready_timeout_cb, self);
 
-out:
-	g_string_free (conf, TRUE);
 	return pid ? TRUE : FALSE;
 }
 
+static gboolean
+fallback_cb (gpointer user_data)
+{
+	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (user_data);
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+
+	priv->fallback_id = 0;
+
+	nm_log_info (LOGD_DNS, "dnsmasq: restarting with servers from its config file");
+	nm_dns_plugin_child_kill (NM_DNS_PLUGIN (self));
+
+	if (start_dnsmasq (self))
+		g_signal_emit_by_name (self, NM_DNS_PLUGIN_READY);
+	else
+		g_signal_emit_by_name (self, NM_DNS_PLUGIN_FAILED);
+	return FALSE;
+}
+
+/* Stop using D-Bus for the rest of the run and restart dnsmasq with the
+ * servers in the config file, like before dnsmasq could be updated live.
+ */
+static void
+fall_back_to_conf (NMDnsDnsmasq *self)
+{
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+
+	priv->have_dbus = FALSE;
+	priv->use_dbus = FALSE;
+	priv->ready = FALSE;
+	clear_pending (self);
+	clear_ready_timeout (self);
+
+	if (!priv->fallback_id)
+		priv->fallback_id = g_idle_add (fallback_cb, self);
+}
+
+static void
+set_servers_done (DBusPendingCall *call, void *user_data)
+{
+	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (user_data);
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+	DBusMessage *reply;
+
+	g_return_if_fail (call == priv->call);
+
+	reply = dbus_pending_call_steal_reply (call);
+	dbus_pending_call_unref (priv->call);
+	priv->call = NULL;
+
+	if (!reply || dbus_message_get_type (reply) == DBUS_MESSAGE_TYPE_ERROR) {
+		nm_log_warn (LOGD_DNS, "dnsmasq: SetServers failed: %s",
+		             reply ? dbus_message_get_error_name (reply) : "no reply");
+		fall_back_to_conf (self);
+	} else if (!priv->ready) {
+		nm_log_dbg (LOGD_DNS, "dnsmasq: servers set; now in use");
+		clear_ready_timeout (self);
+		priv->ready = TRUE;
+		g_signal_emit_by_name (self, NM_DNS_PLUGIN_READY);
+	}
+
+	if (reply)
+		dbus_message_unref (reply);
+}
+
+static void
+send_pending (NMDnsDnsmasq *self)
+{
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+	DBusConnection *connection;
+
+	if (!priv->pending)
+		return;
+
+	/* A newer server list replaces any call still in flight */
+	if (priv->call) {
+		dbus_pending_call_cancel (priv->call);
+		dbus_pending_call_unref (priv->call);
+		priv->call = NULL;
+	}
+
+	if (priv->bus)
+		connection = priv->bus;
+	else
+		connection = nm_dbus_manager_get_dbus_connection (priv->dbus_mgr);
+	nm_log_dbg (LOGD_DNS, "dnsmasq: updating servers over D-Bus");
+	if (   !connection
+	    || !dbus_connection_send_with_reply (connection, priv->pending, &priv->call, -1)
+	    || !priv->call) {
+		nm_log_warn (LOGD_DNS, "Failed to send new servers to dnsmasq");
+		fall_back_to_conf (self);
+		return;
+	}
+	dbus_pending_call_set_notify (priv->call, set_servers_done, self, NULL);
+
+	dbus_message_unref (priv->pending);
+	priv->pending = NULL;
+}
+
+static void
+name_owner_changed (NMDBusManager *dbus_mgr,
+                    const char *name,
+                    const char *old_owner,
+                    const char *new_owner,
+                    gpointer user_data)
+{
+	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (user_data);
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+
+	if (strcmp (name, DNSMASQ_DBUS_SERVICE) != 0)
+		return;
+
+	priv->on_bus = (new_owner && strlen (new_owner));
+	if (priv->on_bus)
+		send_pending (self);
+}
+
+static gboolean
+update (NMDnsPlugin *plugin,
+        const GSList *vpn_configs,
+        const GSList *dev_configs,
+        const GSList *other_configs,
+        const char *hostname)
+{
+	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (plugin);
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+	Servers servers;
+	gboolean running, success;
+
+	build_servers (&servers, vpn_configs, dev_configs, other_configs);
+
+	nm_log_dbg (LOGD_DNS, "dnsmasq local caching DNS configuration:");
+	nm_log_dbg (LOGD_DNS, "%s", servers.conf->str);
+
+	if (!priv->dbus_probed) {
+		priv->have_dbus = dnsmasq_has_dbus (get_binary (self));
+		priv->dbus_probed = TRUE;
+		if (!priv->have_dbus)
+			nm_log_info (LOGD_DNS, "dnsmasq has no D-Bus support; it will be restarted on DNS changes");
+	}
+
+	running = nm_dns_plugin_child_pid (plugin) && !priv->fallback_id;
+	if (running && !g_strcmp0 (priv->conf, servers.conf->str)) {
+		success = TRUE;
+		goto out;
+	}
+
+	/* Push the new servers into the running dnsmasq, which keeps its cache
+	 * and never leaves a window where queries go straight upstream.  It only
+	 * needs restarting when it has died, when it can't be reached over D-Bus,
+	 * or when link-local servers have to go through the config file.
+	 */
+	if (running && priv->use_dbus && !servers.need_conf) {
+		g_free (priv->conf);
+		priv->conf = g_string_free (servers.conf, FALSE);
+		servers.conf = NULL;
+
+		if (priv->pending)
+			dbus_message_unref (priv->pending);
+		priv->pending = servers.msg;
+		servers.msg = NULL;
+		if (priv->on_bus)
+			send_pending (self);
+
+		success = TRUE;
+		goto out;
+	}
+
+	nm_dns_plugin_child_kill (plugin);
+	clear_pending (self);
+	clear_ready_timeout (self);
+	if (priv->fallback_id) {
+		g_source_remove (priv->fallback_id);
+		priv->fallback_id = 0;
+	}
+
+	g_free (priv->conf);
+	priv->conf = g_string_free (servers.conf, FALSE);
+	servers.conf = NULL;
+
+	priv->use_dbus = priv->have_dbus && !servers.need_conf;
+	if (priv->use_dbus) {
+		priv->pending = servers.msg;
+		servers.msg = NULL;
+	}
+
+	/* Over D-Bus, is_pending() holds back resolv.conf until dnsmasq has
+	 * accepted its servers and emitted 'ready'.
+	 */
+	success = start_dnsmasq (self);
+
+out:
+	if (servers.conf)
+		g_string_free (servers.conf, TRUE);
+	if (servers.msg)
+		dbus_message_unref (servers.msg);
+	return success;
+}
+
 /****************************************************************/
 
 static const char *
@@ -360,12 +744,24 @@ static void
 child_quit (NMDnsPlugin *plugin, gint status)
 {
 	NMDnsDnsmasq *self = NM_DNS_DNSMASQ (plugin);
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
 	gboolean failed = TRUE;
 	int err;
 
+	priv->ready = FALSE;
+	clear_ready_timeout (self);
+
 	if (WIFEXITED (status)) {
 		err = WEXITSTATUS (status);
-		if (err) {
+		if (err == 1 && priv->use_dbus) {
+			/* Most likely dnsmasq couldn't set up D-Bus after all */
+			nm_log_warn (LOGD_DNS, "dnsmasq exited with error: %s (%d); not using D-Bus",
+			             dm_exit_code_to_msg (err),
+			             err);
+			unlink (priv->conffile);
+			fall_back_to_conf (self);
+			return;
+		} else if (err) {
 			nm_log_warn (LOGD_DNS, "dnsmasq exited with error: %s (%d)",
 			             dm_exit_code_to_msg (err),
 			             err);
@@ -378,7 +774,7 @@ child_quit (NMDnsPlugin *plugin, gint status)
 	} else {
 		nm_log_warn (LOGD_DNS, "dnsmasq died from an unknown cause");
 	}
-	unlink (CONFFILE);
+	unlink (priv->conffile);
 
 	if (failed)
 		g_signal_emit_by_name (self, NM_DNS_PLUGIN_FAILED);
@@ -398,6 +794,15 @@ is_caching (NMDnsPlugin *plugin)
 	return TRUE;
 }
 
+static gboolean
+is_pending (NMDnsPlugin *plugin)
+{
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (plugin);
+
+	/* Restarting, or started but still waiting for its servers */
+	return priv->fallback_id || (nm_dns_plugin_child_pid (plugin) && !priv->ready);
+}
+
 static const char *
 get_name (NMDnsPlugin *plugin)
 {
@@ -412,15 +817,104 @@ nm_dns_dnsmasq_new (void)
 	return (NMDnsDnsmasq *) g_object_new (NM_TYPE_DNS_DNSMASQ, NULL);
 }
 
+#define NAME_OWNER_MATCH \
+	"type='signal',interface='" DBUS_INTERFACE_DBUS "',member='NameOwnerChanged',arg0='" DNSMASQ_DBUS_SERVICE "'"
+
+static DBusHandlerResult
+test_bus_filter (DBusConnection *connection, DBusMessage *message, void *user_data)
+{
+	const char *name, *old_owner, *new_owner;
+
+	if (   dbus_message_is_signal (message, DBUS_INTERFACE_DBUS, "NameOwnerChanged")
+	    && dbus_message_get_args (message, NULL,
+	                              DBUS_TYPE_STRING, &name,
+	                              DBUS_TYPE_STRING, &old_owner,
+	                              DBUS_TYPE_STRING, &new_owner,
+	                              DBUS_TYPE_INVALID))
+		name_owner_changed (NULL, name, old_owner, new_owner, user_data);
+
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+NMDnsDnsmasq *
+nm_dns_dnsmasq_test_new (const char *binary, const char *rundir, DBusConnection *bus)
+{
+	NMDnsDnsmasq *self = nm_dns_dnsmasq_new ();
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+
+	priv->binary = g_strdup (binary);
+	g_free (priv->conffile);
+	priv->conffile = g_build_filename (rundir, "dnsmasq.conf", NULL);
+	g_free (priv->pidfile);
+	priv->pidfile = g_build_filename (rundir, "dnsmasq.pid", NULL);
+
+	priv->bus = dbus_connection_ref (bus);
+	dbus_bus_add_match (bus, NAME_OWNER_MATCH, NULL);
+	dbus_connection_add_filter (bus, test_bus_filter, self, NULL);
+
+	return self;
+}
+
+const char *
+nm_dns_dnsmasq_test_get_conffile (NMDnsDnsmasq *self)
+{
+	return NM_DNS_DNSMASQ_GET_PRIVATE (self)->conffile;
+}
+
 static void
 nm_dns_dnsmasq_init (NMDnsDnsmasq *self)
 {
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+
+	priv->conffile = g_strdup (CONFFILE);
+	priv->pidfile = g_strdup (PIDFILE);
+
+	priv->dbus_mgr = nm_dbus_manager_get ();
+	priv->name_owner_id = g_signal_connect (priv->dbus_mgr,
+	                                        NM_DBUS_MANAGER_NAME_OWNER_CHANGED,
+	                                        G_CALLBACK (name_owner_changed),
+	                                        self);
 }
 
 static void
 dispose (GObject *object)
 {
-	unlink (CONFFILE);
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (object);
+
+	if (priv->dbus_mgr) {
+		if (priv->name_owner_id)
+			g_signal_handler_disconnect (priv->dbus_mgr, priv->name_owner_id);
+		priv->name_owner_id = 0;
+		g_object_unref (priv->dbus_mgr);
+		priv->dbus_mgr = NULL;
+	}
+
+	if (priv->bus) {
+		dbus_connection_remove_filter (priv->bus, test_bus_filter, object);
+		dbus_bus_remove_match (priv->bus, NAME_OWNER_MATCH, NULL);
+		dbus_connection_unref (priv->bus);
+		priv->bus = NULL;
+	}
+
+	clear_pending (NM_DNS_DNSMASQ (object));
+	clear_ready_timeout (NM_DNS_DNSMASQ (object));
+	if (priv->fallback_id) {
+		g_source_remove (priv->fallback_id);
+		priv->fallback_id = 0;
+	}
+
+	g_free (priv->conf);
+	priv->conf = NULL;
+
+	if (priv->conffile) {
+		unlink (priv->conffile);
+		g_free (priv->conffile);
+		priv->conffile = NULL;
+	}
+	g_free (priv->pidfile);
+	priv->pidfile = NULL;
+	g_free (priv->binary);
+	priv->binary = NULL;
 
 	G_OBJECT_CLASS (nm_dns_dnsmasq_parent_class)->dispose (object);
 }
@@ -438,6 +932,7 @@ nm_dns_dnsmasq_class_init (NMDnsDnsmasqClass *dns_class)
 	plugin_class->init = init;
 	plugin_class->child_quit = child_quit;
 	plugin_class->is_caching = is_caching;
+	plugin_class->is_pending = is_pending;
 	plugin_class->update = update;
 	plugin_class->get_name = get_name;
 }
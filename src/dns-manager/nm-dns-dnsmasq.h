@@ -21,6 +21,7 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <dbus/dbus.h>
 
 #include "nm-dns-plugin.h"
 
@@ -43,5 +44,19 @@ GType nm_dns_dnsmasq_get_type (void);
 
 NMDnsDnsmasq *nm_dns_dnsmasq_new (void);
 
+/* For testing only; returns the SetServers call for the given configs */
+DBusMessage *nm_dns_dnsmasq_test_build_set_servers (const GSList *vpn_configs,
+                                                    const GSList *dev_configs,
+                                                    const GSList *other_configs);
+
+/* For testing only; runs 'binary' in place of dnsmasq, keeps its files in
+ * 'rundir' and reaches it over 'bus' instead of the system bus.
+ */
+NMDnsDnsmasq *nm_dns_dnsmasq_test_new (const char *binary,
+                                       const char *rundir,
+                                       DBusConnection *bus);
+
+const char *nm_dns_dnsmasq_test_get_conffile (NMDnsDnsmasq *self);
+
 #endif /* NM_DNS_DNSMASQ_H */
 
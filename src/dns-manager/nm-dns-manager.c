@@ -72,6 +72,12 @@ typedef struct {
 	guint8 hash[HASH_LEN];  /* SHA1 hash of current DNS config */
 	guint8 prev_hash[HASH_LEN];  /* Hash when begin_updates() was called */
 
+	/* SHA1 hash of the last resolv.conf contents successfully handed to
+	 * resolvconf, netconfig or written out directly.
+	 */
+	guint8 resolv_hash[HASH_LEN];
+	gboolean resolv_hash_valid;
+
 	GSList *plugins;
 
 	gboolean dns_touched;
@@ -86,32 +92,59 @@ enum {
 static guint signals[LAST_SIGNAL] = { 0 };
 
 
+/* An ordered set of strings: the array keeps insertion order, the hash
+ * table (which doesn't own its keys) makes the duplicate check O(1).
+ */
+typedef struct {
+	GPtrArray *items;
+	GHashTable *seen;
+} StringSet;
+
 typedef struct {
-	GPtrArray *nameservers;
+	StringSet nameservers;
 	const char *domain;
-	GPtrArray *searches;
+	StringSet searches;
 	const char *nis_domain;
-	GPtrArray *nis_servers;
+	StringSet nis_servers;
 } NMResolvConfData;
 
 static void
-add_string_item (GPtrArray *array, const char *str)
+string_set_init (StringSet *set)
 {
-	int i;
+	set->items = g_ptr_array_new ();
+	set->seen = g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+/* Returns the items as a NULL-terminated string array, or NULL if empty */
+static char **
+string_set_free (StringSet *set)
+{
+	g_hash_table_destroy (set->seen);
+	set->seen = NULL;
+
+	if (set->items->len == 0) {
+		g_ptr_array_free (set->items, TRUE);
+		return NULL;
+	}
+	g_ptr_array_add (set->items, NULL);
+	return (char **) g_ptr_array_free (set->items, FALSE);
+}
 
-	g_return_if_fail (array != NULL);
+static void
+add_string_item (StringSet *set, const char *str)
+{
+	char *copy;
+
+	g_return_if_fail (set != NULL);
 	g_return_if_fail (str != NULL);
 
 	/* Check for dupes before adding */
-	for (i = 0; i < array->len; i++) {
-		const char *candidate = g_ptr_array_index (array, i);
-
-		if (candidate && !strcmp (candidate, str))
-			return;
-	}
+	if (g_hash_table_lookup (set->seen, str))
+		return;
 
-	/* No dupes, add the new item */
-	g_ptr_array_add (array, g_strdup (str));
+	copy = g_strdup (str);
+	g_ptr_array_add (set->items, copy);
+	g_hash_table_insert (set->seen, copy, copy);
 }
 
 static void
@@ -126,7 +159,7 @@ merge_one_ip4_config (NMResolvConfData *rc, NMIP4Config *src)
 
 		addr.s_addr = nm_ip4_config_get_nameserver (src, i);
 		if (inet_ntop (AF_INET, &addr, buf, INET_ADDRSTRLEN) > 0)
-			add_string_item (rc->nameservers, buf);
+			add_string_item (&rc->nameservers, buf);
 	}
 
 	num = nm_ip4_config_get_num_domains (src);
@@ -136,12 +169,12 @@ merge_one_ip4_config (NMResolvConfData *rc, NMIP4Config *src)
 		domain = nm_ip4_config_get_domain (src, i);
 		if (!rc->domain)
 			rc->domain = domain;
-		add_string_item (rc->searches, domain);
+		add_string_item (&rc->searches, domain);
 	}
 
 	num = nm_ip4_config_get_num_searches (src);
 	for (i = 0; i < num; i++)
-		add_string_item (rc->searches, nm_ip4_config_get_search (src, i));
+		add_string_item (&rc->searches, nm_ip4_config_get_search (src, i));
 
 	/* NIS stuff */
 	num = nm_ip4_config_get_num_nis_servers (src);
@@ -151,7 +184,7 @@ merge_one_ip4_config (NMResolvConfData *rc, NMIP4Config *src)
 
 		addr.s_addr = nm_ip4_config_get_nis_server (src, i);
 		if (inet_ntop (AF_INET, &addr, buf, INET_ADDRSTRLEN) > 0)
-			add_string_item (rc->nis_servers, buf);
+			add_string_item (&rc->nis_servers, buf);
 	}
 
 	if (nm_ip4_config_get_nis_domain (src)) {
@@ -181,15 +214,15 @@ merge_one_ip6_config (NMResolvConfData *rc, NMIP6Config *src)
 		/* inet_ntop is probably supposed to do this for us, but it doesn't */
 		if (IN6_IS_ADDR_V4MAPPED (addr)) {
 			if (inet_ntop (AF_INET, &(addr->s6_addr32[3]), buf, INET_ADDRSTRLEN) > 0)
-				add_string_item (rc->nameservers, buf);
+				add_string_item (&rc->nameservers, buf);
 		} else {
 			if (inet_ntop (AF_INET6, addr, buf, INET6_ADDRSTRLEN) > 0) {
 				if (IN6_IS_ADDR_LINKLOCAL (addr) && strchr (buf, '%') == NULL) {
 					tmp = g_strdup_printf ("%s%%%s", buf, iface);
-					add_string_item (rc->nameservers, tmp);
+					add_string_item (&rc->nameservers, tmp);
 					g_free (tmp);
 				} else
-					add_string_item (rc->nameservers, buf);
+					add_string_item (&rc->nameservers, buf);
 			}
 		}
 	}
@@ -201,12 +234,12 @@ merge_one_ip6_config (NMResolvConfData *rc, NMIP6Config *src)
 		domain = nm_ip6_config_get_domain (src, i);
 		if (!rc->domain)
 			rc->domain = domain;
-		add_string_item (rc->searches, domain);
+		add_string_item (&rc->searches, domain);
 	}
 
 	num = nm_ip6_config_get_num_searches (src);
 	for (i = 0; i < num; i++)
-		add_string_item (rc->searches, nm_ip6_config_get_search (src, i));
+		add_string_item (&rc->searches, nm_ip6_config_get_search (src, i));
 }
 
 
@@ -565,6 +598,46 @@ compute_hash (NMDnsManager *self, guint8 buffer[HASH_LEN])
 	g_checksum_free (sum);
 }
 
+static void
+hash_strv (GChecksum *sum, const char *tag, char **strv)
+{
+	/* Include the terminating NULs so adjacent items can't run together */
+	g_checksum_update (sum, (const guchar *) tag, strlen (tag) + 1);
+	for (; strv && *strv; strv++)
+		g_checksum_update (sum, (const guchar *) *strv, strlen (*strv) + 1);
+}
+
+/* Hash of what will actually end up in resolv.conf (or be handed to
+ * resolvconf/netconfig), as opposed to compute_hash() which covers the
+ * IP configs it is built from.
+ */
+static void
+compute_resolv_conf_hash (const char *domain,
+                          char **searches,
+                          char **nameservers,
+                          const char *nis_domain,
+                          char **nis_servers,
+                          guint8 buffer[HASH_LEN])
+{
+	GChecksum *sum;
+	gsize len = HASH_LEN;
+	char *single[2] = { NULL, NULL };
+
+	sum = g_checksum_new (G_CHECKSUM_SHA1);
+	g_assert (len == g_checksum_type_get_length (G_CHECKSUM_SHA1));
+
+	single[0] = (char *) domain;
+	hash_strv (sum, "domain", single);
+	hash_strv (sum, "search", searches);
+	hash_strv (sum, "nameserver", nameservers);
+	single[0] = (char *) nis_domain;
+	hash_strv (sum, "nisdomain", single);
+	hash_strv (sum, "nisserver", nis_servers);
+
+	g_checksum_get_digest (sum, buffer, &len);
+	g_checksum_free (sum);
+}
+
 static gboolean
 update_dns (NMDnsManager *self,
             gboolean no_caching,
@@ -579,7 +652,8 @@ update_dns (NMDnsManager *self,
 	char **nameservers = NULL;
 	char **nis_servers = NULL;
 	int num, i, len;
-	gboolean success = FALSE, caching = FALSE;
+	gboolean success = FALSE, caching = FALSE, pending = FALSE;
+	guint8 resolv_hash[HASH_LEN];
 
 	g_return_val_if_fail (error != NULL, FALSE);
 	g_return_val_if_fail (*error == NULL, FALSE);
@@ -593,11 +667,11 @@ update_dns (NMDnsManager *self,
 	/* Update hash with config we're applying */
 	compute_hash (self, priv->hash);
 
-	rc.nameservers = g_ptr_array_new ();
+	string_set_init (&rc.nameservers);
 	rc.domain = NULL;
-	rc.searches = g_ptr_array_new ();
+	string_set_init (&rc.searches);
 	rc.nis_domain = NULL;
-	rc.nis_servers = g_ptr_array_new ();
+	string_set_init (&rc.nis_servers);
 
 	if (priv->ip4_vpn_config)
 		merge_one_ip4_config (&rc, priv->ip4_vpn_config);
@@ -639,7 +713,7 @@ update_dns (NMDnsManager *self,
 
 		/* +1 to get rid of the dot */
 		if (hostsearch && strlen (hostsearch + 1))
-			add_string_item (rc.searches, hostsearch + 1);
+			add_string_item (&rc.searches, hostsearch + 1);
 	}
 
 	domain = rc.domain;
@@ -647,30 +721,17 @@ update_dns (NMDnsManager *self,
 	/* Per 'man resolv.conf', the search list is limited to 6 domains
 	 * totalling 256 characters.
 	 */
-	num = MIN (rc.searches->len, 6);
+	num = MIN (rc.searches.items->len, 6);
 	for (i = 0, len = 0; i < num; i++) {
-		len += strlen (rc.searches->pdata[i]) + 1; /* +1 for spaces */
+		len += strlen (rc.searches.items->pdata[i]) + 1; /* +1 for spaces */
 		if (len > 256)
 			break;
 	}
-	g_ptr_array_set_size (rc.searches, i);
-	if (rc.searches->len) {
-		g_ptr_array_add (rc.searches, NULL);
-		searches = (char **) g_ptr_array_free (rc.searches, FALSE);
-	} else
-		g_ptr_array_free (rc.searches, TRUE);
-
-	if (rc.nameservers->len) {
-		g_ptr_array_add (rc.nameservers, NULL);
-		nameservers = (char **) g_ptr_array_free (rc.nameservers, FALSE);
-	} else
-		g_ptr_array_free (rc.nameservers, TRUE);
-
-	if (rc.nis_servers->len) {
-		g_ptr_array_add (rc.nis_servers, NULL);
-		nis_servers = (char **) g_ptr_array_free (rc.nis_servers, FALSE);
-	} else
-		g_ptr_array_free (rc.nis_servers, TRUE);
+	while (rc.searches.items->len > (guint) i)
+		g_free (g_ptr_array_remove_index (rc.searches.items, rc.searches.items->len - 1));
+	searches = string_set_free (&rc.searches);
+	nameservers = string_set_free (&rc.nameservers);
+	nis_servers = string_set_free (&rc.nis_servers);
 
 	nis_domain = rc.nis_domain;
 
@@ -722,12 +783,23 @@ update_dns (NMDnsManager *self,
 			 * caching DNS configuration to resolv.conf.
 			 */
 			caching = FALSE;
+		} else if (nm_dns_plugin_is_caching (plugin) && nm_dns_plugin_is_pending (plugin)) {
+			nm_log_dbg (LOGD_DNS, "DNS: plugin %s not ready yet", plugin_name);
+			pending = TRUE;
 		}
 	}
 	g_slist_free (vpn_configs);
 	g_slist_free (dev_configs);
 	g_slist_free (other_configs);
 
+	/* Keep the current resolv.conf until the local nameserver can answer;
+	 * the plugin's 'ready' signal redoes the update then.
+	 */
+	if (caching && pending) {
+		success = TRUE;
+		goto done;
+	}
+
 	/* If caching was successful, we only send 127.0.0.1 to /etc/resolv.conf
 	 * to ensure that the glibc resolver doesn't try to round-robin nameservers,
 	 * but only uses the local caching nameserver.
@@ -739,6 +811,20 @@ update_dns (NMDnsManager *self,
 		nameservers[0] = g_strdup ("127.0.0.1");
 	}
 
+	/* Configs often change without changing the merged result (eg, when
+	 * only their order changes, or a config that adds nothing new comes and
+	 * goes); don't rewrite resolv.conf or respawn helpers in that case.
+	 */
+	compute_resolv_conf_hash (domain, searches, nameservers,
+	                          nis_domain, nis_servers, resolv_hash);
+	if (   priv->resolv_hash_valid
+	    && memcmp (resolv_hash, priv->resolv_hash, HASH_LEN) == 0) {
+		nm_log_dbg (LOGD_DNS, "resolv.conf contents unchanged; not updating");
+		success = TRUE;
+		goto done;
+	}
+	priv->resolv_hash_valid = FALSE;
+
 #ifdef RESOLVCONF_PATH
 	success = dispatch_resolvconf (domain, searches, nameservers, error);
 #endif
@@ -754,9 +840,13 @@ update_dns (NMDnsManager *self,
 		success = update_resolv_conf (domain, searches, nameservers, error);
 
 	/* signal that resolv.conf was changed */
-	if (success)
+	if (success) {
+		memcpy (priv->resolv_hash, resolv_hash, HASH_LEN);
+		priv->resolv_hash_valid = TRUE;
 		g_signal_emit (self, signals[CONFIG_CHANGED], 0);
+	}
 
+done:
 	if (searches)
 		g_strfreev (searches);
 	if (nameservers)
@@ -786,6 +876,20 @@ plugin_failed (NMDnsPlugin *plugin, gpointer user_data)
 	}
 }
 
+static void
+plugin_ready (NMDnsPlugin *plugin, gpointer user_data)
+{
+	NMDnsManager *self = NM_DNS_MANAGER (user_data);
+	GError *error = NULL;
+
+	if (!update_dns (self, FALSE, &error)) {
+		nm_log_warn (LOGD_DNS, "could not commit DNS changes: (%d) %s",
+		             error ? error->code : -1,
+		             error && error->message ? error->message : "(unknown)");
+		g_clear_error (&error);
+	}
+}
+
 gboolean
 nm_dns_manager_add_ip4_config (NMDnsManager *mgr,
                                const char *iface,
@@ -1067,6 +1171,9 @@ load_plugins (NMDnsManager *self, const char **plugins)
 			g_signal_connect (plugin, NM_DNS_PLUGIN_FAILED,
 			                  G_CALLBACK (plugin_failed),
 			                  self);
+			g_signal_connect (plugin, NM_DNS_PLUGIN_READY,
+			                  G_CALLBACK (plugin_ready),
+			                  self);
 		}
 	} else {
 		/* Create default plugins */
@@ -45,6 +45,7 @@ G_DEFINE_TYPE_EXTENDED (NMDnsPlugin, nm_dns_plugin, G_TYPE_OBJECT, G_TYPE_FLAG_A
 enum {
 	FAILED,
 	CHILD_QUIT,
+	READY,
 	LAST_SIGNAL
 };
 static guint signals[LAST_SIGNAL] = { 0 };
@@ -79,6 +80,14 @@ nm_dns_plugin_is_caching (NMDnsPlugin *self)
 	return NM_DNS_PLUGIN_GET_CLASS (self)->is_caching (self);
 }
 
+gboolean
+nm_dns_plugin_is_pending (NMDnsPlugin *self)
+{
+	if (NM_DNS_PLUGIN_GET_CLASS (self)->is_pending)
+		return NM_DNS_PLUGIN_GET_CLASS (self)->is_pending (self);
+	return FALSE;
+}
+
 const char *
 nm_dns_plugin_get_name (NMDnsPlugin *self)
 {
@@ -258,6 +267,14 @@ gboolean nm_dns_plugin_child_kill (NMDnsPlugin *self)
 	return TRUE;
 }
 
+GPid
+nm_dns_plugin_child_pid (NMDnsPlugin *self)
+{
+	g_return_val_if_fail (NM_IS_DNS_PLUGIN (self), 0);
+
+	return NM_DNS_PLUGIN_GET_PRIVATE (self)->pid;
+}
+
 /********************************************/
 
 static void
@@ -322,5 +339,14 @@ nm_dns_plugin_class_init (NMDnsPluginClass *plugin_class)
 					  NULL, NULL,
 					  g_cclosure_marshal_VOID__INT,
 					  G_TYPE_NONE, 1, G_TYPE_INT);
+
+	signals[READY] =
+		g_signal_new (NM_DNS_PLUGIN_READY,
+					  G_OBJECT_CLASS_TYPE (object_class),
+					  G_SIGNAL_RUN_FIRST,
+					  G_STRUCT_OFFSET (NMDnsPluginClass, ready),
+					  NULL, NULL,
+					  g_cclosure_marshal_VOID__VOID,
+					  G_TYPE_NONE, 0);
 }
 
@@ -31,6 +31,7 @@
 
 #define NM_DNS_PLUGIN_FAILED "failed"
 #define NM_DNS_PLUGIN_CHILD_QUIT "child-quit"
+#define NM_DNS_PLUGIN_READY "ready"
 
 #define IP_CONFIG_IFACE_TAG "dns-manager-iface"
 
@@ -63,6 +64,13 @@ typedef struct {
 	 */
 	gboolean (*is_caching) (NMDnsPlugin *self);
 
+	/* Subclasses may override and return TRUE while a successful update
+	 * hasn't taken effect yet, eg while a freshly started nameserver is still
+	 * waiting for its servers.  NMDnsManager leaves resolv.conf alone until
+	 * the plugin emits 'ready'.
+	 */
+	gboolean (*is_pending) (NMDnsPlugin *self);
+
 	/* Subclasses should override this and return their plugin name */
 	const char *(*get_name) (NMDnsPlugin *self);
 
@@ -81,12 +89,21 @@ typedef struct {
 	 * by waitpid(2)) is fatal it should then emit the 'failed' signal.
 	 */
 	void (*child_quit) (NMDnsPlugin *self, gint status);
+
+	/* Emitted by the plugin and consumed by NMDnsManager when an update
+	 * the plugin reported as pending has taken effect, eg once a freshly
+	 * started nameserver has accepted its servers.  Causes NM to redo the
+	 * DNS update.
+	 */
+	void (*ready) (NMDnsPlugin *self);
 } NMDnsPluginClass;
 
 GType nm_dns_plugin_get_type (void);
 
 gboolean nm_dns_plugin_is_caching (NMDnsPlugin *self);
 
+gboolean nm_dns_plugin_is_pending (NMDnsPlugin *self);
+
 const char *nm_dns_plugin_get_name (NMDnsPlugin *self);
 
 gboolean nm_dns_plugin_update (NMDnsPlugin *self,
@@ -110,5 +127,7 @@ GPid nm_dns_plugin_child_spawn (NMDnsPlugin *self,
 
 gboolean nm_dns_plugin_child_kill (NMDnsPlugin *self);
 
+GPid nm_dns_plugin_child_pid (NMDnsPlugin *self);
+
 #endif /* NM_DNS_PLUGIN_H */
 
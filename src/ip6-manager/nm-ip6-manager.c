@@ -872,6 +872,12 @@ process_address_change (NMIP6Manager *manager, struct nl_msg *msg)
 		return NULL;
 	}
 
+	/* The netlink monitor also listens for IPv4 address changes */
+	if (rtnl_addr_get_family (rtnladdr) != AF_INET6) {
+		rtnl_addr_put (rtnladdr);
+		return NULL;
+	}
+
 	device = nm_ip6_manager_get_device (manager, rtnl_addr_get_ifindex (rtnladdr));
 
 	old_size = nl_cache_nitems (priv->addr_cache);
@@ -908,6 +914,12 @@ process_route_change (NMIP6Manager *manager, struct nl_msg *msg)
 		return NULL;
 	}
 
+	/* The netlink monitor also listens for IPv4 route changes */
+	if (rtnl_route_get_family (rtnlroute) != AF_INET6) {
+		rtnl_route_put (rtnlroute);
+		return NULL;
+	}
+
 	/* Cached/cloned routes are created by the kernel for specific operations
 	 * and aren't part of the interface's permanent routing configuration.
 	 */
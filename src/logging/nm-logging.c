@@ -47,8 +47,29 @@
 
 #define LOGD_DEFAULT (LOGD_ALL & ~LOGD_WIFI_SCAN)
 
-static guint32 log_level = LOGL_INFO | LOGL_WARN | LOGL_ERR;
-static guint32 log_domains = LOGD_DEFAULT;
+guint32 _nm_log_level = LOGL_INFO | LOGL_WARN | LOGL_ERR;
+guint32 _nm_log_domains = LOGD_DEFAULT;
+
+/* Lock-free ring buffer of recent messages.  Writers reserve a slot with an
+ * atomic increment; each entry's sequence number is zero while it is being
+ * written, and index + 1 afterwards so readers can detect overwritten or
+ * incomplete entries without taking a lock.
+ */
+#define BUFFER_MSG_LEN 256
+
+typedef struct {
+	volatile gint seq;
+	guint64 usec;
+	guint32 level;
+	const char *loc;
+	const char *func;
+	char msg[BUFFER_MSG_LEN];
+} BufferEntry;
+
+static BufferEntry *buffer = NULL;
+static guint buffer_size = 0;
+static volatile gint buffer_next = 0;
+static GTimer *buffer_timer = NULL;
 
 typedef struct {
 	guint32 num;
@@ -131,7 +152,7 @@ nm_logging_setup (const char *level, const char *domains, GError **error)
 
 		for (diter = &level_descs[0]; diter->name; diter++) {
 			if (!strcasecmp (diter->name, level)) {
-				log_level = diter->num;
+				_nm_log_level = diter->num;
 				found = TRUE;
 				break;
 			}
@@ -190,7 +211,7 @@ nm_logging_setup (const char *level, const char *domains, GError **error)
 			}
 		}
 		g_strfreev (tmp);
-		log_domains = new_domains;
+		_nm_log_domains = new_domains;
 	}
 
 	return TRUE;
@@ -202,7 +223,7 @@ nm_logging_level_to_string (void)
 	const LogDesc *diter;
 
 	for (diter = &level_descs[0]; diter->name; diter++) {
-		if (diter->num == log_level)
+		if (diter->num == _nm_log_level)
 			return diter->name;
 	}
 	g_warn_if_reached ();
@@ -217,7 +238,7 @@ nm_logging_domains_to_string (void)
 
 	str = g_string_sized_new (75);
 	for (diter = &domain_descs[0]; diter->name; diter++) {
-		if (diter->num & log_domains) {
+		if (diter->num & _nm_log_domains) {
 			if (str->len)
 				g_string_append_c (str, ',');
 			g_string_append (str, diter->name);
@@ -229,13 +250,46 @@ nm_logging_domains_to_string (void)
 gboolean
 nm_logging_level_enabled (guint32 level)
 {
-	return !!(log_level & level);
+	return !!(_nm_log_level & level);
 }
 
 gboolean
 nm_logging_domain_enabled (guint32 domain)
 {
-	return !!(log_domains & domain);
+	return !!(_nm_log_domains & domain);
+}
+
+static const char *
+level_to_tag (guint32 level)
+{
+	switch (level) {
+	case LOGL_DEBUG:
+		return "debug";
+	case LOGL_INFO:
+		return "info";
+	case LOGL_WARN:
+		return "warn";
+	default:
+		return "error";
+	}
+}
+
+static void
+buffer_append (const char *loc, const char *func, guint32 level, const char *msg)
+{
+	BufferEntry *entry;
+	guint idx;
+
+	idx = (guint) g_atomic_int_exchange_and_add (&buffer_next, 1);
+	entry = &buffer[idx % buffer_size];
+
+	g_atomic_int_set (&entry->seq, 0);
+	entry->usec = (guint64) (g_timer_elapsed (buffer_timer, NULL) * G_USEC_PER_SEC);
+	entry->level = level;
+	entry->loc = loc;
+	entry->func = func;
+	g_strlcpy (entry->msg, msg, sizeof (entry->msg));
+	g_atomic_int_set (&entry->seq, idx + 1);
 }
 
 void
@@ -247,28 +301,124 @@ _nm_log (const char *loc,
          ...)
 {
 	va_list args;
-	char *msg;
+	char buf[512];
+	char *msg = buf;
 	GTimeVal tv;
 
-	if (!(log_level & level) || !(log_domains & domain))
+	if (!(_nm_log_level & level) || !(_nm_log_domains & domain))
 		return;
 
 	va_start (args, fmt);
-	msg = g_strdup_vprintf (fmt, args);
+	if (g_vsnprintf (buf, sizeof (buf), fmt, args) >= sizeof (buf)) {
+		va_end (args);
+		va_start (args, fmt);
+		msg = g_strdup_vprintf (fmt, args);
+	}
 	va_end (args);
 
-	if ((log_level & LOGL_DEBUG) && (level == LOGL_DEBUG)) {
-		g_get_current_time (&tv);
-		syslog (LOG_INFO, "<debug> [%ld.%ld] [%s] %s(): %s", tv.tv_sec, tv.tv_usec, loc, func, msg);
-	} else if ((log_level & LOGL_INFO) && (level == LOGL_INFO))
+	if (buffer)
+		buffer_append (loc, func, level, msg);
+
+	if (level == LOGL_DEBUG) {
+		/* With the ring buffer, debug messages stay out of syslog */
+		if (!buffer) {
+			g_get_current_time (&tv);
+			syslog (LOG_INFO, "<debug> [%ld.%ld] [%s] %s(): %s", tv.tv_sec, tv.tv_usec, loc, func, msg);
+		}
+	} else if (level == LOGL_INFO)
 		syslog (LOG_INFO, "<info> %s", msg);
-	else if ((log_level & LOGL_WARN) && (level == LOGL_WARN))
+	else if (level == LOGL_WARN)
 		syslog (LOG_WARNING, "<warn> %s", msg);
-	else if ((log_level & LOGL_ERR) && (level == LOGL_ERR)) {
+	else if (level == LOGL_ERR) {
 		g_get_current_time (&tv);
 		syslog (LOG_ERR, "<error> [%ld.%ld] [%s] %s(): %s", tv.tv_sec, tv.tv_usec, loc, func, msg);
 	}
-	g_free (msg);
+
+	if (msg != buf)
+		g_free (msg);
+}
+
+/************************************************************************/
+
+/**
+ * nm_logging_buffer_setup:
+ * @size: number of messages to keep, or 0 to disable the buffer
+ *
+ * Keeps the last @size log messages in memory, with timestamps relative to
+ * the call, so they can be retrieved with nm_logging_buffer_get_messages().
+ * While the buffer is enabled debug messages are only written to it and not
+ * to syslog.  Must be called before logging starts.
+ */
+void
+nm_logging_buffer_setup (guint size)
+{
+	g_return_if_fail (buffer == NULL);
+
+	if (size == 0)
+		return;
+
+	buffer_size = size;
+	buffer_timer = g_timer_new ();
+	buffer = g_new0 (BufferEntry, size);
+}
+
+/**
+ * nm_logging_buffer_get_messages:
+ *
+ * Returns: (transfer full): the buffered messages, oldest first, or an empty
+ * array if the buffer is disabled
+ */
+char **
+nm_logging_buffer_get_messages (void)
+{
+	GPtrArray *lines;
+	BufferEntry entry;
+	guint idx, end;
+
+	lines = g_ptr_array_new ();
+	if (buffer) {
+		end = (guint) g_atomic_int_get (&buffer_next);
+		idx = end > buffer_size ? end - buffer_size : 0;
+		for (; idx != end; idx++) {
+			BufferEntry *slot = &buffer[idx % buffer_size];
+
+			/* Skip entries being written or already overwritten */
+			if ((guint) g_atomic_int_get (&slot->seq) != idx + 1)
+				continue;
+			memcpy (&entry, slot, sizeof (entry));
+			if ((guint) g_atomic_int_get (&slot->seq) != idx + 1)
+				continue;
+
+			entry.msg[BUFFER_MSG_LEN - 1] = '\0';
+			g_ptr_array_add (lines, g_strdup_printf ("<%s> [%" G_GUINT64_FORMAT ".%06u] [%s] %s(): %s",
+			                                         level_to_tag (entry.level),
+			                                         entry.usec / G_USEC_PER_SEC,
+			                                         (guint) (entry.usec % G_USEC_PER_SEC),
+			                                         entry.loc,
+			                                         entry.func,
+			                                         entry.msg));
+		}
+	}
+	g_ptr_array_add (lines, NULL);
+
+	return (char **) g_ptr_array_free (lines, FALSE);
+}
+
+/**
+ * nm_logging_buffer_dump:
+ *
+ * Writes the buffered messages to syslog.
+ */
+void
+nm_logging_buffer_dump (void)
+{
+	char **lines, **iter;
+
+	lines = nm_logging_buffer_get_messages ();
+	syslog (LOG_INFO, "<info> logging: dumping %u buffered messages", g_strv_length (lines));
+	for (iter = lines; *iter; iter++)
+		syslog (LOG_INFO, "%s", *iter);
+	g_strfreev (lines);
 }
 
 /************************************************************************/
@@ -81,20 +81,30 @@ typedef enum {
 GQuark nm_logging_error_quark    (void);
 
 
+/* Current level and domain masks; only exported so the macros below can
+ * skip disabled messages without evaluating their arguments.  Use
+ * nm_logging_setup() to change them.
+ */
+extern guint32 _nm_log_level;
+extern guint32 _nm_log_domains;
+
 #define nm_log_err(domain, ...) \
-	_nm_log (G_STRLOC, G_STRFUNC, domain, LOGL_ERR, ## __VA_ARGS__ )
+	nm_log (domain, LOGL_ERR, ## __VA_ARGS__ )
 
 #define nm_log_warn(domain, ...) \
-	_nm_log (G_STRLOC, G_STRFUNC, domain, LOGL_WARN, ## __VA_ARGS__ )
+	nm_log (domain, LOGL_WARN, ## __VA_ARGS__ )
 
 #define nm_log_info(domain, ...) \
-	_nm_log (G_STRLOC, G_STRFUNC, domain, LOGL_INFO, ## __VA_ARGS__ )
+	nm_log (domain, LOGL_INFO, ## __VA_ARGS__ )
 
 #define nm_log_dbg(domain, ...) \
-	_nm_log (G_STRLOC, G_STRFUNC, domain, LOGL_DEBUG, ## __VA_ARGS__ )
+	nm_log (domain, LOGL_DEBUG, ## __VA_ARGS__ )
 
 #define nm_log(domain, level, ...) \
-	_nm_log (G_STRLOC, G_STRFUNC, domain, level, ## __VA_ARGS__ )
+	G_STMT_START { \
+		if ((_nm_log_level & (level)) && (_nm_log_domains & (domain))) \
+			_nm_log (G_STRLOC, G_STRFUNC, domain, level, ## __VA_ARGS__ ); \
+	} G_STMT_END
 
 void _nm_log (const char *loc,
               const char *func,
@@ -123,4 +133,9 @@ gboolean nm_logging_setup     (const char *level, const char *domains, GError **
 void     nm_logging_start     (gboolean become_daemon);
 void     nm_logging_shutdown  (void);
 
+/* In-memory ring buffer of recent messages */
+void     nm_logging_buffer_setup        (guint size);
+char **  nm_logging_buffer_get_messages (void);
+void     nm_logging_buffer_dump         (void);
+
 #endif /* NM_LOGGING_H */
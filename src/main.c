@@ -94,6 +94,9 @@ signal_handling_thread (void *arg)
 			quit_early = TRUE; /* for quitting before entering the main loop */
 			g_main_loop_quit (main_loop);
 			break;
+		case SIGUSR1:
+			nm_logging_buffer_dump ();
+			break;
 		case SIGHUP:
 			/* Reread config stuff like system config files, VPN service files, etc */
 			nm_log_info (LOGD_CORE, "caught signal %d, not supported yet.", signo);
@@ -123,6 +126,7 @@ setup_signals (void)
 	sigaddset (&signal_set, SIGHUP);
 	sigaddset (&signal_set, SIGINT);
 	sigaddset (&signal_set, SIGTERM);
+	sigaddset (&signal_set, SIGUSR1);
 
 	/* Block all signals of interest. */
 	status = pthread_sigmask (SIG_BLOCK, &signal_set, &old_sig_mask);
@@ -439,6 +443,7 @@ main (int argc, char *argv[])
 		         error->message);
 		exit (1);
 	}
+	nm_logging_buffer_setup (nm_config_get_log_buffer_size (config));
 
 	/* Parse the state file */
 	if (!parse_state_file (state_file, &net_enabled, &wifi_enabled, &wwan_enabled, &wimax_enabled, &error)) {
@@ -23,6 +23,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <dbus/dbus-glib.h>
@@ -36,7 +37,6 @@
 #include "nm-settings-connection.h"
 #include "nm-posix-signals.h"
 
-
 G_DEFINE_TYPE (NMActRequest, nm_act_request, NM_TYPE_ACTIVE_CONNECTION)
 
 #define NM_ACT_REQUEST_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
@@ -179,20 +179,20 @@ nm_act_request_cancel_secrets (NMActRequest *self, guint32 call_id)
 
 /********************************************************************/
 
+static void
+share_rule_free (ShareRule *rule)
+{
+	g_free (rule->table);
+	g_free (rule->rule);
+	g_free (rule);
+}
+
 static void
 clear_share_rules (NMActRequest *req)
 {
 	NMActRequestPrivate *priv = NM_ACT_REQUEST_GET_PRIVATE (req);
-	GSList *iter;
-
-	for (iter = priv->share_rules; iter; iter = g_slist_next (iter)) {
-		ShareRule *rule = (ShareRule *) iter->data;
-
-		g_free (rule->table);
-		g_free (rule->rule);
-		g_free (rule);
-	}
 
+	g_slist_foreach (priv->share_rules, (GFunc) share_rule_free, NULL);
 	g_slist_free (priv->share_rules);
 	priv->share_rules = NULL;
 }
@@ -207,65 +207,328 @@ share_child_setup (gpointer user_data G_GNUC_UNUSED)
 	nm_unblock_posix_signals (NULL);
 }
 
-void
-nm_act_request_set_shared (NMActRequest *req, gboolean shared)
+/* Rulesets are applied one at a time, in the order they were queued, so
+ * that a teardown can never overtake the setup of the same rules.  Jobs
+ * don't reference the activation request since teardown may be queued
+ * from dispose().
+ */
+typedef struct {
+	char *ruleset;
+	guint num_rules;
+	gboolean add;
+	GSList *rules;       /* the rules in ruleset order, for per-rule fallback */
+	GTimer *timer;
+	GPid pid;
+	guint watch_id;
+} ShareJob;
+
+static GQueue *share_jobs = NULL;
+static ShareJob *share_job_running = NULL;
+
+static void share_jobs_run_next (void);
+
+static void
+share_job_free (ShareJob *job)
 {
-	NMActRequestPrivate *priv = NM_ACT_REQUEST_GET_PRIVATE (req);
-	GSList *list, *iter;
+	g_free (job->ruleset);
+	g_slist_foreach (job->rules, (GFunc) share_rule_free, NULL);
+	g_slist_free (job->rules);
+	if (job->timer)
+		g_timer_destroy (job->timer);
+	g_free (job);
+}
 
-	g_return_if_fail (NM_IS_ACT_REQUEST (req));
+static void
+share_rule_run_sync (ShareRule *rule, const char *op, gboolean quiet)
+{
+	char *envp[1] = { NULL };
+	char **argv;
+	char *cmd;
+	int status;
+	GError *error = NULL;
+
+	cmd = g_strdup_printf ("%s --table %s --%s %s",
+	                       IPTABLES_PATH, rule->table, op, rule->rule);
+	argv = g_strsplit (cmd, " ", 0);
+	if (argv && argv[0]) {
+		nm_log_info (LOGD_SHARING, "Executing: %s", cmd);
+		if (!g_spawn_sync ("/", argv, envp, G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL,
+		                   share_child_setup, NULL, NULL, NULL, &status, &error)) {
+			nm_log_warn (LOGD_SHARING, "Error executing command: (%d) %s",
+			             error ? error->code : -1,
+			             (error && error->message) ? error->message : "(unknown)");
+			g_clear_error (&error);
+		} else if (WEXITSTATUS (status) && !quiet) {
+			nm_log_warn (LOGD_SHARING, "** Command returned exit status %d.",
+			             WEXITSTATUS (status));
+		}
+	}
+	g_strfreev (argv);
+	g_free (cmd);
+}
+
+/* Handles a finished job; @success is FALSE if iptables-restore couldn't
+ * be run or rejected the ruleset.
+ */
+static void
+share_job_done (ShareJob *job, gboolean success)
+{
+	GSList *iter;
 
-	NM_ACT_REQUEST_GET_PRIVATE (req)->shared = shared;
+	nm_log_dbg (LOGD_SHARING, "%s %u sharing rules took %.1f ms",
+	            job->add ? "adding" : "removing",
+	            job->num_rules,
+	            job->timer ? g_timer_elapsed (job->timer, NULL) * 1000 : 0.0);
+
+	/* A table's rules are committed together, so if any of them was
+	 * already gone (say, after a firewall reload) none got deleted, and if
+	 * iptables-restore is missing or rejected a table none of its rules got
+	 * added.  Apply them one by one with iptables instead.
+	 */
+	if (!success && !job->add) {
+		nm_log_info (LOGD_SHARING, "removing sharing rules one at a time");
+		for (iter = job->rules; iter; iter = g_slist_next (iter))
+			share_rule_run_sync ((ShareRule *) iter->data, "delete", FALSE);
+	} else if (!success) {
+		/* Tables committed before the failure already have their rules;
+		 * drop those copies first so no rule is inserted twice.
+		 */
+		nm_log_info (LOGD_SHARING, "adding sharing rules one at a time");
+		for (iter = job->rules; iter; iter = g_slist_next (iter)) {
+			share_rule_run_sync ((ShareRule *) iter->data, "delete", TRUE);
+			share_rule_run_sync ((ShareRule *) iter->data, "insert", FALSE);
+		}
+	}
 
-	/* Tear the rules down in reverse order when sharing is stopped */
-	list = g_slist_copy (priv->share_rules);
-	if (!shared)
+	share_job_free (job);
+}
+
+static gboolean
+share_job_status_ok (gint status)
+{
+	if (WIFEXITED (status)) {
+		if (WEXITSTATUS (status)) {
+			nm_log_warn (LOGD_SHARING, "** iptables-restore returned exit status %d.",
+			             WEXITSTATUS (status));
+			return FALSE;
+		}
+		return TRUE;
+	} else if (WIFSIGNALED (status)) {
+		nm_log_warn (LOGD_SHARING, "** iptables-restore died with signal %d.",
+		             WTERMSIG (status));
+	}
+	return FALSE;
+}
+
+static void
+share_job_watch_cb (GPid pid, gint status, gpointer user_data)
+{
+	ShareJob *job = user_data;
+
+	g_assert (job == share_job_running);
+
+	job->watch_id = 0;
+	g_spawn_close_pid (pid);
+	share_job_running = NULL;
+	share_job_done (job, share_job_status_ok (status));
+
+	share_jobs_run_next ();
+}
+
+static gboolean
+write_all (int fd, const char *buf, size_t len)
+{
+	while (len) {
+		ssize_t n = write (fd, buf, len);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		buf += n;
+		len -= n;
+	}
+	return TRUE;
+}
+
+static gboolean
+share_job_spawn (ShareJob *job)
+{
+	char *argv[3] = { IPTABLES_RESTORE_PATH, "--noflush", NULL };
+	char *envp[1] = { NULL };
+	int stdin_fd = -1;
+	GError *error = NULL;
+
+	nm_log_dbg (LOGD_SHARING, "Executing: %s --noflush <<EOF\n%sEOF",
+	            IPTABLES_RESTORE_PATH, job->ruleset);
+
+	job->timer = g_timer_new ();
+	if (!g_spawn_async_with_pipes ("/", argv, envp,
+	                               G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL,
+	                               share_child_setup, NULL, &job->pid,
+	                               &stdin_fd, NULL, NULL, &error)) {
+		nm_log_warn (LOGD_SHARING, "Error executing command: (%d) %s",
+		             error ? error->code : -1,
+		             (error && error->message) ? error->message : "(unknown)");
+		g_clear_error (&error);
+		return FALSE;
+	}
+
+	/* The ruleset is small enough to fit into the pipe buffer */
+	if (!write_all (stdin_fd, job->ruleset, strlen (job->ruleset))) {
+		nm_log_warn (LOGD_SHARING, "Error writing rules to iptables-restore: (%d) %s",
+		             errno, strerror (errno));
+	}
+	close (stdin_fd);
+	return TRUE;
+}
+
+static void
+share_jobs_run_next (void)
+{
+	ShareJob *job;
+
+	while (!share_job_running && (job = g_queue_pop_head (share_jobs))) {
+		if (!share_job_spawn (job)) {
+			share_job_done (job, FALSE);
+			continue;
+		}
+
+		share_job_running = job;
+		job->watch_id = g_child_watch_add (job->pid, share_job_watch_cb, job);
+	}
+}
+
+/* Runs the running and all queued jobs to completion without returning to
+ * the main loop, which may never run again (e.g. at shutdown).
+ */
+static void
+share_jobs_run_sync (void)
+{
+	ShareJob *job;
+	gint status;
+
+	job = share_job_running;
+	if (job) {
+		share_job_running = NULL;
+		g_source_remove (job->watch_id);
+		job->watch_id = 0;
+		if (waitpid (job->pid, &status, 0) < 0)
+			status = -1;
+		g_spawn_close_pid (job->pid);
+		share_job_done (job, status != -1 && share_job_status_ok (status));
+	}
+
+	while (share_jobs && (job = g_queue_pop_head (share_jobs))) {
+		gboolean success = FALSE;
+
+		if (share_job_spawn (job)) {
+			if (waitpid (job->pid, &status, 0) >= 0)
+				success = share_job_status_ok (status);
+			g_spawn_close_pid (job->pid);
+		}
+		share_job_done (job, success);
+	}
+}
+
+/* Builds an iptables-restore ruleset inserting (or, in reverse order,
+ * deleting) the request's share rules, grouped by table.
+ */
+static char *
+build_share_ruleset (GSList *rules, gboolean add)
+{
+	GString *str;
+	GSList *tables = NULL, *iter, *list;
+
+	list = g_slist_copy (rules);
+	if (!add)
 		list = g_slist_reverse (list);
 
-	/* Send the rules to iptables */
 	for (iter = list; iter; iter = g_slist_next (iter)) {
 		ShareRule *rule = (ShareRule *) iter->data;
-		char *envp[1] = { NULL };
-		char **argv;
-		char *cmd;
-
-		cmd = g_strdup_printf ("%s --table %s %s %s",
-		                       IPTABLES_PATH,
-		                       rule->table,
-		                       shared ? "--insert" : "--delete",
-		                       rule->rule);
-		if (!cmd)
-			continue;
 
-		argv = g_strsplit (cmd, " ", 0);
-		if (argv && argv[0]) {
-			int status;
-			GError *error = NULL;
-
-			nm_log_info (LOGD_SHARING, "Executing: %s", cmd);
-			if (!g_spawn_sync ("/", argv, envp, G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL,
-			                   share_child_setup, NULL, NULL, NULL, &status, &error)) {
-				nm_log_warn (LOGD_SHARING, "Error executing command: (%d) %s",
-				             error ? error->code : -1,
-				             (error && error->message) ? error->message : "(unknown)");
-				g_clear_error (&error);
-			} else if (WEXITSTATUS (status)) {
-				nm_log_warn (LOGD_SHARING, "** Command returned exit status %d.",
-				             WEXITSTATUS (status));
-			}
+		if (!g_slist_find_custom (tables, rule->table, (GCompareFunc) strcmp))
+			tables = g_slist_append (tables, rule->table);
+	}
+
+	str = g_string_sized_new (512);
+	for (iter = tables; iter; iter = g_slist_next (iter)) {
+		const char *table = iter->data;
+		GSList *r;
+
+		g_string_append_printf (str, "*%s\n", table);
+		for (r = list; r; r = g_slist_next (r)) {
+			ShareRule *rule = (ShareRule *) r->data;
+
+			if (!strcmp (rule->table, table))
+				g_string_append_printf (str, "%s %s\n", add ? "-I" : "-D", rule->rule);
 		}
-		g_free (cmd);
-		if (argv)
-			g_strfreev (argv);
+		g_string_append (str, "COMMIT\n");
 	}
 
+	g_slist_free (tables);
 	g_slist_free (list);
+	return g_string_free (str, FALSE);
+}
+
+static void
+set_shared (NMActRequest *req, gboolean shared, gboolean sync)
+{
+	NMActRequestPrivate *priv = NM_ACT_REQUEST_GET_PRIVATE (req);
+	ShareJob *job;
+
+	priv->shared = shared;
+
+	/* Send all the rules to iptables at once, asynchronously; they are
+	 * torn down in reverse order when sharing is stopped.
+	 */
+	if (priv->share_rules) {
+		job = g_malloc0 (sizeof (ShareJob));
+		job->ruleset = build_share_ruleset (priv->share_rules, shared);
+		job->num_rules = g_slist_length (priv->share_rules);
+		job->add = shared;
+
+		/* The teardown job takes over the rules; the setup job gets a copy */
+		if (shared) {
+			GSList *iter;
+
+			for (iter = priv->share_rules; iter; iter = g_slist_next (iter)) {
+				ShareRule *rule = (ShareRule *) iter->data;
+				ShareRule *copy = g_malloc0 (sizeof (ShareRule));
+
+				copy->table = g_strdup (rule->table);
+				copy->rule = g_strdup (rule->rule);
+				job->rules = g_slist_prepend (job->rules, copy);
+			}
+			job->rules = g_slist_reverse (job->rules);
+		} else {
+			job->rules = g_slist_reverse (priv->share_rules);
+			priv->share_rules = NULL;
+		}
+
+		if (!share_jobs)
+			share_jobs = g_queue_new ();
+		g_queue_push_tail (share_jobs, job);
+		if (sync)
+			share_jobs_run_sync ();
+		else
+			share_jobs_run_next ();
+	}
 
 	/* Clear the share rule list when sharing is stopped */
 	if (!shared)
 		clear_share_rules (req);
 }
 
+void
+nm_act_request_set_shared (NMActRequest *req, gboolean shared)
+{
+	g_return_if_fail (NM_IS_ACT_REQUEST (req));
+
+	set_shared (req, shared, FALSE);
+}
+
 gboolean
 nm_act_request_get_shared (NMActRequest *req)
 {
@@ -436,9 +699,11 @@ dispose (GObject *object)
 		priv->device_state_id = 0;
 	}
 
-	/* Clear any share rules */
+	/* Clear any share rules; synchronously, since at shutdown the main
+	 * loop won't run again to process a queued teardown.
+	 */
 	if (priv->share_rules) {
-		nm_act_request_set_shared (NM_ACT_REQUEST (object), FALSE);
+		set_shared (NM_ACT_REQUEST (object), FALSE, TRUE);
 		clear_share_rules (NM_ACT_REQUEST (object));
 	}
 
@@ -34,6 +34,7 @@ struct NMConfig {
 	char **dns_plugins;
 	char *log_level;
 	char *log_domains;
+	guint log_buffer_size;
 	char *connectivity_uri;
 	guint connectivity_interval;
 	char *connectivity_response;
@@ -100,6 +101,14 @@ nm_config_get_log_domains (NMConfig *config)
 	return config->log_domains;
 }
 
+guint
+nm_config_get_log_buffer_size (NMConfig *config)
+{
+	g_return_val_if_fail (config != NULL, 0);
+
+	return config->log_buffer_size;
+}
+
 const char *
 nm_config_get_connectivity_uri (NMConfig *config)
 {
@@ -176,6 +185,8 @@ fill_from_file (NMConfig *config,
 		else
 			config->log_domains = g_key_file_get_value (kf, "logging", "domains", NULL);
 
+		config->log_buffer_size = MAX (g_key_file_get_integer (kf, "logging", "buffer", NULL), 0);
+
 		if (cli_connectivity_uri && strlen (cli_connectivity_uri))
 			config->connectivity_uri = g_strdup (cli_connectivity_uri);
 		else
@@ -49,6 +49,7 @@ const char *nm_config_get_dhcp_client (NMConfig *config);
 const char **nm_config_get_dns_plugins (NMConfig *config);
 const char *nm_config_get_log_level (NMConfig *config);
 const char *nm_config_get_log_domains (NMConfig *config);
+guint nm_config_get_log_buffer_size (NMConfig *config);
 const char *nm_config_get_connectivity_uri (NMConfig *config);
 const guint nm_config_get_connectivity_interval (NMConfig *config);
 const char *nm_config_get_connectivity_response (NMConfig *config);
@@ -1136,7 +1136,7 @@ set_mm_running (NMDeviceBt *self, gboolean running)
 	 * change state (which rechecks available connections) when MM comes and goes.
 	 */
 	if (priv->capabilities & NM_BT_CAPABILITY_DUN)
-	    nm_device_recheck_available_connections (NM_DEVICE (self));
+		nm_device_update_available_connections (NM_DEVICE (self), NULL, NULL);
 }
 
 static void
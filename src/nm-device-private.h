@@ -81,6 +81,14 @@ NMConnectionProvider *nm_device_get_connection_provider (NMDevice *device);
 
 void nm_device_recheck_available_connections (NMDevice *device);
 
+typedef gboolean (*NMDeviceConnectionFilterFunc) (NMDevice *device,
+                                                  NMConnection *connection,
+                                                  gpointer user_data);
+
+void nm_device_update_available_connections (NMDevice *device,
+                                             NMDeviceConnectionFilterFunc filter,
+                                             gpointer user_data);
+
 void nm_device_queued_state_clear (NMDevice *device);
 
 NMDeviceState nm_device_queued_state_peek (NMDevice *device);
@@ -139,6 +139,10 @@ struct _NMDeviceWifiPrivate {
 	gint8             invalid_strength_counter;
 
 	GSList *          ap_list;
+	GHashTable *      aps_by_supplicant_path;
+	GHashTable *      aps_by_key;     /* (BSSID, SSID, mode) -> GSList of APs */
+	GSList *          pending_bsses;  /* new APs waiting to be merged */
+	guint             pending_bss_id;
 	NMAccessPoint *   current_ap;
 	guint32           rate;
 	gboolean          enabled; /* rfkilled or not */
@@ -155,6 +159,7 @@ struct _NMDeviceWifiPrivate {
 
 	guint32           failed_link_count;
 	guint             periodic_source_id;
+	gboolean          link_events;  /* driver reports link changes; slow polling */
 	guint             link_timeout_id;
 
 	NMDeviceWifiCapabilities capabilities;
@@ -201,6 +206,10 @@ static void supplicant_iface_notify_scanning_cb (NMSupplicantInterface * iface,
 
 static void schedule_scanlist_cull (NMDeviceWifi *self);
 
+static void merge_pending_bsses (NMDeviceWifi *self);
+
+static void clear_pending_bsses (NMDeviceWifi *self);
+
 static gboolean request_wireless_scan (gpointer user_data);
 
 static void update_hw_address (NMDevice *dev);
@@ -458,6 +467,8 @@ supplicant_interface_release (NMDeviceWifi *self)
 		priv->scanlist_cull_id = 0;
 	}
 
+	clear_pending_bsses (self);
+
 	if (priv->supplicant.iface) {
 		/* Tell the supplicant to disconnect from the current AP */
 		nm_supplicant_interface_disconnect (priv->supplicant.iface);
@@ -484,24 +495,153 @@ static NMAccessPoint *
 get_ap_by_supplicant_path (NMDeviceWifi *self, const char *path)
 {
 	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
-	GSList *iter;
 
-	for (iter = priv->ap_list; iter && path; iter = g_slist_next (iter)) {
-		if (g_strcmp0 (path, nm_ap_get_supplicant_path (NM_AP (iter->data))) == 0)
-			return NM_AP (iter->data);
+	if (!path)
+		return NULL;
+	return g_hash_table_lookup (priv->aps_by_supplicant_path, path);
+}
+
+/*
+ * The AP list is indexed by supplicant BSS path and by a key built from
+ * everything nm_ap_match_in_list() requires to be equal: BSSID, SSID and
+ * mode.  APs without a valid BSSID get a wildcard BSSID in the key since
+ * they match any BSSID.
+ */
+#define AP_KEY_TAG "ap-index-key"
+
+static char *
+ap_index_key (NMAccessPoint *ap, gboolean any_bssid)
+{
+	const struct ether_addr *bssid = nm_ap_get_address (ap);
+	const GByteArray *ssid = nm_ap_get_ssid (ap);
+	GString *key;
+	guint i, len;
+
+	key = g_string_sized_new (64);
+	g_string_append_printf (key, "%d/", nm_ap_get_mode (ap));
+	if (!any_bssid && nm_ethernet_address_is_valid (bssid)) {
+		for (i = 0; i < ETH_ALEN; i++)
+			g_string_append_printf (key, "%02x", bssid->ether_addr_octet[i]);
+	} else
+		g_string_append_c (key, '*');
+	g_string_append_c (key, '/');
+	if (ssid) {
+		/* Like nm_utils_same_ssid(), ignore a trailing NUL */
+		len = ssid->len;
+		if (len && ssid->data[len - 1] == '\0')
+			len--;
+		g_string_append_c (key, 'S');
+		for (i = 0; i < len; i++)
+			g_string_append_printf (key, "%02x", ssid->data[i]);
+	}
+	return g_string_free (key, FALSE);
+}
+
+static void
+ap_index_add (NMDeviceWifi *self, NMAccessPoint *ap)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	const char *path;
+	GSList *bucket;
+	char *key;
+
+	key = ap_index_key (ap, FALSE);
+	bucket = g_hash_table_lookup (priv->aps_by_key, key);
+	g_object_set_data_full (G_OBJECT (ap), AP_KEY_TAG, g_strdup (key), g_free);
+	g_hash_table_insert (priv->aps_by_key, key, g_slist_prepend (bucket, ap));
+
+	path = nm_ap_get_supplicant_path (ap);
+	if (path)
+		g_hash_table_insert (priv->aps_by_supplicant_path, g_strdup (path), ap);
+}
+
+static void
+ap_index_remove (NMDeviceWifi *self, NMAccessPoint *ap)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	const char *path, *key;
+	GSList *bucket;
+
+	key = g_object_get_data (G_OBJECT (ap), AP_KEY_TAG);
+	if (key) {
+		bucket = g_hash_table_lookup (priv->aps_by_key, key);
+		bucket = g_slist_remove (bucket, ap);
+		if (bucket)
+			g_hash_table_insert (priv->aps_by_key, g_strdup (key), bucket);
+		else
+			g_hash_table_remove (priv->aps_by_key, key);
+		g_object_set_data (G_OBJECT (ap), AP_KEY_TAG, NULL);
+	}
+
+	path = nm_ap_get_supplicant_path (ap);
+	if (path && g_hash_table_lookup (priv->aps_by_supplicant_path, path) == ap)
+		g_hash_table_remove (priv->aps_by_supplicant_path, path);
+}
+
+/* Takes ownership of @ap's reference */
+static void
+ap_list_add (NMDeviceWifi *self, NMAccessPoint *ap)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+
+	priv->ap_list = g_slist_prepend (priv->ap_list, ap);
+	ap_index_add (self, ap);
+}
+
+/* Caller is responsible for the list's reference to @ap */
+static void
+ap_list_remove (NMDeviceWifi *self, NMAccessPoint *ap)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+
+	priv->ap_list = g_slist_remove (priv->ap_list, ap);
+	ap_index_remove (self, ap);
+}
+
+/* Must be called after changing any indexed property of an AP in the list */
+static void
+ap_list_reindex (NMDeviceWifi *self, NMAccessPoint *ap)
+{
+	if (g_object_get_data (G_OBJECT (ap), AP_KEY_TAG)) {
+		ap_index_remove (self, ap);
+		ap_index_add (self, ap);
 	}
-	return NULL;
 }
 
 static NMAccessPoint *
-get_active_ap (NMDeviceWifi *self,
-               NMAccessPoint *ignore_ap,
-               gboolean match_hidden)
+ap_list_match (NMDeviceWifi *self, NMAccessPoint *find_ap, gboolean strict_match)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	NMAccessPoint *found;
+	char *key;
+
+	/* A non-strict match without a BSSID may match any BSSID */
+	if (!strict_match && !nm_ethernet_address_is_valid (nm_ap_get_address (find_ap)))
+		return nm_ap_match_in_list (find_ap, priv->ap_list, strict_match);
+
+	key = ap_index_key (find_ap, FALSE);
+	found = nm_ap_match_in_list (find_ap, g_hash_table_lookup (priv->aps_by_key, key), strict_match);
+	g_free (key);
+
+	/* APs without a valid BSSID match any BSSID */
+	if (!found && nm_ethernet_address_is_valid (nm_ap_get_address (find_ap))) {
+		key = ap_index_key (find_ap, TRUE);
+		found = nm_ap_match_in_list (find_ap, g_hash_table_lookup (priv->aps_by_key, key), strict_match);
+		g_free (key);
+	}
+	return found;
+}
+
+static NMAccessPoint *
+get_active_ap_for_link (NMDeviceWifi *self,
+                        const WifiLinkSnapshot *link,
+                        NMAccessPoint *ignore_ap,
+                        gboolean match_hidden)
 {
 	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
 	const char *iface = nm_device_get_iface (NM_DEVICE (self));
-	struct ether_addr bssid;
-	GByteArray *ssid;
+	struct ether_addr bssid = link->bssid;
+	GByteArray *ssid = NULL;
 	GSList *iter;
 	int i = 0;
 	NMAccessPoint *match_nofreq = NULL, *active_ap = NULL;
@@ -510,7 +650,6 @@ get_active_ap (NMDeviceWifi *self,
 	NM80211Mode devmode;
 	guint32 devfreq;
 
-	wifi_utils_get_bssid (priv->wifi_data, &bssid);
 	nm_log_dbg (LOGD_WIFI, "(%s): active BSSID: %02x:%02x:%02x:%02x:%02x:%02x",
 	            iface,
 	            bssid.ether_addr_octet[0], bssid.ether_addr_octet[1],
@@ -520,7 +659,10 @@ get_active_ap (NMDeviceWifi *self,
 	if (!nm_ethernet_address_is_valid (&bssid))
 		return NULL;
 
-	ssid = wifi_utils_get_ssid (priv->wifi_data);
+	if (link->ssid_len) {
+		ssid = g_byte_array_sized_new (link->ssid_len);
+		g_byte_array_append (ssid, link->ssid, link->ssid_len);
+	}
 	nm_log_dbg (LOGD_WIFI, "(%s): active SSID: %s%s%s",
 	            iface,
 	            ssid ? "'" : "",
@@ -528,7 +670,7 @@ get_active_ap (NMDeviceWifi *self,
 	            ssid ? "'" : "");
 
 	devmode = wifi_utils_get_mode (priv->wifi_data);
-	devfreq = wifi_utils_get_freq (priv->wifi_data);
+	devfreq = link->freq;
 
 	/* When matching hidden APs, do a second pass that ignores the SSID check,
 	 * because NM might not yet know the SSID of the hidden AP in the scan list
@@ -632,6 +774,17 @@ done:
 	return active_ap;
 }
 
+static NMAccessPoint *
+get_active_ap (NMDeviceWifi *self,
+               NMAccessPoint *ignore_ap,
+               gboolean match_hidden)
+{
+	WifiLinkSnapshot link;
+
+	wifi_utils_get_link_snapshot (NM_DEVICE_WIFI_GET_PRIVATE (self)->wifi_data, &link);
+	return get_active_ap_for_link (self, &link, ignore_ap, match_hidden);
+}
+
 static void
 update_seen_bssids_cache (NMDeviceWifi *self, NMAccessPoint *ap)
 {
@@ -711,6 +864,7 @@ periodic_update (gpointer user_data)
 	guint32 new_rate, percent;
 	NMDeviceState state;
 	guint32 supplicant_state;
+	WifiLinkSnapshot link;
 
 	/* BSSID and signal strength have meaningful values only if the device
 	 * is activated and not scanning.
@@ -733,6 +887,9 @@ periodic_update (gpointer user_data)
 	if (priv->mode == NM_802_11_MODE_AP)
 		return TRUE;
 
+	/* Everything below comes from one query of the driver */
+	wifi_utils_get_link_snapshot (priv->wifi_data, &link);
+
 	/* In IBSS mode, most newer firmware/drivers do "BSS coalescing" where
 	 * multiple IBSS stations using the same SSID will eventually switch to
 	 * using the same BSSID to avoid network segmentation.  When this happens,
@@ -742,23 +899,24 @@ periodic_update (gpointer user_data)
 	 * current AP with it, if the current AP is adhoc.
 	 */
 	if (priv->current_ap && (nm_ap_get_mode (priv->current_ap) == NM_802_11_MODE_ADHOC)) {
-		struct ether_addr bssid = { {0x0, 0x0, 0x0, 0x0, 0x0, 0x0} };
+		struct ether_addr bssid = link.bssid;
 
-		wifi_utils_get_bssid (priv->wifi_data, &bssid);
 		/* 0x02 means "locally administered" and should be OR-ed into
 		 * the first byte of IBSS BSSIDs.
 		 */
 		if (   (bssid.ether_addr_octet[0] & 0x02)
-		    && nm_ethernet_address_is_valid (&bssid))
+		    && nm_ethernet_address_is_valid (&bssid)) {
 			nm_ap_set_address (priv->current_ap, &bssid);
+			ap_list_reindex (self, priv->current_ap);
+		}
 	}
 
-	new_ap = get_active_ap (self, NULL, FALSE);
+	new_ap = get_active_ap_for_link (self, &link, NULL, FALSE);
 	if (new_ap) {
 		/* Try to smooth out the strength.  Atmel cards, for example, will give no strength
 		 * one second and normal strength the next.
 		 */
-		percent = wifi_utils_get_qual (priv->wifi_data);
+		percent = link.qual;
 		if (percent >= 0 || ++priv->invalid_strength_counter > 3) {
 			nm_ap_set_strength (new_ap, (gint8) percent);
 			priv->invalid_strength_counter = 0;
@@ -796,7 +954,7 @@ periodic_update (gpointer user_data)
 		set_active_ap (self, new_ap);
 	}
 
-	new_rate = wifi_utils_get_rate (priv->wifi_data);
+	new_rate = link.rate;
 	if (new_rate != priv->rate) {
 		priv->rate = new_rate;
 		g_object_notify (G_OBJECT (self), NM_DEVICE_WIFI_BITRATE);
@@ -817,22 +975,58 @@ hw_bring_up (NMDevice *device, gboolean *no_firmware)
 static gboolean
 is_up (NMDevice *device)
 {
-	if (!NM_DEVICE_WIFI_GET_PRIVATE (device)->periodic_source_id)
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (device);
+
+	if (!priv->periodic_source_id && !priv->link_events)
 		return FALSE;
 
 	return TRUE;
 }
 
+static void
+link_event_cb (WifiData *data, WifiLinkEvent event, gpointer user_data)
+{
+	periodic_update (user_data);
+}
+
 static gboolean
 bring_up (NMDevice *dev)
 {
 	NMDeviceWifi *self = NM_DEVICE_WIFI (dev);
 	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
 
-	priv->periodic_source_id = g_timeout_add_seconds (6, periodic_update, self);
+	/* Prefer being told about link changes by the driver over waking up
+	 * every few seconds to ask.  The driver only reports connection changes
+	 * (and signal threshold crossings if the supplicant enabled them), and
+	 * the supplicant's BSS updates refresh the AP strength, so a slow poll
+	 * is enough to keep the Bitrate and strength from going stale.
+	 */
+	priv->link_events = wifi_utils_watch_link_events (priv->wifi_data, link_event_cb, self);
+	if (priv->link_events) {
+		nm_log_dbg (LOGD_WIFI, "(%s): monitoring link changes with driver events",
+		            nm_device_get_iface (dev));
+		priv->periodic_source_id = g_timeout_add_seconds (30, periodic_update, self);
+	} else
+		priv->periodic_source_id = g_timeout_add_seconds (6, periodic_update, self);
 	return TRUE;
 }
 
+static void
+stop_link_updates (NMDeviceWifi *self)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+
+	if (priv->periodic_source_id) {
+		g_source_remove (priv->periodic_source_id);
+		priv->periodic_source_id = 0;
+	}
+
+	if (priv->link_events) {
+		wifi_utils_unwatch_link_events (priv->wifi_data);
+		priv->link_events = FALSE;
+	}
+}
+
 static gboolean
 _set_hw_addr (NMDeviceWifi *self, const guint8 *addr, const char *detail)
 {
@@ -875,16 +1069,53 @@ _set_hw_addr (NMDeviceWifi *self, const guint8 *addr, const char *detail)
 	return success;
 }
 
+static gboolean
+connection_ssid_in_aps (NMDevice *device, NMConnection *connection, gpointer user_data)
+{
+	NMSettingWireless *s_wifi;
+	const GByteArray *ssid;
+	GSList *iter;
+
+	s_wifi = nm_connection_get_setting_wireless (connection);
+	if (!s_wifi)
+		return FALSE;
+	ssid = nm_setting_wireless_get_ssid (s_wifi);
+	if (!ssid)
+		return FALSE;
+
+	for (iter = (GSList *) user_data; iter; iter = g_slist_next (iter)) {
+		if (nm_utils_same_ssid (ssid, nm_ap_get_ssid (NM_AP (iter->data)), TRUE))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Only connections for the SSIDs of @aps can change availability */
 static void
-remove_access_point (NMDeviceWifi *device, NMAccessPoint *ap)
+update_available_connections_for_aps (NMDeviceWifi *self, GSList *aps)
 {
-	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (device);
+	if (aps)
+		nm_device_update_available_connections (NM_DEVICE (self), connection_ssid_in_aps, aps);
+}
 
+/* Returns the list's reference on @ap to the caller */
+static void
+remove_access_point_internal (NMDeviceWifi *device, NMAccessPoint *ap)
+{
 	g_signal_emit (device, signals[ACCESS_POINT_REMOVED], 0, ap);
-	priv->ap_list = g_slist_remove (priv->ap_list, ap);
-	g_object_unref (ap);
+	ap_list_remove (device, ap);
+}
 
-	nm_device_recheck_available_connections (NM_DEVICE (device));
+static void
+remove_access_point (NMDeviceWifi *device, NMAccessPoint *ap)
+{
+	GSList *removed;
+
+	remove_access_point_internal (device, ap);
+	removed = g_slist_prepend (NULL, ap);
+	update_available_connections_for_aps (device, removed);
+	g_slist_free (removed);
+	g_object_unref (ap);
 }
 
 static void
@@ -892,13 +1123,20 @@ remove_all_aps (NMDeviceWifi *self)
 {
 	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
 
+	clear_pending_bsses (self);
+
+	if (!priv->ap_list)
+		return;
+
 	/* Remove outdated APs */
-	while (g_slist_length (priv->ap_list)) {
+	while (priv->ap_list) {
 		NMAccessPoint *ap = NM_AP (priv->ap_list->data);
-		remove_access_point (self, ap);
+
+		remove_access_point_internal (self, ap);
+		g_object_unref (ap);
 	}
-	g_slist_free (priv->ap_list);
-	priv->ap_list = NULL;
+
+	nm_device_update_available_connections (NM_DEVICE (self), NULL, NULL);
 }
 
 static void
@@ -907,10 +1145,7 @@ take_down (NMDevice *dev)
 	NMDeviceWifi *self = NM_DEVICE_WIFI (dev);
 	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
 
-	if (priv->periodic_source_id) {
-		g_source_remove (priv->periodic_source_id);
-		priv->periodic_source_id = 0;
-	}
+	stop_link_updates (self);
 
 	cleanup_association_attempt (self, TRUE);
 	set_active_ap (self, NULL);
@@ -1392,19 +1627,17 @@ get_best_auto_connection (NMDevice *dev,
 {
 	NMDeviceWifi *self = NM_DEVICE_WIFI (dev);
 	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	const char *wifi_type = g_intern_static_string (NM_SETTING_WIRELESS_SETTING_NAME);
+	const char *shared_method = g_intern_static_string (NM_SETTING_IP4_CONFIG_METHOD_SHARED);
 	GSList *iter, *ap_iter;
 
 	for (iter = connections; iter; iter = g_slist_next (iter)) {
 		NMConnection *connection = NM_CONNECTION (iter->data);
-		NMSettingWireless *s_wireless;
-		const GByteArray *mac;
-		const GSList *mac_blacklist, *mac_blacklist_iter;
-		gboolean mac_blacklist_found = FALSE;
-		NMSettingIP4Config *s_ip4;
-		const char *method = NULL;
+		const NMSettingsConnectionMatch *match;
 		guint64 timestamp = 0;
 
-		if (!nm_connection_is_type (connection, NM_SETTING_WIRELESS_SETTING_NAME))
+		match = nm_settings_connection_get_match (NM_SETTINGS_CONNECTION (connection));
+		if (match->type != wifi_type)
 			continue;
 
 		/* Don't autoconnect to networks that have been tried at least once
@@ -1416,44 +1649,28 @@ get_best_auto_connection (NMDevice *dev,
 				continue;
 		}
 
-		s_wireless = nm_connection_get_setting_wireless (connection);
-		if (!s_wireless)
-			continue;
-
-		mac = nm_setting_wireless_get_mac_address (s_wireless);
-		if (mac && memcmp (mac->data, &priv->perm_hw_addr, ETH_ALEN))
-			continue;
-
-		/* Check for MAC address blacklist */
-		mac_blacklist = nm_setting_wireless_get_mac_address_blacklist (s_wireless);
-		for (mac_blacklist_iter = mac_blacklist; mac_blacklist_iter;
-		     mac_blacklist_iter = g_slist_next (mac_blacklist_iter)) {
-			struct ether_addr addr;
-
-			if (!ether_aton_r (mac_blacklist_iter->data, &addr)) {
-				g_warn_if_reached ();
-				continue;
-			}
-			if (memcmp (&addr, &priv->perm_hw_addr, ETH_ALEN) == 0) {
-				mac_blacklist_found = TRUE;
-				break;
-			}
-		}
-		/* Found device MAC address in the blacklist - do not use this connection */
-		if (mac_blacklist_found)
+		/* Connection locked to another device, or device MAC address in
+		 * the blacklist - do not use this connection.
+		 */
+		if (!nm_settings_connection_match_mac (match, &priv->perm_hw_addr))
 			continue;
 
 		/* Use the connection if it's a shared connection */
-		s_ip4 = nm_connection_get_setting_ip4_config (connection);
-		if (s_ip4)
-			method = nm_setting_ip4_config_get_method (s_ip4);
-
-		if (s_ip4 && !strcmp (method, NM_SETTING_IP4_CONFIG_METHOD_SHARED))
+		if (match->ip4_method == shared_method)
 			return connection;
 
 		for (ap_iter = priv->ap_list; ap_iter; ap_iter = g_slist_next (ap_iter)) {
 			NMAccessPoint *ap = NM_AP (ap_iter->data);
 
+			/* Cheap checks first */
+			if (!nm_utils_same_ssid (match->ssid, nm_ap_get_ssid (ap), TRUE))
+				continue;
+			if (   !match->secure
+			    && (   (nm_ap_get_flags (ap) & NM_802_11_AP_FLAGS_PRIVACY)
+			        || nm_ap_get_wpa_flags (ap) != NM_802_11_AP_SEC_NONE
+			        || nm_ap_get_rsn_flags (ap) != NM_802_11_AP_SEC_NONE))
+				continue;
+
 			if (nm_ap_check_compatible (ap, connection)) {
 				/* All good; connection is usable */
 				*specific_object = (char *) nm_ap_get_dbus_path (ap);
@@ -1500,6 +1717,16 @@ impl_device_get_access_points (NMDeviceWifi *self,
 	return TRUE;
 }
 
+static GPtrArray *
+get_exported_children (NMDevice *device, const char **out_name)
+{
+	GPtrArray *aps = NULL;
+
+	*out_name = "AccessPoints";
+	impl_device_get_access_points (NM_DEVICE_WIFI (device), &aps, NULL);
+	return aps;
+}
+
 static void
 request_scan_cb (NMDevice *device,
                  DBusGMethodInvocation *context,
@@ -1861,6 +2088,9 @@ supplicant_iface_scan_done_cb (NMSupplicantInterface *iface,
 
 	schedule_scan (self, success);
 
+	/* Merge the BSSes found by this scan in one go */
+	merge_pending_bsses (self);
+
 	/* Ensure that old APs get removed, which otherwise only
 	 * happens when there are new BSSes.
 	 */
@@ -1881,18 +2111,17 @@ supplicant_iface_scan_done_cb (NMSupplicantInterface *iface,
  *
  * If there is already an entry that matches the BSSID and ESSID of the
  * AP to merge, replace that entry with the scanned AP.  Otherwise, add
- * the scanned AP to the list.
+ * the scanned AP to the list.  Returns TRUE if a new AP was added.
  *
  * TODO: possibly need to differentiate entries based on security too; i.e. if
  * there are two scan results with the same BSSID and SSID but different
  * security options?
  *
  */
-static void
+static gboolean
 merge_scanned_ap (NMDeviceWifi *self,
                   NMAccessPoint *merge_ap)
 {
-	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
 	NMAccessPoint *found_ap = NULL;
 	const GByteArray *ssid;
 	const struct ether_addr *bssid;
@@ -1934,7 +2163,7 @@ merge_scanned_ap (NMDeviceWifi *self,
 
 	found_ap = get_ap_by_supplicant_path (self, nm_ap_get_supplicant_path (merge_ap));
 	if (!found_ap)
-		found_ap = nm_ap_match_in_list (merge_ap, priv->ap_list, strict_match);
+		found_ap = ap_list_match (self, merge_ap, strict_match);
 	if (found_ap) {
 		nm_log_dbg (LOGD_WIFI_SCAN, "(%s): merging AP '%s' " MAC_FMT " (%p) with existing (%p)",
 		            nm_device_get_iface (NM_DEVICE (self)),
@@ -1943,6 +2172,7 @@ merge_scanned_ap (NMDeviceWifi *self,
 		            merge_ap,
 		            found_ap);
 
+		ap_index_remove (self, found_ap);
 		nm_ap_set_supplicant_path (found_ap, nm_ap_get_supplicant_path (merge_ap));
 		nm_ap_set_flags (found_ap, nm_ap_get_flags (merge_ap));
 		nm_ap_set_wpa_flags (found_ap, nm_ap_get_wpa_flags (merge_ap));
@@ -1957,20 +2187,21 @@ merge_scanned_ap (NMDeviceWifi *self,
 		 * fake, since it clearly exists somewhere.
 		 */
 		nm_ap_set_fake (found_ap, FALSE);
-	} else {
-		/* New entry in the list */
-		nm_log_dbg (LOGD_WIFI_SCAN, "(%s): adding new AP '%s' " MAC_FMT " (%p)",
-		            nm_device_get_iface (NM_DEVICE (self)),
-		            ssid ? nm_utils_escape_ssid (ssid->data, ssid->len) : "(none)",
-		            MAC_ARG (bssid->ether_addr_octet),
-		            merge_ap);
-
-		g_object_ref (merge_ap);
-		priv->ap_list = g_slist_prepend (priv->ap_list, merge_ap);
-		nm_ap_export_to_dbus (merge_ap);
-		g_signal_emit (self, signals[ACCESS_POINT_ADDED], 0, merge_ap);
-		nm_device_recheck_available_connections (NM_DEVICE (self));
+		ap_index_add (self, found_ap);
+		return FALSE;
 	}
+
+	/* New entry in the list */
+	nm_log_dbg (LOGD_WIFI_SCAN, "(%s): adding new AP '%s' " MAC_FMT " (%p)",
+	            nm_device_get_iface (NM_DEVICE (self)),
+	            ssid ? nm_utils_escape_ssid (ssid->data, ssid->len) : "(none)",
+	            MAC_ARG (bssid->ether_addr_octet),
+	            merge_ap);
+
+	ap_list_add (self, g_object_ref (merge_ap));
+	nm_ap_export_to_dbus (merge_ap);
+	g_signal_emit (self, signals[ACCESS_POINT_ADDED], 0, merge_ap);
+	return TRUE;
 }
 
 #define WPAS_REMOVED_TAG "supplicant-removed"
@@ -2012,7 +2243,7 @@ cull_scan_list (NMDeviceWifi *self)
 			continue;
 
 		if (nm_ap_get_last_seen (ap) + prune_interval_s < now)
-			outdated_list = g_slist_append (outdated_list, ap);
+			outdated_list = g_slist_prepend (outdated_list, ap);
 	}
 
 	/* Remove outdated APs */
@@ -2032,10 +2263,9 @@ cull_scan_list (NMDeviceWifi *self)
 		            ssid ? nm_utils_escape_ssid (ssid->data, ssid->len) : "(none)",
 		            ssid ? "'" : "");
 
-		remove_access_point (self, outdated_ap);
+		remove_access_point_internal (self, outdated_ap);
 		removed++;
 	}
-	g_slist_free (outdated_list);
 
 	nm_log_dbg (LOGD_WIFI_SCAN, "(%s): removed %d APs (of %d)",
 	            nm_device_get_iface (NM_DEVICE (self)),
@@ -2043,8 +2273,9 @@ cull_scan_list (NMDeviceWifi *self)
 
 	ap_list_dump (self);
 
-	if(removed > 0)
-	    nm_device_recheck_available_connections (NM_DEVICE (self));
+	update_available_connections_for_aps (self, outdated_list);
+	g_slist_foreach (outdated_list, (GFunc) g_object_unref, NULL);
+	g_slist_free (outdated_list);
 
 	return FALSE;
 }
@@ -2060,6 +2291,61 @@ schedule_scanlist_cull (NMDeviceWifi *self)
 	priv->scanlist_cull_id = g_timeout_add_seconds (4, (GSourceFunc) cull_scan_list, self);
 }
 
+static void
+merge_pending_bsses (NMDeviceWifi *self)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+	GSList *pending, *iter, *added = NULL;
+
+	if (priv->pending_bss_id) {
+		g_source_remove (priv->pending_bss_id);
+		priv->pending_bss_id = 0;
+	}
+
+	pending = g_slist_reverse (priv->pending_bsses);
+	priv->pending_bsses = NULL;
+
+	for (iter = pending; iter; iter = g_slist_next (iter)) {
+		NMAccessPoint *ap = NM_AP (iter->data);
+
+		if (merge_scanned_ap (self, ap))
+			added = g_slist_prepend (added, ap);
+	}
+
+	/* Only re-evaluate connections once for the whole batch, and only
+	 * those matching the SSIDs of new APs.
+	 */
+	update_available_connections_for_aps (self, added);
+	g_slist_free (added);
+
+	g_slist_foreach (pending, (GFunc) g_object_unref, NULL);
+	g_slist_free (pending);
+}
+
+static gboolean
+merge_pending_bsses_cb (gpointer user_data)
+{
+	NMDeviceWifi *self = NM_DEVICE_WIFI (user_data);
+
+	NM_DEVICE_WIFI_GET_PRIVATE (self)->pending_bss_id = 0;
+	merge_pending_bsses (self);
+	return FALSE;
+}
+
+static void
+clear_pending_bsses (NMDeviceWifi *self)
+{
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+
+	if (priv->pending_bss_id) {
+		g_source_remove (priv->pending_bss_id);
+		priv->pending_bss_id = 0;
+	}
+	g_slist_foreach (priv->pending_bsses, (GFunc) g_object_unref, NULL);
+	g_slist_free (priv->pending_bsses);
+	priv->pending_bsses = NULL;
+}
+
 static void
 supplicant_iface_new_bss_cb (NMSupplicantInterface *iface,
                              const char *object_path,
@@ -2082,11 +2368,17 @@ supplicant_iface_new_bss_cb (NMSupplicantInterface *iface,
 
 	ap = nm_ap_new_from_properties (object_path, properties);
 	if (ap) {
+		NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+
 		nm_ap_dump (ap, "New AP: ");
 
-		/* Add the AP to the device's AP list */
-		merge_scanned_ap (self, ap);
-		g_object_unref (ap);
+		/* Queue the AP for merging into the device's AP list; BSSes are
+		 * merged in one batch when the scan completes, or once the
+		 * mainloop is idle if they arrive outside of a scan.
+		 */
+		priv->pending_bsses = g_slist_prepend (priv->pending_bsses, ap);
+		if (!priv->pending_bss_id && !nm_supplicant_interface_get_scanning (iface))
+			priv->pending_bss_id = g_idle_add (merge_pending_bsses_cb, self);
 	} else {
 		nm_log_warn (LOGD_WIFI_SCAN, "(%s): invalid AP properties received",
 		             nm_device_get_iface (NM_DEVICE (self)));
@@ -2115,6 +2407,7 @@ supplicant_iface_bss_updated_cb (NMSupplicantInterface *iface,
 		return;
 
 	/* Update the AP's last-seen property */
+	merge_pending_bsses (self);
 	ap = get_ap_by_supplicant_path (self, object_path);
 	if (ap)
 		nm_ap_set_last_seen (ap, (guint32) time (NULL));
@@ -2133,6 +2426,7 @@ supplicant_iface_bss_removed_cb (NMSupplicantInterface *iface,
 	g_return_if_fail (self != NULL);
 	g_return_if_fail (object_path != NULL);
 
+	merge_pending_bsses (self);
 	ap = get_ap_by_supplicant_path (self, object_path);
 	if (ap)
 		g_object_set_data (G_OBJECT (ap), WPAS_REMOVED_TAG, GUINT_TO_POINTER (TRUE));
@@ -3015,6 +3309,8 @@ act_stage1_prepare (NMDevice *dev, NMDeviceStateReason *reason)
 	 * the device is deactivated (Hotspot).
 	 */
 	if (!ap) {
+		GSList *added;
+
 		ap = nm_ap_new_fake_from_connection (connection);
 		g_return_val_if_fail (ap != NULL, NM_ACT_STAGE_RETURN_FAILURE);
 
@@ -3023,10 +3319,12 @@ act_stage1_prepare (NMDevice *dev, NMDeviceStateReason *reason)
 		else if (nm_ap_is_hotspot (ap))
 			nm_ap_set_address (ap, (const struct ether_addr *) &priv->hw_addr);
 
-		priv->ap_list = g_slist_prepend (priv->ap_list, ap);
+		ap_list_add (self, ap);
 		nm_ap_export_to_dbus (ap);
 		g_signal_emit (self, signals[ACCESS_POINT_ADDED], 0, ap);
-		nm_device_recheck_available_connections (NM_DEVICE (self));
+		added = g_slist_prepend (NULL, ap);
+		update_available_connections_for_aps (self, added);
+		g_slist_free (added);
 	}
 
 	nm_active_connection_set_specific_object (NM_ACTIVE_CONNECTION (req), nm_ap_get_dbus_path (ap));
@@ -3323,7 +3621,7 @@ activation_success_handler (NMDevice *dev)
 	NMDeviceWifi *self = NM_DEVICE_WIFI (dev);
 	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
 	NMAccessPoint *ap;
-	struct ether_addr bssid = { {0x0, 0x0, 0x0, 0x0, 0x0, 0x0} };
+	WifiLinkSnapshot link;
 	NMAccessPoint *tmp_ap;
 	NMActRequest *req;
 	NMConnection *connection;
@@ -3349,15 +3647,17 @@ activation_success_handler (NMDevice *dev)
 	 * But if activation was successful, the card will know the BSSID.  Grab
 	 * the BSSID off the card and fill in the BSSID of the activation AP.
 	 */
-	wifi_utils_get_bssid (priv->wifi_data, &bssid);
-	if (!nm_ethernet_address_is_valid (nm_ap_get_address (ap)))
-		nm_ap_set_address (ap, &bssid);
+	wifi_utils_get_link_snapshot (priv->wifi_data, &link);
+	if (!nm_ethernet_address_is_valid (nm_ap_get_address (ap))) {
+		nm_ap_set_address (ap, &link.bssid);
+		ap_list_reindex (self, ap);
+	}
 	if (!nm_ap_get_freq (ap))
-		nm_ap_set_freq (ap, wifi_utils_get_freq (priv->wifi_data));
+		nm_ap_set_freq (ap, link.freq);
 	if (!nm_ap_get_max_bitrate (ap))
-		nm_ap_set_max_bitrate (ap, wifi_utils_get_rate (priv->wifi_data));
+		nm_ap_set_max_bitrate (ap, link.rate);
 
-	tmp_ap = get_active_ap (self, ap, TRUE);
+	tmp_ap = get_active_ap_for_link (self, &link, ap, TRUE);
 	if (tmp_ap) {
 		const GByteArray *ssid = nm_ap_get_ssid (tmp_ap);
 
@@ -3366,13 +3666,15 @@ activation_success_handler (NMDevice *dev)
 		 */
 
 		/* If the better match was a hidden AP, update it's SSID */
-		if (!ssid || nm_utils_is_empty_ssid (ssid->data, ssid->len))
+		if (!ssid || nm_utils_is_empty_ssid (ssid->data, ssid->len)) {
 			nm_ap_set_ssid (tmp_ap, nm_ap_get_ssid (ap));
+			ap_list_reindex (self, tmp_ap);
+		}
 
 		nm_active_connection_set_specific_object (NM_ACTIVE_CONNECTION (req),
 		                                          nm_ap_get_dbus_path (tmp_ap));
 
-		priv->ap_list = g_slist_remove (priv->ap_list, ap);
+		ap_list_remove (self, ap);
 		g_object_unref (ap);
 	}
 
@@ -3641,7 +3943,11 @@ nm_device_wifi_new (const char *udi,
 static void
 nm_device_wifi_init (NMDeviceWifi *self)
 {
-	NM_DEVICE_WIFI_GET_PRIVATE (self)->mode = NM_802_11_MODE_INFRA;
+	NMDeviceWifiPrivate *priv = NM_DEVICE_WIFI_GET_PRIVATE (self);
+
+	priv->mode = NM_802_11_MODE_INFRA;
+	priv->aps_by_supplicant_path = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->aps_by_key = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 }
 
 static void
@@ -3657,10 +3963,7 @@ dispose (GObject *object)
 
 	priv->disposed = TRUE;
 
-	if (priv->periodic_source_id) {
-		g_source_remove (priv->periodic_source_id);
-		priv->periodic_source_id = 0;
-	}
+	stop_link_updates (self);
 
 	cleanup_association_attempt (self, TRUE);
 	supplicant_interface_release (self);
@@ -3672,6 +3975,8 @@ dispose (GObject *object)
 
 	set_active_ap (self, NULL);
 	remove_all_aps (self);
+	g_hash_table_destroy (priv->aps_by_supplicant_path);
+	g_hash_table_destroy (priv->aps_by_key);
 
 	if (priv->wifi_data)
 		wifi_utils_deinit (priv->wifi_data);
@@ -3783,6 +4088,7 @@ nm_device_wifi_class_init (NMDeviceWifiClass *klass)
 	parent_class->can_interrupt_activation = can_interrupt_activation;
 	parent_class->spec_match_list = spec_match_list;
 	parent_class->hwaddr_matches = hwaddr_matches;
+	parent_class->get_exported_children = get_exported_children;
 
 	parent_class->state_changed = device_state_changed;
 
@@ -181,6 +181,8 @@ typedef struct {
 	RfKillType    rfkill_type;
 	gboolean      firmware_missing;
 	GHashTable *  available_connections;
+	GHashTable *  compatible_connections; /* check_connection_compatible() cache */
+	gboolean      compatible_valid;
 
 	guint32         ip4_address;
 
@@ -307,6 +309,7 @@ nm_device_init (NMDevice *self)
 	priv->rfkill_type = RFKILL_TYPE_UNKNOWN;
 	priv->autoconnect = DEFAULT_AUTOCONNECT;
 	priv->available_connections = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+	priv->compatible_connections = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
 }
 
 static void
@@ -4337,6 +4340,7 @@ dispose (GObject *object)
 	}
 
 	g_hash_table_unref (priv->available_connections);
+	g_hash_table_unref (priv->compatible_connections);
 
 	activation_source_clear (self, TRUE, AF_INET);
 	activation_source_clear (self, TRUE, AF_INET6);
@@ -5077,10 +5081,13 @@ nm_device_state_changed (NMDevice *device,
 	if (state <= NM_DEVICE_STATE_UNAVAILABLE)
 		_clear_available_connections (device, TRUE);
 
-	/* Update the available connections list when a device first becomes available */
+	/* Update the available connections list when a device first becomes
+	 * available; compatibility doesn't depend on the device state, so only
+	 * availability needs to be rechecked.
+	 */
 	if (   state >= NM_DEVICE_STATE_DISCONNECTED
 	    && old_state < NM_DEVICE_STATE_DISCONNECTED)
-		nm_device_recheck_available_connections (device);
+		nm_device_update_available_connections (device, NULL, NULL);
 
 	/* Handle the new state here; but anything that could trigger
 	 * another state change should be done below.
@@ -5511,35 +5518,120 @@ _signal_available_connections_changed (NMDevice *device)
 static void
 _clear_available_connections (NMDevice *device, gboolean do_signal)
 {
-	g_hash_table_remove_all (NM_DEVICE_GET_PRIVATE (device)->available_connections);
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (device);
+
+	if (g_hash_table_size (priv->available_connections) == 0)
+		return;
+
+	g_hash_table_remove_all (priv->available_connections);
 	if (do_signal == TRUE)
 		_signal_available_connections_changed (device);
 }
 
 static gboolean
-_try_add_available_connection (NMDevice *self, NMConnection *connection)
+_check_compatible (NMDevice *self, NMConnection *connection)
 {
-	if (nm_device_get_state (self) < NM_DEVICE_STATE_DISCONNECTED)
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+
+	if (!nm_device_check_connection_compatible (self, connection, NULL))
 		return FALSE;
 
-	if (nm_device_check_connection_compatible (self, connection, NULL)) {
-		/* Let subclasses implement additional checks on the connection */
-		if (   NM_DEVICE_GET_CLASS (self)->check_connection_available
-		    && NM_DEVICE_GET_CLASS (self)->check_connection_available (self, connection)) {
+	g_hash_table_insert (priv->compatible_connections,
+	                     g_object_ref (connection),
+	                     GUINT_TO_POINTER (1));
+	return TRUE;
+}
 
-			g_hash_table_insert (NM_DEVICE_GET_PRIVATE (self)->available_connections,
-					             g_object_ref (connection),
-					             GUINT_TO_POINTER (1));
-			return TRUE;
-		}
+static void
+_ensure_compatible_connections (NMDevice *self)
+{
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+	const GSList *connections, *iter;
+
+	if (priv->compatible_valid || !priv->con_provider)
+		return;
+
+	g_hash_table_remove_all (priv->compatible_connections);
+	connections = nm_connection_provider_get_connections (priv->con_provider);
+	for (iter = connections; iter; iter = g_slist_next (iter))
+		_check_compatible (self, NM_CONNECTION (iter->data));
+	priv->compatible_valid = TRUE;
+}
+
+/* Re-runs the subclass availability check for a connection already known
+ * to be compatible with the device.  Returns TRUE if the available
+ * connections changed.
+ */
+static gboolean
+_update_available_connection (NMDevice *self, NMConnection *connection)
+{
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+	gboolean available = FALSE, was_available;
+
+	if (   nm_device_get_state (self) >= NM_DEVICE_STATE_DISCONNECTED
+	    && g_hash_table_lookup (priv->compatible_connections, connection)) {
+		/* Let subclasses implement additional checks on the connection */
+		available =    NM_DEVICE_GET_CLASS (self)->check_connection_available
+		            && NM_DEVICE_GET_CLASS (self)->check_connection_available (self, connection);
 	}
-	return FALSE;
+
+	was_available = !!g_hash_table_lookup (priv->available_connections, connection);
+	if (available == was_available)
+		return FALSE;
+
+	if (available) {
+		g_hash_table_insert (priv->available_connections,
+		                     g_object_ref (connection),
+		                     GUINT_TO_POINTER (1));
+	} else
+		g_hash_table_remove (priv->available_connections, connection);
+	return TRUE;
 }
 
 static gboolean
-_del_available_connection (NMDevice *device, NMConnection *connection)
+_recheck_available_connections (NMDevice *self,
+                                gboolean recheck_compatible,
+                                NMDeviceConnectionFilterFunc filter,
+                                gpointer user_data)
 {
-	return g_hash_table_remove (NM_DEVICE_GET_PRIVATE (device)->available_connections, connection);
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+	GHashTableIter iter;
+	gpointer connection;
+	gboolean changed = FALSE;
+
+	if (recheck_compatible)
+		priv->compatible_valid = FALSE;
+
+	if (nm_device_get_state (self) < NM_DEVICE_STATE_DISCONNECTED) {
+		if (g_hash_table_size (priv->available_connections)) {
+			g_hash_table_remove_all (priv->available_connections);
+			changed = TRUE;
+		}
+		return changed;
+	}
+
+	_ensure_compatible_connections (self);
+
+	if (recheck_compatible) {
+		/* Drop anything that isn't compatible anymore */
+		g_hash_table_iter_init (&iter, priv->available_connections);
+		while (g_hash_table_iter_next (&iter, &connection, NULL)) {
+			if (!g_hash_table_lookup (priv->compatible_connections, connection)) {
+				g_hash_table_iter_remove (&iter);
+				changed = TRUE;
+			}
+		}
+	}
+
+	g_hash_table_iter_init (&iter, priv->compatible_connections);
+	while (g_hash_table_iter_next (&iter, &connection, NULL)) {
+		if (filter && !filter (self, NM_CONNECTION (connection), user_data))
+			continue;
+		if (_update_available_connection (self, NM_CONNECTION (connection)))
+			changed = TRUE;
+	}
+
+	return changed;
 }
 
 static gboolean
@@ -5551,66 +5643,91 @@ check_connection_available (NMDevice *device, NMConnection *connection)
 	return TRUE;
 }
 
+/**
+ * nm_device_recheck_available_connections:
+ * @device: the #NMDevice
+ *
+ * Re-checks every connection for compatibility with and availability on
+ * @device from scratch.
+ **/
 void
 nm_device_recheck_available_connections (NMDevice *device)
 {
-	NMDevicePrivate *priv;
-	const GSList *connections, *iter;
-
 	g_return_if_fail (device != NULL);
 	g_return_if_fail (NM_IS_DEVICE (device));
 
-	priv = NM_DEVICE_GET_PRIVATE(device);
-
-	_clear_available_connections (device, FALSE);
+	if (_recheck_available_connections (device, TRUE, NULL, NULL))
+		_signal_available_connections_changed (device);
+}
 
-	connections = nm_connection_provider_get_connections (priv->con_provider);
-	for (iter = connections; iter; iter = g_slist_next (iter))
-		_try_add_available_connection (device, NM_CONNECTION (iter->data));
+/**
+ * nm_device_update_available_connections:
+ * @device: the #NMDevice
+ * @filter: (allow-none): only recheck connections this returns %TRUE for
+ * @user_data: data for @filter
+ *
+ * Re-runs only the availability check (eg, against the scan list) for
+ * connections already known to be compatible with @device.  Subclasses
+ * should call this when live network information changes, passing a
+ * @filter that selects the connections that change could affect.
+ **/
+void
+nm_device_update_available_connections (NMDevice *device,
+                                        NMDeviceConnectionFilterFunc filter,
+                                        gpointer user_data)
+{
+	g_return_if_fail (device != NULL);
+	g_return_if_fail (NM_IS_DEVICE (device));
 
-	_signal_available_connections_changed (device);
+	if (_recheck_available_connections (device, FALSE, filter, user_data))
+		_signal_available_connections_changed (device);
 }
 
 static void
 cp_connection_added (NMConnectionProvider *cp, NMConnection *connection, gpointer user_data)
 {
-	if (_try_add_available_connection (NM_DEVICE (user_data), connection))
-		_signal_available_connections_changed (NM_DEVICE (user_data));
+	NMDevice *self = NM_DEVICE (user_data);
+
+	if (NM_DEVICE_GET_PRIVATE (self)->compatible_valid)
+		_check_compatible (self, connection);
+	else if (nm_device_get_state (self) >= NM_DEVICE_STATE_DISCONNECTED)
+		_ensure_compatible_connections (self);
+
+	if (_update_available_connection (self, connection))
+		_signal_available_connections_changed (self);
 }
 
 static void
 cp_connections_loaded (NMConnectionProvider *cp, NMConnection *connection, gpointer user_data)
 {
-	const GSList *connections, *iter;
-	gboolean added = FALSE;
-
-	connections = nm_connection_provider_get_connections (cp);
-	for (iter = connections; iter; iter = g_slist_next (iter))
-		added |= _try_add_available_connection (NM_DEVICE (user_data), NM_CONNECTION (iter->data));
-
-	if (added)
+	if (_recheck_available_connections (NM_DEVICE (user_data), TRUE, NULL, NULL))
 		_signal_available_connections_changed (NM_DEVICE (user_data));
 }
 
 static void
 cp_connection_removed (NMConnectionProvider *cp, NMConnection *connection, gpointer user_data)
 {
-	if (_del_available_connection (NM_DEVICE (user_data), connection))
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (user_data);
+
+	g_hash_table_remove (priv->compatible_connections, connection);
+	if (g_hash_table_remove (priv->available_connections, connection))
 		_signal_available_connections_changed (NM_DEVICE (user_data));
 }
 
 static void
 cp_connection_updated (NMConnectionProvider *cp, NMConnection *connection, gpointer user_data)
 {
-	gboolean added, deleted;
+	NMDevice *self = NM_DEVICE (user_data);
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
 
-	/* FIXME: don't remove it from the hash if it's just going to get re-added */
-	deleted = _del_available_connection (NM_DEVICE (user_data), connection);
-	added = _try_add_available_connection (NM_DEVICE (user_data), connection);
+	/* Only this connection needs to be re-tested against the device */
+	if (priv->compatible_valid) {
+		g_hash_table_remove (priv->compatible_connections, connection);
+		_check_compatible (self, connection);
+	}
 
-	/* Only signal if the connection was removed OR added, but not both */
-	if (added != deleted)
-		_signal_available_connections_changed (NM_DEVICE (user_data));
+	if (_update_available_connection (self, connection))
+		_signal_available_connections_changed (self);
 }
 
 gboolean
@@ -5620,6 +5737,25 @@ nm_device_supports_vlans (NMDevice *device)
 	return NM_IS_DEVICE_ETHERNET (device);
 }
 
+/**
+ * nm_device_get_exported_children:
+ * @device: the device
+ * @out_name: on return, the D-Bus pseudo-property name of the children
+ *
+ * Returns: (transfer full): object paths of the device's child objects that
+ * are only exported through a method call, or %NULL if it has none
+ */
+GPtrArray *
+nm_device_get_exported_children (NMDevice *device, const char **out_name)
+{
+	g_return_val_if_fail (NM_IS_DEVICE (device), NULL);
+	g_return_val_if_fail (out_name != NULL, NULL);
+
+	if (NM_DEVICE_GET_CLASS (device)->get_exported_children)
+		return NM_DEVICE_GET_CLASS (device)->get_exported_children (device, out_name);
+	return NULL;
+}
+
 /**
  * nm_device_read_hwaddr:
  * @dev: the device
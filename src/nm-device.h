@@ -191,6 +191,12 @@ typedef struct {
 
 	gboolean        (* have_any_ready_slaves) (NMDevice *self,
 	                                           const GSList *slaves);
+
+	/* Returns the object paths of child objects only exported through a
+	 * Get<Name> method (like access points), and sets @out_name to <Name>.
+	 */
+	GPtrArray *     (* get_exported_children) (NMDevice *self,
+	                                           const char **out_name);
 } NMDeviceClass;
 
 
@@ -306,6 +312,8 @@ void nm_device_set_connection_provider (NMDevice *device, NMConnectionProvider *
 
 gboolean nm_device_supports_vlans (NMDevice *device);
 
+GPtrArray *nm_device_get_exported_children (NMDevice *device, const char **out_name);
+
 G_END_DECLS
 
 #endif	/* NM_DEVICE_H */
@@ -178,25 +178,32 @@ dispatcher_done_cb (DBusGProxy *proxy, DBusGProxyCall *call, gpointer user_data)
 			GValue *tmp;
 			const char *script, *err;
 			DispatchResult result;
+			guint elapsed;
 
 			if (   (G_VALUE_TYPE (g_value_array_get_nth (item, 0)) == G_TYPE_STRING)
 			    && (G_VALUE_TYPE (g_value_array_get_nth (item, 1)) == G_TYPE_UINT)
-			    && (G_VALUE_TYPE (g_value_array_get_nth (item, 2)) == G_TYPE_STRING)) {
+			    && (G_VALUE_TYPE (g_value_array_get_nth (item, 2)) == G_TYPE_STRING)
+			    && (G_VALUE_TYPE (g_value_array_get_nth (item, 3)) == G_TYPE_UINT)) {
+				/* script */
+				tmp = g_value_array_get_nth (item, 0);
+				script = g_value_get_string (tmp);
+
+				/* wall time */
+				tmp = g_value_array_get_nth (item, 3);
+				elapsed = g_value_get_uint (tmp);
+
 				/* result */
 				tmp = g_value_array_get_nth (item, 1);
 				result = g_value_get_uint (tmp);
 				if (result != DISPATCH_RESULT_SUCCESS) {
-					/* script */
-					tmp = g_value_array_get_nth (item, 0);
-					script = g_value_get_string (tmp);
-
 					/* error */
 					tmp = g_value_array_get_nth (item, 2);
 					err = g_value_get_string (tmp);
 
-					nm_log_warn (LOGD_CORE, "Dispatcher script %s: %s",
-					             dispatch_result_to_string (result), err);
-				}
+					nm_log_warn (LOGD_CORE, "Dispatcher script %s after %u ms: %s",
+					             dispatch_result_to_string (result), elapsed, err);
+				} else
+					nm_log_dbg (LOGD_CORE, "Dispatcher script %s took %u ms", script, elapsed);
 			} else
 				nm_log_dbg (LOGD_CORE, "Dispatcher result element %d invalid type", i);
 
@@ -44,7 +44,8 @@ G_DEFINE_TYPE (NMIP4Config, nm_ip4_config, G_TYPE_OBJECT)
 typedef struct {
 	char *path;
 
-	GSList *addresses;
+	GPtrArray *addresses;
+	GHashTable *addresses_index; /* see index_get(), built on demand */
 	guint32	ptp_address;
 
 	guint32	mtu;	/* Maximum Transmission Unit of the interface */
@@ -59,7 +60,8 @@ typedef struct {
 	GArray *nis;
 	char * nis_domain;
 
-	GSList *routes;
+	GPtrArray *routes;
+	GHashTable *routes_index; /* see index_get(), built on demand */
 
 	gboolean never_default;
 } NMIP4ConfigPrivate;
@@ -91,6 +93,156 @@ nm_utils_ip4_addr_to_nl_addr (guint32 ip4_addr)
 }
 
 
+static guint
+address_key_hash (gconstpointer key)
+{
+	return nm_ip4_address_get_address ((NMIP4Address *) key);
+}
+
+static gboolean
+address_key_equal (gconstpointer a, gconstpointer b)
+{
+	return nm_ip4_address_get_address ((NMIP4Address *) a) == nm_ip4_address_get_address ((NMIP4Address *) b);
+}
+
+static gboolean
+address_equal (gconstpointer a, gconstpointer b)
+{
+	return nm_ip4_address_compare ((NMIP4Address *) a, (NMIP4Address *) b);
+}
+
+static guint
+route_key_hash (gconstpointer key)
+{
+	NMIP4Route *route = (NMIP4Route *) key;
+
+	return   nm_ip4_route_get_dest (route)
+	       ^ (nm_ip4_route_get_prefix (route) << 24)
+	       ^ (nm_ip4_route_get_next_hop (route) * 31);
+}
+
+static gboolean
+route_key_equal (gconstpointer a, gconstpointer b)
+{
+	NMIP4Route *route_a = (NMIP4Route *) a;
+	NMIP4Route *route_b = (NMIP4Route *) b;
+
+	return    nm_ip4_route_get_dest (route_a) == nm_ip4_route_get_dest (route_b)
+	       && nm_ip4_route_get_prefix (route_a) == nm_ip4_route_get_prefix (route_b)
+	       && nm_ip4_route_get_next_hop (route_a) == nm_ip4_route_get_next_hop (route_b);
+}
+
+static gboolean
+route_equal (gconstpointer a, gconstpointer b)
+{
+	return nm_ip4_route_compare ((NMIP4Route *) a, (NMIP4Route *) b);
+}
+
+static gint
+position_compare (gconstpointer a, gconstpointer b)
+{
+	guint pos_a = GPOINTER_TO_UINT (a), pos_b = GPOINTER_TO_UINT (b);
+
+	return pos_a < pos_b ? -1 : (pos_a > pos_b);
+}
+
+/* Stores @positions for the key of @item, keyed on the item at the first
+ * position so the key stays valid while that item is in @items.
+ */
+static void
+index_set_positions (GHashTable *index, GPtrArray *items, gpointer item, GSList *positions)
+{
+	g_hash_table_steal (index, item);
+	if (positions)
+		g_hash_table_insert (index, g_ptr_array_index (items, GPOINTER_TO_UINT (positions->data)), positions);
+}
+
+static void
+index_insert (GHashTable *index, GPtrArray *items, guint pos)
+{
+	gpointer item = g_ptr_array_index (items, pos);
+	GSList *positions;
+
+	if (index) {
+		positions = g_hash_table_lookup (index, item);
+		positions = g_slist_insert_sorted (positions, GUINT_TO_POINTER (pos), position_compare);
+		index_set_positions (index, items, item, positions);
+	}
+}
+
+static void
+index_remove (GHashTable *index, GPtrArray *items, guint pos)
+{
+	gpointer item = g_ptr_array_index (items, pos);
+	GSList *positions;
+
+	if (index) {
+		positions = g_hash_table_lookup (index, item);
+		positions = g_slist_remove (positions, GUINT_TO_POINTER (pos));
+		index_set_positions (index, items, item, positions);
+	}
+}
+
+/* Returns the index of @items, (re)building it if needed.  It maps the
+ * fields that make an item a dupe when merging (see
+ * nm_utils_merge_ip4_config()) to the ascending positions of the items
+ * with those fields; it serves both merging and de-duplication.
+ */
+static GHashTable *
+index_get (GPtrArray *items, GHashTable **index, GHashFunc hash_func, GEqualFunc key_equal_func)
+{
+	guint i;
+
+	if (!*index) {
+		*index = g_hash_table_new_full (hash_func, key_equal_func, NULL, (GDestroyNotify) g_slist_free);
+		for (i = 0; i < items->len; i++)
+			index_insert (*index, items, i);
+	}
+	return *index;
+}
+
+/* Returns TRUE if @items has an item equal to @item */
+static gboolean
+index_contains (GHashTable *index, GPtrArray *items, gconstpointer item, GEqualFunc equal_func)
+{
+	GSList *iter;
+
+	for (iter = g_hash_table_lookup (index, item); iter; iter = g_slist_next (iter)) {
+		if (equal_func (g_ptr_array_index (items, GPOINTER_TO_UINT (iter->data)), item))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Returns the position of the first item with the same key as @item, or -1 */
+static int
+index_find (GHashTable *index, gconstpointer item)
+{
+	GSList *positions = g_hash_table_lookup (index, item);
+
+	return positions ? (int) GPOINTER_TO_UINT (positions->data) : -1;
+}
+
+static void
+index_invalidate (GHashTable **index)
+{
+	if (*index) {
+		g_hash_table_destroy (*index);
+		*index = NULL;
+	}
+}
+
+static GSList *
+ptr_array_to_slist (GPtrArray *array)
+{
+	GSList *list = NULL;
+	guint i;
+
+	for (i = array->len; i > 0; i--)
+		list = g_slist_prepend (list, g_ptr_array_index (array, i - 1));
+	return list;
+}
+
 NMIP4Config *
 nm_ip4_config_new (void)
 {
@@ -135,7 +287,8 @@ nm_ip4_config_take_address (NMIP4Config *config, NMIP4Address *address)
 	g_return_if_fail (address != NULL);
 
 	priv = NM_IP4_CONFIG_GET_PRIVATE (config);
-	priv->addresses = g_slist_append (priv->addresses, address);
+	g_ptr_array_add (priv->addresses, address);
+	index_insert (priv->addresses_index, priv->addresses, priv->addresses->len - 1);
 }
 
 void
@@ -143,18 +296,18 @@ nm_ip4_config_add_address (NMIP4Config *config,
                            NMIP4Address *address)
 {
 	NMIP4ConfigPrivate *priv;
-	GSList *iter;
+	GHashTable *index;
 
 	g_return_if_fail (NM_IS_IP4_CONFIG (config));
 	g_return_if_fail (address != NULL);
 
 	priv = NM_IP4_CONFIG_GET_PRIVATE (config);
-	for (iter = priv->addresses; iter; iter = g_slist_next (iter)) {
-		if (nm_ip4_address_compare ((NMIP4Address *) iter->data, address))
-			return;
-	}
+	index = index_get (priv->addresses, &priv->addresses_index, address_key_hash, address_key_equal);
+	if (index_contains (index, priv->addresses, address, address_equal))
+		return;
 
-	priv->addresses = g_slist_append (priv->addresses, nm_ip4_address_dup (address));
+	g_ptr_array_add (priv->addresses, nm_ip4_address_dup (address));
+	index_insert (index, priv->addresses, priv->addresses->len - 1);
 }
 
 void
@@ -163,30 +316,50 @@ nm_ip4_config_replace_address (NMIP4Config *config,
                                NMIP4Address *new_address)
 {
 	NMIP4ConfigPrivate *priv;
-	GSList *old;
 
 	g_return_if_fail (NM_IS_IP4_CONFIG (config));
 
 	priv = NM_IP4_CONFIG_GET_PRIVATE (config);
-	old = g_slist_nth (priv->addresses, i);
-	g_return_if_fail (old != NULL);
-	nm_ip4_address_unref ((NMIP4Address *) old->data);
+	g_return_if_fail (i < priv->addresses->len);
 
-	old->data = nm_ip4_address_dup (new_address);
+	index_remove (priv->addresses_index, priv->addresses, i);
+	nm_ip4_address_unref ((NMIP4Address *) g_ptr_array_index (priv->addresses, i));
+	g_ptr_array_index (priv->addresses, i) = nm_ip4_address_dup (new_address);
+	index_insert (priv->addresses_index, priv->addresses, i);
+}
+
+/* Returns the position of the first address with the same IP address as
+ * @address, or -1 if there is none.
+ */
+int
+nm_ip4_config_find_address (NMIP4Config *config, NMIP4Address *address)
+{
+	NMIP4ConfigPrivate *priv;
+	GHashTable *index;
+
+	g_return_val_if_fail (NM_IS_IP4_CONFIG (config), -1);
+	g_return_val_if_fail (address != NULL, -1);
+
+	priv = NM_IP4_CONFIG_GET_PRIVATE (config);
+	index = index_get (priv->addresses, &priv->addresses_index, address_key_hash, address_key_equal);
+	return index_find (index, address);
 }
 
 NMIP4Address *nm_ip4_config_get_address (NMIP4Config *config, guint i)
 {
+	GPtrArray *addresses;
+
 	g_return_val_if_fail (NM_IS_IP4_CONFIG (config), NULL);
 
-	return (NMIP4Address *) g_slist_nth_data (NM_IP4_CONFIG_GET_PRIVATE (config)->addresses, i);
+	addresses = NM_IP4_CONFIG_GET_PRIVATE (config)->addresses;
+	return i < addresses->len ? (NMIP4Address *) g_ptr_array_index (addresses, i) : NULL;
 }
 
 guint32 nm_ip4_config_get_num_addresses (NMIP4Config *config)
 {
 	g_return_val_if_fail (NM_IS_IP4_CONFIG (config), 0);
 
-	return g_slist_length (NM_IP4_CONFIG_GET_PRIVATE (config)->addresses);
+	return NM_IP4_CONFIG_GET_PRIVATE (config)->addresses->len;
 }
 
 guint32 nm_ip4_config_get_ptp_address (NMIP4Config *config)
@@ -302,25 +475,26 @@ nm_ip4_config_take_route (NMIP4Config *config, NMIP4Route *route)
 	g_return_if_fail (route != NULL);
 
 	priv = NM_IP4_CONFIG_GET_PRIVATE (config);
-	priv->routes = g_slist_append (priv->routes, route);
+	g_ptr_array_add (priv->routes, route);
+	index_insert (priv->routes_index, priv->routes, priv->routes->len - 1);
 }
 
 void
 nm_ip4_config_add_route (NMIP4Config *config, NMIP4Route *route)
 {
 	NMIP4ConfigPrivate *priv;
-	GSList *iter;
+	GHashTable *index;
 
 	g_return_if_fail (NM_IS_IP4_CONFIG (config));
 	g_return_if_fail (route != NULL);
 
 	priv = NM_IP4_CONFIG_GET_PRIVATE (config);
-	for (iter = priv->routes; iter; iter = g_slist_next (iter)) {
-		if (nm_ip4_route_compare ((NMIP4Route *) iter->data, route))
-			return;
-	}
+	index = index_get (priv->routes, &priv->routes_index, route_key_hash, route_key_equal);
+	if (index_contains (index, priv->routes, route, route_equal))
+		return;
 
-	priv->routes = g_slist_append (priv->routes, nm_ip4_route_dup (route));
+	g_ptr_array_add (priv->routes, nm_ip4_route_dup (route));
+	index_insert (index, priv->routes, priv->routes->len - 1);
 }
 
 void
@@ -329,31 +503,51 @@ nm_ip4_config_replace_route (NMIP4Config *config,
 							 NMIP4Route *new_route)
 {
 	NMIP4ConfigPrivate *priv;
-	GSList *old;
 
 	g_return_if_fail (NM_IS_IP4_CONFIG (config));
 
 	priv = NM_IP4_CONFIG_GET_PRIVATE (config);
-	old = g_slist_nth (priv->routes, i);
-	g_return_if_fail (old != NULL);
-	nm_ip4_route_unref ((NMIP4Route *) old->data);
+	g_return_if_fail (i < priv->routes->len);
 
-	old->data = nm_ip4_route_dup (new_route);
+	index_remove (priv->routes_index, priv->routes, i);
+	nm_ip4_route_unref ((NMIP4Route *) g_ptr_array_index (priv->routes, i));
+	g_ptr_array_index (priv->routes, i) = nm_ip4_route_dup (new_route);
+	index_insert (priv->routes_index, priv->routes, i);
+}
+
+/* Returns the position of the first route with the same destination, prefix
+ * and next hop as @route, or -1 if there is none.
+ */
+int
+nm_ip4_config_find_route (NMIP4Config *config, NMIP4Route *route)
+{
+	NMIP4ConfigPrivate *priv;
+	GHashTable *index;
+
+	g_return_val_if_fail (NM_IS_IP4_CONFIG (config), -1);
+	g_return_val_if_fail (route != NULL, -1);
+
+	priv = NM_IP4_CONFIG_GET_PRIVATE (config);
+	index = index_get (priv->routes, &priv->routes_index, route_key_hash, route_key_equal);
+	return index_find (index, route);
 }
 
 NMIP4Route *
 nm_ip4_config_get_route (NMIP4Config *config, guint i)
 {
+	GPtrArray *routes;
+
 	g_return_val_if_fail (NM_IS_IP4_CONFIG (config), NULL);
 
-	return (NMIP4Route *) g_slist_nth_data (NM_IP4_CONFIG_GET_PRIVATE (config)->routes, i);
+	routes = NM_IP4_CONFIG_GET_PRIVATE (config)->routes;
+	return i < routes->len ? (NMIP4Route *) g_ptr_array_index (routes, i) : NULL;
 }
 
 guint32 nm_ip4_config_get_num_routes (NMIP4Config *config)
 {
 	g_return_val_if_fail (NM_IS_IP4_CONFIG (config), 0);
 
-	return g_slist_length (NM_IP4_CONFIG_GET_PRIVATE (config)->routes);
+	return NM_IP4_CONFIG_GET_PRIVATE (config)->routes->len;
 }
 
 void nm_ip4_config_reset_routes (NMIP4Config *config)
@@ -363,8 +557,8 @@ void nm_ip4_config_reset_routes (NMIP4Config *config)
 	g_return_if_fail (NM_IS_IP4_CONFIG (config));
 
 	priv = NM_IP4_CONFIG_GET_PRIVATE (config);
-	g_slist_foreach (priv->routes, (GFunc) g_free, NULL);
-	priv->routes = NULL;
+	index_invalidate (&priv->routes_index);
+	g_ptr_array_set_size (priv->routes, 0);
 }
 
 void nm_ip4_config_add_domain (NMIP4Config *config, const char *domain)
@@ -658,49 +852,14 @@ nm_ip4_config_to_rtnl_addr (NMIP4Config *config, guint32 i, guint32 flags)
 	return addr;
 }
 
+/* Returns TRUE if every item of @a is also in @b, whose index is @b_index */
 static gboolean
-addr_slist_compare (GSList *a, GSList *b)
-{
-	GSList *iter_a, *iter_b;
-	gboolean found = FALSE;
-
-	for (iter_a = a; iter_a; iter_a = g_slist_next (iter_a)) {
-		NMIP4Address *addr_a = (NMIP4Address *) iter_a->data;
-
-		for (iter_b = b, found = FALSE; iter_b; iter_b = g_slist_next (iter_b)) {
-			NMIP4Address *addr_b = (NMIP4Address *) iter_b->data;
-
-			if (nm_ip4_address_compare (addr_a, addr_b)) {
-				found = TRUE;
-				break;
-			}
-		}
-
-		if (!found)
-			return FALSE;
-	}
-	return TRUE;
-}
-
-static gboolean
-route_slist_compare (GSList *a, GSList *b)
+ptr_array_subset (GPtrArray *a, GPtrArray *b, GHashTable *b_index, GEqualFunc equal_func)
 {
-	GSList *iter_a, *iter_b;
-	gboolean found = FALSE;
-
-	for (iter_a = a; iter_a; iter_a = g_slist_next (iter_a)) {
-		NMIP4Route *route_a = (NMIP4Route *) iter_a->data;
-
-		for (iter_b = b, found = FALSE; iter_b; iter_b = g_slist_next (iter_b)) {
-			NMIP4Route *route_b = (NMIP4Route *) iter_b->data;
+	guint i;
 
-			if (nm_ip4_route_compare (route_a, route_b)) {
-				found = TRUE;
-				break;
-			}
-		}
-
-		if (!found)
+	for (i = 0; i < a->len; i++) {
+		if (!index_contains (b_index, b, g_ptr_array_index (a, i), equal_func))
 			return FALSE;
 	}
 	return TRUE;
@@ -764,8 +923,12 @@ nm_ip4_config_diff (NMIP4Config *a, NMIP4Config *b)
 	a_priv = NM_IP4_CONFIG_GET_PRIVATE (a);
 	b_priv = NM_IP4_CONFIG_GET_PRIVATE (b);
 
-	if (   !addr_slist_compare (a_priv->addresses, b_priv->addresses)
-	    || !addr_slist_compare (b_priv->addresses, a_priv->addresses))
+	if (   !ptr_array_subset (a_priv->addresses, b_priv->addresses,
+	                          index_get (b_priv->addresses, &b_priv->addresses_index, address_key_hash, address_key_equal),
+	                          address_equal)
+	    || !ptr_array_subset (b_priv->addresses, a_priv->addresses,
+	                          index_get (a_priv->addresses, &a_priv->addresses_index, address_key_hash, address_key_equal),
+	                          address_equal))
 		flags |= NM_IP4_COMPARE_FLAG_ADDRESSES;
 
 	if (a_priv->ptp_address != b_priv->ptp_address)
@@ -790,8 +953,12 @@ nm_ip4_config_diff (NMIP4Config *a, NMIP4Config *b)
 		&& (g_strcmp0 (a_priv->nis_domain, b_priv->nis_domain) != 0))
 		flags |= NM_IP4_COMPARE_FLAG_NIS_DOMAIN;
 
-	if (   !route_slist_compare (a_priv->routes, b_priv->routes)
-	    || !route_slist_compare (b_priv->routes, a_priv->routes))
+	if (   !ptr_array_subset (a_priv->routes, b_priv->routes,
+	                          index_get (b_priv->routes, &b_priv->routes_index, route_key_hash, route_key_equal),
+	                          route_equal)
+	    || !ptr_array_subset (b_priv->routes, a_priv->routes,
+	                          index_get (a_priv->routes, &a_priv->routes_index, route_key_hash, route_key_equal),
+	                          route_equal))
 		flags |= NM_IP4_COMPARE_FLAG_ROUTES;
 
 	if (   (a_priv->domains->len != b_priv->domains->len)
@@ -880,6 +1047,8 @@ nm_ip4_config_init (NMIP4Config *config)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (config);
 
+	priv->addresses = g_ptr_array_new_with_free_func ((GDestroyNotify) nm_ip4_address_unref);
+	priv->routes = g_ptr_array_new_with_free_func ((GDestroyNotify) nm_ip4_route_unref);
 	priv->nameservers = g_array_new (FALSE, TRUE, sizeof (guint32));
 	priv->wins = g_array_new (FALSE, TRUE, sizeof (guint32));
 	priv->domains = g_ptr_array_sized_new (3);
@@ -892,8 +1061,10 @@ finalize (GObject *object)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (object);
 
-	nm_utils_slist_free (priv->addresses, (GDestroyNotify) nm_ip4_address_unref);
-	nm_utils_slist_free (priv->routes, (GDestroyNotify) nm_ip4_route_unref);
+	index_invalidate (&priv->addresses_index);
+	index_invalidate (&priv->routes_index);
+	g_ptr_array_free (priv->addresses, TRUE);
+	g_ptr_array_free (priv->routes, TRUE);
 	g_array_free (priv->wins, TRUE);
 	g_array_free (priv->nameservers, TRUE);
 	g_ptr_array_free (priv->domains, TRUE);
@@ -909,10 +1080,13 @@ get_property (GObject *object, guint prop_id,
 			  GValue *value, GParamSpec *pspec)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (object);
+	GSList *list;
 
 	switch (prop_id) {
 	case PROP_ADDRESSES:
-		nm_utils_ip4_addresses_to_gvalue (priv->addresses, value);
+		list = ptr_array_to_slist (priv->addresses);
+		nm_utils_ip4_addresses_to_gvalue (list, value);
+		g_slist_free (list);
 		break;
 	case PROP_NAMESERVERS:
 		g_value_set_boxed (value, priv->nameservers);
@@ -921,7 +1095,9 @@ get_property (GObject *object, guint prop_id,
 		g_value_set_boxed (value, priv->domains);
 		break;
 	case PROP_ROUTES:
-		nm_utils_ip4_routes_to_gvalue (priv->routes, value);
+		list = ptr_array_to_slist (priv->routes);
+		nm_utils_ip4_routes_to_gvalue (list, value);
+		g_slist_free (list);
 		break;
 	case PROP_WINS_SERVERS:
 		g_value_set_boxed (value, priv->wins);
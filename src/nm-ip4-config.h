@@ -58,6 +58,7 @@ void          nm_ip4_config_take_address        (NMIP4Config *config, NMIP4Addre
 void          nm_ip4_config_add_address         (NMIP4Config *config, NMIP4Address *address);
 void          nm_ip4_config_replace_address     (NMIP4Config *config, guint32 i, NMIP4Address *new_address);
 NMIP4Address *nm_ip4_config_get_address         (NMIP4Config *config, guint32 i);
+int           nm_ip4_config_find_address        (NMIP4Config *config, NMIP4Address *address);
 guint32       nm_ip4_config_get_num_addresses   (NMIP4Config *config);
 
 guint32       nm_ip4_config_get_ptp_address     (NMIP4Config *config);
@@ -77,6 +78,7 @@ void          nm_ip4_config_take_route          (NMIP4Config *config, NMIP4Route
 void          nm_ip4_config_add_route           (NMIP4Config *config, NMIP4Route *route);
 void          nm_ip4_config_replace_route       (NMIP4Config *config, guint32 i, NMIP4Route *new_route);
 NMIP4Route *  nm_ip4_config_get_route           (NMIP4Config *config, guint32 i);
+int           nm_ip4_config_find_route          (NMIP4Config *config, NMIP4Route *route);
 guint32       nm_ip4_config_get_num_routes      (NMIP4Config *config);
 void          nm_ip4_config_reset_routes        (NMIP4Config *config);
 
@@ -57,6 +57,7 @@ void          nm_ip6_config_take_address        (NMIP6Config *config, NMIP6Addre
 void          nm_ip6_config_add_address         (NMIP6Config *config, NMIP6Address *address);
 void          nm_ip6_config_replace_address     (NMIP6Config *config, guint32 i, NMIP6Address *new_address);
 NMIP6Address *nm_ip6_config_get_address         (NMIP6Config *config, guint32 i);
+int           nm_ip6_config_find_address        (NMIP6Config *config, NMIP6Address *address);
 guint32       nm_ip6_config_get_num_addresses   (NMIP6Config *config);
 
 const struct in6_addr *nm_ip6_config_get_ptp_address (NMIP6Config *config);
@@ -74,6 +75,7 @@ void          nm_ip6_config_take_route          (NMIP6Config *config, NMIP6Route
 void          nm_ip6_config_add_route           (NMIP6Config *config, NMIP6Route *route);
 void          nm_ip6_config_replace_route       (NMIP6Config *config, guint32 i, NMIP6Route *new_route);
 NMIP6Route *  nm_ip6_config_get_route           (NMIP6Config *config, guint32 i);
+int           nm_ip6_config_find_route          (NMIP6Config *config, NMIP6Route *route);
 guint32       nm_ip6_config_get_num_routes      (NMIP6Config *config);
 void          nm_ip6_config_reset_routes        (NMIP6Config *config);
 
@@ -20,6 +20,7 @@
 
 #include <config.h>
 #include <string.h>
+#include <time.h>
 #include <dbus/dbus-glib-lowlevel.h>
 #include <gio/gio.h>
 
@@ -52,6 +53,8 @@ typedef struct {
 	NMAuthChain *chain;
 	GCancellable *cancellable;
 	char *permission;
+	gboolean allow_interaction;
+	guint cache_generation;
 	guint idle_id;
 	gboolean disposed;
 } AuthCall;
@@ -93,6 +96,147 @@ pk_authority_get (void)
 	/* Yes, ref every time; we want to keep the object alive */
 	return g_object_ref (authority);
 }
+
+static void pk_authority_changed_cb (GObject *object, gpointer unused);
+
+static void
+pk_authority_watch_changed (PolkitAuthority *authority)
+{
+	static guint32 changed_id = 0;
+
+	/* Hook up the changed signal the first time somebody cares */
+	if (changed_id == 0) {
+		changed_id = g_signal_connect (authority,
+		                               "changed",
+		                               G_CALLBACK (pk_authority_changed_cb),
+		                               NULL);
+	}
+}
+
+/* Cache of PolicyKit decisions made without user interaction, keyed by the
+ * caller's unique bus name and the permission.  Entries are dropped when
+ * the authority reports a change, when the caller leaves the bus, and after
+ * AUTH_CACHE_TIMEOUT seconds since decisions based on temporary
+ * authorizations expire without any notification.
+ */
+#define AUTH_CACHE_TIMEOUT 60
+
+typedef struct {
+	NMAuthCallResult result;
+	time_t stamp;
+} AuthCacheEntry;
+
+static GHashTable *auth_cache = NULL;
+static guint auth_cache_generation = 0;  /* bumped on every authority change */
+static guint auth_cache_hits = 0;
+static guint auth_cache_misses = 0;
+
+static char *
+auth_cache_key (const char *owner, const char *permission)
+{
+	return g_strdup_printf ("%s\n%s", owner, permission);
+}
+
+static gboolean
+auth_cache_key_has_owner (gpointer key, gpointer value, gpointer user_data)
+{
+	const char *owner = user_data;
+	gsize len = strlen (owner);
+
+	return !strncmp (key, owner, len) && ((const char *) key)[len] == '\n';
+}
+
+static void
+auth_cache_name_owner_changed (NMDBusManager *dbus_mgr,
+                               const char *name,
+                               const char *old_owner,
+                               const char *new_owner,
+                               gpointer user_data)
+{
+	/* Unique names are never reused, so a departed caller's entries are
+	 * just dead weight.
+	 */
+	if (name[0] == ':' && old_owner && old_owner[0] && (!new_owner || !new_owner[0]))
+		g_hash_table_foreach_remove (auth_cache, auth_cache_key_has_owner, (gpointer) name);
+}
+
+static void
+auth_cache_flush (void)
+{
+	/* Answers to requests already in flight may predate the change */
+	auth_cache_generation++;
+
+	if (!auth_cache || !g_hash_table_size (auth_cache))
+		return;
+
+	nm_log_dbg (LOGD_CORE, "PolicyKit authority changed; dropping %u cached decisions "
+	            "(%u hits, %u misses)",
+	            g_hash_table_size (auth_cache), auth_cache_hits, auth_cache_misses);
+	g_hash_table_remove_all (auth_cache);
+}
+
+static NMAuthCallResult
+auth_cache_lookup (const char *owner, const char *permission)
+{
+	AuthCacheEntry *entry;
+	NMAuthCallResult result = NM_AUTH_CALL_RESULT_UNKNOWN;
+	time_t now = time (NULL);
+	char *key;
+
+	/* Only unique names identify a single caller */
+	if (!auth_cache || owner[0] != ':')
+		return NM_AUTH_CALL_RESULT_UNKNOWN;
+
+	key = auth_cache_key (owner, permission);
+	entry = g_hash_table_lookup (auth_cache, key);
+	if (entry) {
+		if (now >= entry->stamp && now - entry->stamp < AUTH_CACHE_TIMEOUT)
+			result = entry->result;
+		else
+			g_hash_table_remove (auth_cache, key);
+	}
+	g_free (key);
+
+	if (result != NM_AUTH_CALL_RESULT_UNKNOWN) {
+		auth_cache_hits++;
+		nm_log_dbg (LOGD_CORE, "cached auth result %d for %s from %s (%u hits, %u misses)",
+		            result, permission, owner, auth_cache_hits, auth_cache_misses);
+	} else
+		auth_cache_misses++;
+
+	return result;
+}
+
+static void
+auth_cache_add (PolkitAuthority *authority,
+                const char *owner,
+                const char *permission,
+                NMAuthCallResult result)
+{
+	AuthCacheEntry *entry;
+
+	if (owner[0] != ':')
+		return;
+
+	if (!auth_cache) {
+		NMDBusManager *dbus_mgr;
+
+		auth_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+		pk_authority_watch_changed (authority);
+
+		/* Kept for the lifetime of the process, like the authority */
+		dbus_mgr = nm_dbus_manager_get ();
+		g_signal_connect (dbus_mgr,
+		                  NM_DBUS_MANAGER_NAME_OWNER_CHANGED,
+		                  G_CALLBACK (auth_cache_name_owner_changed),
+		                  NULL);
+	}
+
+	entry = g_malloc0 (sizeof (AuthCacheEntry));
+	entry->result = result;
+	entry->stamp = time (NULL);
+	g_hash_table_insert (auth_cache, auth_cache_key (owner, permission), entry);
+}
 #endif
 
 static NMAuthChain *
@@ -381,6 +525,15 @@ pk_call_cb (GObject *object, GAsyncResult *result, gpointer user_data)
 			call_result = NM_AUTH_CALL_RESULT_NO;
 
 		nm_auth_chain_set_data (chain, call->permission, GUINT_TO_POINTER (call_result), NULL);
+
+		/* Only decisions that needed no interaction can be reused; a YES
+		 * obtained by authenticating must not outlive PolicyKit's own
+		 * retention of it.
+		 */
+		if (   !call->allow_interaction
+		    && call_result != NM_AUTH_CALL_RESULT_AUTH
+		    && call->cache_generation == auth_cache_generation)
+			auth_cache_add (chain->authority, chain->owner, call->permission, call_result);
 	}
 
 	g_clear_error (&error);
@@ -401,6 +554,7 @@ nm_auth_chain_add_call (NMAuthChain *self,
 #if WITH_POLKIT
 	PolkitSubject *subject;
 	PolkitCheckAuthorizationFlags flags = POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE;
+	NMAuthCallResult call_result;
 
 	g_return_val_if_fail (self != NULL, FALSE);
 	g_return_val_if_fail (self->owner != NULL, FALSE);
@@ -411,6 +565,7 @@ nm_auth_chain_add_call (NMAuthChain *self,
 		return FALSE;
 
 	call = auth_call_new (self, permission);
+	call->allow_interaction = allow_interaction;
 
 	if (self->authority == NULL) {
 		/* No polkit, no authorization */
@@ -419,9 +574,20 @@ nm_auth_chain_add_call (NMAuthChain *self,
 		return FALSE;
 	}
 
+	/* Cached YES and NO answers hold whether or not interaction is allowed */
+	call_result = auth_cache_lookup (self->owner, permission);
+	if (call_result != NM_AUTH_CALL_RESULT_UNKNOWN) {
+		nm_auth_chain_set_data (self, permission, GUINT_TO_POINTER (call_result), NULL);
+		auth_call_schedule_early_finish (call, NULL);
+		g_object_unref (subject);
+		return TRUE;
+	}
+
 	if (allow_interaction)
 		flags = POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION;
 
+	call->cache_generation = auth_cache_generation;
+
 	polkit_authority_check_authorization (self->authority,
 	                                      subject,
 	                                      permission,
@@ -475,57 +641,308 @@ nm_auth_chain_unref (NMAuthChain *self)
 
 /************ utils **************/
 
-gboolean
-nm_auth_get_caller_uid (DBusGMethodInvocation *context,
-                        NMDBusManager *dbus_mgr,
-                        gulong *out_uid,
-                        char **out_error_desc)
+/* Unique bus name -> UID of the peer.  Unique names are never reused, so
+ * an entry stays valid until the name leaves the bus.
+ */
+static GHashTable *uid_cache = NULL;
+/* Unique bus name -> UidRequest for lookups in flight */
+static GHashTable *uid_requests = NULL;
+/* Cleared once the bus daemon turns out not to know GetConnectionCredentials */
+static gboolean uid_use_credentials = TRUE;
+
+typedef struct {
+	NMAuthUidFunc callback;
+	gpointer user_data;
+} UidWaiter;
+
+typedef struct {
+	NMDBusManager *dbus_mgr;
+	char *sender;
+	GSList *waiters;
+	gboolean credentials;  /* asked with GetConnectionCredentials */
+	gboolean sender_gone;  /* left the bus while we were asking */
+} UidRequest;
+
+static void
+uid_cache_name_owner_changed (NMDBusManager *dbus_mgr,
+                              const char *name,
+                              const char *old_owner,
+                              const char *new_owner,
+                              gpointer user_data)
+{
+	UidRequest *request;
+
+	if (name[0] != ':' || !old_owner || !old_owner[0] || (new_owner && new_owner[0]))
+		return;
+
+	g_hash_table_remove (uid_cache, name);
+
+	/* A reply that's still on its way would describe a dead connection */
+	request = g_hash_table_lookup (uid_requests, name);
+	if (request)
+		request->sender_gone = TRUE;
+}
+
+static void
+uid_cache_init (NMDBusManager *dbus_mgr)
+{
+	if (uid_cache)
+		return;
+
+	uid_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	uid_requests = g_hash_table_new (g_str_hash, g_str_equal);
+
+	/* Kept for the lifetime of the process */
+	g_signal_connect (g_object_ref (dbus_mgr),
+	                  NM_DBUS_MANAGER_NAME_OWNER_CHANGED,
+	                  G_CALLBACK (uid_cache_name_owner_changed),
+	                  NULL);
+}
+
+static void
+uid_request_finish (UidRequest *request, gulong uid, const char *error_desc)
+{
+	GSList *iter;
+	gulong *cached;
+
+	g_hash_table_remove (uid_requests, request->sender);
+
+	if (!error_desc && !request->sender_gone) {
+		cached = g_malloc (sizeof (*cached));
+		*cached = uid;
+		g_hash_table_insert (uid_cache, g_strdup (request->sender), cached);
+	}
+
+	request->waiters = g_slist_reverse (request->waiters);
+	for (iter = request->waiters; iter; iter = g_slist_next (iter)) {
+		UidWaiter *waiter = iter->data;
+
+		waiter->callback (uid, error_desc, waiter->user_data);
+		g_slice_free (UidWaiter, waiter);
+	}
+	g_slist_free (request->waiters);
+
+	g_object_unref (request->dbus_mgr);
+	g_free (request->sender);
+	g_slice_free (UidRequest, request);
+}
+
+static gboolean
+credentials_get_uid (DBusMessage *reply, gulong *out_uid)
+{
+	DBusMessageIter iter, array, entry, variant;
+	const char *key;
+	dbus_uint32_t uid;
+
+	if (!dbus_message_iter_init (reply, &iter))
+		return FALSE;
+	if (   dbus_message_iter_get_arg_type (&iter) != DBUS_TYPE_ARRAY
+	    || dbus_message_iter_get_element_type (&iter) != DBUS_TYPE_DICT_ENTRY)
+		return FALSE;
+
+	dbus_message_iter_recurse (&iter, &array);
+	while (dbus_message_iter_get_arg_type (&array) == DBUS_TYPE_DICT_ENTRY) {
+		dbus_message_iter_recurse (&array, &entry);
+		dbus_message_iter_get_basic (&entry, &key);
+		if (strcmp (key, "UnixUserID") == 0) {
+			dbus_message_iter_next (&entry);
+			dbus_message_iter_recurse (&entry, &variant);
+			if (dbus_message_iter_get_arg_type (&variant) != DBUS_TYPE_UINT32)
+				return FALSE;
+			dbus_message_iter_get_basic (&variant, &uid);
+			*out_uid = uid;
+			return TRUE;
+		}
+		dbus_message_iter_next (&array);
+	}
+	return FALSE;
+}
+
+static void uid_request_reply (DBusPendingCall *pending, void *user_data);
+
+static gboolean
+uid_request_send (UidRequest *request)
 {
 	DBusConnection *connection;
-	char *sender = NULL;
+	DBusMessage *message;
+	DBusPendingCall *pending = NULL;
+
+	connection = nm_dbus_manager_get_dbus_connection (request->dbus_mgr);
+	if (!connection)
+		return FALSE;
+
+	request->credentials = uid_use_credentials;
+	message = dbus_message_new_method_call (DBUS_SERVICE_DBUS,
+	                                        DBUS_PATH_DBUS,
+	                                        DBUS_INTERFACE_DBUS,
+	                                        request->credentials ?
+	                                            "GetConnectionCredentials" :
+	                                            "GetConnectionUnixUser");
+	if (!message)
+		return FALSE;
+	dbus_message_append_args (message, DBUS_TYPE_STRING, &request->sender, DBUS_TYPE_INVALID);
+
+	if (dbus_connection_send_with_reply (connection, message, &pending, -1) && pending)
+		dbus_pending_call_set_notify (pending, uid_request_reply, request, NULL);
+	dbus_message_unref (message);
+
+	return pending != NULL;
+}
+
+static void
+uid_request_reply (DBusPendingCall *pending, void *user_data)
+{
+	UidRequest *request = user_data;
+	DBusMessage *reply;
+	DBusError error;
+	dbus_uint32_t uid32;
+	gulong uid = G_MAXULONG;
 	gboolean success = FALSE;
-	DBusError dbus_error;
 
-	g_return_val_if_fail (context != NULL, FALSE);
-	g_return_val_if_fail (out_uid != NULL, FALSE);
+	reply = dbus_pending_call_steal_reply (pending);
+	dbus_pending_call_unref (pending);
+	if (!reply) {
+		uid_request_finish (request, G_MAXULONG, "Could not determine the user ID of the requestor");
+		return;
+	}
 
-	if (!dbus_mgr) {
-		dbus_mgr = nm_dbus_manager_get ();
-		g_assert (dbus_mgr);
-	} else
+	dbus_error_init (&error);
+	if (dbus_set_error_from_message (&error, reply)) {
+		if (request->credentials && dbus_error_has_name (&error, DBUS_ERROR_UNKNOWN_METHOD)) {
+			/* dbus-daemon before 1.7; ask the old way */
+			uid_use_credentials = FALSE;
+			dbus_error_free (&error);
+			dbus_message_unref (reply);
+			if (!uid_request_send (request))
+				uid_request_finish (request, G_MAXULONG, "Could not get the D-Bus system bus");
+			return;
+		}
+		dbus_error_free (&error);
+	} else if (request->credentials)
+		success = credentials_get_uid (reply, &uid);
+	else if (dbus_message_get_args (reply, NULL, DBUS_TYPE_UINT32, &uid32, DBUS_TYPE_INVALID)) {
+		uid = uid32;
+		success = TRUE;
+	}
+	dbus_message_unref (reply);
+
+	if (success)
+		uid_request_finish (request, uid, NULL);
+	else
+		uid_request_finish (request, G_MAXULONG, "Could not determine the user ID of the requestor");
+}
+
+/**
+ * nm_auth_get_sender_uid_async:
+ * @dbus_mgr: the #NMDBusManager, or %NULL to use the default one
+ * @sender: the unique bus name of the caller
+ * @callback: called with the caller's UID, or with %G_MAXULONG and an error
+ *   description on failure
+ * @user_data: data for @callback
+ *
+ * Looks up the UNIX user of the process owning @sender without blocking.
+ * Results are cached until @sender leaves the bus, and concurrent lookups
+ * for the same sender share one bus request.  When the answer is already
+ * known, @callback is called before this function returns.
+ */
+void
+nm_auth_get_sender_uid_async (NMDBusManager *dbus_mgr,
+                              const char *sender,
+                              NMAuthUidFunc callback,
+                              gpointer user_data)
+{
+	UidRequest *request;
+	UidWaiter *waiter;
+	gulong *cached;
+
+	g_return_if_fail (sender != NULL);
+	g_return_if_fail (callback != NULL);
+
+	if (dbus_mgr)
 		g_object_ref (dbus_mgr);
+	else
+		dbus_mgr = nm_dbus_manager_get ();
 
-	*out_uid = G_MAXULONG;
+	uid_cache_init (dbus_mgr);
 
-	sender = dbus_g_method_get_sender (context);
-	if (!sender) {
-		if (out_error_desc)
-			*out_error_desc = g_strdup ("Could not determine D-Bus requestor");
-		goto out;
+	cached = g_hash_table_lookup (uid_cache, sender);
+	if (cached) {
+		g_object_unref (dbus_mgr);
+		callback (*cached, NULL, user_data);
+		return;
 	}
 
-	connection = nm_dbus_manager_get_dbus_connection (dbus_mgr);
-	if (!connection) {
-		if (out_error_desc)
-			*out_error_desc = g_strdup ("Could not get the D-Bus system bus");
-		goto out;
+	waiter = g_slice_new (UidWaiter);
+	waiter->callback = callback;
+	waiter->user_data = user_data;
+
+	request = g_hash_table_lookup (uid_requests, sender);
+	if (request) {
+		g_object_unref (dbus_mgr);
+		request->waiters = g_slist_prepend (request->waiters, waiter);
+		return;
 	}
 
-	dbus_error_init (&dbus_error);
-	/* FIXME: do this async */
-	*out_uid = dbus_bus_get_unix_user (connection, sender, &dbus_error);
-	if (dbus_error_is_set (&dbus_error)) {
-		if (out_error_desc)
-			*out_error_desc = g_strdup_printf ("Could not determine the user ID of the requestor");
-		dbus_error_free (&dbus_error);
-		*out_uid = G_MAXULONG;
-	} else
-		success = TRUE;
+	request = g_slice_new0 (UidRequest);
+	request->dbus_mgr = dbus_mgr;
+	request->sender = g_strdup (sender);
+	request->waiters = g_slist_prepend (NULL, waiter);
+	g_hash_table_insert (uid_requests, request->sender, request);
+
+	if (!uid_request_send (request))
+		uid_request_finish (request, G_MAXULONG, "Could not get the D-Bus system bus");
+}
+
+/**
+ * nm_auth_get_caller_uid_async:
+ * @context: the D-Bus method invocation of the caller
+ * @dbus_mgr: the #NMDBusManager, or %NULL to use the default one
+ * @callback: called with the caller's UID, or with %G_MAXULONG and an error
+ *   description on failure
+ * @user_data: data for @callback
+ *
+ * Like nm_auth_get_sender_uid_async() for the sender of @context.
+ */
+void
+nm_auth_get_caller_uid_async (DBusGMethodInvocation *context,
+                              NMDBusManager *dbus_mgr,
+                              NMAuthUidFunc callback,
+                              gpointer user_data)
+{
+	char *sender;
+
+	g_return_if_fail (context != NULL);
+	g_return_if_fail (callback != NULL);
 
-out:
-	g_object_unref (dbus_mgr);
+	sender = dbus_g_method_get_sender (context);
+	if (!sender) {
+		callback (G_MAXULONG, "Could not determine D-Bus requestor", user_data);
+		return;
+	}
+
+	nm_auth_get_sender_uid_async (dbus_mgr, sender, callback, user_data);
 	g_free (sender);
-	return success;
+}
+
+/**
+ * nm_auth_get_sender_uid_cached:
+ * @sender: the unique bus name of the caller
+ * @out_uid: on return, the caller's UID
+ *
+ * Returns: %TRUE if the UID of @sender is known without asking the bus
+ */
+gboolean
+nm_auth_get_sender_uid_cached (const char *sender, gulong *out_uid)
+{
+	gulong *cached;
+
+	g_return_val_if_fail (sender != NULL, FALSE);
+	g_return_val_if_fail (out_uid != NULL, FALSE);
+
+	cached = uid_cache ? g_hash_table_lookup (uid_cache, sender) : NULL;
+	if (cached)
+		*out_uid = *cached;
+	return cached != NULL;
 }
 
 gboolean
@@ -584,6 +1001,11 @@ pk_authority_changed_cb (GObject *object, gpointer unused)
 {
 	GSList *iter;
 
+	/* Callbacks usually re-check permissions, so they must not see stale
+	 * cached decisions.
+	 */
+	auth_cache_flush ();
+
 	for (iter = funcs; iter; iter = g_slist_next (iter)) {
 		PkChangedInfo *info = iter->data;
 
@@ -597,7 +1019,6 @@ nm_auth_changed_func_register (GDestroyNotify callback, gpointer callback_data)
 {
 #if WITH_POLKIT
 	PolkitAuthority *authority;
-	static guint32 changed_id = 0;
 #endif
 	PkChangedInfo *info;
 	GSList *iter;
@@ -608,13 +1029,7 @@ nm_auth_changed_func_register (GDestroyNotify callback, gpointer callback_data)
 	if (!authority)
 		return;
 
-	/* Hook up the changed signal the first time a callback is registered */
-	if (changed_id == 0) {
-		changed_id = g_signal_connect (authority,
-		                               "changed",
-		                               G_CALLBACK (pk_authority_changed_cb),
-		                               &funcs);
-	}
+	pk_authority_watch_changed (authority);
 #endif
 
 	/* No duplicates */
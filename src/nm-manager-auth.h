@@ -93,10 +93,21 @@ gboolean nm_auth_chain_add_call (NMAuthChain *chain,
 void nm_auth_chain_unref (NMAuthChain *chain);
 
 /* Utils */
-gboolean nm_auth_get_caller_uid (DBusGMethodInvocation *context,
-                                 NMDBusManager *dbus_mgr,
-                                 gulong *out_uid,
-                                 char **out_error_desc);
+
+/* @error_desc is NULL on success */
+typedef void (*NMAuthUidFunc) (gulong uid, const char *error_desc, gpointer user_data);
+
+void nm_auth_get_caller_uid_async (DBusGMethodInvocation *context,
+                                   NMDBusManager *dbus_mgr,
+                                   NMAuthUidFunc callback,
+                                   gpointer user_data);
+
+void nm_auth_get_sender_uid_async (NMDBusManager *dbus_mgr,
+                                   const char *sender,
+                                   NMAuthUidFunc callback,
+                                   gpointer user_data);
+
+gboolean nm_auth_get_sender_uid_cached (const char *sender, gulong *out_uid);
 
 /* Caller must free returned error description */
 gboolean nm_auth_uid_in_acl (NMConnection *connection,
@@ -84,6 +84,10 @@ static gboolean impl_manager_get_devices (NMManager *manager,
                                           GPtrArray **devices,
                                           GError **err);
 
+static gboolean impl_manager_get_objects (NMManager *manager,
+                                          GHashTable **objects,
+                                          GError **err);
+
 static gboolean impl_manager_get_device_by_ip_iface (NMManager *self,
                                                      const char *iface,
                                                      char **out_object_path,
@@ -129,6 +133,10 @@ static void impl_manager_get_logging (NMManager *manager,
                                       char **level,
                                       char **domains);
 
+static gboolean impl_manager_get_log_buffer (NMManager *manager,
+                                             char ***messages,
+                                             GError **error);
+
 #include "nm-manager-glue.h"
 
 static void bluez_manager_bdaddr_added_cb (NMBluezManager *bluez_mgr,
@@ -874,29 +882,20 @@ out:
 }
 
 static void
-pending_activation_check_authorized (PendingActivation *pending,
-                                     NMDBusManager *dbus_mgr)
+pending_activation_uid_cb (gulong sender_uid, const char *error_desc, gpointer user_data)
 {
-	char *error_desc = NULL;
-	gulong sender_uid = G_MAXULONG;
+	PendingActivation *pending = user_data;
 	GError *error;
 	const char *wifi_permission = NULL;
 	NMConnection *connection;
 	NMSettings *settings;
 
-	g_return_if_fail (pending != NULL);
-	g_return_if_fail (dbus_mgr != NULL);
-
-	if (!nm_auth_get_caller_uid (pending->context, 
-	                             dbus_mgr,
-	                             &sender_uid,
-	                             &error_desc)) {
+	if (error_desc) {
 		error = g_error_new_literal (NM_MANAGER_ERROR,
 		                             NM_MANAGER_ERROR_PERMISSION_DENIED,
 		                             error_desc);
 		pending->callback (pending, error);
 		g_error_free (error);
-		g_free (error_desc);
 		return;
 	}
 
@@ -942,6 +941,16 @@ pending_activation_check_authorized (PendingActivation *pending,
 	}
 }
 
+static void
+pending_activation_check_authorized (PendingActivation *pending,
+                                     NMDBusManager *dbus_mgr)
+{
+	g_return_if_fail (pending != NULL);
+	g_return_if_fail (dbus_mgr != NULL);
+
+	nm_auth_get_caller_uid_async (pending->context, dbus_mgr, pending_activation_uid_cb, pending);
+}
+
 static void
 pending_activation_destroy (PendingActivation *pending,
                             GError *error,
@@ -1526,29 +1535,22 @@ manager_hidden_ap_found (NMDevice *device,
 	NMManager *manager = NM_MANAGER (user_data);
 	NMManagerPrivate *priv = NM_MANAGER_GET_PRIVATE (manager);
 	const struct ether_addr *bssid;
-	GSList *iter;
-	GSList *connections;
-	gboolean done = FALSE;
+	NMSettingsConnection *connection;
+	NMSettingWireless *s_wifi;
 
 	g_return_if_fail (nm_ap_get_ssid (ap) == NULL);
 
 	bssid = nm_ap_get_address (ap);
 	g_assert (bssid);
 
-	/* Look for this AP's BSSID in the seen-bssids list of a connection,
-	 * and if a match is found, copy over the SSID */
-	connections = nm_settings_get_connections (priv->settings);
-	for (iter = connections; iter && !done; iter = g_slist_next (iter)) {
-		NMConnection *connection = NM_CONNECTION (iter->data);
-		NMSettingWireless *s_wifi;
-
-		s_wifi = nm_connection_get_setting_wireless (connection);
-		if (s_wifi) {
-			if (nm_settings_connection_has_seen_bssid (NM_SETTINGS_CONNECTION (connection), bssid))
-				nm_ap_set_ssid (ap, nm_setting_wireless_get_ssid (s_wifi));
-		}
+	/* Look for a connection that has seen this AP's BSSID, and if a match
+	 * is found, copy over the SSID */
+	connection = nm_settings_get_connection_by_seen_bssid (priv->settings, bssid);
+	if (connection) {
+		s_wifi = nm_connection_get_setting_wireless (NM_CONNECTION (connection));
+		if (s_wifi)
+			nm_ap_set_ssid (ap, nm_setting_wireless_get_ssid (s_wifi));
 	}
-	g_slist_free (connections);
 }
 
 static RfKillState
@@ -1767,47 +1769,75 @@ device_auth_done_cb (NMAuthChain *chain,
 	nm_auth_chain_unref (chain);
 }
 
+typedef struct {
+	NMManager *self;
+	NMDevice *device;
+	DBusGMethodInvocation *context;
+	char *permission;
+	gboolean allow_interaction;
+	NMDeviceAuthRequestFunc callback;
+	gpointer user_data;
+} DeviceAuthInfo;
+
 static void
-device_auth_request_cb (NMDevice *device,
-                        DBusGMethodInvocation *context,
-                        const char *permission,
-                        gboolean allow_interaction,
-                        NMDeviceAuthRequestFunc callback,
-                        gpointer user_data,
-                        NMManager *self)
+device_auth_uid_cb (gulong sender_uid, const char *error_desc, gpointer user_data)
 {
-	NMManagerPrivate *priv = NM_MANAGER_GET_PRIVATE (self);
+	DeviceAuthInfo *info = user_data;
+	NMManagerPrivate *priv = NM_MANAGER_GET_PRIVATE (info->self);
 	GError *error = NULL;
-	gulong sender_uid = G_MAXULONG;
-	char *error_desc = NULL;
 	NMAuthChain *chain;
 
-	/* Get the caller's UID for the root check */
-	if (!nm_auth_get_caller_uid (context, priv->dbus_mgr, &sender_uid, &error_desc)) {
+	if (error_desc) {
 		error = g_error_new_literal (NM_MANAGER_ERROR,
 		                             NM_MANAGER_ERROR_PERMISSION_DENIED,
 		                             error_desc);
-		callback (device, context, error, user_data);
+		info->callback (info->device, info->context, error, info->user_data);
 		g_error_free (error);
-		g_free (error_desc);
-		return;
-	}
-
-	/* Yay for root */
-	if (0 == sender_uid)
-		callback (device, context, NULL, user_data);
-	else {
+	} else if (0 == sender_uid) {
+		/* Yay for root */
+		info->callback (info->device, info->context, NULL, info->user_data);
+	} else {
 		/* Otherwise validate the non-root request */
-		chain = nm_auth_chain_new (context, NULL, device_auth_done_cb, self);
+		chain = nm_auth_chain_new (info->context, NULL, device_auth_done_cb, info->self);
 		g_assert (chain);
 		priv->auth_chains = g_slist_append (priv->auth_chains, chain);
 
-		nm_auth_chain_set_data (chain, "device", g_object_ref (device), g_object_unref);
-		nm_auth_chain_set_data (chain, "requested-permission", g_strdup (permission), g_free);
-		nm_auth_chain_set_data (chain, "callback", callback, NULL);
-		nm_auth_chain_set_data (chain, "user-data", user_data, NULL);
-		nm_auth_chain_add_call (chain, permission, allow_interaction);
+		nm_auth_chain_set_data (chain, "device", g_object_ref (info->device), g_object_unref);
+		nm_auth_chain_set_data (chain, "requested-permission", g_strdup (info->permission), g_free);
+		nm_auth_chain_set_data (chain, "callback", info->callback, NULL);
+		nm_auth_chain_set_data (chain, "user-data", info->user_data, NULL);
+		nm_auth_chain_add_call (chain, info->permission, info->allow_interaction);
 	}
+
+	g_object_unref (info->device);
+	g_object_unref (info->self);
+	g_free (info->permission);
+	g_slice_free (DeviceAuthInfo, info);
+}
+
+static void
+device_auth_request_cb (NMDevice *device,
+                        DBusGMethodInvocation *context,
+                        const char *permission,
+                        gboolean allow_interaction,
+                        NMDeviceAuthRequestFunc callback,
+                        gpointer user_data,
+                        NMManager *self)
+{
+	NMManagerPrivate *priv = NM_MANAGER_GET_PRIVATE (self);
+	DeviceAuthInfo *info;
+
+	info = g_slice_new0 (DeviceAuthInfo);
+	info->self = g_object_ref (self);
+	info->device = g_object_ref (device);
+	info->context = context;
+	info->permission = g_strdup (permission);
+	info->allow_interaction = allow_interaction;
+	info->callback = callback;
+	info->user_data = user_data;
+
+	/* Get the caller's UID for the root check */
+	nm_auth_get_caller_uid_async (context, priv->dbus_mgr, device_auth_uid_cb, info);
 }
 
 static void
@@ -2383,6 +2413,94 @@ impl_manager_get_devices (NMManager *manager, GPtrArray **devices, GError **err)
 	return TRUE;
 }
 
+static void snapshot_add_object (GHashTable *objects,
+                                 DBusGConnection *bus,
+                                 const char *path);
+
+static void
+snapshot_add_referenced (GHashTable *objects, DBusGConnection *bus, GValue *value)
+{
+	GPtrArray *paths;
+	guint i;
+
+	if (G_VALUE_HOLDS (value, DBUS_TYPE_G_OBJECT_PATH))
+		snapshot_add_object (objects, bus, g_value_get_boxed (value));
+	else if (G_VALUE_HOLDS (value, DBUS_TYPE_G_ARRAY_OF_OBJECT_PATH)) {
+		paths = g_value_get_boxed (value);
+		for (i = 0; paths && i < paths->len; i++)
+			snapshot_add_object (objects, bus, g_ptr_array_index (paths, i));
+	}
+}
+
+static void
+snapshot_add_object (GHashTable *objects, DBusGConnection *bus, const char *path)
+{
+	GObject *object;
+	GHashTable *props;
+	GHashTableIter iter;
+	gpointer value;
+
+	/* Only the manager's own object tree; settings connections have their
+	 * own API and "/" means "no object".
+	 */
+	if (   !path
+	    || !g_str_has_prefix (path, NM_DBUS_PATH "/")
+	    || g_str_has_prefix (path, NM_DBUS_PATH_SETTINGS)
+	    || g_hash_table_lookup (objects, path))
+		return;
+
+	object = dbus_g_connection_lookup_g_object (bus, path);
+	if (!object)
+		return;
+
+	props = nm_properties_get_exported (object);
+	if (NM_IS_DEVICE (object)) {
+		GPtrArray *children;
+		const char *name = NULL;
+
+		children = nm_device_get_exported_children (NM_DEVICE (object), &name);
+		if (children)
+			nm_properties_add_object_paths (props, name, children);
+	}
+
+	/* Insert before recursing so reference cycles terminate */
+	g_hash_table_insert (objects, g_strdup (path), props);
+
+	g_hash_table_iter_init (&iter, props);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		snapshot_add_referenced (objects, bus, value);
+}
+
+/* Returns the manager and every object reachable from it (devices, access
+ * points, active connections, IP and DHCP configs) with all their exported
+ * properties, so clients can populate their object cache in one round trip.
+ */
+static gboolean
+impl_manager_get_objects (NMManager *manager, GHashTable **objects, GError **err)
+{
+	NMManagerPrivate *priv = NM_MANAGER_GET_PRIVATE (manager);
+	DBusGConnection *bus;
+	GHashTable *props;
+	GHashTableIter iter;
+	GPtrArray *devices = NULL;
+	gpointer value;
+
+	bus = nm_dbus_manager_get_connection (priv->dbus_mgr);
+	*objects = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                  g_free, (GDestroyNotify) g_hash_table_destroy);
+
+	props = nm_properties_get_exported (G_OBJECT (manager));
+	impl_manager_get_devices (manager, &devices, NULL);
+	nm_properties_add_object_paths (props, "Devices", devices);
+	g_hash_table_insert (*objects, g_strdup (NM_DBUS_PATH), props);
+
+	g_hash_table_iter_init (&iter, props);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		snapshot_add_referenced (*objects, bus, value);
+
+	return TRUE;
+}
+
 static gboolean
 impl_manager_get_device_by_ip_iface (NMManager *self,
                                      const char *iface,
@@ -2801,8 +2919,10 @@ nm_manager_activate_connection (NMManager *manager,
 
 	priv = NM_MANAGER_GET_PRIVATE (manager);
 
-	/* Get the UID of the user that originated the request, if any */
-	if (dbus_sender) {
+	/* Get the UID of the user that originated the request, if any.  D-Bus
+	 * requests were authorized first, so the UID is normally known already.
+	 */
+	if (dbus_sender && !nm_auth_get_sender_uid_cached (dbus_sender, &sender_uid)) {
 		dbus_error_init (&dbus_error);
 		sender_uid = dbus_bus_get_unix_user (nm_dbus_manager_get_dbus_connection (priv->dbus_mgr),
 		                                     dbus_sender,
@@ -3213,6 +3333,51 @@ deactivate_net_auth_done_cb (NMAuthChain *chain,
 	nm_auth_chain_unref (chain);
 }
 
+typedef struct {
+	NMManager *self;
+	DBusGMethodInvocation *context;
+	char *active_path;
+} DeactivateInfo;
+
+static void
+deactivate_uid_cb (gulong sender_uid, const char *error_desc, gpointer user_data)
+{
+	DeactivateInfo *info = user_data;
+	NMManagerPrivate *priv = NM_MANAGER_GET_PRIVATE (info->self);
+	GError *error = NULL;
+	NMAuthChain *chain;
+
+	if (error_desc) {
+		error = g_error_new_literal (NM_MANAGER_ERROR,
+		                             NM_MANAGER_ERROR_PERMISSION_DENIED,
+		                             error_desc);
+		dbus_g_method_return_error (info->context, error);
+		g_error_free (error);
+	} else if (0 == sender_uid) {
+		/* Yay for root */
+		if (!nm_manager_deactivate_connection (info->self,
+		                                       info->active_path,
+		                                       NM_DEVICE_STATE_REASON_USER_REQUESTED,
+		                                       &error)) {
+			dbus_g_method_return_error (info->context, error);
+			g_clear_error (&error);
+		} else
+			dbus_g_method_return (info->context);
+	} else {
+		/* Otherwise validate the user request */
+		chain = nm_auth_chain_new (info->context, NULL, deactivate_net_auth_done_cb, info->self);
+		g_assert (chain);
+		priv->auth_chains = g_slist_append (priv->auth_chains, chain);
+
+		nm_auth_chain_set_data (chain, "path", g_strdup (info->active_path), g_free);
+		nm_auth_chain_add_call (chain, NM_AUTH_PERMISSION_NETWORK_CONTROL, TRUE);
+	}
+
+	g_object_unref (info->self);
+	g_free (info->active_path);
+	g_slice_free (DeactivateInfo, info);
+}
+
 static void
 impl_manager_deactivate_connection (NMManager *self,
                                     const char *active_path,
@@ -3222,9 +3387,7 @@ impl_manager_deactivate_connection (NMManager *self,
 	NMConnection *connection = NULL;
 	GError *error = NULL;
 	GSList *iter;
-	NMAuthChain *chain;
-	gulong sender_uid = G_MAXULONG;
-	char *error_desc = NULL;
+	DeactivateInfo *info;
 
 	/* Find the connection by its object path */
 	for (iter = priv->active_connections; iter; iter = g_slist_next (iter)) {
@@ -3248,40 +3411,11 @@ impl_manager_deactivate_connection (NMManager *self,
 	/* Need to check the caller's permissions and stuff before we can
 	 * deactivate the connection.
 	 */
-	if (!nm_auth_get_caller_uid (context, 
-		                         priv->dbus_mgr,
-	                             &sender_uid,
-	                             &error_desc)) {
-		error = g_error_new_literal (NM_MANAGER_ERROR,
-		                             NM_MANAGER_ERROR_PERMISSION_DENIED,
-		                             error_desc);
-		dbus_g_method_return_error (context, error);
-		g_error_free (error);
-		g_free (error_desc);
-		return;
-	}
-
-	/* Yay for root */
-	if (0 == sender_uid) {
-		if (!nm_manager_deactivate_connection (self,
-		                                       active_path,
-		                                       NM_DEVICE_STATE_REASON_USER_REQUESTED,
-		                                       &error)) {
-			dbus_g_method_return_error (context, error);
-			g_clear_error (&error);
-		} else
-			dbus_g_method_return (context);
-
-		return;
-	}
-
-	/* Otherwise validate the user request */
-	chain = nm_auth_chain_new (context, NULL, deactivate_net_auth_done_cb, self);
-	g_assert (chain);
-	priv->auth_chains = g_slist_append (priv->auth_chains, chain);
-
-	nm_auth_chain_set_data (chain, "path", g_strdup (active_path), g_free);
-	nm_auth_chain_add_call (chain, NM_AUTH_PERMISSION_NETWORK_CONTROL, TRUE);
+	info = g_slice_new0 (DeactivateInfo);
+	info->self = g_object_ref (self);
+	info->context = context;
+	info->active_path = g_strdup (active_path);
+	nm_auth_get_caller_uid_async (context, priv->dbus_mgr, deactivate_uid_cb, info);
 }
 
 static void
@@ -3555,16 +3689,51 @@ enable_net_done_cb (NMAuthChain *chain,
 	nm_auth_chain_unref (chain);
 }
 
+typedef struct {
+	NMManager *self;
+	DBusGMethodInvocation *context;
+	gboolean enable;
+} EnableInfo;
+
+static void
+enable_uid_cb (gulong sender_uid, const char *error_desc, gpointer user_data)
+{
+	EnableInfo *info = user_data;
+	NMManagerPrivate *priv = NM_MANAGER_GET_PRIVATE (info->self);
+	NMAuthChain *chain;
+	GError *error;
+
+	if (error_desc) {
+		error = g_error_new_literal (NM_MANAGER_ERROR,
+		                             NM_MANAGER_ERROR_PERMISSION_DENIED,
+		                             error_desc);
+		dbus_g_method_return_error (info->context, error);
+		g_error_free (error);
+	} else if (0 == sender_uid) {
+		/* Root doesn't need PK authentication */
+		_internal_enable (info->self, info->enable);
+		dbus_g_method_return (info->context);
+	} else {
+		chain = nm_auth_chain_new (info->context, NULL, enable_net_done_cb, info->self);
+		g_assert (chain);
+		priv->auth_chains = g_slist_append (priv->auth_chains, chain);
+
+		nm_auth_chain_set_data (chain, "enable", GUINT_TO_POINTER (info->enable), NULL);
+		nm_auth_chain_add_call (chain, NM_AUTH_PERMISSION_ENABLE_DISABLE_NETWORK, TRUE);
+	}
+
+	g_object_unref (info->self);
+	g_slice_free (EnableInfo, info);
+}
+
 static void
 impl_manager_enable (NMManager *self,
                      gboolean enable,
                      DBusGMethodInvocation *context)
 {
 	NMManagerPrivate *priv;
-	NMAuthChain *chain;
+	EnableInfo *info;
 	GError *error = NULL;
-	gulong sender_uid = G_MAXULONG;
-	char *error_desc = NULL;
 
 	g_return_if_fail (NM_IS_MANAGER (self));
 
@@ -3579,29 +3748,11 @@ impl_manager_enable (NMManager *self,
 		return;
 	}
 
-	if (!nm_auth_get_caller_uid (context, priv->dbus_mgr, &sender_uid, &error_desc)) {
-		error = g_error_new_literal (NM_MANAGER_ERROR,
-		                             NM_MANAGER_ERROR_PERMISSION_DENIED,
-		                             error_desc);
-		dbus_g_method_return_error (context, error);
-		g_error_free (error);
-		g_free (error_desc);
-		return;
-	}
-
-	/* Root doesn't need PK authentication */
-	if (0 == sender_uid) {
-		_internal_enable (self, enable);
-		dbus_g_method_return (context);
-		return;
-	}
-
-	chain = nm_auth_chain_new (context, NULL, enable_net_done_cb, self);
-	g_assert (chain);
-	priv->auth_chains = g_slist_append (priv->auth_chains, chain);
-
-	nm_auth_chain_set_data (chain, "enable", GUINT_TO_POINTER (enable), NULL);
-	nm_auth_chain_add_call (chain, NM_AUTH_PERMISSION_ENABLE_DISABLE_NETWORK, TRUE);
+	info = g_slice_new0 (EnableInfo);
+	info->self = g_object_ref (self);
+	info->context = context;
+	info->enable = enable;
+	nm_auth_get_caller_uid_async (context, priv->dbus_mgr, enable_uid_cb, info);
 }
 
 /* Permissions */
@@ -3722,6 +3873,15 @@ impl_manager_get_logging (NMManager *manager,
 	*domains = g_strdup (nm_logging_domains_to_string ());
 }
 
+static gboolean
+impl_manager_get_log_buffer (NMManager *manager,
+                             char ***messages,
+                             GError **error)
+{
+	*messages = nm_logging_buffer_get_messages ();
+	return TRUE;
+}
+
 void
 nm_manager_start (NMManager *self)
 {
@@ -3945,6 +4105,53 @@ prop_set_auth_done_cb (NMAuthChain *chain,
 	nm_auth_chain_unref (chain);
 }
 
+typedef struct {
+	NMManager *self;
+	DBusConnection *connection;
+	DBusMessage *message;
+	const char *glib_propname;
+	const char *permission;
+	gboolean set_enabled;
+} PropSetInfo;
+
+static void
+prop_set_uid_cb (gulong uid, const char *error_desc, gpointer user_data)
+{
+	PropSetInfo *info = user_data;
+	NMManagerPrivate *priv = NM_MANAGER_GET_PRIVATE (info->self);
+	DBusMessage *reply = NULL;
+	NMAuthChain *chain;
+
+	if (error_desc)
+		reply = dbus_message_new_error (info->message, NM_PERM_DENIED_ERROR, error_desc);
+	else if (uid > 0) {
+		/* Otherwise validate the user request */
+		chain = nm_auth_chain_new_raw_message (info->message, prop_set_auth_done_cb, info->self);
+		g_assert (chain);
+		priv->auth_chains = g_slist_append (priv->auth_chains, chain);
+		nm_auth_chain_set_data (chain, "prop", g_strdup (info->glib_propname), g_free);
+		nm_auth_chain_set_data (chain, "permission", g_strdup (info->permission), g_free);
+		nm_auth_chain_set_data (chain, "enabled", GUINT_TO_POINTER (info->set_enabled), NULL);
+		nm_auth_chain_set_data (chain, "message", dbus_message_ref (info->message), (GDestroyNotify) dbus_message_unref);
+		nm_auth_chain_set_data (chain, "objectpath", g_strdup (dbus_message_get_path (info->message)), g_free);
+		nm_auth_chain_add_call (chain, info->permission, TRUE);
+	} else {
+		/* Yay for root */
+		g_object_set (info->self, info->glib_propname, info->set_enabled, NULL);
+		reply = dbus_message_new_method_return (info->message);
+	}
+
+	if (reply) {
+		dbus_connection_send (info->connection, reply, NULL);
+		dbus_message_unref (reply);
+	}
+
+	dbus_message_unref (info->message);
+	dbus_connection_unref (info->connection);
+	g_object_unref (info->self);
+	g_slice_free (PropSetInfo, info);
+}
+
 static DBusHandlerResult
 prop_filter (DBusConnection *connection,
              DBusMessage *message,
@@ -3959,11 +4166,9 @@ prop_filter (DBusConnection *connection,
 	const char *sender = NULL;
 	const char *objpath = NULL;
 	const char *glib_propname = NULL, *permission = NULL;
-	DBusError dbus_error;
-	gulong uid = G_MAXULONG;
 	DBusMessage *reply = NULL;
 	gboolean set_enabled = FALSE;
-	NMAuthChain *chain;
+	PropSetInfo *info;
 
 	/* The sole purpose of this function is to validate property accesses
 	 * on the NMManager object since dbus-glib doesn't yet give us this
@@ -4026,31 +4231,14 @@ prop_filter (DBusConnection *connection,
 		goto out;
 	}
 
-	dbus_error_init (&dbus_error);
-	uid = dbus_bus_get_unix_user (connection, sender, &dbus_error);
-	if (dbus_error_is_set (&dbus_error)) {
-		reply = dbus_message_new_error (message, NM_PERM_DENIED_ERROR,
-		                                "Could not determine the user ID of the requestor");
-		dbus_error_free (&dbus_error);
-		goto out;
-	}
-
-	if (uid > 0) {
-		/* Otherwise validate the user request */
-		chain = nm_auth_chain_new_raw_message (message, prop_set_auth_done_cb, self);
-		g_assert (chain);
-		priv->auth_chains = g_slist_append (priv->auth_chains, chain);
-		nm_auth_chain_set_data (chain, "prop", g_strdup (glib_propname), g_free);
-		nm_auth_chain_set_data (chain, "permission", g_strdup (permission), g_free);
-		nm_auth_chain_set_data (chain, "enabled", GUINT_TO_POINTER (set_enabled), NULL);
-		nm_auth_chain_set_data (chain, "message", dbus_message_ref (message), (GDestroyNotify) dbus_message_unref);
-		nm_auth_chain_set_data (chain, "objectpath", g_strdup (objpath), g_free);
-		nm_auth_chain_add_call (chain, permission, TRUE);
-	} else {
-		/* Yay for root */
-		g_object_set (self, glib_propname, set_enabled, NULL);
-		reply = dbus_message_new_method_return (message);
-	}
+	info = g_slice_new0 (PropSetInfo);
+	info->self = g_object_ref (self);
+	info->connection = dbus_connection_ref (connection);
+	info->message = dbus_message_ref (message);
+	info->glib_propname = glib_propname;
+	info->permission = permission;
+	info->set_enabled = set_enabled;
+	nm_auth_get_sender_uid_async (priv->dbus_mgr, sender, prop_set_uid_cb, info);
 
 out:
 	if (reply) {
@@ -4179,6 +4367,23 @@ authority_changed_cb (gpointer user_data)
 	g_signal_emit (NM_MANAGER (user_data), signals[CHECK_PERMISSIONS], 0);
 }
 
+static void
+update_active_connection_timestamps (NMManager *manager, gboolean flush_to_disk)
+{
+	NMManagerPrivate *priv = NM_MANAGER_GET_PRIVATE (manager);
+	GSList *iter;
+
+	for (iter = priv->active_connections; iter; iter = g_slist_next (iter)) {
+		NMActiveConnection *ac = iter->data;
+		NMSettingsConnection *connection;
+
+		if (nm_active_connection_get_state (ac) == NM_ACTIVE_CONNECTION_STATE_ACTIVATED) {
+			connection = NM_SETTINGS_CONNECTION (nm_active_connection_get_connection (ac));
+			nm_settings_connection_update_timestamp (connection, (guint64) time (NULL), flush_to_disk);
+		}
+	}
+}
+
 static void
 dispose (GObject *object)
 {
@@ -4202,6 +4407,9 @@ dispose (GObject *object)
 	/* FIXME: remove when we handle bridges non-destructively */
 	write_nm_created_bridges (manager);
 
+	/* Connections stay up across a restart; save when they were last used */
+	update_active_connection_timestamps (manager, TRUE);
+
 	/* Remove all devices */
 	while (g_slist_length (priv->devices)) {
 		priv->devices = remove_one_device (manager,
@@ -4480,20 +4688,8 @@ get_property (GObject *object, guint prop_id,
 static gboolean
 periodic_update_active_connection_timestamps (gpointer user_data)
 {
-	NMManager *manager = NM_MANAGER (user_data);
-	NMManagerPrivate *priv = NM_MANAGER_GET_PRIVATE (manager);
-	GSList *iter;
-
-	for (iter = priv->active_connections; iter; iter = g_slist_next (iter)) {
-		NMActiveConnection *ac = iter->data;
-		NMSettingsConnection *connection;
-
-		if (nm_active_connection_get_state (ac) == NM_ACTIVE_CONNECTION_STATE_ACTIVATED) {
-			connection = NM_SETTINGS_CONNECTION (nm_active_connection_get_connection (ac));
-			nm_settings_connection_update_timestamp (connection, (guint64) time (NULL), FALSE);
-		}
-	}
-
+	/* Only in memory; they're saved on deactivation and at shutdown */
+	update_active_connection_timestamps (NM_MANAGER (user_data), FALSE);
 	return TRUE;
 }
 
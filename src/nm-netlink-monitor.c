@@ -38,9 +38,11 @@
 #include <linux/if.h>
 #include <linux/unistd.h>
 #include <unistd.h>
+#include <poll.h>
 #include <netlink/netlink.h>
 #include <netlink/object.h>
 #include <netlink/route/addr.h>
+#include <netlink/route/route.h>
 #include <netlink/route/rtnl.h>
 
 #include <glib.h>
@@ -48,12 +50,19 @@
 
 #include "nm-netlink-compat.h"
 #include "nm-netlink-monitor.h"
+#include "nm-netlink-utils.h"
 #include "nm-logging.h"
 
 #define EVENT_CONDITIONS      ((GIOCondition) (G_IO_IN | G_IO_PRI))
 #define ERROR_CONDITIONS      ((GIOCondition) (G_IO_ERR | G_IO_NVAL))
 #define DISCONNECT_CONDITIONS ((GIOCondition) (G_IO_HUP))
 
+/* Upper bound on socket reads when catching up with queued events */
+#define MAX_SYNC_READS 256
+
+/* Receive buffer for the event socket, which sees every route change */
+#define EVENT_SOCKET_RCVBUF (512 * 1024)
+
 #define NM_NETLINK_MONITOR_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), \
                                            NM_TYPE_NETLINK_MONITOR, \
                                            NMNetlinkMonitorPrivate))
@@ -68,11 +77,37 @@ typedef struct {
 	struct nl_sock *nlh_sync;
 	struct nl_cache * link_cache;
 
+	/* link_cache is kept current from RTNLGRP_LINK events; these index it */
+	GHashTable *links_by_index;  /* ifindex -> struct rtnl_link */
+	GHashTable *index_by_name;   /* interface name -> ifindex */
+	gboolean    link_cache_valid;
+	guint       link_resync_id;
+	guint       link_resync_count;
+
+	/* Per-interface address and route views, kept current from the
+	 * IFADDR and ROUTE groups; populated on first use.
+	 */
+	GHashTable *ip_views;        /* ifindex -> IpView */
+	GHashTable *route_oifs;      /* struct rtnl_route -> ifindex of its view */
+	gboolean    ip_views_valid;
+
+	/* Notifications read while catching up with pending events are
+	 * emitted later from an idle handler.
+	 */
+	gboolean    defer_notifications;
+	GSList *    deferred_msgs;
+	guint       deferred_id;
+
 	guint request_status_id;
 
 	GHashTable *subscriptions;
 } NMNetlinkMonitorPrivate;
 
+typedef struct {
+	GHashTable *addrs;   /* struct rtnl_addr -> itself */
+	GHashTable *routes;  /* struct rtnl_route -> itself */
+} IpView;
+
 enum {
 	NOTIFICATION = 0,
 	CARRIER_ON,
@@ -134,6 +169,334 @@ log_error_limited (NMNetlinkMonitor *monitor, guint32 code, const char *fmt, ...
 
 /****************************************************************/
 
+static gboolean
+is_link_object (struct nl_object *obj)
+{
+	return g_strcmp0 (nl_object_get_type (obj), "route/link") == 0;
+}
+
+static void
+ip_view_free (IpView *view)
+{
+	g_hash_table_destroy (view->addrs);
+	g_hash_table_destroy (view->routes);
+	g_slice_free (IpView, view);
+}
+
+static IpView *
+ip_view_get (NMNetlinkMonitorPrivate *priv, int ifindex, gboolean create)
+{
+	IpView *view;
+
+	view = g_hash_table_lookup (priv->ip_views, GINT_TO_POINTER (ifindex));
+	if (!view && create) {
+		view = g_slice_new0 (IpView);
+		view->addrs = g_hash_table_new_full (nm_netlink_addr_hash, nm_netlink_object_identical,
+		                                     (GDestroyNotify) nl_object_put, NULL);
+		view->routes = g_hash_table_new_full (nm_netlink_route_hash, nm_netlink_object_identical,
+		                                      (GDestroyNotify) nl_object_put, NULL);
+		g_hash_table_insert (priv->ip_views, GINT_TO_POINTER (ifindex), view);
+	}
+	return view;
+}
+
+static void
+ip_view_update (NMNetlinkMonitorPrivate *priv, struct nl_object *obj, gboolean remove)
+{
+	IpView *view;
+	GHashTable *table;
+	gboolean is_addr;
+	int ifindex, old_ifindex;
+
+	if (g_strcmp0 (nl_object_get_type (obj), "route/addr") == 0) {
+		is_addr = TRUE;
+		ifindex = rtnl_addr_get_ifindex ((struct rtnl_addr *) obj);
+	} else if (g_strcmp0 (nl_object_get_type (obj), "route/route") == 0) {
+		/* Cloned routes are kernel cache entries, not configuration */
+		if (rtnl_route_get_flags ((struct rtnl_route *) obj) & RTM_F_CLONED)
+			return;
+		/* Unreachable/blackhole routes have no output interface */
+		if (rtnl_route_get_nnexthops ((struct rtnl_route *) obj) < 1)
+			return;
+		is_addr = FALSE;
+		ifindex = rtnl_route_get_oif ((struct rtnl_route *) obj);
+
+		/* The output interface isn't part of a route's identity, so a
+		 * replaced route may have moved; drop it from its old view.
+		 */
+		old_ifindex = GPOINTER_TO_INT (g_hash_table_lookup (priv->route_oifs, obj));
+		if (old_ifindex > 0 && old_ifindex != ifindex) {
+			view = ip_view_get (priv, old_ifindex, FALSE);
+			if (view)
+				g_hash_table_remove (view->routes, obj);
+		}
+		g_hash_table_remove (priv->route_oifs, obj);
+		if (!remove && ifindex > 0) {
+			nl_object_get (obj);
+			g_hash_table_insert (priv->route_oifs, obj, GINT_TO_POINTER (ifindex));
+		}
+	} else
+		return;
+
+	if (ifindex <= 0)
+		return;
+
+	view = ip_view_get (priv, ifindex, !remove);
+	if (!view)
+		return;
+	table = is_addr ? view->addrs : view->routes;
+
+	/* Replace any existing entry; the new object may carry updated
+	 * non-identifying attributes like flags or lifetimes.
+	 */
+	g_hash_table_remove (table, obj);
+	if (!remove) {
+		nl_object_get (obj);
+		g_hash_table_insert (table, obj, obj);
+	}
+}
+
+static void
+ip_view_add_cb (struct nl_object *obj, void *arg)
+{
+	ip_view_update ((NMNetlinkMonitorPrivate *) arg, obj, FALSE);
+}
+
+static gboolean
+ip_views_rebuild (NMNetlinkMonitorPrivate *priv)
+{
+	struct nl_cache *cache = NULL;
+	int err;
+
+	g_hash_table_remove_all (priv->ip_views);
+	g_hash_table_remove_all (priv->route_oifs);
+	priv->ip_views_valid = FALSE;
+
+	err = rtnl_addr_alloc_cache (priv->nlh_sync, &cache);
+	if (err < 0 || !cache) {
+		nm_log_err (LOGD_HW, "error reading addresses: %s", nl_geterror (err));
+		return FALSE;
+	}
+	nl_cache_foreach (cache, ip_view_add_cb, priv);
+	nl_cache_free (cache);
+
+	cache = NULL;
+	err = rtnl_route_alloc_cache (priv->nlh_sync, AF_UNSPEC, 0, &cache);
+	if (err < 0 || !cache) {
+		nm_log_err (LOGD_HW, "error reading routes: %s", nl_geterror (err));
+		g_hash_table_remove_all (priv->ip_views);
+		g_hash_table_remove_all (priv->route_oifs);
+		return FALSE;
+	}
+	nl_cache_foreach (cache, ip_view_add_cb, priv);
+	nl_cache_free (cache);
+
+	priv->ip_views_valid = TRUE;
+	return TRUE;
+}
+
+static void
+link_index_remove (NMNetlinkMonitorPrivate *priv, int ifindex)
+{
+	struct rtnl_link *old;
+	const char *name;
+
+	old = g_hash_table_lookup (priv->links_by_index, GINT_TO_POINTER (ifindex));
+	if (!old)
+		return;
+
+	name = rtnl_link_get_name (old);
+	if (   name
+	    && GPOINTER_TO_INT (g_hash_table_lookup (priv->index_by_name, name)) == ifindex)
+		g_hash_table_remove (priv->index_by_name, name);
+
+	g_hash_table_remove (priv->links_by_index, GINT_TO_POINTER (ifindex));
+}
+
+static void
+link_index_add (NMNetlinkMonitorPrivate *priv, struct rtnl_link *link)
+{
+	int ifindex = rtnl_link_get_ifindex (link);
+	const char *name = rtnl_link_get_name (link);
+
+	if (ifindex <= 0)
+		return;
+
+	link_index_remove (priv, ifindex);
+
+	nl_object_get (OBJ_CAST (link));
+	g_hash_table_insert (priv->links_by_index, GINT_TO_POINTER (ifindex), link);
+	if (name)
+		g_hash_table_insert (priv->index_by_name, g_strdup (name), GINT_TO_POINTER (ifindex));
+}
+
+static void
+link_index_add_cb (struct nl_object *obj, void *arg)
+{
+	link_index_add ((NMNetlinkMonitorPrivate *) arg, (struct rtnl_link *) obj);
+}
+
+static void
+link_index_rebuild (NMNetlinkMonitorPrivate *priv)
+{
+	g_hash_table_remove_all (priv->index_by_name);
+	g_hash_table_remove_all (priv->links_by_index);
+	nl_cache_foreach (priv->link_cache, link_index_add_cb, priv);
+}
+
+static int
+link_cache_refill (NMNetlinkMonitorPrivate *priv)
+{
+	int err;
+
+	err = nl_cache_refill (priv->nlh_sync, priv->link_cache);
+	if (err == 0) {
+		link_index_rebuild (priv);
+		priv->link_cache_valid = TRUE;
+	}
+	return err;
+}
+
+/* Replace (or add) a link in the cache with the given object */
+static void
+link_cache_update (NMNetlinkMonitorPrivate *priv, struct rtnl_link *link)
+{
+	struct rtnl_link *old;
+	int ifindex = rtnl_link_get_ifindex (link);
+
+	old = g_hash_table_lookup (priv->links_by_index, GINT_TO_POINTER (ifindex));
+	if (old)
+		nl_cache_remove (OBJ_CAST (old));
+	link_index_remove (priv, ifindex);
+
+	if (nl_cache_add (priv->link_cache, OBJ_CAST (link)) == 0)
+		link_index_add (priv, link);
+}
+
+static gboolean
+route_oif_matches (gpointer key, gpointer value, gpointer user_data)
+{
+	return value == user_data;
+}
+
+static void
+link_cache_delete (NMNetlinkMonitorPrivate *priv, int ifindex)
+{
+	struct rtnl_link *old;
+
+	old = g_hash_table_lookup (priv->links_by_index, GINT_TO_POINTER (ifindex));
+	if (old)
+		nl_cache_remove (OBJ_CAST (old));
+	link_index_remove (priv, ifindex);
+
+	g_hash_table_remove (priv->ip_views, GINT_TO_POINTER (ifindex));
+	g_hash_table_foreach_remove (priv->route_oifs, route_oif_matches, GINT_TO_POINTER (ifindex));
+}
+
+static gboolean
+link_resync (gpointer user_data)
+{
+	NMNetlinkMonitor *self = NM_NETLINK_MONITOR (user_data);
+	NMNetlinkMonitorPrivate *priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
+	int err;
+
+	priv->link_resync_id = 0;
+
+	err = link_cache_refill (priv);
+	if (err < 0) {
+		nm_log_err (LOGD_HW, "error resynchronizing link cache: %s", nl_geterror (err));
+		/* Lookups keep querying the kernel directly until a later resync succeeds */
+	}
+
+	/* Reload the address and route views now if anything uses them, rather
+	 * than leaving the first lookup after the overrun to pay for it; if this
+	 * fails they get reloaded on next use.
+	 */
+	if (!priv->ip_views_valid && g_hash_table_size (priv->ip_views))
+		ip_views_rebuild (priv);
+	return FALSE;
+}
+
+static void
+schedule_link_resync (NMNetlinkMonitor *self)
+{
+	NMNetlinkMonitorPrivate *priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
+
+	priv->link_cache_valid = FALSE;
+	priv->link_resync_count++;
+	nm_log_dbg (LOGD_HW, "netlink event socket overflowed; resynchronizing link cache (%u)",
+	            priv->link_resync_count);
+
+	/* Address and route views get reloaded on next use */
+	priv->ip_views_valid = FALSE;
+
+	if (!priv->link_resync_id)
+		priv->link_resync_id = g_idle_add_full (G_PRIORITY_HIGH, link_resync, self, NULL);
+}
+
+/* Whether the link cache reflects every link event the kernel has sent us.
+ * Notifications for changes we just made on the sync socket are queued on
+ * the event socket before the kernel acks the request, so if nothing is
+ * pending there the cache is current.
+ */
+static gboolean
+events_pending (NMNetlinkMonitorPrivate *priv)
+{
+	struct pollfd pfd;
+
+	pfd.fd = nl_socket_get_fd (priv->nlh_event);
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return poll (&pfd, 1, 0) > 0;
+}
+
+static gboolean
+link_cache_is_current (NMNetlinkMonitorPrivate *priv)
+{
+	if (!priv->link_cache_valid || !priv->event_id || !priv->nlh_event)
+		return FALSE;
+
+	return !events_pending (priv);
+}
+
+/* Returns the cached link for @ifindex or @name, asking the kernel for just
+ * that one link if the cache may be stale.  The returned object is owned
+ * by the cache.
+ */
+static struct rtnl_link *
+link_lookup (NMNetlinkMonitorPrivate *priv, int ifindex, const char *name)
+{
+	struct rtnl_link *link = NULL;
+	int err;
+
+	if (!link_cache_is_current (priv)) {
+		err = rtnl_link_get_kernel (priv->nlh_sync, ifindex, name, &link);
+		if (err == 0) {
+			link_cache_update (priv, link);
+			rtnl_link_put (link);
+		} else if (err == -NLE_OPNOTSUPP) {
+			/* Kernel can't look up links by name; fall back to a full dump */
+			link_cache_refill (priv);
+		} else if (err == -NLE_OBJ_NOTFOUND) {
+			/* Link is gone */
+			if (ifindex <= 0 && name)
+				ifindex = GPOINTER_TO_INT (g_hash_table_lookup (priv->index_by_name, name));
+			if (ifindex > 0)
+				link_cache_delete (priv, ifindex);
+			return NULL;
+		}
+	}
+
+	if (ifindex <= 0 && name)
+		ifindex = GPOINTER_TO_INT (g_hash_table_lookup (priv->index_by_name, name));
+	if (ifindex <= 0)
+		return NULL;
+
+	return g_hash_table_lookup (priv->links_by_index, GINT_TO_POINTER (ifindex));
+}
+
+/****************************************************************/
+
 static void
 link_msg_handler (struct nl_object *obj, void *arg)
 {
@@ -216,24 +579,115 @@ event_msg_recv (struct nl_msg *msg, void *arg)
 	return NL_OK;
 }
 
+static void
+event_object_handler (struct nl_object *obj, void *arg)
+{
+	NMNetlinkMonitor *self = NM_NETLINK_MONITOR (arg);
+	NMNetlinkMonitorPrivate *priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
+	struct rtnl_link *link_obj = (struct rtnl_link *) obj;
+	int msgtype = nl_object_get_msgtype (obj);
+
+	if (!is_link_object (obj)) {
+		if (priv->ip_views_valid)
+			ip_view_update (priv, obj, msgtype == RTM_DELADDR || msgtype == RTM_DELROUTE);
+		return;
+	}
+
+	/* Only generic link messages carry the full link state; AF_INET6 and
+	 * AF_BRIDGE dumps requested by other users would clobber the cache.
+	 */
+	if (priv->link_cache && rtnl_link_get_family (link_obj) == AF_UNSPEC) {
+		if (msgtype == RTM_DELLINK)
+			link_cache_delete (priv, rtnl_link_get_ifindex (link_obj));
+		else
+			link_cache_update (priv, link_obj);
+	}
+
+	if (!priv->defer_notifications)
+		link_msg_handler (obj, arg);
+}
+
+static void
+emit_deferred_notifications (NMNetlinkMonitor *self)
+{
+	NMNetlinkMonitorPrivate *priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
+	GSList *msgs, *iter;
+
+	if (priv->deferred_id) {
+		g_source_remove (priv->deferred_id);
+		priv->deferred_id = 0;
+	}
+
+	msgs = g_slist_reverse (priv->deferred_msgs);
+	priv->deferred_msgs = NULL;
+
+	for (iter = msgs; iter; iter = g_slist_next (iter)) {
+		g_signal_emit (self, signals[NOTIFICATION], 0, iter->data);
+		nl_msg_parse (iter->data, &link_msg_handler, self);
+		nlmsg_free (iter->data);
+	}
+	g_slist_free (msgs);
+}
+
+static gboolean
+deferred_notifications_cb (gpointer user_data)
+{
+	NMNetlinkMonitor *self = NM_NETLINK_MONITOR (user_data);
+
+	NM_NETLINK_MONITOR_GET_PRIVATE (self)->deferred_id = 0;
+	emit_deferred_notifications (self);
+	return FALSE;
+}
+
 static int
 event_msg_ready (struct nl_msg *msg, void *arg)
 {
 	NMNetlinkMonitor *self = NM_NETLINK_MONITOR (arg);
+	NMNetlinkMonitorPrivate *priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
 
 	/* By the time the message gets here we've already checked the sender
 	 * and we're sure it's safe to parse this message.
 	 */
 
-	/* Let clients handle generic messages */
-	g_signal_emit (self, signals[NOTIFICATION], 0, msg);
+	if (priv->defer_notifications) {
+		/* Caught up from inside a lookup; notify clients later */
+		nlmsg_get (msg);
+		priv->deferred_msgs = g_slist_prepend (priv->deferred_msgs, msg);
+		if (!priv->deferred_id)
+			priv->deferred_id = g_idle_add_full (G_PRIORITY_HIGH, deferred_notifications_cb, self, NULL);
+	} else {
+		/* Let clients handle generic messages */
+		g_signal_emit (self, signals[NOTIFICATION], 0, msg);
+	}
 
-	/* Parse carrier messages */
-	nl_msg_parse (msg, &link_msg_handler, self);
+	/* Update the caches and parse carrier messages */
+	nl_msg_parse (msg, &event_object_handler, self);
 
 	return NL_OK;
 }
 
+/* Applies any events already queued on the event socket to the caches,
+ * without emitting signals from inside the caller's stack.
+ */
+static void
+sync_pending_events (NMNetlinkMonitor *self)
+{
+	NMNetlinkMonitorPrivate *priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
+	int i, err;
+
+	g_return_if_fail (priv->defer_notifications == FALSE);
+
+	priv->defer_notifications = TRUE;
+	for (i = 0; i < MAX_SYNC_READS && events_pending (priv); i++) {
+		err = nl_recvmsgs_default (priv->nlh_event);
+		if (err == -NLE_NOMEM)
+			schedule_link_resync (self);
+		else if (err < 0)
+			break;
+	}
+	priv->defer_notifications = FALSE;
+}
+
 static gboolean
 event_handler (GIOChannel *channel,
                GIOCondition io_condition,
@@ -266,9 +720,16 @@ event_handler (GIOChannel *channel,
 
 	g_return_val_if_fail (!(io_condition & ~EVENT_CONDITIONS), FALSE);
 
+	/* Keep notifications in order */
+	if (priv->deferred_msgs)
+		emit_deferred_notifications (self);
+
 	/* Process the netlink messages */
 	err = nl_recvmsgs_default (priv->nlh_event);
-	if (err < 0) {
+	if (err == -NLE_NOMEM) {
+		/* ENOBUFS: the kernel dropped messages, so the caches are stale */
+		schedule_link_resync (self);
+	} else if (err < 0) {
 		log_error_limited (self, NM_NETLINK_MONITOR_ERROR_PROCESSING_MESSAGE,
 		                   _("error processing netlink message: %s"),
 		                   nl_geterror (err));
@@ -338,10 +799,22 @@ event_connection_setup (NMNetlinkMonitor *self, GError **error)
 
 	nl_socket_disable_seq_check (priv->nlh_event);
 
+	/* Route changes come in bursts (e.g. a full BGP/VPN table); give the
+	 * socket enough room that a burst doesn't force a full resync.
+	 */
+	nl_socket_set_buffer_size (priv->nlh_event, EVENT_SOCKET_RCVBUF, 0);
+
 	/* Subscribe to the LINK group for internal carrier signals */
 	if (!nm_netlink_monitor_subscribe (self, RTNLGRP_LINK, error))
 		goto error;
 
+	/* And to address and route changes for the per-interface views */
+	if (   !nm_netlink_monitor_subscribe (self, RTNLGRP_IPV4_IFADDR, error)
+	    || !nm_netlink_monitor_subscribe (self, RTNLGRP_IPV6_IFADDR, error)
+	    || !nm_netlink_monitor_subscribe (self, RTNLGRP_IPV4_ROUTE, error)
+	    || !nm_netlink_monitor_subscribe (self, RTNLGRP_IPV6_ROUTE, error))
+		goto error;
+
 	fd = nl_socket_get_fd (priv->nlh_event);
 	priv->io_channel = g_io_channel_unix_new (fd);
 
@@ -418,6 +891,8 @@ sync_connection_setup (NMNetlinkMonitor *self, GError **error)
 		goto error;
 	}
 	nl_cache_mngt_provide (priv->link_cache);
+	link_index_rebuild (priv);
+	priv->link_cache_valid = TRUE;
 
 	return TRUE;
 
@@ -617,6 +1092,7 @@ deferred_emit_carrier_state (gpointer user_data)
 {
 	NMNetlinkMonitor *self = NM_NETLINK_MONITOR (user_data);
 	NMNetlinkMonitorPrivate *priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
+	GList *links, *iter;
 	int err;
 
 	priv->request_status_id = 0;
@@ -624,11 +1100,23 @@ deferred_emit_carrier_state (gpointer user_data)
 	/* Update the link cache with latest state, and if there are no errors
 	 * emit the link states for all the interfaces in the cache.
 	 */
-	err = nl_cache_refill (priv->nlh_sync, priv->link_cache);
-	if (err < 0)
+	err = link_cache_refill (priv);
+	if (err < 0) {
 		nm_log_err (LOGD_HW, "error updating link cache: %s", nl_geterror (err));
-	else
-		nl_cache_foreach_filter (priv->link_cache, NULL, link_msg_handler, self);
+		return FALSE;
+	}
+
+	/* Signal handlers may look up links and thus modify the cache, so
+	 * don't emit while iterating it.
+	 */
+	links = g_hash_table_get_values (priv->links_by_index);
+	for (iter = links; iter; iter = g_list_next (iter))
+		nl_object_get (OBJ_CAST (iter->data));
+	for (iter = links; iter; iter = g_list_next (iter)) {
+		link_msg_handler (OBJ_CAST (iter->data), self);
+		rtnl_link_put (iter->data);
+	}
+	g_list_free (links);
 
 	return FALSE;
 }
@@ -647,23 +1135,6 @@ nm_netlink_monitor_request_status (NMNetlinkMonitor *self)
 		priv->request_status_id = g_idle_add (deferred_emit_carrier_state, self);
 }
 
-typedef struct {
-	NMNetlinkMonitor *self;
-	struct rtnl_link *filter;
-	GError *error;
-	guint32 flags;
-} GetFlagsInfo;
-
-static void
-get_flags_sync_cb (struct nl_object *obj, void *arg)
-{
-	GetFlagsInfo *info = arg;
-
-	/* Ensure this cache item matches our filter */
-	if (nl_object_match_filter (obj, OBJ_CAST (info->filter)) != 0)
-		info->flags = rtnl_link_get_flags ((struct rtnl_link *) obj);
-}
-
 gboolean
 nm_netlink_monitor_get_flags_sync (NMNetlinkMonitor *self,
                                    guint32 ifindex,
@@ -671,9 +1142,7 @@ nm_netlink_monitor_get_flags_sync (NMNetlinkMonitor *self,
                                    GError **error)
 {
 	NMNetlinkMonitorPrivate *priv;
-	GetFlagsInfo info;
-	struct rtnl_link *filter;
-	int err;
+	struct rtnl_link *link;
 
 	g_return_val_if_fail (self != NULL, FALSE);
 	g_return_val_if_fail (NM_IS_NETLINK_MONITOR (self), FALSE);
@@ -681,60 +1150,120 @@ nm_netlink_monitor_get_flags_sync (NMNetlinkMonitor *self,
 
 	priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
 
-	/* Update the link cache with the latest information */
-	err = nl_cache_refill (priv->nlh_sync, priv->link_cache);
-	if (err < 0) {
-		g_set_error (error,
-		             NM_NETLINK_MONITOR_ERROR,
-		             NM_NETLINK_MONITOR_ERROR_LINK_CACHE_UPDATE,
-		             _("error updating link cache: %s"),
-		             nl_geterror (err));
-		return FALSE;
-	}
+	link = link_lookup (priv, ifindex, NULL);
+	*ifflags = link ? rtnl_link_get_flags (link) : 0;
 
-	/* HACK: Apparently to get it working we have to refill the cache twice;
-	 * otherwise some kernels (or maybe libnl?) only send a few of the
-	 * interfaces in the refill request.
-	 */
-	if (nl_cache_refill (priv->nlh_sync, priv->link_cache)) {
-		g_set_error (error,
-		             NM_NETLINK_MONITOR_ERROR,
-		             NM_NETLINK_MONITOR_ERROR_LINK_CACHE_UPDATE,
-		             _("error updating link cache: %s"),
-		             nl_geterror (err));
-		return FALSE;
+	return TRUE; /* success */
+}
+
+/**
+ * nm_netlink_monitor_get_link_resync_count:
+ * @self: the #NMNetlinkMonitor
+ *
+ * Returns: the number of times the link cache had to be fully reloaded
+ * because the kernel dropped link events (ENOBUFS)
+ **/
+guint
+nm_netlink_monitor_get_link_resync_count (NMNetlinkMonitor *self)
+{
+	g_return_val_if_fail (NM_IS_NETLINK_MONITOR (self), 0);
+
+	return NM_NETLINK_MONITOR_GET_PRIVATE (self)->link_resync_count;
+}
+
+static IpView *
+get_current_ip_view (NMNetlinkMonitor *self, int ifindex)
+{
+	NMNetlinkMonitorPrivate *priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
+
+	if (priv->event_id && priv->nlh_event)
+		sync_pending_events (self);
+	else {
+		/* Not processing events, so the views can't be trusted */
+		priv->ip_views_valid = FALSE;
 	}
 
-	/* Set up the filter */
-	filter = rtnl_link_alloc ();
-	if (!filter) {
-		g_set_error (error,
-		             NM_NETLINK_MONITOR_ERROR,
-		             NM_NETLINK_MONITOR_ERROR_BAD_ALLOC,
-		             _("error processing netlink message: %s"),
-		             nl_geterror (err));
-		return FALSE;
+	if (!priv->ip_views_valid && !ip_views_rebuild (priv))
+		return NULL;
+
+	return ip_view_get (priv, ifindex, FALSE);
+}
+
+static GSList *
+collect_objects (GHashTable *table, int family, int (*get_family) (struct nl_object *))
+{
+	GHashTableIter iter;
+	struct nl_object *obj;
+	GSList *list = NULL;
+
+	g_hash_table_iter_init (&iter, table);
+	while (g_hash_table_iter_next (&iter, (gpointer) &obj, NULL)) {
+		if (family != AF_UNSPEC && get_family (obj) != family)
+			continue;
+		nl_object_get (obj);
+		list = g_slist_prepend (list, obj);
 	}
-	rtnl_link_set_ifindex (filter, ifindex);
+	return list;
+}
 
-	memset (&info, 0, sizeof (info));
-	info.self = self;
-	info.filter = filter;
-	info.error = NULL;
-	nl_cache_foreach_filter (priv->link_cache, NULL, get_flags_sync_cb, &info);
+static int
+addr_family (struct nl_object *obj)
+{
+	return rtnl_addr_get_family ((struct rtnl_addr *) obj);
+}
 
-	rtnl_link_put (filter);
+static int
+route_family (struct nl_object *obj)
+{
+	return rtnl_route_get_family ((struct rtnl_route *) obj);
+}
 
-	if (info.error) {
-		if (error)
-			*error = info.error;
-		else
-			g_error_free (info.error);
-		return FALSE;
-	} else
-		*ifflags = info.flags;
+/**
+ * nm_netlink_monitor_get_addresses:
+ * @self: the #NMNetlinkMonitor
+ * @ifindex: interface index
+ * @family: address family to filter for, or %AF_UNSPEC
+ *
+ * Returns the addresses currently assigned to the interface, from the
+ * event-maintained view rather than a dump of every address on the system.
+ *
+ * Returns: a list of referenced #rtnl_addr objects; release each with
+ * rtnl_addr_put() and free the list
+ **/
+GSList *
+nm_netlink_monitor_get_addresses (NMNetlinkMonitor *self, int ifindex, int family)
+{
+	IpView *view;
 
-	return TRUE; /* success */
+	g_return_val_if_fail (NM_IS_NETLINK_MONITOR (self), NULL);
+	g_return_val_if_fail (ifindex > 0, NULL);
+
+	view = get_current_ip_view (self, ifindex);
+	return view ? collect_objects (view->addrs, family, addr_family) : NULL;
+}
+
+/**
+ * nm_netlink_monitor_get_routes:
+ * @self: the #NMNetlinkMonitor
+ * @ifindex: interface index
+ * @family: address family to filter for, or %AF_UNSPEC
+ *
+ * Returns the routes whose output interface is @ifindex, from the
+ * event-maintained view rather than a dump of the whole routing table.
+ *
+ * Returns: a list of referenced #rtnl_route objects; release each with
+ * rtnl_route_put() and free the list
+ **/
+GSList *
+nm_netlink_monitor_get_routes (NMNetlinkMonitor *self, int ifindex, int family)
+{
+	IpView *view;
+
+	g_return_val_if_fail (NM_IS_NETLINK_MONITOR (self), NULL);
+	g_return_val_if_fail (ifindex > 0, NULL);
+
+	view = get_current_ip_view (self, ifindex);
+	return view ? collect_objects (view->routes, family, route_family) : NULL;
 }
 
 /***************************************************************/
@@ -757,6 +1286,7 @@ nm_netlink_iface_to_index (const char *iface)
 {
 	NMNetlinkMonitor *self;
 	NMNetlinkMonitorPrivate *priv;
+	struct rtnl_link *link;
 	int idx;
 
 	g_return_val_if_fail (iface != NULL, -1);
@@ -764,8 +1294,8 @@ nm_netlink_iface_to_index (const char *iface)
 	self = nm_netlink_monitor_get ();
 	priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
 
-	nl_cache_refill (priv->nlh_sync, priv->link_cache);
-	idx = rtnl_link_name2i (priv->link_cache, iface);
+	link = link_lookup (priv, 0, iface);
+	idx = link ? rtnl_link_get_ifindex (link) : 0;
 	g_object_unref (self);
 
 	return idx;
@@ -778,12 +1308,12 @@ nm_netlink_iface_to_index (const char *iface)
  * Returns: the device name corresponding to the kernel interface index; caller
  * owns returned value and must free it when it is no longer required
  **/
-#define MAX_IFACE_LEN 33
 char *
 nm_netlink_index_to_iface (int idx)
 {
 	NMNetlinkMonitor *self;
 	NMNetlinkMonitorPrivate *priv;
+	struct rtnl_link *link;
 	char *buf = NULL;
 
 	g_return_val_if_fail (idx >= 0, NULL);
@@ -791,15 +1321,11 @@ nm_netlink_index_to_iface (int idx)
 	self = nm_netlink_monitor_get ();
 	priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
 
-	buf = g_malloc0 (MAX_IFACE_LEN);
-	g_assert (buf);
-
-	nl_cache_refill (priv->nlh_sync, priv->link_cache);
-	if (!rtnl_link_i2name (priv->link_cache, idx, buf, MAX_IFACE_LEN - 1)) {
+	link = link_lookup (priv, idx, NULL);
+	if (link && rtnl_link_get_name (link))
+		buf = g_strdup (rtnl_link_get_name (link));
+	else
 		nm_log_warn (LOGD_HW, "(%d) failed to find interface name for index", idx);
-		g_free (buf);
-		buf = NULL;
-	}
 
 	g_object_unref (self);
 	return buf;
@@ -810,7 +1336,7 @@ nm_netlink_index_to_rtnl_link (int idx)
 {
 	NMNetlinkMonitor *self;
 	NMNetlinkMonitorPrivate *priv;
-	struct rtnl_link *ret = NULL;
+	struct rtnl_link *link, *ret = NULL;
 
 	if (idx <= 0)
 		return NULL;
@@ -818,8 +1344,10 @@ nm_netlink_index_to_rtnl_link (int idx)
 	self = nm_netlink_monitor_get ();
 	priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
 
-	nl_cache_refill (priv->nlh_sync, priv->link_cache);
-	ret = rtnl_link_get (priv->link_cache, idx);
+	/* Callers may modify the returned link, so hand out a copy */
+	link = link_lookup (priv, idx, NULL);
+	if (link)
+		ret = (struct rtnl_link *) nl_object_clone (OBJ_CAST (link));
 	g_object_unref (self);
 
 	return ret;
@@ -862,6 +1390,13 @@ nm_netlink_monitor_init (NMNetlinkMonitor *self)
 	NMNetlinkMonitorPrivate *priv = NM_NETLINK_MONITOR_GET_PRIVATE (self);
 
 	priv->subscriptions = g_hash_table_new (g_direct_hash, g_direct_equal);
+	priv->links_by_index = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+	                                              NULL, (GDestroyNotify) rtnl_link_put);
+	priv->index_by_name = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->ip_views = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+	                                        NULL, (GDestroyNotify) ip_view_free);
+	priv->route_oifs = g_hash_table_new_full (nm_netlink_route_hash, nm_netlink_object_identical,
+	                                          (GDestroyNotify) nl_object_put, NULL);
 }
 
 static void
@@ -872,6 +1407,19 @@ finalize (GObject *object)
 	if (priv->request_status_id)
 		g_source_remove (priv->request_status_id);
 
+	if (priv->link_resync_id)
+		g_source_remove (priv->link_resync_id);
+
+	if (priv->deferred_id)
+		g_source_remove (priv->deferred_id);
+	g_slist_foreach (priv->deferred_msgs, (GFunc) nlmsg_free, NULL);
+	g_slist_free (priv->deferred_msgs);
+
+	g_hash_table_destroy (priv->ip_views);
+	g_hash_table_destroy (priv->route_oifs);
+	g_hash_table_destroy (priv->index_by_name);
+	g_hash_table_destroy (priv->links_by_index);
+
 	if (priv->io_channel)
 		nm_netlink_monitor_close_connection (NM_NETLINK_MONITOR (object));
 
@@ -91,6 +91,15 @@ gboolean          nm_netlink_monitor_get_flags_sync   (NMNetlinkMonitor *monitor
                                                        guint32 *ifflags,
                                                        GError **error);
 
+guint             nm_netlink_monitor_get_link_resync_count (NMNetlinkMonitor *monitor);
+
+GSList *          nm_netlink_monitor_get_addresses    (NMNetlinkMonitor *monitor,
+                                                       int ifindex,
+                                                       int family);
+GSList *          nm_netlink_monitor_get_routes       (NMNetlinkMonitor *monitor,
+                                                       int ifindex,
+                                                       int family);
+
 #include "nm-netlink-compat.h"
 
 /* Generic utility functions */
@@ -85,8 +85,8 @@ nm_netlink_find_address (int ifindex,
                          void *addr,  /* struct in_addr or struct in6_addr */
                          int prefix)
 {
-	struct nl_sock *nlh = NULL;
-	struct nl_cache *cache = NULL;
+	NMNetlinkMonitor *monitor;
+	GSList *addrs, *iter;
 	FindAddrInfo info;
 
 	g_return_val_if_fail (ifindex > 0, FALSE);
@@ -106,14 +106,15 @@ nm_netlink_find_address (int ifindex,
 	else
 		g_assert_not_reached ();
 
-	nlh = nm_netlink_get_default_handle ();
-	if (nlh) {
-		rtnl_addr_alloc_cache(nlh, &cache);
-		if (cache) {
-			nl_cache_mngt_provide (cache);
-			nl_cache_foreach (cache, find_one_address, &info);
-			nl_cache_free (cache);
+	monitor = nm_netlink_monitor_get ();
+	if (monitor) {
+		addrs = nm_netlink_monitor_get_addresses (monitor, ifindex, family);
+		for (iter = addrs; iter; iter = g_slist_next (iter)) {
+			find_one_address (iter->data, &info);
+			rtnl_addr_put (iter->data);
 		}
+		g_slist_free (addrs);
+		g_object_unref (monitor);
 	}
 	return info.found;
 }
@@ -311,6 +312,117 @@ nm_netlink_route_delete (struct rtnl_route *route)
 	return (err && (err != -NLE_OBJ_NOTFOUND) && (err != -NLE_RANGE) ) ? FALSE : TRUE;
 }
 
+static guint
+nl_addr_hash (struct nl_addr *addr)
+{
+	const guint8 *bytes;
+	guint i, len, h;
+
+	if (!addr)
+		return 0;
+
+	h = (nl_addr_get_family (addr) << 8) + nl_addr_get_prefixlen (addr);
+	bytes = nl_addr_get_binary_addr (addr);
+	len = nl_addr_get_len (addr);
+	for (i = 0; bytes && i < len; i++)
+		h = (h << 5) + h + bytes[i];
+	return h;
+}
+
+/* The hash functions only use attributes that nl_object_identical()
+ * compares, so objects it considers identical always hash the same.
+ */
+guint
+nm_netlink_addr_hash (gconstpointer key)
+{
+	struct rtnl_addr *addr = (struct rtnl_addr *) key;
+
+	return   nl_addr_hash (rtnl_addr_get_local (addr))
+	       ^ (rtnl_addr_get_family (addr) << 16)
+	       ^ rtnl_addr_get_prefixlen (addr);
+}
+
+guint
+nm_netlink_route_hash (gconstpointer key)
+{
+	struct rtnl_route *route = (struct rtnl_route *) key;
+
+	return   nl_addr_hash (rtnl_route_get_dst (route))
+	       ^ (rtnl_route_get_priority (route) << 8)
+	       ^ rtnl_route_get_table (route);
+}
+
+gboolean
+nm_netlink_object_identical (gconstpointer a, gconstpointer b)
+{
+	return nl_object_identical ((struct nl_object *) a, (struct nl_object *) b);
+}
+
+/* Requests sent before collecting their acknowledgements; bounded so the
+ * acks can't overrun the socket's receive buffer.
+ */
+#define BATCH_WINDOW 64
+
+/**
+ * nm_netlink_send_batch:
+ * @msgs: netlink requests to send; each is freed
+ * @num: number of requests in @msgs
+ * @errors: (allow-none): on return, the result of each request: zero on
+ *   success or the netlink error otherwise
+ *
+ * Sends the requests on the default handle in order without waiting for
+ * the kernel to acknowledge each one before sending the next, then
+ * collects the acknowledgements.
+ *
+ * Returns: the number of requests that failed
+ **/
+int
+nm_netlink_send_batch (struct nl_msg **msgs, int num, int *errors)
+{
+	struct nl_sock *nlh;
+	int i, start, sent, err, failed = 0;
+
+	nlh = nm_netlink_get_default_handle ();
+
+	for (start = 0; start < num; start += BATCH_WINDOW) {
+		int end = MIN (start + BATCH_WINDOW, num);
+
+		/* The kernel handles rtnetlink requests in order, so the acks come
+		 * back in the order they were sent.
+		 */
+		for (i = start, sent = start; i < end; i++) {
+			err = nlh ? nl_send_auto_complete (nlh, msgs[i]) : -NLE_BAD_SOCK;
+			nlmsg_free (msgs[i]);
+			msgs[i] = NULL;
+			if (err < 0)
+				break;
+			sent++;
+		}
+
+		for (i = start; i < end; i++) {
+			if (i < sent) {
+				err = nl_wait_for_ack (nlh);
+				/* LIBNL Bug: Aliased ESRCH */
+				if (err == -NLE_FAILURE)
+					err = -NLE_OBJ_NOTFOUND;
+			} else {
+				err = nlh ? -NLE_FAILURE : -NLE_BAD_SOCK;
+				if (msgs[i]) {
+					nlmsg_free (msgs[i]);
+					msgs[i] = NULL;
+				}
+			}
+
+			if (err < 0)
+				failed++;
+			if (errors)
+				errors[i] = err;
+		}
+	}
+
+	return failed;
+}
+
 
 static void
 dump_route (struct rtnl_route *route)
@@ -410,10 +522,12 @@ foreach_route_cb (struct nl_object *object, void *user_data)
 		}
 	}
 
-	info->out_route = info->callback (route, dst, info->iface, info->user_data);
-	if (info->out_route) {
-		/* Ref the route so it sticks around after the cache is cleared */
-		rtnl_route_get (info->out_route);
+	route = info->callback (route, dst, info->iface, info->user_data);
+	if (route) {
+		/* Hand out a private copy; the route may live in the monitor's
+		 * views, which callers must not modify.
+		 */
+		info->out_route = (struct rtnl_route *) nl_object_clone ((struct nl_object *) route);
 	}
 }
 
@@ -440,7 +554,9 @@ nm_netlink_foreach_route (int ifindex,
                           NlRouteForeachFunc callback,
                           gpointer user_data)
 {
+	NMNetlinkMonitor *monitor;
 	struct nl_cache *cache;
+	GSList *routes, *iter;
 	ForeachRouteInfo info;
 
 	memset (&info, 0, sizeof (info));
@@ -452,11 +568,23 @@ nm_netlink_foreach_route (int ifindex,
 	info.user_data = user_data;
 	info.iface = nm_netlink_index_to_iface (ifindex);
 
-	rtnl_route_alloc_cache (nm_netlink_get_default_handle (), family, 0, &cache);
-	g_warn_if_fail (cache != NULL);
-	if (cache) {
-		nl_cache_foreach (cache, foreach_route_cb, &info);
-		nl_cache_free (cache);
+	monitor = ifindex > 0 ? nm_netlink_monitor_get () : NULL;
+	if (monitor) {
+		/* Only look at the interface's own routes */
+		routes = nm_netlink_monitor_get_routes (monitor, ifindex, family);
+		for (iter = routes; iter; iter = g_slist_next (iter)) {
+			foreach_route_cb (iter->data, &info);
+			rtnl_route_put (iter->data);
+		}
+		g_slist_free (routes);
+		g_object_unref (monitor);
+	} else {
+		rtnl_route_alloc_cache (nm_netlink_get_default_handle (), family, 0, &cache);
+		g_warn_if_fail (cache != NULL);
+		if (cache) {
+			nl_cache_foreach (cache, foreach_route_cb, &info);
+			nl_cache_free (cache);
+		}
 	}
 	g_free (info.iface);
 	return info.out_route;
@@ -55,6 +55,13 @@ int nm_netlink_route6_add (struct rtnl_route *route,
 
 gboolean nm_netlink_route_delete (struct rtnl_route *route);
 
+int nm_netlink_send_batch (struct nl_msg **msgs, int num, int *errors);
+
+/* GHashTable functions keyed on the identifying attributes of libnl objects */
+guint    nm_netlink_addr_hash         (gconstpointer addr);   /* struct rtnl_addr */
+guint    nm_netlink_route_hash        (gconstpointer route);  /* struct rtnl_route */
+gboolean nm_netlink_object_identical  (gconstpointer a, gconstpointer b);
+
 /**
  * NlRouteForeachFunc:
  * @route: the route being processed
@@ -887,8 +887,8 @@ auto_activate_device (gpointer user_data)
 	/* Remove connections that shouldn't be auto-activated */
 	while (iter) {
 		NMSettingsConnection *candidate = NM_SETTINGS_CONNECTION (iter->data);
+		const NMSettingsConnectionMatch *match;
 		gboolean remove_it = FALSE;
-		const char *permission;
 
 		/* Grab next item before we possibly delete the current item */
 		iter = g_slist_next (iter);
@@ -897,15 +897,14 @@ auto_activate_device (gpointer user_data)
 		 * to any logged-in users.  Also ignore shared wifi connections for
 		 * which no user has the shared wifi permission.
 		 */
-		if (   get_connection_auto_retries (NM_CONNECTION (candidate)) == 0
+		match = nm_settings_connection_get_match (candidate);
+		if (   !match->autoconnect
+		    || get_connection_auto_retries (NM_CONNECTION (candidate)) == 0
 		    || nm_settings_connection_is_visible (candidate) == FALSE)
 			remove_it = TRUE;
-		else {
-			permission = nm_utils_get_shared_wifi_permission (NM_CONNECTION (candidate));
-			if (permission) {
-				if (nm_settings_connection_check_permission (candidate, permission) == FALSE)
-					remove_it = TRUE;
-			}
+		else if (match->shared_permission) {
+			if (nm_settings_connection_check_permission (candidate, match->shared_permission) == FALSE)
+				remove_it = TRUE;
 		}
 
 		if (remove_it)
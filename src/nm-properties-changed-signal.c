@@ -184,6 +184,69 @@ notify (GObject *object, GParamSpec *pspec)
 		info->idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, properties_changed, object, idle_id_reset);
 }
 
+/**
+ * nm_properties_get_exported:
+ * @object: an object using nm_properties_changed_signal_new()
+ *
+ * Collects the current value of every exported property of @object in the
+ * same form the PropertiesChanged signal uses, for bulk snapshots.
+ *
+ * Returns: a new hash table of D-Bus property name -> #GValue
+ **/
+GHashTable *
+nm_properties_get_exported (GObject *object)
+{
+	GHashTable *props;
+	GParamSpec **pspecs;
+	guint n_pspecs, i;
+	GValue *value;
+
+	props = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, destroy_value);
+
+	pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (object), &n_pspecs);
+	for (i = 0; i < n_pspecs; i++) {
+		GParamSpec *pspec = pspecs[i];
+
+		if (   !(pspec->flags & G_PARAM_READABLE)
+		    || (pspec->flags & NM_PROPERTY_PARAM_NO_EXPORT))
+			continue;
+
+		/* Internal object references can't be sent over the bus */
+		if (   G_TYPE_IS_OBJECT (pspec->value_type)
+		    || G_TYPE_IS_INTERFACE (pspec->value_type)
+		    || pspec->value_type == G_TYPE_POINTER)
+			continue;
+
+		value = g_slice_new0 (GValue);
+		g_value_init (value, pspec->value_type);
+		g_object_get_property (object, pspec->name, value);
+		g_hash_table_insert (props, uscore_to_wincaps (pspec->name), value);
+	}
+	g_free (pspecs);
+
+	return props;
+}
+
+/**
+ * nm_properties_add_object_paths:
+ * @props: a hash table returned by nm_properties_get_exported()
+ * @name: the D-Bus name to store @paths under
+ * @paths: (transfer full): array of object paths
+ *
+ * Adds a list of child objects that are only exported through a method
+ * (like a device's access points) to @props.
+ **/
+void
+nm_properties_add_object_paths (GHashTable *props, const char *name, GPtrArray *paths)
+{
+	GValue *value;
+
+	value = g_slice_new0 (GValue);
+	g_value_init (value, DBUS_TYPE_G_ARRAY_OF_OBJECT_PATH);
+	g_value_take_boxed (value, paths);
+	g_hash_table_insert (props, g_strdup (name), value);
+}
+
 guint
 nm_properties_changed_signal_new (GObjectClass *object_class,
 						    guint class_offset)
@@ -29,4 +29,10 @@
 guint nm_properties_changed_signal_new (GObjectClass *object_class,
 								guint class_offset);
 
+GHashTable *nm_properties_get_exported (GObject *object);
+
+void nm_properties_add_object_paths (GHashTable *props,
+                                     const char *name,
+                                     GPtrArray *paths);
+
 #endif /* _NM_PROPERTIES_CHANGED_SIGNAL_H_ */
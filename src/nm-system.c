@@ -152,153 +152,152 @@ nm_system_device_set_ip4_route (int ifindex,
 	return route;
 }
 
+static gboolean
+addr_to_string (struct rtnl_addr *addr, char *buf, size_t len)
+{
+	struct nl_addr *nladdr = rtnl_addr_get_local (addr);
+	int family = rtnl_addr_get_family (addr);
+
+	if (!nladdr || (family != AF_INET && family != AF_INET6))
+		return FALSE;
+	return inet_ntop (family, nl_addr_get_binary_addr (nladdr), buf, len) != NULL;
+}
+
 static gboolean
 sync_addresses (int ifindex,
                 int family,
 				struct rtnl_addr **addrs,
 				int num_addrs)
 {
-	struct nl_sock *nlh;
-	struct nl_cache *addr_cache = NULL;
-	struct rtnl_addr *filter_addr = NULL, *match_addr;
-	struct nl_object *match;
-	struct nl_addr *nladdr;
-	int i, err;
+	NMNetlinkMonitor *monitor;
+	GSList *existing, *iter;
+	GHashTable *wanted;
+	GPtrArray *msgs;
+	struct nl_msg *msg;
+	int *errors;
+	int i, err, num_del;
 	guint32 log_domain = (family == AF_INET) ? LOGD_IP4 : LOGD_IP6;
 	char buf[INET6_ADDRSTRLEN + 1];
 	char *iface = NULL;
-	gboolean success = FALSE;
 
 	log_domain |= LOGD_DEVICE;
 
-	nlh = nm_netlink_get_default_handle ();
-	if (!nlh)
+	monitor = nm_netlink_monitor_get ();
+	if (!monitor)
 		return FALSE;
 
-	err = rtnl_addr_alloc_cache (nlh, &addr_cache);
-	if (err < 0)
+	iface = nm_netlink_index_to_iface (ifindex);
+	if (!iface) {
+		g_object_unref (monitor);
 		return FALSE;
+	}
 
-	filter_addr = rtnl_addr_alloc ();
-	if (!filter_addr)
-		goto out;
-
-	rtnl_addr_set_ifindex (filter_addr, ifindex);
-	if (family)
-		rtnl_addr_set_family (filter_addr, family);
+	nm_log_dbg (log_domain, "(%s): syncing addresses (family %d)", iface, family);
 
-	iface = nm_netlink_index_to_iface (ifindex);
-	if (!iface)
-		goto out;
+	/* Index the wanted addresses so each existing one is matched in O(1) */
+	wanted = g_hash_table_new (nm_netlink_addr_hash, nm_netlink_object_identical);
+	for (i = 0; i < num_addrs; i++) {
+		if (addrs[i])
+			g_hash_table_insert (wanted, addrs[i], GINT_TO_POINTER (i + 1));
+	}
 
-	nm_log_dbg (log_domain, "(%s): syncing addresses (family %d)", iface, family);
+	msgs = g_ptr_array_new ();
 
-	/* Walk through the cache, comparing the addresses already on
-	 * the interface to the addresses in addrs.
+	/* Compare the addresses already on the interface to the addresses
+	 * in addrs; anything not wanted gets removed.
 	 */
-	for (match = nl_cache_get_first (addr_cache); match; match = nl_cache_get_next (match)) {
-		gboolean buf_valid = FALSE;
-		match_addr = (struct rtnl_addr *) match;
-
-		/* Skip addresses not on our interface */
-		if (!nl_object_match_filter (match, (struct nl_object *) filter_addr))
+	existing = nm_netlink_monitor_get_addresses (monitor, ifindex, family);
+	for (iter = existing; iter; iter = g_slist_next (iter)) {
+		struct rtnl_addr *match_addr = iter->data;
+
+		i = GPOINTER_TO_INT (g_hash_table_lookup (wanted, match_addr)) - 1;
+		if (i >= 0) {
+			/* match == addrs[i], so remove it from addrs so we don't
+			 * try to add it to the interface again below.
+			 */
+			g_hash_table_remove (wanted, addrs[i]);
+			rtnl_addr_put (addrs[i]);
+			addrs[i] = NULL;
 			continue;
-
-		if (addrs) {
-			for (i = 0; i < num_addrs; i++) {
-				if (addrs[i] && nl_object_identical (match, (struct nl_object *) addrs[i]))
-					break;
-			}
-
-			if (addrs[i]) {
-				/* match == addrs[i], so remove it from addrs so we don't
-				 * try to add it to the interface again below.
-				 */
-				rtnl_addr_put (addrs[i]);
-				addrs[i] = NULL;
-				continue;
-			}
 		}
 
-		nladdr = rtnl_addr_get_local (match_addr);
-
 		/* Don't delete IPv6 link-local addresses; they don't belong to NM */
-		if (rtnl_addr_get_family (match_addr) == AF_INET6) {
-			struct in6_addr *tmp;
-
-			if (rtnl_addr_get_scope (match_addr) == RT_SCOPE_LINK) {
-				nm_log_dbg (log_domain, "(%s): ignoring IPv6 link-local address", iface);
-				continue;
-			}
-
-			tmp = nl_addr_get_binary_addr (nladdr);
-			if (inet_ntop (AF_INET6, tmp, buf, sizeof (buf)))
-				buf_valid = TRUE;
-		} else if (rtnl_addr_get_family (match_addr) == AF_INET) {
-			struct in_addr *tmp;
-
-			tmp = nl_addr_get_binary_addr (nladdr);
-			if (inet_ntop (AF_INET, tmp, buf, sizeof (buf)))
-				buf_valid = TRUE;
+		if (   rtnl_addr_get_family (match_addr) == AF_INET6
+		    && rtnl_addr_get_scope (match_addr) == RT_SCOPE_LINK) {
+			nm_log_dbg (log_domain, "(%s): ignoring IPv6 link-local address", iface);
+			continue;
 		}
 
-		if (buf_valid) {
+		if (addr_to_string (match_addr, buf, sizeof (buf))) {
 			nm_log_dbg (log_domain, "(%s): removing address '%s/%d'",
 			            iface, buf, rtnl_addr_get_prefixlen (match_addr));
 		}
 
 		/* Otherwise, match_addr should be removed from the interface. */
-		err = rtnl_addr_delete (nlh, match_addr, 0);
+		err = rtnl_addr_build_delete_request (match_addr, 0, &msg);
 		if (err < 0) {
 			nm_log_err (log_domain, "(%s): error %d returned from rtnl_addr_delete(): %s",
-						iface, err, nl_geterror (err));
+			            iface, err, nl_geterror (err));
+			continue;
 		}
+		g_ptr_array_add (msgs, msg);
 	}
+	num_del = msgs->len;
 
 	/* Now add the remaining new addresses */
 	for (i = 0; i < num_addrs; i++) {
-		struct in6_addr *in6tmp;
-		struct in_addr *in4tmp;
-		gboolean buf_valid = FALSE;
-
 		if (!addrs[i])
 			continue;
 
-		nladdr = rtnl_addr_get_local (addrs[i]);
-		if (rtnl_addr_get_family (addrs[i]) == AF_INET6) {
-			in6tmp = nl_addr_get_binary_addr (nladdr);
-			if (inet_ntop (AF_INET6, in6tmp, buf, sizeof (buf)))
-				buf_valid = TRUE;
-		} else if (rtnl_addr_get_family (addrs[i]) == AF_INET) {
-			in4tmp = nl_addr_get_binary_addr (nladdr);
-			if (inet_ntop (AF_INET, in4tmp, buf, sizeof (buf)))
-				buf_valid = TRUE;
+		if (addr_to_string (addrs[i], buf, sizeof (buf))) {
+			nm_log_dbg (log_domain, "(%s): adding address '%s/%d'",
+			            iface, buf, nl_addr_get_prefixlen (rtnl_addr_get_local (addrs[i])));
 		}
 
-		if (buf_valid) {
-			nm_log_dbg (log_domain, "(%s): adding address '%s/%d'",
-			            iface, buf, nl_addr_get_prefixlen (nladdr));
+		err = rtnl_addr_build_add_request (addrs[i], 0, &msg);
+		if (err < 0) {
+			nm_log_err (log_domain,
+			            "(%s): error %d returned from rtnl_addr_add():\n%s",
+			            iface, err, nl_geterror (err));
+			continue;
 		}
+		g_ptr_array_add (msgs, msg);
+	}
+
+	/* Send all the changes in one go */
+	errors = g_new0 (int, msgs->len + 1);
+	nm_netlink_send_batch ((struct nl_msg **) msgs->pdata, msgs->len, errors);
+	for (i = 0; i < (int) msgs->len; i++) {
+		err = errors[i];
+		if (err >= 0)
+			continue;
 
-		err = rtnl_addr_add (nlh, addrs[i], 0);
-		if (err < 0 && (err != -NLE_EXIST)) {
+		if (i < num_del) {
+			nm_log_err (log_domain, "(%s): error %d returned from rtnl_addr_delete(): %s",
+			            iface, err, nl_geterror (err));
+		} else if (err != -NLE_EXIST) {
 			nm_log_err (log_domain,
 			            "(%s): error %d returned from rtnl_addr_add():\n%s",
 			            iface, err, nl_geterror (err));
 		}
+	}
+	g_free (errors);
+
+	g_ptr_array_free (msgs, TRUE);
+	g_hash_table_destroy (wanted);
 
-		rtnl_addr_put (addrs[i]);
+	g_slist_foreach (existing, (GFunc) rtnl_addr_put, NULL);
+	g_slist_free (existing);
+
+	for (i = 0; i < num_addrs; i++) {
+		if (addrs[i])
+			rtnl_addr_put (addrs[i]);
 	}
 	g_free (addrs);
-	success = TRUE;
 
-out:
-	if (filter_addr)
-		rtnl_addr_put (filter_addr);
-	if (addr_cache)
-		nl_cache_free (addr_cache);
 	g_free (iface);
-	return success;
+	g_object_unref (monitor);
+	return TRUE;
 }
 
 static gboolean
@@ -1357,17 +1356,22 @@ nm_system_iface_flush_addresses (int ifindex, int family)
 }
 
 
+typedef struct {
+	guint32 log_level;
+	GSList *routes;
+} FlushRoutesInfo;
+
 static struct rtnl_route *
-delete_one_route (struct rtnl_route *route,
-                  struct nl_addr *dst,
-                  const char *iface,
-                  gpointer user_data)
+collect_one_route (struct rtnl_route *route,
+                   struct nl_addr *dst,
+                   const char *iface,
+                   gpointer user_data)
 {
-	guint32 log_level = GPOINTER_TO_UINT (user_data);
+	FlushRoutesInfo *info = user_data;
 
-	nm_log_dbg (log_level, "   deleting route");
-	if (!nm_netlink_route_delete (route))
-		nm_log_err (LOGD_DEVICE, "(%s): failed to delete route", iface);
+	nm_log_dbg (info->log_level, "   deleting route");
+	rtnl_route_get (route);
+	info->routes = g_slist_prepend (info->routes, route);
 
 	return NULL;
 }
@@ -1386,6 +1390,11 @@ nm_system_iface_flush_routes (int ifindex, int family)
 {
 	guint32 log_level = LOGD_IP4 | LOGD_IP6;
 	const char *sf = "UNSPEC";
+	FlushRoutesInfo info;
+	GPtrArray *msgs;
+	struct nl_msg *msg;
+	GSList *iter;
+	int *errors, i;
 	char *iface;
 
 	g_return_val_if_fail (ifindex > 0, FALSE);
@@ -1403,11 +1412,36 @@ nm_system_iface_flush_routes (int ifindex, int family)
 	nm_log_dbg (log_level, "(%s): flushing routes ifindex %d family %s (%d)",
 	            iface, ifindex, sf, family);
 
+	info.log_level = log_level;
+	info.routes = NULL;
+
 	/* We don't want to flush IPv6 link-local routes that may exist on the
 	 * the interface since the LL address and routes should normally stay
 	 * assigned all the time.
 	 */
-	nm_netlink_foreach_route (ifindex, family, RT_SCOPE_UNIVERSE, TRUE, delete_one_route, GUINT_TO_POINTER (log_level));
+	nm_netlink_foreach_route (ifindex, family, RT_SCOPE_UNIVERSE, TRUE, collect_one_route, &info);
+
+	/* Delete them all in one batch */
+	msgs = g_ptr_array_new ();
+	for (iter = info.routes; iter; iter = g_slist_next (iter)) {
+		if (rtnl_route_build_del_request (iter->data, 0, &msg) == 0)
+			g_ptr_array_add (msgs, msg);
+		else
+			nm_log_err (LOGD_DEVICE, "(%s): failed to delete route", iface);
+		rtnl_route_put (iter->data);
+	}
+	g_slist_free (info.routes);
+
+	errors = g_new0 (int, msgs->len + 1);
+	nm_netlink_send_batch ((struct nl_msg **) msgs->pdata, msgs->len, errors);
+	for (i = 0; i < (int) msgs->len; i++) {
+		if (   errors[i] < 0
+		    && errors[i] != -NLE_OBJ_NOTFOUND
+		    && errors[i] != -NLE_RANGE)
+			nm_log_err (LOGD_DEVICE, "(%s): failed to delete route", iface);
+	}
+	g_free (errors);
+	g_ptr_array_free (msgs, TRUE);
 
 	g_free (iface);
 	return TRUE;
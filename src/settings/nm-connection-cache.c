@@ -0,0 +1,999 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager system settings service
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * (C) Copyright 2013 Red Hat, Inc.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dbus/dbus-glib.h>
+
+#include <nm-connection.h>
+#include <nm-setting.h>
+#include "nm-dbus-glib-types.h"
+#include "nm-connection-cache.h"
+
+/* File layout, in host byte order since the cache never leaves the machine:
+ *
+ *   "NMCC" u32:byte-order-mark u32:version u32:num-entries string:nm-version
+ *   entry*
+ *
+ *   entry:   u32:length path u32:num-deps dep* u32:num-extra string*
+ *            u32:num-settings (string:name u32:num-props (string:name value)*)*
+ *   dep:     path u8:exists u64:inode u64:size
+ *            i64:mtime-sec i64:mtime-nsec i64:ctime-sec i64:ctime-nsec
+ *   string:  u32:length (NULL_LEN for NULL) bytes
+ *
+ * Property values are written according to the property's GType, which is
+ * also used to read them back, so they carry no type information.  The
+ * first dep of every entry is the file the entry is keyed by.  A cache
+ * written by another NetworkManager release is discarded, since parsers
+ * and setting semantics may have changed in between.
+ */
+
+#define CACHE_MAGIC    "NMCC"
+#define CACHE_BOM      0x01020304
+#define CACHE_VERSION  2
+#define HEADER_LEN     16
+#define NULL_LEN       G_MAXUINT32
+
+#define WRITE_DELAY    5
+
+typedef struct {
+	const guint8 *data;    /* serialized entry (after the length) */
+	gsize len;
+	guint8 *owned;         /* @data, if not in the mapped file */
+	volatile gint used;    /* looked up or added since the cache was read */
+} CacheEntry;
+
+struct _NMConnectionCache {
+	char *filename;
+	GMappedFile *mapped;
+	GHashTable *entries;   /* path -> CacheEntry */
+	gboolean dirty;
+	guint write_id;
+};
+
+struct _NMConnectionCacheStamp {
+	char *path;
+	GByteArray *deps;      /* u32:num-deps dep* */
+};
+
+/************************************************************/
+
+static void
+put_u32 (GByteArray *buf, guint32 val)
+{
+	g_byte_array_append (buf, (const guint8 *) &val, sizeof (val));
+}
+
+static void
+put_u64 (GByteArray *buf, guint64 val)
+{
+	g_byte_array_append (buf, (const guint8 *) &val, sizeof (val));
+}
+
+static void
+put_bytes (GByteArray *buf, const guint8 *data, gsize len)
+{
+	put_u32 (buf, len);
+	g_byte_array_append (buf, data, len);
+}
+
+static void
+put_string (GByteArray *buf, const char *str)
+{
+	if (str)
+		put_bytes (buf, (const guint8 *) str, strlen (str));
+	else
+		put_u32 (buf, NULL_LEN);
+}
+
+typedef struct {
+	const guint8 *p;
+	const guint8 *end;
+	gboolean failed;
+} Reader;
+
+static const guint8 *
+get_raw (Reader *r, gsize len)
+{
+	const guint8 *p = r->p;
+
+	if (r->failed || (gsize) (r->end - r->p) < len) {
+		r->failed = TRUE;
+		return NULL;
+	}
+	r->p += len;
+	return p;
+}
+
+static guint32
+get_u32 (Reader *r)
+{
+	const guint8 *p = get_raw (r, sizeof (guint32));
+	guint32 val = 0;
+
+	if (p)
+		memcpy (&val, p, sizeof (val));
+	return val;
+}
+
+static guint64
+get_u64 (Reader *r)
+{
+	const guint8 *p = get_raw (r, sizeof (guint64));
+	guint64 val = 0;
+
+	if (p)
+		memcpy (&val, p, sizeof (val));
+	return val;
+}
+
+/* Returns a pointer into the cache data; @out_len is NULL_LEN for NULL */
+static const guint8 *
+get_bytes (Reader *r, guint32 *out_len)
+{
+	*out_len = get_u32 (r);
+	if (*out_len == NULL_LEN)
+		return NULL;
+	return get_raw (r, *out_len);
+}
+
+static char *
+get_string (Reader *r)
+{
+	const guint8 *p;
+	guint32 len;
+
+	p = get_bytes (r, &len);
+	return p ? g_strndup ((const char *) p, len) : NULL;
+}
+
+/************************************************************/
+
+static gboolean encode_value (GByteArray *buf, const GValue *value);
+
+typedef struct {
+	GByteArray *buf;
+	guint32 count;
+	gboolean failed;
+} EncodeInfo;
+
+static void
+encode_collection_item (const GValue *value, gpointer user_data)
+{
+	EncodeInfo *info = user_data;
+
+	info->count++;
+	if (!info->failed && !encode_value (info->buf, value))
+		info->failed = TRUE;
+}
+
+static void
+encode_map_item (const GValue *key, const GValue *value, gpointer user_data)
+{
+	EncodeInfo *info = user_data;
+
+	info->count++;
+	if (!info->failed && (!encode_value (info->buf, key) || !encode_value (info->buf, value)))
+		info->failed = TRUE;
+}
+
+static gboolean
+encode_value (GByteArray *buf, const GValue *value)
+{
+	GType type = G_VALUE_TYPE (value);
+
+	if (type == DBUS_TYPE_G_UCHAR_ARRAY) {
+		GByteArray *array = g_value_get_boxed (value);
+
+		if (array)
+			put_bytes (buf, array->data, array->len);
+		else
+			put_u32 (buf, NULL_LEN);
+		return TRUE;
+	}
+
+	if (dbus_g_type_is_collection (type) || dbus_g_type_is_map (type)) {
+		EncodeInfo info = { buf, 0, FALSE };
+		guint count_pos;
+
+		if (!g_value_get_boxed (value)) {
+			put_u32 (buf, NULL_LEN);
+			return TRUE;
+		}
+
+		/* Patched once the items have been counted */
+		count_pos = buf->len;
+		put_u32 (buf, 0);
+
+		if (dbus_g_type_is_collection (type))
+			dbus_g_type_collection_value_iterate (value, encode_collection_item, &info);
+		else
+			dbus_g_type_map_value_iterate (value, encode_map_item, &info);
+		memcpy (buf->data + count_pos, &info.count, sizeof (info.count));
+		return !info.failed;
+	}
+
+	if (dbus_g_type_is_struct (type)) {
+		guint i, size = dbus_g_type_get_struct_size (type);
+
+		if (!g_value_get_boxed (value)) {
+			put_u32 (buf, NULL_LEN);
+			return TRUE;
+		}
+
+		put_u32 (buf, size);
+		for (i = 0; i < size; i++) {
+			GValue member = { 0 };
+			gboolean success;
+
+			g_value_init (&member, dbus_g_type_get_struct_member_type (type, i));
+			success =    dbus_g_type_struct_get_member (value, i, &member)
+			          && encode_value (buf, &member);
+			g_value_unset (&member);
+			if (!success)
+				return FALSE;
+		}
+		return TRUE;
+	}
+
+	switch (G_TYPE_FUNDAMENTAL (type)) {
+	case G_TYPE_STRING:
+		put_string (buf, g_value_get_string (value));
+		break;
+	case G_TYPE_BOOLEAN:
+		put_u32 (buf, g_value_get_boolean (value));
+		break;
+	case G_TYPE_CHAR:
+		put_u32 (buf, (guint32) g_value_get_char (value));
+		break;
+	case G_TYPE_UCHAR:
+		put_u32 (buf, g_value_get_uchar (value));
+		break;
+	case G_TYPE_INT:
+		put_u32 (buf, (guint32) g_value_get_int (value));
+		break;
+	case G_TYPE_UINT:
+		put_u32 (buf, g_value_get_uint (value));
+		break;
+	case G_TYPE_ENUM:
+		put_u32 (buf, (guint32) g_value_get_enum (value));
+		break;
+	case G_TYPE_FLAGS:
+		put_u32 (buf, g_value_get_flags (value));
+		break;
+	case G_TYPE_INT64:
+		put_u64 (buf, (guint64) g_value_get_int64 (value));
+		break;
+	case G_TYPE_UINT64:
+		put_u64 (buf, g_value_get_uint64 (value));
+		break;
+	default:
+		/* Anything else (eg, maps of GValues) isn't cached */
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+decode_value (Reader *r, GType type, GValue *value)
+{
+	g_value_init (value, type);
+
+	if (type == DBUS_TYPE_G_UCHAR_ARRAY) {
+		const guint8 *data;
+		guint32 len;
+
+		data = get_bytes (r, &len);
+		if (data) {
+			GByteArray *array = g_byte_array_sized_new (len);
+
+			g_byte_array_append (array, data, len);
+			g_value_take_boxed (value, array);
+		}
+		return !r->failed;
+	}
+
+	if (dbus_g_type_is_collection (type) || dbus_g_type_is_map (type)) {
+		DBusGTypeSpecializedAppendContext ctx;
+		gboolean is_map = dbus_g_type_is_map (type);
+		GType item_type, key_type = G_TYPE_INVALID;
+		guint32 i, count;
+
+		count = get_u32 (r);
+		if (r->failed || count == NULL_LEN)
+			return !r->failed;
+
+		if (is_map) {
+			key_type = dbus_g_type_get_map_key_specialization (type);
+			item_type = dbus_g_type_get_map_value_specialization (type);
+		} else
+			item_type = dbus_g_type_get_collection_specialization (type);
+
+		g_value_take_boxed (value, dbus_g_type_specialized_construct (type));
+		dbus_g_type_specialized_init_append (value, &ctx);
+		for (i = 0; i < count; i++) {
+			GValue key = { 0 }, item = { 0 };
+
+			/* The append functions take over the contents of the values */
+			if (is_map) {
+				if (!decode_value (r, key_type, &key) || !decode_value (r, item_type, &item)) {
+					if (G_IS_VALUE (&key))
+						g_value_unset (&key);
+					if (G_IS_VALUE (&item))
+						g_value_unset (&item);
+					return FALSE;
+				}
+				dbus_g_type_specialized_map_append (&ctx, &key, &item);
+			} else {
+				if (!decode_value (r, item_type, &item)) {
+					g_value_unset (&item);
+					return FALSE;
+				}
+				dbus_g_type_specialized_collection_append (&ctx, &item);
+			}
+		}
+		if (!is_map)
+			dbus_g_type_specialized_collection_end_append (&ctx);
+		return TRUE;
+	}
+
+	if (dbus_g_type_is_struct (type)) {
+		guint32 i, size;
+
+		size = get_u32 (r);
+		if (r->failed || size == NULL_LEN)
+			return !r->failed;
+		if (size != dbus_g_type_get_struct_size (type))
+			return FALSE;
+
+		g_value_take_boxed (value, dbus_g_type_specialized_construct (type));
+		for (i = 0; i < size; i++) {
+			GValue member = { 0 };
+			gboolean success;
+
+			success =    decode_value (r, dbus_g_type_get_struct_member_type (type, i), &member)
+			          && dbus_g_type_struct_set_member (value, i, &member);
+			g_value_unset (&member);
+			if (!success)
+				return FALSE;
+		}
+		return TRUE;
+	}
+
+	switch (G_TYPE_FUNDAMENTAL (type)) {
+	case G_TYPE_STRING:
+		g_value_take_string (value, get_string (r));
+		break;
+	case G_TYPE_BOOLEAN:
+		g_value_set_boolean (value, get_u32 (r) ? TRUE : FALSE);
+		break;
+	case G_TYPE_CHAR:
+		g_value_set_char (value, (gchar) get_u32 (r));
+		break;
+	case G_TYPE_UCHAR:
+		g_value_set_uchar (value, (guchar) get_u32 (r));
+		break;
+	case G_TYPE_INT:
+		g_value_set_int (value, (gint) get_u32 (r));
+		break;
+	case G_TYPE_UINT:
+		g_value_set_uint (value, get_u32 (r));
+		break;
+	case G_TYPE_ENUM:
+		g_value_set_enum (value, (gint) get_u32 (r));
+		break;
+	case G_TYPE_FLAGS:
+		g_value_set_flags (value, get_u32 (r));
+		break;
+	case G_TYPE_INT64:
+		g_value_set_int64 (value, (gint64) get_u64 (r));
+		break;
+	case G_TYPE_UINT64:
+		g_value_set_uint64 (value, get_u64 (r));
+		break;
+	default:
+		return FALSE;
+	}
+	return !r->failed;
+}
+
+static GParamSpec *
+find_property (const char *setting_name, const char *prop_name)
+{
+	GType type;
+	GObjectClass *klass;
+	GParamSpec *pspec;
+
+	type = nm_connection_lookup_setting_type (setting_name);
+	if (type == G_TYPE_INVALID)
+		return NULL;
+
+	klass = g_type_class_ref (type);
+	pspec = g_object_class_find_property (klass, prop_name);
+	g_type_class_unref (klass);
+	return pspec;
+}
+
+static gboolean
+encode_connection (GByteArray *buf, NMConnection *connection)
+{
+	GHashTable *hash;
+	GHashTableIter iter, setting_iter;
+	const char *setting_name, *prop_name;
+	GHashTable *setting_hash;
+	GValue *value;
+	gboolean success = TRUE;
+
+	hash = nm_connection_to_hash (connection, NM_SETTING_HASH_FLAG_ALL);
+	if (!hash)
+		return FALSE;
+
+	put_u32 (buf, g_hash_table_size (hash));
+	g_hash_table_iter_init (&iter, hash);
+	while (success && g_hash_table_iter_next (&iter, (gpointer) &setting_name, (gpointer) &setting_hash)) {
+		put_string (buf, setting_name);
+		put_u32 (buf, g_hash_table_size (setting_hash));
+
+		g_hash_table_iter_init (&setting_iter, setting_hash);
+		while (success && g_hash_table_iter_next (&setting_iter, (gpointer) &prop_name, (gpointer) &value)) {
+			GParamSpec *pspec = find_property (setting_name, prop_name);
+
+			/* Values are read back with the property's type */
+			if (!pspec || pspec->value_type != G_VALUE_TYPE (value)) {
+				success = FALSE;
+				break;
+			}
+
+			put_string (buf, prop_name);
+			success = encode_value (buf, value);
+		}
+	}
+
+	g_hash_table_destroy (hash);
+	return success;
+}
+
+static void
+destroy_gvalue (gpointer data)
+{
+	GValue *value = (GValue *) data;
+
+	if (G_IS_VALUE (value))
+		g_value_unset (value);
+	g_slice_free (GValue, value);
+}
+
+static NMConnection *
+decode_connection (Reader *r)
+{
+	GHashTable *hash;
+	NMConnection *connection = NULL;
+	guint32 num_settings, num_props, i, j;
+
+	hash = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                              g_free, (GDestroyNotify) g_hash_table_destroy);
+
+	num_settings = get_u32 (r);
+	for (i = 0; !r->failed && i < num_settings; i++) {
+		GHashTable *setting_hash;
+		char *setting_name;
+
+		setting_name = get_string (r);
+		if (!setting_name)
+			goto out;
+
+		setting_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, destroy_gvalue);
+		g_hash_table_insert (hash, setting_name, setting_hash);
+
+		num_props = get_u32 (r);
+		for (j = 0; !r->failed && j < num_props; j++) {
+			GParamSpec *pspec;
+			GValue *value;
+			char *prop_name;
+
+			prop_name = get_string (r);
+			if (!prop_name)
+				goto out;
+
+			pspec = find_property (setting_name, prop_name);
+			if (!pspec) {
+				g_free (prop_name);
+				goto out;
+			}
+
+			value = g_slice_new0 (GValue);
+			g_hash_table_insert (setting_hash, prop_name, value);
+			if (!decode_value (r, pspec->value_type, value))
+				goto out;
+		}
+	}
+
+	if (!r->failed)
+		connection = nm_connection_new_from_hash (hash, NULL);
+
+out:
+	g_hash_table_destroy (hash);
+	return connection;
+}
+
+/************************************************************/
+
+static void
+put_dep (GByteArray *buf, const char *path)
+{
+	struct stat st;
+	gboolean exists;
+	guint8 b;
+
+	exists = (stat (path, &st) == 0);
+	if (!exists)
+		memset (&st, 0, sizeof (st));
+
+	put_string (buf, path);
+	b = exists ? 1 : 0;
+	g_byte_array_append (buf, &b, 1);
+	put_u64 (buf, st.st_ino);
+	put_u64 (buf, st.st_size);
+	put_u64 (buf, st.st_mtim.tv_sec);
+	put_u64 (buf, st.st_mtim.tv_nsec);
+	put_u64 (buf, st.st_ctim.tv_sec);
+	put_u64 (buf, st.st_ctim.tv_nsec);
+}
+
+static gboolean
+check_dep (Reader *r)
+{
+	struct stat st;
+	gboolean exists;
+	const guint8 *p;
+	char *path;
+
+	path = get_string (r);
+	p = get_raw (r, 1);
+	if (!path || !p) {
+		g_free (path);
+		return FALSE;
+	}
+
+	exists = (stat (path, &st) == 0);
+	g_free (path);
+
+	if (exists != (*p != 0))
+		return FALSE;
+	if (!exists)
+		return get_raw (r, 6 * sizeof (guint64)) != NULL;
+
+	if (   get_u64 (r) != (guint64) st.st_ino
+	    || get_u64 (r) != (guint64) st.st_size
+	    || get_u64 (r) != (guint64) st.st_mtim.tv_sec
+	    || get_u64 (r) != (guint64) st.st_mtim.tv_nsec
+	    || get_u64 (r) != (guint64) st.st_ctim.tv_sec
+	    || get_u64 (r) != (guint64) st.st_ctim.tv_nsec)
+		return FALSE;
+	return !r->failed;
+}
+
+static void
+cache_entry_free (gpointer data)
+{
+	CacheEntry *entry = data;
+
+	g_free (entry->owned);
+	g_slice_free (CacheEntry, entry);
+}
+
+static void
+load_entries (NMConnectionCache *cache)
+{
+	Reader r;
+	guint32 num, i;
+	const guint8 *magic;
+	char *nm_version;
+
+	r.p = (const guint8 *) g_mapped_file_get_contents (cache->mapped);
+	r.end = r.p + g_mapped_file_get_length (cache->mapped);
+	r.failed = FALSE;
+
+	magic = get_raw (&r, strlen (CACHE_MAGIC));
+	if (   !magic
+	    || memcmp (magic, CACHE_MAGIC, strlen (CACHE_MAGIC))
+	    || get_u32 (&r) != CACHE_BOM
+	    || get_u32 (&r) != CACHE_VERSION)
+		return;
+
+	num = get_u32 (&r);
+	nm_version = get_string (&r);
+	if (g_strcmp0 (nm_version, VERSION) != 0) {
+		g_free (nm_version);
+		return;
+	}
+	g_free (nm_version);
+	for (i = 0; !r.failed && i < num; i++) {
+		CacheEntry *entry;
+		Reader entry_r;
+		char *path;
+		guint32 len;
+
+		entry_r.p = get_bytes (&r, &len);
+		if (!entry_r.p)
+			break;
+		entry_r.end = entry_r.p + len;
+		entry_r.failed = FALSE;
+
+		entry = g_slice_new0 (CacheEntry);
+		entry->data = entry_r.p;
+		entry->len = len;
+
+		path = get_string (&entry_r);
+		if (!path) {
+			cache_entry_free (entry);
+			break;
+		}
+		g_hash_table_insert (cache->entries, path, entry);
+	}
+
+	/* A truncated or corrupt cache is thrown away as a whole */
+	if (r.failed || i < num)
+		g_hash_table_remove_all (cache->entries);
+}
+
+/**
+ * nm_connection_cache_new:
+ * @filename: the cache file
+ *
+ * Maps the cache file, if it exists and was written by this version of
+ * NetworkManager, and indexes its entries.
+ *
+ * Returns: the new cache, which is empty if @filename couldn't be used
+ */
+NMConnectionCache *
+nm_connection_cache_new (const char *filename)
+{
+	NMConnectionCache *cache;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	cache = g_slice_new0 (NMConnectionCache);
+	cache->filename = g_strdup (filename);
+	cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, cache_entry_free);
+
+	cache->mapped = g_mapped_file_new (filename, FALSE, NULL);
+	if (cache->mapped)
+		load_entries (cache);
+
+	return cache;
+}
+
+void
+nm_connection_cache_free (NMConnectionCache *cache)
+{
+	g_return_if_fail (cache != NULL);
+
+	if (cache->write_id) {
+		g_source_remove (cache->write_id);
+		nm_connection_cache_write (cache, NULL);
+	}
+
+	g_hash_table_destroy (cache->entries);
+	if (cache->mapped)
+		g_mapped_file_unref (cache->mapped);
+	g_free (cache->filename);
+	g_slice_free (NMConnectionCache, cache);
+}
+
+/**
+ * nm_connection_cache_lookup:
+ * @cache: the cache
+ * @path: the file the connection is read from
+ * @out_extra: on return, the plugin-specific strings given to
+ *   nm_connection_cache_add(); free with g_strfreev()
+ *
+ * Safe to call from several threads at once.
+ *
+ * Returns: a new connection equal to the one that was read from @path, or
+ * %NULL if it is not in the cache or any of its files changed since
+ */
+NMConnection *
+nm_connection_cache_lookup (NMConnectionCache *cache,
+                            const char *path,
+                            char ***out_extra)
+{
+	CacheEntry *entry;
+	NMConnection *connection;
+	GPtrArray *extra;
+	Reader r;
+	guint32 num, i;
+
+	g_return_val_if_fail (cache != NULL, NULL);
+	g_return_val_if_fail (path != NULL, NULL);
+
+	entry = g_hash_table_lookup (cache->entries, path);
+	if (!entry)
+		return NULL;
+
+	r.p = entry->data;
+	r.end = entry->data + entry->len;
+	r.failed = FALSE;
+
+	g_free (get_string (&r));
+
+	num = get_u32 (&r);
+	for (i = 0; i < num; i++) {
+		if (!check_dep (&r))
+			return NULL;
+	}
+
+	num = get_u32 (&r);
+	extra = g_ptr_array_new ();
+	for (i = 0; !r.failed && i < num; i++)
+		g_ptr_array_add (extra, get_string (&r));
+	g_ptr_array_add (extra, NULL);
+
+	connection = decode_connection (&r);
+	if (!connection) {
+		g_strfreev ((char **) g_ptr_array_free (extra, FALSE));
+		return NULL;
+	}
+
+	if (out_extra)
+		*out_extra = (char **) g_ptr_array_free (extra, FALSE);
+	else
+		g_strfreev ((char **) g_ptr_array_free (extra, FALSE));
+
+	g_atomic_int_set (&entry->used, TRUE);
+	return connection;
+}
+
+static gboolean
+write_cb (gpointer user_data)
+{
+	NMConnectionCache *cache = user_data;
+
+	cache->write_id = 0;
+	nm_connection_cache_write (cache, NULL);
+	return FALSE;
+}
+
+static void
+schedule_write (NMConnectionCache *cache)
+{
+	cache->dirty = TRUE;
+	if (!cache->write_id)
+		cache->write_id = g_timeout_add_seconds (WRITE_DELAY, write_cb, cache);
+}
+
+/**
+ * nm_connection_cache_stamp_new:
+ * @path: the file a connection is about to be read from
+ * @deps: %NULL-terminated list of other files the connection may be read
+ *   from, whether or not they exist, or %NULL
+ *
+ * Records the state of the files before they are read, so that a file
+ * that changes while it's being parsed is read again next time.  Safe to
+ * call from several threads at once.
+ *
+ * Returns: the stamp to pass to nm_connection_cache_add()
+ */
+NMConnectionCacheStamp *
+nm_connection_cache_stamp_new (const char *path, const char **deps)
+{
+	NMConnectionCacheStamp *stamp;
+	guint32 num;
+
+	g_return_val_if_fail (path != NULL, NULL);
+
+	stamp = g_slice_new0 (NMConnectionCacheStamp);
+	stamp->path = g_strdup (path);
+	stamp->deps = g_byte_array_sized_new (256);
+
+	num = deps ? g_strv_length ((char **) deps) : 0;
+	put_u32 (stamp->deps, num + 1);
+	put_dep (stamp->deps, path);
+	for (; deps && *deps; deps++)
+		put_dep (stamp->deps, *deps);
+
+	return stamp;
+}
+
+void
+nm_connection_cache_stamp_free (NMConnectionCacheStamp *stamp)
+{
+	g_return_if_fail (stamp != NULL);
+
+	g_free (stamp->path);
+	g_byte_array_free (stamp->deps, TRUE);
+	g_slice_free (NMConnectionCacheStamp, stamp);
+}
+
+/**
+ * nm_connection_cache_add:
+ * @cache: the cache
+ * @stamp: the state of the files @connection was read from, taken with
+ *   nm_connection_cache_stamp_new() before reading them
+ * @extra: %NULL-terminated list of plugin-specific strings to keep with
+ *   the connection, or %NULL
+ * @connection: the connection read from the stamped files
+ *
+ * Adds or replaces the cache entry for the stamp's path.  Connections with
+ * properties that can't be serialized are silently not cached.
+ */
+void
+nm_connection_cache_add (NMConnectionCache *cache,
+                         const NMConnectionCacheStamp *stamp,
+                         const char **extra,
+                         NMConnection *connection)
+{
+	CacheEntry *entry;
+	GByteArray *buf;
+	guint32 num;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (stamp != NULL);
+	g_return_if_fail (NM_IS_CONNECTION (connection));
+
+	buf = g_byte_array_sized_new (1024);
+	put_string (buf, stamp->path);
+	g_byte_array_append (buf, stamp->deps->data, stamp->deps->len);
+
+	num = extra ? g_strv_length ((char **) extra) : 0;
+	put_u32 (buf, num);
+	for (; extra && *extra; extra++)
+		put_string (buf, *extra);
+
+	if (!encode_connection (buf, connection)) {
+		g_byte_array_free (buf, TRUE);
+		nm_connection_cache_remove (cache, stamp->path);
+		return;
+	}
+
+	entry = g_slice_new0 (CacheEntry);
+	entry->len = buf->len;
+	entry->owned = g_byte_array_free (buf, FALSE);
+	entry->data = entry->owned;
+	entry->used = TRUE;
+	g_hash_table_insert (cache->entries, g_strdup (stamp->path), entry);
+
+	schedule_write (cache);
+}
+
+/**
+ * nm_connection_cache_remove:
+ * @cache: the cache
+ * @path: a file that changed or was removed
+ *
+ * Drops the cache entry for @path, if any.
+ */
+void
+nm_connection_cache_remove (NMConnectionCache *cache, const char *path)
+{
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (path != NULL);
+
+	if (g_hash_table_remove (cache->entries, path))
+		schedule_write (cache);
+}
+
+/**
+ * nm_connection_cache_write:
+ * @cache: the cache
+ * @error: location for a #GError
+ *
+ * Writes all entries that were looked up or added since the cache was
+ * read back to the cache file, if anything changed.  Entries for files
+ * that disappeared or changed are dropped.  The file is only readable by
+ * its owner since connections include their secrets.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+nm_connection_cache_write (NMConnectionCache *cache, GError **error)
+{
+	GHashTableIter iter;
+	CacheEntry *entry;
+	GByteArray *buf;
+	guint32 num = 0, bom = CACHE_BOM, version = CACHE_VERSION;
+	char *tmp_name;
+	gboolean success = FALSE;
+	int fd, errsv;
+	gsize written = 0;
+
+	g_return_val_if_fail (cache != NULL, FALSE);
+
+	if (cache->write_id) {
+		g_source_remove (cache->write_id);
+		cache->write_id = 0;
+	}
+
+	/* Stale entries are only dropped here, so they count as a change too */
+	g_hash_table_iter_init (&iter, cache->entries);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &entry)) {
+		if (!entry->used)
+			cache->dirty = TRUE;
+	}
+	if (!cache->dirty)
+		return TRUE;
+
+	buf = g_byte_array_sized_new (HEADER_LEN);
+	g_byte_array_append (buf, (const guint8 *) CACHE_MAGIC, strlen (CACHE_MAGIC));
+	put_u32 (buf, bom);
+	put_u32 (buf, version);
+	put_u32 (buf, 0);
+	put_string (buf, VERSION);
+
+	g_hash_table_iter_init (&iter, cache->entries);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &entry)) {
+		if (!entry->used)
+			continue;
+		put_bytes (buf, entry->data, entry->len);
+		num++;
+	}
+	memcpy (buf->data + HEADER_LEN - sizeof (num), &num, sizeof (num));
+
+	tmp_name = g_strdup_printf ("%s.tmp", cache->filename);
+	unlink (tmp_name);
+	fd = open (tmp_name, O_WRONLY | O_CREAT | O_EXCL | O_TRUNC, 0600);
+	if (fd < 0)
+		goto error;
+
+	while (written < buf->len) {
+		ssize_t ret = write (fd, buf->data + written, buf->len - written);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			errsv = errno;
+			close (fd);
+			unlink (tmp_name);
+			errno = errsv;
+			goto error;
+		}
+		written += ret;
+	}
+
+	if (close (fd) < 0 || rename (tmp_name, cache->filename) < 0) {
+		errsv = errno;
+		unlink (tmp_name);
+		errno = errsv;
+		goto error;
+	}
+
+	cache->dirty = FALSE;
+	success = TRUE;
+	goto out;
+
+error:
+	errsv = errno;
+	g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errsv),
+	             "Could not write connection cache %s: %s",
+	             cache->filename, g_strerror (errsv));
+out:
+	g_free (tmp_name);
+	g_byte_array_free (buf, TRUE);
+	return success;
+}
@@ -0,0 +1,62 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager system settings service
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * (C) Copyright 2013 Red Hat, Inc.
+ */
+
+#ifndef NM_CONNECTION_CACHE_H
+#define NM_CONNECTION_CACHE_H
+
+#include <glib.h>
+#include <nm-connection.h>
+
+/* On-disk cache of connections already read and verified by a settings
+ * plugin, so unchanged files don't have to be parsed again at startup.
+ * Entries are keyed by file name and only used while the file, and any
+ * other files the connection was read from, still have the same inode,
+ * size, mtime and ctime.
+ *
+ * Lookups and stamps may run in parallel from nm_settings_utils_parse_files()
+ * workers; everything else must be called from the main thread, and never
+ * while lookups are running.
+ */
+typedef struct _NMConnectionCache NMConnectionCache;
+typedef struct _NMConnectionCacheStamp NMConnectionCacheStamp;
+
+NMConnectionCache *nm_connection_cache_new (const char *filename);
+
+void nm_connection_cache_free (NMConnectionCache *cache);
+
+NMConnection *nm_connection_cache_lookup (NMConnectionCache *cache,
+                                          const char *path,
+                                          char ***out_extra);
+
+NMConnectionCacheStamp *nm_connection_cache_stamp_new (const char *path,
+                                                       const char **deps);
+
+void nm_connection_cache_stamp_free (NMConnectionCacheStamp *stamp);
+
+void nm_connection_cache_add (NMConnectionCache *cache,
+                              const NMConnectionCacheStamp *stamp,
+                              const char **extra,
+                              NMConnection *connection);
+
+void nm_connection_cache_remove (NMConnectionCache *cache, const char *path);
+
+gboolean nm_connection_cache_write (NMConnectionCache *cache, GError **error);
+
+#endif  /* NM_CONNECTION_CACHE_H */
@@ -29,6 +29,8 @@
 #include <nm-setting-connection.h>
 #include <nm-setting-vpn.h>
 #include <nm-setting-wireless.h>
+#include <nm-setting-wired.h>
+#include <nm-setting-ip4-config.h>
 #include <nm-utils.h>
 
 #include "nm-settings-connection.h"
@@ -70,12 +72,15 @@ G_DEFINE_TYPE (NMSettingsConnection, nm_settings_connection, NM_TYPE_CONNECTION)
 enum {
 	PROP_0 = 0,
 	PROP_VISIBLE,
+	PROP_TIMESTAMP,
 };
 
 enum {
 	UPDATED,
 	REMOVED,
 	UNREGISTER,
+	SEEN_BSSID_ADDED,
+	SETTINGS_REPLACED,
 	LAST_SIGNAL
 };
 static guint signals[LAST_SIGNAL] = { 0 };
@@ -110,6 +115,8 @@ typedef struct {
 	guint64 timestamp;   /* Up-to-date timestamp of connection use */
 	gboolean timestamp_set;
 	GHashTable *seen_bssids; /* Up-to-date BSSIDs that's been seen for the connection */
+
+	NMSettingsConnectionMatch *match; /* built on demand, NULL when stale */
 } NMSettingsConnectionPrivate;
 
 /**************************************************************/
@@ -371,6 +378,143 @@ secrets_cleared_cb (NMSettingsConnection *self)
 	priv->agent_secrets = NULL;
 }
 
+static void
+match_free (NMSettingsConnectionMatch *match)
+{
+	if (!match)
+		return;
+	if (match->ssid)
+		g_byte_array_free (match->ssid, TRUE);
+	g_free (match->mac_blacklist);
+	g_slice_free (NMSettingsConnectionMatch, match);
+}
+
+static void
+match_set_mac (NMSettingsConnectionMatch *match,
+               const GByteArray *mac,
+               const GSList *blacklist)
+{
+	const GSList *iter;
+	guint i = 0;
+
+	if (mac && mac->len == ETH_ALEN) {
+		memcpy (&match->mac, mac->data, ETH_ALEN);
+		match->has_mac = TRUE;
+	}
+
+	if (!blacklist)
+		return;
+
+	match->mac_blacklist = g_new0 (struct ether_addr, g_slist_length ((GSList *) blacklist));
+	for (iter = blacklist; iter; iter = g_slist_next (iter)) {
+		if (!ether_aton_r (iter->data, &match->mac_blacklist[i])) {
+			g_warn_if_reached ();
+			continue;
+		}
+		i++;
+	}
+	match->mac_blacklist_len = i;
+}
+
+static NMSettingsConnectionMatch *
+match_new (NMConnection *connection)
+{
+	NMSettingsConnectionMatch *match;
+	NMSettingConnection *s_con;
+	NMSettingWired *s_wired;
+	NMSettingWireless *s_wifi;
+	NMSettingIP4Config *s_ip4;
+
+	match = g_slice_new0 (NMSettingsConnectionMatch);
+
+	s_con = nm_connection_get_setting_connection (connection);
+	if (s_con) {
+		match->type = g_intern_string (nm_setting_connection_get_connection_type (s_con));
+		match->autoconnect = nm_setting_connection_get_autoconnect (s_con);
+	}
+
+	s_ip4 = nm_connection_get_setting_ip4_config (connection);
+	if (s_ip4)
+		match->ip4_method = g_intern_string (nm_setting_ip4_config_get_method (s_ip4));
+	match->shared_permission = nm_utils_get_shared_wifi_permission (connection);
+
+	s_wired = nm_connection_get_setting_wired (connection);
+	if (s_wired) {
+		match_set_mac (match,
+		               nm_setting_wired_get_mac_address (s_wired),
+		               nm_setting_wired_get_mac_address_blacklist (s_wired));
+	}
+
+	s_wifi = nm_connection_get_setting_wireless (connection);
+	if (s_wifi) {
+		const GByteArray *ssid = nm_setting_wireless_get_ssid (s_wifi);
+
+		match_set_mac (match,
+		               nm_setting_wireless_get_mac_address (s_wifi),
+		               nm_setting_wireless_get_mac_address_blacklist (s_wifi));
+		if (ssid) {
+			match->ssid = g_byte_array_sized_new (ssid->len);
+			g_byte_array_append (match->ssid, ssid->data, ssid->len);
+		}
+		match->secure = (nm_setting_wireless_get_security (s_wifi) != NULL);
+	}
+
+	return match;
+}
+
+/**
+ * nm_settings_connection_get_match:
+ * @self: the #NMSettingsConnection
+ *
+ * Returns a pre-parsed summary of the connection's settings relevant to
+ * matching it against devices and access points, so that auto-activation
+ * doesn't have to read and parse the same settings over and over.  The
+ * returned data is owned by @self and only valid until its settings are
+ * next replaced.
+ *
+ * Returns: the connection's match descriptor
+ **/
+const NMSettingsConnectionMatch *
+nm_settings_connection_get_match (NMSettingsConnection *self)
+{
+	NMSettingsConnectionPrivate *priv;
+
+	g_return_val_if_fail (self != NULL, NULL);
+	g_return_val_if_fail (NM_IS_SETTINGS_CONNECTION (self), NULL);
+
+	priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (self);
+	if (!priv->match)
+		priv->match = match_new (NM_CONNECTION (self));
+	return priv->match;
+}
+
+/**
+ * nm_settings_connection_match_mac:
+ * @match: a connection's match descriptor
+ * @addr: the permanent hardware address of a device
+ *
+ * Returns: %TRUE if the connection is not locked to a different MAC
+ * address and @addr is not in its MAC address blacklist
+ **/
+gboolean
+nm_settings_connection_match_mac (const NMSettingsConnectionMatch *match,
+                                  const struct ether_addr *addr)
+{
+	guint i;
+
+	g_return_val_if_fail (match != NULL, FALSE);
+	g_return_val_if_fail (addr != NULL, FALSE);
+
+	if (match->has_mac && memcmp (&match->mac, addr, ETH_ALEN))
+		return FALSE;
+
+	for (i = 0; i < match->mac_blacklist_len; i++) {
+		if (memcmp (&match->mac_blacklist[i], addr, ETH_ALEN) == 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
 /* Update the settings of this connection to match that of 'new', taking care to
  * make a private copy of secrets.
  */
@@ -413,6 +557,12 @@ nm_settings_connection_replace_settings (NMSettingsConnection *self,
 		nm_settings_connection_recheck_visibility (self);
 	}
 	g_hash_table_destroy (new_settings);
+
+	/* Settings may have changed even on failure */
+	match_free (priv->match);
+	priv->match = NULL;
+	g_signal_emit (self, signals[SETTINGS_REPLACED], 0);
+
 	return success;
 }
 
@@ -515,40 +665,115 @@ commit_changes (NMSettingsConnection *connection,
 	g_object_unref (connection);
 }
 
+/**************************************************************/
+
+/* The timestamps and seen-bssids look-aside databases are read once and kept
+ * in memory; changes mark the database dirty and are written back (atomically,
+ * via g_file_set_contents()) at most DB_FLUSH_DELAY seconds later, on an
+ * explicit nm_settings_connection_flush_databases(), or at shutdown.
+ */
+#define DB_FLUSH_DELAY 10
+
+typedef struct {
+	const char *path;
+	const char *group;
+	GKeyFile *keyfile;
+	gboolean dirty;
+	guint flush_id;
+} SettingsDb;
+
+static SettingsDb timestamps_db = { SETTINGS_TIMESTAMPS_FILE, "timestamps", NULL, FALSE, 0 };
+static SettingsDb seen_bssids_db = { SETTINGS_SEEN_BSSIDS_FILE, "seen-bssids", NULL, FALSE, 0 };
+
+static GKeyFile *
+db_get (SettingsDb *db)
+{
+	GError *error = NULL;
+
+	if (db->keyfile)
+		return db->keyfile;
+
+	db->keyfile = g_key_file_new ();
+	g_key_file_set_list_separator (db->keyfile, ',');
+	if (!g_key_file_load_from_file (db->keyfile, db->path, G_KEY_FILE_KEEP_COMMENTS, &error)) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+			nm_log_warn (LOGD_SETTINGS, "error parsing %s file '%s': %s",
+			             db->group, db->path, error->message);
+		}
+		g_clear_error (&error);
+	}
+	return db->keyfile;
+}
+
 static void
-remove_entry_from_db (NMSettingsConnection *connection, const char* db_name)
+db_flush (SettingsDb *db)
 {
-	GKeyFile *key_file;
-	const char *db_file;
+	char *data;
+	gsize len;
+	GError *error = NULL;
 
-	if (strcmp (db_name, "timestamps") == 0)
-		db_file = SETTINGS_TIMESTAMPS_FILE;
-	else if (strcmp (db_name, "seen-bssids") == 0)
-		db_file = SETTINGS_SEEN_BSSIDS_FILE;
-	else
+	if (db->flush_id) {
+		g_source_remove (db->flush_id);
+		db->flush_id = 0;
+	}
+
+	if (!db->dirty || !db->keyfile)
 		return;
+	db->dirty = FALSE;
 
-	key_file = g_key_file_new ();
-	if (g_key_file_load_from_file (key_file, db_file, G_KEY_FILE_KEEP_COMMENTS, NULL)) {
-		const char *connection_uuid;
-		char *data;
-		gsize len;
-		GError *error = NULL;
+	data = g_key_file_to_data (db->keyfile, &len, &error);
+	if (data) {
+		g_file_set_contents (db->path, data, len, &error);
+		g_free (data);
+	}
+	if (error) {
+		nm_log_warn (LOGD_SETTINGS, "error writing %s file '%s': %s",
+		             db->group, db->path, error->message);
+		g_error_free (error);
+	}
+}
 
-		connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
+static gboolean
+db_flush_cb (gpointer user_data)
+{
+	SettingsDb *db = user_data;
 
-		g_key_file_remove_key (key_file, db_name, connection_uuid, NULL);
-		data = g_key_file_to_data (key_file, &len, &error);
-		if (data) {
-			g_file_set_contents (db_file, data, len, &error);
-			g_free (data);
-		}
-		if (error) {
-			nm_log_warn (LOGD_SETTINGS, "error writing %s file '%s': %s", db_name, db_file, error->message);
-			g_error_free (error);
-		}
-	}
-	g_key_file_free (key_file);
+	db->flush_id = 0;
+	db_flush (db);
+	return FALSE;
+}
+
+static void
+db_changed (SettingsDb *db)
+{
+	db->dirty = TRUE;
+
+	/* Don't push the pending flush back, so the delay stays bounded */
+	if (!db->flush_id)
+		db->flush_id = g_timeout_add_seconds (DB_FLUSH_DELAY, db_flush_cb, db);
+}
+
+/**
+ * nm_settings_connection_flush_databases:
+ *
+ * Writes any pending changes to the timestamps and seen-bssids databases
+ * to disk immediately.
+ **/
+void
+nm_settings_connection_flush_databases (void)
+{
+	db_flush (&timestamps_db);
+	db_flush (&seen_bssids_db);
+}
+
+static void
+remove_entry_from_db (NMSettingsConnection *connection, SettingsDb *db)
+{
+	const char *connection_uuid;
+
+	connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
+	if (g_key_file_remove_key (db_get (db), db->group, connection_uuid, NULL))
+		db_changed (db);
 }
 
 static void
@@ -569,10 +794,10 @@ do_delete (NMSettingsConnection *connection,
 	g_object_unref (for_agents);
 
 	/* Remove timestamp from timestamps database file */
-	remove_entry_from_db (connection, "timestamps");
+	remove_entry_from_db (connection, &timestamps_db);
 
 	/* Remove connection from seen-bssids database file */
-	remove_entry_from_db (connection, "seen-bssids");
+	remove_entry_from_db (connection, &seen_bssids_db);
 
 	callback (connection, NULL, user_data);
 	g_object_unref (connection);
@@ -935,29 +1160,15 @@ pk_auth_cb (NMAuthChain *chain,
 
 static gboolean
 check_user_in_acl (NMConnection *connection,
-                   DBusGMethodInvocation *context,
-                   NMDBusManager *dbus_mgr,
                    NMSessionMonitor *session_monitor,
-                   gulong *out_sender_uid,
+                   gulong sender_uid,
                    GError **error)
 {
-	gulong sender_uid = G_MAXULONG;
 	char *error_desc = NULL;
 
 	g_return_val_if_fail (connection != NULL, FALSE);
-	g_return_val_if_fail (context != NULL, FALSE);
 	g_return_val_if_fail (session_monitor != NULL, FALSE);
 
-	/* Get the caller's UID */
-	if (!nm_auth_get_caller_uid (context, dbus_mgr, &sender_uid, &error_desc)) {
-		g_set_error_literal (error,
-		                     NM_SETTINGS_ERROR,
-		                     NM_SETTINGS_ERROR_PERMISSION_DENIED,
-		                     error_desc);
-		g_free (error_desc);
-		return FALSE;
-	}
-
 	/* Make sure the UID can view this connection */
 	if (0 != sender_uid) {
 		if (!nm_auth_uid_in_acl (connection, session_monitor, sender_uid, &error_desc)) {
@@ -970,48 +1181,83 @@ check_user_in_acl (NMConnection *connection,
 		}
 	}
 
-	if (out_sender_uid)
-		*out_sender_uid = sender_uid;
 	return TRUE;
 }
 
+typedef struct {
+	NMSettingsConnection *self;
+	DBusGMethodInvocation *context;
+	const char *check_permission;
+	AuthCallback callback;
+	gpointer callback_data;
+} AuthStartInfo;
+
 static void
-auth_start (NMSettingsConnection *self,
-            DBusGMethodInvocation *context,
-            const char *check_permission,
-            AuthCallback callback,
-            gpointer callback_data)
+auth_start_uid_cb (gulong sender_uid, const char *error_desc, gpointer user_data)
 {
+	AuthStartInfo *info = user_data;
+	NMSettingsConnection *self = info->self;
 	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (self);
 	NMAuthChain *chain;
-	gulong sender_uid = G_MAXULONG;
 	GError *error = NULL;
 
+	if (error_desc) {
+		error = g_error_new_literal (NM_SETTINGS_ERROR,
+		                             NM_SETTINGS_ERROR_PERMISSION_DENIED,
+		                             error_desc);
+		info->callback (self, info->context, G_MAXULONG, error, info->callback_data);
+		g_error_free (error);
+		goto out;
+	}
+
 	if (!check_user_in_acl (NM_CONNECTION (self),
-	                        context,
-	                        priv->dbus_mgr,
 	                        priv->session_monitor,
-	                        &sender_uid,
+	                        sender_uid,
 	                        &error)) {
-		callback (self, context, G_MAXULONG, error, callback_data);
+		info->callback (self, info->context, G_MAXULONG, error, info->callback_data);
 		g_clear_error (&error);
-		return;
+		goto out;
 	}
 
-	if (check_permission) {
-		chain = nm_auth_chain_new (context, NULL, pk_auth_cb, self);
+	if (info->check_permission) {
+		chain = nm_auth_chain_new (info->context, NULL, pk_auth_cb, self);
 		g_assert (chain);
-		nm_auth_chain_set_data (chain, "perm", (gpointer) check_permission, NULL);
-		nm_auth_chain_set_data (chain, "callback", callback, NULL);
-		nm_auth_chain_set_data (chain, "callback-data", callback_data, NULL);
+		nm_auth_chain_set_data (chain, "perm", (gpointer) info->check_permission, NULL);
+		nm_auth_chain_set_data (chain, "callback", info->callback, NULL);
+		nm_auth_chain_set_data (chain, "callback-data", info->callback_data, NULL);
 		nm_auth_chain_set_data_ulong (chain, "sender-uid", sender_uid);
 
-		nm_auth_chain_add_call (chain, check_permission, TRUE);
+		nm_auth_chain_add_call (chain, info->check_permission, TRUE);
 		priv->pending_auths = g_slist_append (priv->pending_auths, chain);
 	} else {
 		/* Don't need polkit auth, automatic success */
-		callback (self, context, sender_uid, NULL, callback_data);
+		info->callback (self, info->context, sender_uid, NULL, info->callback_data);
 	}
+
+out:
+	g_object_unref (info->self);
+	g_slice_free (AuthStartInfo, info);
+}
+
+static void
+auth_start (NMSettingsConnection *self,
+            DBusGMethodInvocation *context,
+            const char *check_permission,
+            AuthCallback callback,
+            gpointer callback_data)
+{
+	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (self);
+	AuthStartInfo *info;
+
+	info = g_slice_new0 (AuthStartInfo);
+	info->self = g_object_ref (self);
+	info->context = context;
+	info->check_permission = check_permission;
+	info->callback = callback;
+	info->callback_data = callback_data;
+
+	/* Resolve the caller's UID; answered immediately if it's already cached */
+	nm_auth_get_caller_uid_async (context, priv->dbus_mgr, auth_start_uid_cb, info);
 }
 
 /**** DBus method handlers ************************************/
@@ -1207,6 +1453,48 @@ get_modify_permission_update (NMConnection *old, NMConnection *new)
 	return NM_AUTH_PERMISSION_SETTINGS_MODIFY_SYSTEM;
 }
 
+typedef struct {
+	NMSettingsConnection *self;
+	DBusGMethodInvocation *context;
+	NMConnection *new_settings;
+} UpdateAclInfo;
+
+static void
+update_uid_cb (gulong sender_uid, const char *error_desc, gpointer user_data)
+{
+	UpdateAclInfo *info = user_data;
+	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (info->self);
+	GError *error = NULL;
+
+	if (error_desc) {
+		error = g_error_new_literal (NM_SETTINGS_ERROR,
+		                             NM_SETTINGS_ERROR_PERMISSION_DENIED,
+		                             error_desc);
+	} else {
+		/* And that the new connection settings will be visible to the user
+		 * that's sending the update request.  You can't make a connection
+		 * invisible to yourself.
+		 */
+		check_user_in_acl (info->new_settings, priv->session_monitor, sender_uid, &error);
+	}
+
+	if (error) {
+		dbus_g_method_return_error (info->context, error);
+		g_error_free (error);
+		g_object_unref (info->new_settings);
+	} else {
+		/* The UID is cached now, so auth_start() won't hit the bus again */
+		auth_start (info->self,
+		            info->context,
+		            get_modify_permission_update (NM_CONNECTION (info->self), info->new_settings),
+		            update_auth_cb,
+		            info->new_settings);
+	}
+
+	g_object_unref (info->self);
+	g_slice_free (UpdateAclInfo, info);
+}
+
 static void
 impl_settings_connection_update (NMSettingsConnection *self,
                                  GHashTable *new_settings,
@@ -1214,6 +1502,7 @@ impl_settings_connection_update (NMSettingsConnection *self,
 {
 	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (self);
 	NMConnection *tmp;
+	UpdateAclInfo *info;
 	GError *error = NULL;
 
 	/* If the connection is read-only, that has to be changed at the source of
@@ -1235,27 +1524,11 @@ impl_settings_connection_update (NMSettingsConnection *self,
 		return;
 	}
 
-	/* And that the new connection settings will be visible to the user
-	 * that's sending the update request.  You can't make a connection
-	 * invisible to yourself.
-	 */
-	if (!check_user_in_acl (tmp,
-	                        context,
-	                        priv->dbus_mgr,
-	                        priv->session_monitor,
-	                        NULL,
-	                        &error)) {
-		dbus_g_method_return_error (context, error);
-		g_clear_error (&error);
-		g_object_unref (tmp);
-		return;
-	}
-
-	auth_start (self,
-	            context,
-	            get_modify_permission_update (NM_CONNECTION (self), tmp),
-	            update_auth_cb,
-	            tmp);
+	info = g_slice_new0 (UpdateAclInfo);
+	info->self = g_object_ref (self);
+	info->context = context;
+	info->new_settings = tmp;
+	nm_auth_get_caller_uid_async (context, priv->dbus_mgr, update_uid_cb, info);
 }
 
 static void
@@ -1450,41 +1723,28 @@ nm_settings_connection_update_timestamp (NMSettingsConnection *connection,
 {
 	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (connection);
 	const char *connection_uuid;
-	GKeyFile *timestamps_file;
-	char *data, *tmp;
-	gsize len;
-	GError *error = NULL;
+	char *tmp, *old;
 
 	/* Update timestamp in private storage */
-	priv->timestamp = timestamp;
-	priv->timestamp_set = TRUE;
+	if (priv->timestamp != timestamp || !priv->timestamp_set) {
+		priv->timestamp = timestamp;
+		priv->timestamp_set = TRUE;
+		g_object_notify (G_OBJECT (connection), NM_SETTINGS_CONNECTION_TIMESTAMP);
+	}
 
 	if (flush_to_disk == FALSE)
 		return;
 
-	/* Save timestamp to timestamps database file */
-	timestamps_file = g_key_file_new ();
-	if (!g_key_file_load_from_file (timestamps_file, SETTINGS_TIMESTAMPS_FILE, G_KEY_FILE_KEEP_COMMENTS, &error)) {
-		if (!(error->domain == G_FILE_ERROR && error->code == G_FILE_ERROR_NOENT))
-			nm_log_warn (LOGD_SETTINGS, "error parsing timestamps file '%s': %s", SETTINGS_TIMESTAMPS_FILE, error->message);
-		g_clear_error (&error);
-	}
-
+	/* Save timestamp to timestamps database */
 	connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
 	tmp = g_strdup_printf ("%" G_GUINT64_FORMAT, timestamp);
-	g_key_file_set_value (timestamps_file, "timestamps", connection_uuid, tmp);
-	g_free (tmp);
- 
-	data = g_key_file_to_data (timestamps_file, &len, &error);
-	if (data) {
-		g_file_set_contents (SETTINGS_TIMESTAMPS_FILE, data, len, &error);
-		g_free (data);
+	old = g_key_file_get_value (db_get (&timestamps_db), timestamps_db.group, connection_uuid, NULL);
+	if (g_strcmp0 (old, tmp) != 0) {
+		g_key_file_set_value (timestamps_db.keyfile, timestamps_db.group, connection_uuid, tmp);
+		db_changed (&timestamps_db);
 	}
-	if (error) {
-		nm_log_warn (LOGD_SETTINGS, "error saving timestamp to file '%s': %s", SETTINGS_TIMESTAMPS_FILE, error->message);
-		g_error_free (error);
-	}
-	g_key_file_free (timestamps_file);
+	g_free (old);
+	g_free (tmp);
 }
 
 /**
@@ -1500,15 +1760,12 @@ nm_settings_connection_read_and_fill_timestamp (NMSettingsConnection *connection
 	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (connection);
 	const char *connection_uuid;
 	guint64 timestamp = 0;
-	GKeyFile *timestamps_file;
 	GError *err = NULL;
 	char *tmp_str;
 
-	/* Get timestamp from database file */
-	timestamps_file = g_key_file_new ();
-	g_key_file_load_from_file (timestamps_file, SETTINGS_TIMESTAMPS_FILE, G_KEY_FILE_KEEP_COMMENTS, NULL);
+	/* Get timestamp from database */
 	connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
-	tmp_str = g_key_file_get_value (timestamps_file, "timestamps", connection_uuid, &err);
+	tmp_str = g_key_file_get_value (db_get (&timestamps_db), timestamps_db.group, connection_uuid, &err);
 	if (tmp_str) {
 		timestamp = g_ascii_strtoull (tmp_str, NULL, 10);
 		g_free (tmp_str);
@@ -1523,7 +1780,6 @@ nm_settings_connection_read_and_fill_timestamp (NMSettingsConnection *connection
 		            connection_uuid, err->code, err->message);
 		g_clear_error (&err);
 	}
-	g_key_file_free (timestamps_file);
 }
 
 static guint
@@ -1614,11 +1870,8 @@ nm_settings_connection_add_seen_bssid (NMSettingsConnection *connection,
 {
 	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (connection);
 	const char *connection_uuid;
-	GKeyFile *seen_bssids_file;
-	char *data, *bssid_str;
+	char *bssid_str;
 	const char **list;
-	gsize len;
-	GError *error = NULL;
 	GHashTableIter iter;
 	guint n;
 
@@ -1639,33 +1892,13 @@ nm_settings_connection_add_seen_bssid (NMSettingsConnection *connection,
 	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &bssid_str))
 		list[n++] = bssid_str;
 
-	/* Save BSSID to seen-bssids file */
-	seen_bssids_file = g_key_file_new ();
-	g_key_file_set_list_separator (seen_bssids_file, ',');
-	if (!g_key_file_load_from_file (seen_bssids_file, SETTINGS_SEEN_BSSIDS_FILE, G_KEY_FILE_KEEP_COMMENTS, &error)) {
-		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
-			nm_log_warn (LOGD_SETTINGS, "error parsing seen-bssids file '%s': %s",
-			             SETTINGS_SEEN_BSSIDS_FILE, error->message);
-		}
-		g_clear_error (&error);
-	}
-
+	/* Save BSSID to seen-bssids database */
 	connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
-	g_key_file_set_string_list (seen_bssids_file, "seen-bssids", connection_uuid, list, n);
+	g_key_file_set_string_list (db_get (&seen_bssids_db), seen_bssids_db.group, connection_uuid, list, n);
 	g_free (list);
+	db_changed (&seen_bssids_db);
 
-	data = g_key_file_to_data (seen_bssids_file, &len, &error);
-	if (data) {
-		g_file_set_contents (SETTINGS_SEEN_BSSIDS_FILE, data, len, &error);
-		g_free (data);
-	}
-	g_key_file_free (seen_bssids_file);
-
-	if (error) {
-		nm_log_warn (LOGD_SETTINGS, "error saving seen-bssids to file '%s': %s",
-		             SETTINGS_SEEN_BSSIDS_FILE, error->message);
-		g_error_free (error);
-	}
+	g_signal_emit (connection, signals[SEEN_BSSID_ADDED], 0, seen_bssid);
 }
 
 static void
@@ -1693,19 +1926,13 @@ nm_settings_connection_read_and_fill_seen_bssids (NMSettingsConnection *connecti
 {
 	NMSettingsConnectionPrivate *priv = NM_SETTINGS_CONNECTION_GET_PRIVATE (connection);
 	const char *connection_uuid;
-	GKeyFile *seen_bssids_file;
 	char **tmp_strv = NULL;
 	gsize i, len = 0;
 	NMSettingWireless *s_wifi;
 
-	/* Get seen BSSIDs from database file */
-	seen_bssids_file = g_key_file_new ();
-	g_key_file_set_list_separator (seen_bssids_file, ',');
-	if (g_key_file_load_from_file (seen_bssids_file, SETTINGS_SEEN_BSSIDS_FILE, G_KEY_FILE_KEEP_COMMENTS, NULL)) {
-		connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
-		tmp_strv = g_key_file_get_string_list (seen_bssids_file, "seen-bssids", connection_uuid, &len, NULL);
-	}
-	g_key_file_free (seen_bssids_file);
+	/* Get seen BSSIDs from database */
+	connection_uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
+	tmp_strv = g_key_file_get_string_list (db_get (&seen_bssids_db), seen_bssids_db.group, connection_uuid, &len, NULL);
 
 	/* Update connection's seen-bssids */
 	if (tmp_strv) {
@@ -1781,6 +2008,9 @@ dispose (GObject *object)
 
 	g_hash_table_destroy (priv->seen_bssids);
 
+	match_free (priv->match);
+	priv->match = NULL;
+
 	set_visible (self, FALSE);
 
 	if (priv->session_changed_id)
@@ -1801,6 +2031,9 @@ get_property (GObject *object, guint prop_id,
 	case PROP_VISIBLE:
 		g_value_set_boolean (value, NM_SETTINGS_CONNECTION_GET_PRIVATE (object)->visible);
 		break;
+	case PROP_TIMESTAMP:
+		g_value_set_uint64 (value, NM_SETTINGS_CONNECTION_GET_PRIVATE (object)->timestamp);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -1839,6 +2072,14 @@ nm_settings_connection_class_init (NMSettingsConnectionClass *class)
 		                       FALSE,
 		                       G_PARAM_READABLE));
 
+	g_object_class_install_property
+		(object_class, PROP_TIMESTAMP,
+		 g_param_spec_uint64 (NM_SETTINGS_CONNECTION_TIMESTAMP,
+		                      "Timestamp",
+		                      "Timestamp of last activation",
+		                      0, G_MAXUINT64, 0,
+		                      G_PARAM_READABLE));
+
 	/* Signals */
 	signals[UPDATED] = 
 		g_signal_new (NM_SETTINGS_CONNECTION_UPDATED,
@@ -1868,6 +2109,26 @@ nm_settings_connection_class_init (NMSettingsConnectionClass *class)
 		              g_cclosure_marshal_VOID__VOID,
 		              G_TYPE_NONE, 0);
 
+	/* Not exported */
+	signals[SEEN_BSSID_ADDED] =
+		g_signal_new (NM_SETTINGS_CONNECTION_SEEN_BSSID_ADDED,
+		              G_TYPE_FROM_CLASS (class),
+		              G_SIGNAL_RUN_FIRST,
+		              0,
+		              NULL, NULL,
+		              g_cclosure_marshal_VOID__POINTER,
+		              G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+	/* Not exported */
+	signals[SETTINGS_REPLACED] =
+		g_signal_new (NM_SETTINGS_CONNECTION_SETTINGS_REPLACED,
+		              G_TYPE_FROM_CLASS (class),
+		              G_SIGNAL_RUN_FIRST,
+		              0,
+		              NULL, NULL,
+		              g_cclosure_marshal_VOID__VOID,
+		              G_TYPE_NONE, 0);
+
 	dbus_g_object_type_install_info (G_TYPE_FROM_CLASS (class),
 	                                 &dbus_glib_nm_settings_connection_object_info);
 }
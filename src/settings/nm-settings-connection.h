@@ -39,8 +39,11 @@ G_BEGIN_DECLS
 #define NM_SETTINGS_CONNECTION_REMOVED "removed"
 #define NM_SETTINGS_CONNECTION_GET_SECRETS "get-secrets"
 #define NM_SETTINGS_CONNECTION_CANCEL_SECRETS "cancel-secrets"
+#define NM_SETTINGS_CONNECTION_SEEN_BSSID_ADDED "seen-bssid-added"
+#define NM_SETTINGS_CONNECTION_SETTINGS_REPLACED "settings-replaced"
 
 #define NM_SETTINGS_CONNECTION_VISIBLE "visible"
+#define NM_SETTINGS_CONNECTION_TIMESTAMP "timestamp"
 
 typedef struct _NMSettingsConnection NMSettingsConnection;
 
@@ -74,6 +77,26 @@ struct _NMSettingsConnectionClass {
 	                              const char *setting_name);
 };
 
+/* Settings needed to match a connection against devices and APs during
+ * auto-activation, parsed once per settings change.
+ */
+typedef struct {
+	const char *type;              /* interned connection type */
+	gboolean autoconnect;
+	const char *ip4_method;        /* interned; NULL without IPv4 setting */
+	const char *shared_permission; /* permission needed to share, or NULL */
+
+	/* Wired and Wi-Fi only */
+	gboolean has_mac;
+	struct ether_addr mac;
+	struct ether_addr *mac_blacklist;
+	guint mac_blacklist_len;
+
+	/* Wi-Fi only */
+	GByteArray *ssid;
+	gboolean secure;               /* requires wireless security */
+} NMSettingsConnectionMatch;
+
 GType nm_settings_connection_get_type (void);
 
 void nm_settings_connection_commit_changes (NMSettingsConnection *connection,
@@ -141,6 +164,13 @@ void nm_settings_connection_add_seen_bssid (NMSettingsConnection *connection,
 
 void nm_settings_connection_read_and_fill_seen_bssids (NMSettingsConnection *connection);
 
+void nm_settings_connection_flush_databases (void);
+
+const NMSettingsConnectionMatch *nm_settings_connection_get_match (NMSettingsConnection *self);
+
+gboolean nm_settings_connection_match_mac (const NMSettingsConnectionMatch *match,
+                                           const struct ether_addr *addr);
+
 G_END_DECLS
 
 #endif /* NM_SETTINGS_CONNECTION_H */
@@ -17,12 +17,17 @@
  */
 
 #include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 
 #include <nm-connection.h>
 #include "nm-settings-utils.h"
 
+#define MAX_PARSE_THREADS 8
+
 char *
 nm_settings_utils_get_default_wired_name (GHashTable *connections)
 {
@@ -64,3 +69,170 @@ nm_settings_utils_get_default_wired_name (GHashTable *connections)
 	return cname;
 }
 
+typedef struct {
+	const char **paths;
+	gpointer *results;
+	NMSettingsParseFunc parse_func;
+	gpointer user_data;
+} ParseInfo;
+
+static void
+parse_one (gpointer data, gpointer user_data)
+{
+	ParseInfo *info = user_data;
+	guint idx = GPOINTER_TO_UINT (data) - 1;
+
+	/* Each task owns its own slot, so no locking is needed */
+	info->results[idx] = info->parse_func (info->paths[idx], info->user_data);
+}
+
+/**
+ * nm_settings_utils_parse_files:
+ * @paths: files to parse
+ * @num_paths: number of items in @paths
+ * @parse_func: parses one file; called from worker threads
+ * @user_data: data for @parse_func
+ *
+ * Runs @parse_func on every file in @paths using a pool of worker threads
+ * and waits for all of them to finish.  Plugins use this to read their
+ * connections in parallel at startup, then create the actual
+ * #NMSettingsConnection objects from the results on the main thread.
+ *
+ * Returns: a newly allocated array with the result for each item in @paths,
+ * in the same order; free with g_free() after disposing of the results
+ */
+gpointer *
+nm_settings_utils_parse_files (const char **paths,
+                               guint num_paths,
+                               NMSettingsParseFunc parse_func,
+                               gpointer user_data)
+{
+	ParseInfo info;
+	GThreadPool *pool = NULL;
+	long num_cpus;
+	guint num_threads, i;
+
+	g_return_val_if_fail (parse_func != NULL, NULL);
+
+	info.paths = paths;
+	info.results = g_new0 (gpointer, num_paths + 1);
+	info.parse_func = parse_func;
+	info.user_data = user_data;
+
+	num_cpus = sysconf (_SC_NPROCESSORS_ONLN);
+	num_threads = CLAMP (num_cpus, 1, MAX_PARSE_THREADS);
+	num_threads = MIN (num_threads, num_paths);
+
+	if (num_threads > 1 && g_thread_supported ())
+		pool = g_thread_pool_new (parse_one, &info, num_threads, TRUE, NULL);
+
+	for (i = 0; i < num_paths; i++) {
+		if (pool)
+			g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1), NULL);
+		else
+			parse_one (GUINT_TO_POINTER (i + 1), &info);
+	}
+
+	/* Waits for all queued files to be parsed */
+	if (pool)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+	return info.results;
+}
+
+typedef struct {
+	guint64 ino;
+	guint64 size;
+	gint64 mtime_sec;
+	gint64 mtime_nsec;
+	char *checksum;
+} FileFingerprint;
+
+static void
+file_fingerprint_free (gpointer data)
+{
+	FileFingerprint *fingerprint = data;
+
+	g_free (fingerprint->checksum);
+	g_slice_free (FileFingerprint, fingerprint);
+}
+
+/**
+ * nm_settings_utils_fingerprints_new:
+ *
+ * Returns: a new table for nm_settings_utils_file_changed(); free with
+ * g_hash_table_destroy()
+ */
+GHashTable *
+nm_settings_utils_fingerprints_new (void)
+{
+	return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, file_fingerprint_free);
+}
+
+static char *
+file_checksum (const char *path)
+{
+	char *contents = NULL, *checksum;
+	gsize len = 0;
+
+	if (!g_file_get_contents (path, &contents, &len, NULL))
+		return NULL;
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *) contents, len);
+	g_free (contents);
+	return checksum;
+}
+
+/**
+ * nm_settings_utils_file_changed:
+ * @fingerprints: table from nm_settings_utils_fingerprints_new()
+ * @path: a file a change notification was received for
+ *
+ * Lets plugins skip re-reading files that were rewritten with the same
+ * contents.  Files are first compared by inode, size and mtime, and only
+ * read and hashed if those changed.  The first call for a file records it
+ * and always reports a change.
+ *
+ * Returns: %FALSE if @path is known to be the same as at the last call
+ */
+gboolean
+nm_settings_utils_file_changed (GHashTable *fingerprints, const char *path)
+{
+	FileFingerprint *fingerprint;
+	struct stat st;
+	char *checksum;
+	gboolean changed;
+
+	g_return_val_if_fail (fingerprints != NULL, TRUE);
+	g_return_val_if_fail (path != NULL, TRUE);
+
+	if (stat (path, &st) < 0) {
+		g_hash_table_remove (fingerprints, path);
+		return TRUE;
+	}
+
+	fingerprint = g_hash_table_lookup (fingerprints, path);
+	if (   fingerprint
+	    && fingerprint->ino == (guint64) st.st_ino
+	    && fingerprint->size == (guint64) st.st_size
+	    && fingerprint->mtime_sec == (gint64) st.st_mtim.tv_sec
+	    && fingerprint->mtime_nsec == (gint64) st.st_mtim.tv_nsec)
+		return FALSE;
+
+	checksum = file_checksum (path);
+	changed =    !fingerprint
+	          || !checksum
+	          || g_strcmp0 (fingerprint->checksum, checksum) != 0;
+
+	if (!fingerprint) {
+		fingerprint = g_slice_new0 (FileFingerprint);
+		g_hash_table_insert (fingerprints, g_strdup (path), fingerprint);
+	}
+	fingerprint->ino = st.st_ino;
+	fingerprint->size = st.st_size;
+	fingerprint->mtime_sec = st.st_mtim.tv_sec;
+	fingerprint->mtime_nsec = st.st_mtim.tv_nsec;
+	g_free (fingerprint->checksum);
+	fingerprint->checksum = checksum;
+
+	return changed;
+}
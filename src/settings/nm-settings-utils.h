@@ -23,4 +23,18 @@
 
 char *nm_settings_utils_get_default_wired_name (GHashTable *connections);
 
+/* Called from worker threads; must not touch anything but @path and its
+ * own result (no GObjects from the daemon, no main-loop sources).
+ */
+typedef gpointer (*NMSettingsParseFunc) (const char *path, gpointer user_data);
+
+gpointer *nm_settings_utils_parse_files (const char **paths,
+                                         guint num_paths,
+                                         NMSettingsParseFunc parse_func,
+                                         gpointer user_data);
+
+GHashTable *nm_settings_utils_fingerprints_new (void);
+
+gboolean nm_settings_utils_file_changed (GHashTable *fingerprints, const char *path);
+
 #endif  /* NM_SETTINGS_UTILS_H */
@@ -30,6 +30,7 @@
 #include <gmodule.h>
 #include <net/if_arp.h>
 #include <pwd.h>
+#include <netinet/ether.h>
 #include <dbus/dbus.h>
 #include <dbus/dbus-glib-lowlevel.h>
 
@@ -132,6 +133,18 @@ typedef struct {
 	gboolean connections_loaded;
 	GHashTable *connections;
 	GSList *unmanaged_specs;
+
+	/* Secondary indices over 'connections'; each 'by_*' table maps a key
+	 * to a set of NMSettingsConnections sharing it.
+	 */
+	GHashTable *index;     /* NMSettingsConnection -> ConnectionIndex */
+	GHashTable *by_uuid;
+	GHashTable *by_type;
+	GHashTable *by_iface;  /* virtual interface name */
+	GHashTable *by_mac;    /* bound MAC address, hex-encoded */
+	GHashTable *by_ssid;   /* hex-encoded */
+	GHashTable *by_bssid;  /* seen BSSIDs, hex-encoded */
+	GSequence *ordered;    /* all connections in connection_sort() order */
 } NMSettingsPrivate;
 
 #define NM_SETTINGS_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), NM_TYPE_SETTINGS, NMSettingsPrivate))
@@ -159,21 +172,142 @@ enum {
 	LAST_PROP
 };
 
+/**************************************************************/
+
+typedef struct {
+	/* Keys this connection was last indexed under */
+	char *uuid;
+	char *ctype;
+	char *iface;
+	char *mac;
+	char *ssid;
+	GSList *bssids;
+
+	GSequenceIter *ordered;
+} ConnectionIndex;
+
+static void
+connection_index_free (ConnectionIndex *entry)
+{
+	g_free (entry->uuid);
+	g_free (entry->ctype);
+	g_free (entry->iface);
+	g_free (entry->mac);
+	g_free (entry->ssid);
+	g_slist_foreach (entry->bssids, (GFunc) g_free, NULL);
+	g_slist_free (entry->bssids);
+	g_slice_free (ConnectionIndex, entry);
+}
+
+static GHashTable *
+index_new (void)
+{
+	return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_hash_table_destroy);
+}
+
+static char *
+index_key_from_bytes (const GByteArray *bytes)
+{
+	GString *key;
+	guint i;
+
+	if (!bytes || !bytes->len)
+		return NULL;
+
+	key = g_string_sized_new (bytes->len * 2);
+	for (i = 0; i < bytes->len; i++)
+		g_string_append_printf (key, "%02x", bytes->data[i]);
+	return g_string_free (key, FALSE);
+}
+
+static char *
+index_key_from_bssid (const struct ether_addr *bssid)
+{
+	const guint8 *b = bssid->ether_addr_octet;
+
+	return g_strdup_printf ("%02x%02x%02x%02x%02x%02x", b[0], b[1], b[2], b[3], b[4], b[5]);
+}
+
+static void
+index_set_add (GHashTable *index, const char *key, gpointer connection)
+{
+	GHashTable *set;
+
+	if (!key)
+		return;
+
+	set = g_hash_table_lookup (index, key);
+	if (!set) {
+		set = g_hash_table_new (g_direct_hash, g_direct_equal);
+		g_hash_table_insert (index, g_strdup (key), set);
+	}
+	g_hash_table_insert (set, connection, connection);
+}
+
+static void
+index_set_remove (GHashTable *index, const char *key, gpointer connection)
+{
+	GHashTable *set;
+
+	if (!key)
+		return;
+
+	set = g_hash_table_lookup (index, key);
+	if (set) {
+		g_hash_table_remove (set, connection);
+		if (g_hash_table_size (set) == 0)
+			g_hash_table_remove (index, key);
+	}
+}
+
+static gpointer
+index_lookup_one (GHashTable *index, const char *key)
+{
+	GHashTable *set;
+	GHashTableIter iter;
+	gpointer data = NULL;
+
+	set = g_hash_table_lookup (index, key);
+	if (set) {
+		g_hash_table_iter_init (&iter, set);
+		g_hash_table_iter_next (&iter, &data, NULL);
+	}
+	return data;
+}
+
 static void
 load_connections (NMSettings *self)
 {
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
 	GSList *iter;
+	GTimer *timer;
+	guint total = 0;
 
 	if (priv->connections_loaded)
 		return;
 
+	/* Plugins read their files with a pool of worker threads but are asked
+	 * one at a time, in priority order, so claiming stays deterministic.
+	 */
+	timer = g_timer_new ();
 	for (iter = priv->plugins; iter; iter = g_slist_next (iter)) {
 		NMSystemConfigInterface *plugin = NM_SYSTEM_CONFIG_INTERFACE (iter->data);
 		GSList *plugin_connections;
 		GSList *elt;
+		gdouble start = g_timer_elapsed (timer, NULL);
+		char *plugin_name = NULL;
+		guint num;
 
 		plugin_connections = nm_system_config_interface_get_connections (plugin);
+		num = g_slist_length (plugin_connections);
+		total += num;
+
+		g_object_get (G_OBJECT (plugin), NM_SYSTEM_CONFIG_INTERFACE_NAME, &plugin_name, NULL);
+		nm_log_dbg (LOGD_SETTINGS, "plugin '%s' read %u connections in %.1f ms",
+		            plugin_name ? plugin_name : "(unknown)",
+		            num,
+		            (g_timer_elapsed (timer, NULL) - start) * 1000);
+		g_free (plugin_name);
 
 		// FIXME: ensure connections from plugins loaded with a lower priority
 		// get rejected when they conflict with connections from a higher
@@ -185,6 +319,10 @@ load_connections (NMSettings *self)
 		g_slist_free (plugin_connections);
 	}
 
+	nm_log_info (LOGD_SETTINGS, "loaded %u connections in %.1f ms",
+	             total, g_timer_elapsed (timer, NULL) * 1000);
+	g_timer_destroy (timer);
+
 	priv->connections_loaded = TRUE;
 
 	/* FIXME: Bad hack */
@@ -237,25 +375,13 @@ impl_settings_list_connections (NMSettings *self,
 NMSettingsConnection *
 nm_settings_get_connection_by_uuid (NMSettings *self, const char *uuid)
 {
-	NMSettingsPrivate *priv;
-	NMSettingsConnection *candidate;
-	GHashTableIter iter;
-
 	g_return_val_if_fail (self != NULL, NULL);
 	g_return_val_if_fail (NM_IS_SETTINGS (self), NULL);
 	g_return_val_if_fail (uuid != NULL, NULL);
 
-	priv = NM_SETTINGS_GET_PRIVATE (self);
-
 	load_connections (self);
 
-	g_hash_table_iter_init (&iter, priv->connections);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &candidate)) {
-		if (g_strcmp0 (uuid, nm_connection_get_uuid (NM_CONNECTION (candidate))) == 0)
-			return candidate;
-	}
-
-	return NULL;
+	return index_lookup_one (NM_SETTINGS_GET_PRIVATE (self)->by_uuid, uuid);
 }
 
 static gboolean
@@ -308,24 +434,236 @@ connection_sort (gconstpointer pa, gconstpointer pb)
 	return 1;
 }
 
+static int
+connection_sort_data (gconstpointer pa, gconstpointer pb, gpointer user_data)
+{
+	return connection_sort (pa, pb);
+}
+
 /* Returns a list of NMSettingsConnections.  Caller must free the list with
  * g_slist_free().
  */
 GSList *
 nm_settings_get_connections (NMSettings *self)
 {
+	GSequenceIter *iter;
+	GSList *list = NULL;
+
+	g_return_val_if_fail (NM_IS_SETTINGS (self), NULL);
+
+	iter = g_sequence_get_end_iter (NM_SETTINGS_GET_PRIVATE (self)->ordered);
+	while (!g_sequence_iter_is_begin (iter)) {
+		iter = g_sequence_iter_prev (iter);
+		list = g_slist_prepend (list, g_sequence_get (iter));
+	}
+	return list;
+}
+
+static GSList *
+index_lookup_sorted (GHashTable *index, const char *key)
+{
+	GHashTable *set;
 	GHashTableIter iter;
-	gpointer data = NULL;
+	gpointer data;
 	GSList *list = NULL;
 
+	set = key ? g_hash_table_lookup (index, key) : NULL;
+	if (!set)
+		return NULL;
+
+	g_hash_table_iter_init (&iter, set);
+	while (g_hash_table_iter_next (&iter, &data, NULL))
+		list = g_slist_prepend (list, data);
+	return g_slist_sort (list, connection_sort);
+}
+
+/* Returns a list of NMSettingsConnections of the given type (eg,
+ * NM_SETTING_WIRELESS_SETTING_NAME).  Caller must free the list with
+ * g_slist_free().
+ */
+GSList *
+nm_settings_get_connections_by_type (NMSettings *self, const char *type)
+{
+	g_return_val_if_fail (NM_IS_SETTINGS (self), NULL);
+	g_return_val_if_fail (type != NULL, NULL);
+
+	return index_lookup_sorted (NM_SETTINGS_GET_PRIVATE (self)->by_type, type);
+}
+
+/* Returns a list of NMSettingsConnections locked to the given hardware
+ * address.  Caller must free the list with g_slist_free().
+ */
+GSList *
+nm_settings_get_connections_by_mac (NMSettings *self, const GByteArray *mac)
+{
+	GSList *list;
+	char *key;
+
 	g_return_val_if_fail (NM_IS_SETTINGS (self), NULL);
+	g_return_val_if_fail (mac != NULL, NULL);
 
-	g_hash_table_iter_init (&iter, NM_SETTINGS_GET_PRIVATE (self)->connections);
-	while (g_hash_table_iter_next (&iter, NULL, &data))
-		list = g_slist_insert_sorted (list, data, connection_sort);
+	key = index_key_from_bytes (mac);
+	list = index_lookup_sorted (NM_SETTINGS_GET_PRIVATE (self)->by_mac, key);
+	g_free (key);
+	return list;
+}
+
+/* Returns a list of Wi-Fi NMSettingsConnections for the given SSID.  Caller
+ * must free the list with g_slist_free().
+ */
+GSList *
+nm_settings_get_connections_by_ssid (NMSettings *self, const GByteArray *ssid)
+{
+	GSList *list;
+	char *key;
+
+	g_return_val_if_fail (NM_IS_SETTINGS (self), NULL);
+	g_return_val_if_fail (ssid != NULL, NULL);
+
+	key = index_key_from_bytes (ssid);
+	list = index_lookup_sorted (NM_SETTINGS_GET_PRIVATE (self)->by_ssid, key);
+	g_free (key);
 	return list;
 }
 
+/* Returns the connection which has seen the given BSSID, or NULL.  If
+ * several have, the one that comes first in nm_settings_get_connections()
+ * order wins.
+ */
+NMSettingsConnection *
+nm_settings_get_connection_by_seen_bssid (NMSettings *self,
+                                          const struct ether_addr *bssid)
+{
+	NMSettingsPrivate *priv;
+	NMSettingsConnection *best = NULL;
+	ConnectionIndex *best_entry = NULL;
+	GHashTable *set;
+	GHashTableIter iter;
+	gpointer data;
+	char *key;
+
+	g_return_val_if_fail (NM_IS_SETTINGS (self), NULL);
+	g_return_val_if_fail (bssid != NULL, NULL);
+
+	priv = NM_SETTINGS_GET_PRIVATE (self);
+
+	key = index_key_from_bssid (bssid);
+	set = g_hash_table_lookup (priv->by_bssid, key);
+	g_free (key);
+	if (!set)
+		return NULL;
+
+	g_hash_table_iter_init (&iter, set);
+	while (g_hash_table_iter_next (&iter, &data, NULL)) {
+		NMSettingsConnection *candidate = data;
+		ConnectionIndex *entry = g_hash_table_lookup (priv->index, candidate);
+
+		/* First in connection_sort() order wins */
+		if (best && g_sequence_iter_compare (entry->ordered, best_entry->ordered) > 0)
+			continue;
+
+		best = candidate;
+		best_entry = entry;
+	}
+	return best;
+}
+
+static void
+connection_index_add_bssid (NMSettings *self,
+                            NMSettingsConnection *connection,
+                            ConnectionIndex *entry,
+                            const struct ether_addr *bssid)
+{
+	char *key;
+
+	key = index_key_from_bssid (bssid);
+	if (g_slist_find_custom (entry->bssids, key, (GCompareFunc) strcmp)) {
+		g_free (key);
+		return;
+	}
+	index_set_add (NM_SETTINGS_GET_PRIVATE (self)->by_bssid, key, connection);
+	entry->bssids = g_slist_prepend (entry->bssids, key);
+}
+
+static void
+connection_index_add (NMSettings *self, NMSettingsConnection *connection)
+{
+	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	NMConnection *c = NM_CONNECTION (connection);
+	NMSettingConnection *s_con;
+	NMSettingWired *s_wired;
+	NMSettingInfiniband *s_infiniband;
+	NMSettingWireless *s_wifi;
+	const GByteArray *mac = NULL;
+	ConnectionIndex *entry;
+	GSList *bssids, *iter;
+
+	g_return_if_fail (g_hash_table_lookup (priv->index, connection) == NULL);
+
+	s_con = nm_connection_get_setting_connection (c);
+	g_assert (s_con);
+
+	s_wired = nm_connection_get_setting_wired (c);
+	s_infiniband = nm_connection_get_setting_infiniband (c);
+	s_wifi = nm_connection_get_setting_wireless (c);
+	if (s_wired)
+		mac = nm_setting_wired_get_mac_address (s_wired);
+	else if (s_infiniband)
+		mac = nm_setting_infiniband_get_mac_address (s_infiniband);
+	else if (s_wifi)
+		mac = nm_setting_wireless_get_mac_address (s_wifi);
+
+	entry = g_slice_new0 (ConnectionIndex);
+	entry->uuid = g_strdup (nm_setting_connection_get_uuid (s_con));
+	entry->ctype = g_strdup (nm_setting_connection_get_connection_type (s_con));
+	entry->iface = g_strdup (nm_connection_get_virtual_iface_name (c));
+	entry->mac = index_key_from_bytes (mac);
+	if (s_wifi)
+		entry->ssid = index_key_from_bytes (nm_setting_wireless_get_ssid (s_wifi));
+
+	index_set_add (priv->by_uuid, entry->uuid, connection);
+	index_set_add (priv->by_type, entry->ctype, connection);
+	index_set_add (priv->by_iface, entry->iface, connection);
+	index_set_add (priv->by_mac, entry->mac, connection);
+	index_set_add (priv->by_ssid, entry->ssid, connection);
+	entry->ordered = g_sequence_insert_sorted (priv->ordered, connection, connection_sort_data, NULL);
+
+	bssids = nm_settings_connection_get_seen_bssids (connection);
+	for (iter = bssids; iter; iter = g_slist_next (iter)) {
+		struct ether_addr bssid;
+
+		if (ether_aton_r (iter->data, &bssid))
+			connection_index_add_bssid (self, connection, entry, &bssid);
+	}
+	g_slist_foreach (bssids, (GFunc) g_free, NULL);
+	g_slist_free (bssids);
+
+	g_hash_table_insert (priv->index, connection, entry);
+}
+
+static void
+connection_index_remove (NMSettings *self, NMSettingsConnection *connection)
+{
+	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	ConnectionIndex *entry;
+	GSList *iter;
+
+	entry = g_hash_table_lookup (priv->index, connection);
+	if (!entry)
+		return;
+
+	index_set_remove (priv->by_uuid, entry->uuid, connection);
+	index_set_remove (priv->by_type, entry->ctype, connection);
+	index_set_remove (priv->by_iface, entry->iface, connection);
+	index_set_remove (priv->by_mac, entry->mac, connection);
+	index_set_remove (priv->by_ssid, entry->ssid, connection);
+	for (iter = entry->bssids; iter; iter = g_slist_next (iter))
+		index_set_remove (priv->by_bssid, iter->data, connection);
+	g_sequence_remove (entry->ordered);
+
+	g_hash_table_remove (priv->index, connection);
+}
+
 NMSettingsConnection *
 nm_settings_get_connection_by_path (NMSettings *self, const char *path)
 {
@@ -669,6 +1007,9 @@ load_plugins (NMSettings *self, const char **plugins, GError **error)
 #define UPDATED_ID_TAG "updated-id-tag"
 #define VISIBLE_ID_TAG "visible-id-tag"
 #define UNREG_ID_TAG "unreg-id-tag"
+#define TIMESTAMP_ID_TAG "timestamp-id-tag"
+#define BSSID_ID_TAG "bssid-id-tag"
+#define REPLACED_ID_TAG "replaced-id-tag"
 
 static void
 connection_removed (NMSettingsConnection *obj, gpointer user_data)
@@ -695,7 +1036,20 @@ connection_removed (NMSettingsConnection *obj, gpointer user_data)
 	if (id)
 		g_signal_handler_disconnect (connection, id);
 
+	id = GPOINTER_TO_UINT (g_object_get_data (connection, TIMESTAMP_ID_TAG));
+	if (id)
+		g_signal_handler_disconnect (connection, id);
+
+	id = GPOINTER_TO_UINT (g_object_get_data (connection, BSSID_ID_TAG));
+	if (id)
+		g_signal_handler_disconnect (connection, id);
+
+	id = GPOINTER_TO_UINT (g_object_get_data (connection, REPLACED_ID_TAG));
+	if (id)
+		g_signal_handler_disconnect (connection, id);
+
 	/* Forget about the connection internally */
+	connection_index_remove (NM_SETTINGS (user_data), obj);
 	g_hash_table_remove (NM_SETTINGS_GET_PRIVATE (user_data)->connections,
 	                     (gpointer) nm_connection_get_path (NM_CONNECTION (connection)));
 
@@ -732,6 +1086,16 @@ connection_updated (NMSettingsConnection *connection, gpointer user_data)
 	g_signal_emit_by_name (NM_SETTINGS (user_data), NM_CP_SIGNAL_CONNECTION_UPDATED, connection);
 }
 
+static void
+connection_settings_replaced (NMSettingsConnection *connection, gpointer user_data)
+{
+	/* Any of the indexed properties may have changed, even if the new
+	 * settings were rejected or never get committed.
+	 */
+	connection_index_remove (NM_SETTINGS (user_data), connection);
+	connection_index_add (NM_SETTINGS (user_data), connection);
+}
+
 static void
 connection_visibility_changed (NMSettingsConnection *connection,
                                GParamSpec *pspec,
@@ -744,6 +1108,30 @@ connection_visibility_changed (NMSettingsConnection *connection,
 	               connection);
 }
 
+static void
+connection_timestamp_changed (NMSettingsConnection *connection,
+                              GParamSpec *pspec,
+                              gpointer user_data)
+{
+	ConnectionIndex *entry;
+
+	entry = g_hash_table_lookup (NM_SETTINGS_GET_PRIVATE (user_data)->index, connection);
+	if (entry)
+		g_sequence_sort_changed (entry->ordered, connection_sort_data, NULL);
+}
+
+static void
+connection_seen_bssid_added (NMSettingsConnection *connection,
+                             const struct ether_addr *bssid,
+                             gpointer user_data)
+{
+	ConnectionIndex *entry;
+
+	entry = g_hash_table_lookup (NM_SETTINGS_GET_PRIVATE (user_data)->index, connection);
+	if (entry)
+		connection_index_add_bssid (NM_SETTINGS (user_data), connection, entry, bssid);
+}
+
 static void
 secret_agent_registered (NMAgentManager *agent_mgr,
                          NMSecretAgent *agent,
@@ -804,20 +1192,15 @@ claim_connection (NMSettings *self,
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
 	static guint32 ec_counter = 0;
 	GError *error = NULL;
-	GHashTableIter iter;
-	gpointer data;
 	char *path;
 	guint id;
 
 	g_return_if_fail (NM_IS_SETTINGS_CONNECTION (connection));
 	g_return_if_fail (nm_connection_get_path (NM_CONNECTION (connection)) == NULL);
 
-	g_hash_table_iter_init (&iter, priv->connections);
-	while (g_hash_table_iter_next (&iter, NULL, &data)) {
-		/* prevent duplicates */
-		if (data == connection)
-			return;
-	}
+	/* prevent duplicates */
+	if (g_hash_table_lookup (priv->index, connection))
+		return;
 
 	if (!nm_connection_verify (NM_CONNECTION (connection), &error)) {
 		nm_log_warn (LOGD_SETTINGS, "plugin provided invalid connection: '%s' / '%s' invalid: %d",
@@ -859,6 +1242,21 @@ claim_connection (NMSettings *self,
 	                       self);
 	g_object_set_data (G_OBJECT (connection), VISIBLE_ID_TAG, GUINT_TO_POINTER (id));
 
+	id = g_signal_connect (connection, "notify::" NM_SETTINGS_CONNECTION_TIMESTAMP,
+	                       G_CALLBACK (connection_timestamp_changed),
+	                       self);
+	g_object_set_data (G_OBJECT (connection), TIMESTAMP_ID_TAG, GUINT_TO_POINTER (id));
+
+	id = g_signal_connect (connection, NM_SETTINGS_CONNECTION_SEEN_BSSID_ADDED,
+	                       G_CALLBACK (connection_seen_bssid_added),
+	                       self);
+	g_object_set_data (G_OBJECT (connection), BSSID_ID_TAG, GUINT_TO_POINTER (id));
+
+	id = g_signal_connect (connection, NM_SETTINGS_CONNECTION_SETTINGS_REPLACED,
+	                       G_CALLBACK (connection_settings_replaced),
+	                       self);
+	g_object_set_data (G_OBJECT (connection), REPLACED_ID_TAG, GUINT_TO_POINTER (id));
+
 	/* Export the connection over D-Bus */
 	g_warn_if_fail (nm_connection_get_path (NM_CONNECTION (connection)) == NULL);
 	path = g_strdup_printf ("%s/%u", NM_DBUS_PATH_SETTINGS, ec_counter++);
@@ -869,6 +1267,7 @@ claim_connection (NMSettings *self,
 	g_hash_table_insert (priv->connections,
 	                     (gpointer) nm_connection_get_path (NM_CONNECTION (connection)),
 	                     g_object_ref (connection));
+	connection_index_add (self, connection);
 
 	/* Only emit the individual connection-added signal after connections
 	 * have been initially loaded.  While getting the first list of connections
@@ -896,6 +1295,7 @@ remove_default_wired_connection (NMSettings *self,
 	if (g_hash_table_lookup (priv->connections, path)) {
 		if (do_signal)
 			g_signal_emit_by_name (G_OBJECT (connection), NM_SETTINGS_CONNECTION_REMOVED);
+		connection_index_remove (self, connection);
 		g_hash_table_remove (priv->connections, path);
 	}
 }
@@ -908,20 +1308,16 @@ add_new_connection (NMSettings *self,
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
 	GSList *iter;
 	NMSettingsConnection *added = NULL;
-	GHashTableIter citer;
-	NMConnection *candidate = NULL;
+	const char *uuid;
 
 	/* Make sure a connection with this UUID doesn't already exist */
-	g_hash_table_iter_init (&citer, priv->connections);
-	while (g_hash_table_iter_next (&citer, NULL, (gpointer *) &candidate)) {
-		if (g_strcmp0 (nm_connection_get_uuid (connection),
-		               nm_connection_get_uuid (candidate)) == 0) {
-			g_set_error_literal (error,
-			                     NM_SETTINGS_ERROR,
-			                     NM_SETTINGS_ERROR_UUID_EXISTS,
-			                     "A connection with this UUID already exists.");
-			return NULL;
-		}
+	uuid = nm_connection_get_uuid (connection);
+	if (uuid && g_hash_table_lookup (priv->by_uuid, uuid)) {
+		g_set_error_literal (error,
+		                     NM_SETTINGS_ERROR,
+		                     NM_SETTINGS_ERROR_UUID_EXISTS,
+		                     "A connection with this UUID already exists.");
+		return NULL;
 	}
 
 	/* 1) plugin writes the NMConnection to disk
@@ -1097,66 +1493,35 @@ is_adhoc_wpa (NMConnection *connection)
 	return TRUE;
 }
 
-void
-nm_settings_add_connection (NMSettings *self,
-                            NMConnection *connection,
-                            DBusGMethodInvocation *context,
-                            NMSettingsAddCallback callback,
-                            gpointer user_data)
+typedef struct {
+	NMSettings *self;
+	NMConnection *connection;
+	DBusGMethodInvocation *context;
+	NMSettingsAddCallback callback;
+	gpointer callback_data;
+} AddUidInfo;
+
+static void
+add_connection_uid_cb (gulong caller_uid, const char *uid_error, gpointer user_data)
 {
+	AddUidInfo *info = user_data;
+	NMSettings *self = info->self;
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	NMConnection *connection = info->connection;
 	NMSettingConnection *s_con;
 	NMAuthChain *chain;
-	GError *error = NULL, *tmp_error = NULL;
-	gulong caller_uid = G_MAXULONG;
+	GError *error = NULL;
 	char *error_desc = NULL;
 	const char *perm;
 
-	/* Connection must be valid, of course */
-	if (!nm_connection_verify (connection, &tmp_error)) {
-		error = g_error_new (NM_SETTINGS_ERROR,
-		                     NM_SETTINGS_ERROR_INVALID_CONNECTION,
-		                     "The connection was invalid: %s",
-		                     tmp_error ? tmp_error->message : "(unknown)");
-		g_error_free (tmp_error);
-		callback (self, NULL, error, context, user_data);
-		g_error_free (error);
-		return;
-	}
-
-	/* The kernel doesn't support Ad-Hoc WPA connections well at this time,
-	 * and turns them into open networks.  It's been this way since at least
-	 * 2.6.30 or so; until that's fixed, disable WPA-protected Ad-Hoc networks.
-	 */
-	if (is_adhoc_wpa (connection)) {
-		error = g_error_new_literal (NM_SETTINGS_ERROR,
-		                             NM_SETTINGS_ERROR_INVALID_CONNECTION,
-		                             "WPA Ad-Hoc disabled due to kernel bugs");
-		callback (self, NULL, error, context, user_data);
-		g_error_free (error);
-		return;
-	}
-
-	/* Do any of the plugins support adding? */
-	if (!get_plugin (self, NM_SYSTEM_CONFIG_INTERFACE_CAP_MODIFY_CONNECTIONS)) {
-		error = g_error_new_literal (NM_SETTINGS_ERROR,
-		                             NM_SETTINGS_ERROR_ADD_NOT_SUPPORTED,
-		                             "None of the registered plugins support add.");
-		callback (self, NULL, error, context, user_data);
-		g_error_free (error);
-		return;
-	}
-
-	/* Get the caller's UID */
-	if (!nm_auth_get_caller_uid (context, priv->dbus_mgr, &caller_uid, &error_desc)) {
+	if (uid_error) {
 		error = g_error_new (NM_SETTINGS_ERROR,
 		                     NM_SETTINGS_ERROR_NOT_PRIVILEGED,
 		                     "Unable to determine UID of request: %s.",
-		                     error_desc ? error_desc : "(unknown)");
-		g_free (error_desc);
-		callback (self, NULL, error, context, user_data);
+		                     uid_error);
+		info->callback (self, NULL, error, info->context, info->callback_data);
 		g_error_free (error);
-		return;
+		goto out;
 	}
 
 	/* Ensure the caller's username exists in the connection's permissions,
@@ -1168,9 +1533,9 @@ nm_settings_add_connection (NMSettings *self,
 			                             NM_SETTINGS_ERROR_NOT_PRIVILEGED,
 			                             error_desc);
 			g_free (error_desc);
-			callback (self, NULL, error, context, user_data);
+			info->callback (self, NULL, error, info->context, info->callback_data);
 			g_error_free (error);
-			return;
+			goto out;
 		}
 
 		/* Caller is allowed to add this connection */
@@ -1188,15 +1553,76 @@ nm_settings_add_connection (NMSettings *self,
 		perm = NM_AUTH_PERMISSION_SETTINGS_MODIFY_SYSTEM;
 
 	/* Otherwise validate the user request */
-	chain = nm_auth_chain_new (context, NULL, pk_add_cb, self);
+	chain = nm_auth_chain_new (info->context, NULL, pk_add_cb, self);
 	g_assert (chain);
 	priv->auths = g_slist_append (priv->auths, chain);
 	nm_auth_chain_add_call (chain, perm, TRUE);
 	nm_auth_chain_set_data (chain, "perm", (gpointer) perm, NULL);
 	nm_auth_chain_set_data (chain, "connection", g_object_ref (connection), g_object_unref);
-	nm_auth_chain_set_data (chain, "callback", callback, NULL);
-	nm_auth_chain_set_data (chain, "callback-data", user_data, NULL);
+	nm_auth_chain_set_data (chain, "callback", info->callback, NULL);
+	nm_auth_chain_set_data (chain, "callback-data", info->callback_data, NULL);
 	nm_auth_chain_set_data_ulong (chain, "caller-uid", caller_uid);
+
+out:
+	g_object_unref (info->connection);
+	g_object_unref (info->self);
+	g_slice_free (AddUidInfo, info);
+}
+
+void
+nm_settings_add_connection (NMSettings *self,
+                            NMConnection *connection,
+                            DBusGMethodInvocation *context,
+                            NMSettingsAddCallback callback,
+                            gpointer user_data)
+{
+	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	AddUidInfo *info;
+	GError *error = NULL, *tmp_error = NULL;
+
+	/* Connection must be valid, of course */
+	if (!nm_connection_verify (connection, &tmp_error)) {
+		error = g_error_new (NM_SETTINGS_ERROR,
+		                     NM_SETTINGS_ERROR_INVALID_CONNECTION,
+		                     "The connection was invalid: %s",
+		                     tmp_error ? tmp_error->message : "(unknown)");
+		g_error_free (tmp_error);
+		callback (self, NULL, error, context, user_data);
+		g_error_free (error);
+		return;
+	}
+
+	/* The kernel doesn't support Ad-Hoc WPA connections well at this time,
+	 * and turns them into open networks.  It's been this way since at least
+	 * 2.6.30 or so; until that's fixed, disable WPA-protected Ad-Hoc networks.
+	 */
+	if (is_adhoc_wpa (connection)) {
+		error = g_error_new_literal (NM_SETTINGS_ERROR,
+		                             NM_SETTINGS_ERROR_INVALID_CONNECTION,
+		                             "WPA Ad-Hoc disabled due to kernel bugs");
+		callback (self, NULL, error, context, user_data);
+		g_error_free (error);
+		return;
+	}
+
+	/* Do any of the plugins support adding? */
+	if (!get_plugin (self, NM_SYSTEM_CONFIG_INTERFACE_CAP_MODIFY_CONNECTIONS)) {
+		error = g_error_new_literal (NM_SETTINGS_ERROR,
+		                             NM_SETTINGS_ERROR_ADD_NOT_SUPPORTED,
+		                             "None of the registered plugins support add.");
+		callback (self, NULL, error, context, user_data);
+		g_error_free (error);
+		return;
+	}
+
+	/* Get the caller's UID, then check the ACL and ask PolicyKit */
+	info = g_slice_new0 (AddUidInfo);
+	info->self = g_object_ref (self);
+	info->connection = g_object_ref (connection);
+	info->context = context;
+	info->callback = callback;
+	info->callback_data = user_data;
+	nm_auth_get_caller_uid_async (context, priv->dbus_mgr, add_connection_uid_cb, info);
 }
 
 static void
@@ -1312,69 +1738,75 @@ static gboolean
 have_connection_for_device (NMSettings *self, GByteArray *mac, NMDevice *device)
 {
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
+	static const char *ctypes[] = { NM_SETTING_WIRED_SETTING_NAME,
+	                                NM_SETTING_INFINIBAND_SETTING_NAME,
+	                                NM_SETTING_PPPOE_SETTING_NAME,
+	                                NULL };
+	GHashTable *set;
 	GHashTableIter iter;
 	gpointer data;
-	NMSettingConnection *s_con;
 	NMSettingWired *s_wired;
 	NMSettingInfiniband *s_infiniband;
 	const GByteArray *setting_mac;
-	gboolean ret = FALSE;
+	char *key;
+	guint i;
 
 	g_return_val_if_fail (NM_IS_SETTINGS (self), FALSE);
 	g_return_val_if_fail (mac != NULL, FALSE);
 
-	/* Find a wired connection locked to the given MAC address, if any */
-	g_hash_table_iter_init (&iter, priv->connections);
-	while (g_hash_table_iter_next (&iter, NULL, &data)) {
-		NMConnection *connection = NM_CONNECTION (data);
-		const char *ctype, *iface;
-
-		s_con = nm_connection_get_setting_connection (connection);
-		ctype = nm_setting_connection_get_connection_type (s_con);
-
-		iface = nm_connection_get_virtual_iface_name (connection);
-		if (iface) {
-			if (!strcmp (iface, nm_device_get_iface (device))) {
-				ret = TRUE;
-				break;
-			} else
+	/* A connection for a virtual interface of the same name */
+	if (g_hash_table_lookup (priv->by_iface, nm_device_get_iface (device)))
+		return TRUE;
+
+	/* A wired connection locked to the given MAC address */
+	key = index_key_from_bytes (mac);
+	set = key ? g_hash_table_lookup (priv->by_mac, key) : NULL;
+	g_free (key);
+	if (set) {
+		g_hash_table_iter_init (&iter, set);
+		while (g_hash_table_iter_next (&iter, &data, NULL)) {
+			NMConnection *connection = NM_CONNECTION (data);
+
+			if (nm_connection_get_virtual_iface_name (connection))
 				continue;
+			for (i = 0; ctypes[i]; i++) {
+				if (nm_connection_is_type (connection, ctypes[i]))
+					return TRUE;
+			}
 		}
+	}
 
-		if (   strcmp (ctype, NM_SETTING_WIRED_SETTING_NAME)
-		    && strcmp (ctype, NM_SETTING_INFINIBAND_SETTING_NAME)
-		    && strcmp (ctype, NM_SETTING_PPPOE_SETTING_NAME))
+	/* A connection that applies to any wired device */
+	for (i = 0; ctypes[i]; i++) {
+		set = g_hash_table_lookup (priv->by_type, ctypes[i]);
+		if (!set)
 			continue;
 
-		s_wired = nm_connection_get_setting_wired (connection);
-		s_infiniband = nm_connection_get_setting_infiniband (connection);
+		g_hash_table_iter_init (&iter, set);
+		while (g_hash_table_iter_next (&iter, &data, NULL)) {
+			NMConnection *connection = NM_CONNECTION (data);
 
-		/* No wired setting; therefore the PPPoE connection applies to any device */
-		if (!s_wired && !strcmp (ctype, NM_SETTING_PPPOE_SETTING_NAME)) {
-			ret = TRUE;
-			break;
-		}
+			if (nm_connection_get_virtual_iface_name (connection))
+				continue;
 
-		g_assert (s_wired != NULL || s_infiniband != NULL);
-
-		setting_mac = s_wired ?
-			nm_setting_wired_get_mac_address (s_wired) :
-			nm_setting_infiniband_get_mac_address (s_infiniband);
-		if (setting_mac) {
-			/* A connection mac-locked to this device */
-			if (mac->len == setting_mac->len &&
-				!memcmp (setting_mac->data, mac->data, mac->len)) {
-				ret = TRUE;
-				break;
-			}
-		} else {
-			/* A connection that applies to any wired device */
-			ret = TRUE;
-			break;
+			s_wired = nm_connection_get_setting_wired (connection);
+			s_infiniband = nm_connection_get_setting_infiniband (connection);
+
+			/* No wired setting; therefore the PPPoE connection applies to any device */
+			if (!s_wired && !strcmp (ctypes[i], NM_SETTING_PPPOE_SETTING_NAME))
+				return TRUE;
+
+			g_assert (s_wired != NULL || s_infiniband != NULL);
+
+			setting_mac = s_wired ?
+				nm_setting_wired_get_mac_address (s_wired) :
+				nm_setting_infiniband_get_mac_address (s_infiniband);
+			if (!setting_mac)
+				return TRUE;
 		}
 	}
 
-	return ret;
+	return FALSE;
 }
 
 /* Search through the list of blacklisted MAC addresses in the config file. */
@@ -1691,17 +2123,24 @@ get_best_connections (NMConnectionProvider *provider,
 	NMSettings *self = NM_SETTINGS (provider);
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
 	GSList *sorted = NULL;
+	GHashTable *candidates;
 	GHashTableIter iter;
 	NMSettingsConnection *connection;
 	guint added = 0;
 	guint64 oldest = 0;
 
-	g_hash_table_iter_init (&iter, priv->connections);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &connection)) {
+	/* Only look at connections of the requested type */
+	if (ctype1) {
+		candidates = g_hash_table_lookup (priv->by_type, ctype1);
+		if (!candidates)
+			return NULL;
+	} else
+		candidates = priv->index;
+
+	g_hash_table_iter_init (&iter, candidates);
+	while (g_hash_table_iter_next (&iter, (gpointer) &connection, NULL)) {
 		guint64 cur_ts = 0;
 
-		if (ctype1 && !nm_connection_is_type (NM_CONNECTION (connection), ctype1))
-			continue;
 		if (ctype2 && !nm_connection_is_type (NM_CONNECTION (connection), ctype2))
 			continue;
 		if (func && !func (provider, NM_CONNECTION (connection), func_data))
@@ -1734,18 +2173,11 @@ static const GSList *
 get_connections (NMConnectionProvider *provider)
 {
 	static GSList *list = NULL;
-	NMSettings *self = NM_SETTINGS (provider);
-	GHashTableIter iter;
-	NMSettingsConnection *connection;
 
 	/* Lazily free the list with every call so we can keep it 'const' for callers */
 	g_slist_free (list);
-	list = NULL;
-
-	g_hash_table_iter_init (&iter, NM_SETTINGS_GET_PRIVATE (self)->connections);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &connection))
-		list = g_slist_prepend (list, connection);
-	return g_slist_reverse (list);
+	list = nm_settings_get_connections (NM_SETTINGS (provider));
+	return list;
 }
 
 /***************************************************************/
@@ -1794,6 +2226,15 @@ nm_settings_init (NMSettings *self)
 
 	priv->connections = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_object_unref);
 
+	priv->index = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) connection_index_free);
+	priv->by_uuid = index_new ();
+	priv->by_type = index_new ();
+	priv->by_iface = index_new ();
+	priv->by_mac = index_new ();
+	priv->by_ssid = index_new ();
+	priv->by_bssid = index_new ();
+	priv->ordered = g_sequence_new (NULL);
+
 	priv->session_monitor = nm_session_monitor_get ();
 
 	/* Hold a reference to the agent manager so it stays alive; the only
@@ -1817,6 +2258,9 @@ dispose (GObject *object)
 		nm_auth_chain_unref ((NMAuthChain *) iter->data);
 	g_slist_free (priv->auths);
 
+	/* Write out pending timestamp and seen-bssid changes */
+	nm_settings_connection_flush_databases ();
+
 	g_object_unref (priv->dbus_mgr);
 
 	g_object_unref (priv->session_monitor);
@@ -1831,6 +2275,14 @@ finalize (GObject *object)
 	NMSettings *self = NM_SETTINGS (object);
 	NMSettingsPrivate *priv = NM_SETTINGS_GET_PRIVATE (self);
 
+	g_sequence_free (priv->ordered);
+	g_hash_table_destroy (priv->by_uuid);
+	g_hash_table_destroy (priv->by_type);
+	g_hash_table_destroy (priv->by_iface);
+	g_hash_table_destroy (priv->by_mac);
+	g_hash_table_destroy (priv->by_ssid);
+	g_hash_table_destroy (priv->by_bssid);
+	g_hash_table_destroy (priv->index);
 	g_hash_table_destroy (priv->connections);
 
 	clear_unmanaged_specs (self);
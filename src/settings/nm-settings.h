@@ -105,6 +105,18 @@ void nm_settings_add_connection (NMSettings *self,
  */
 GSList *nm_settings_get_connections (NMSettings *settings);
 
+GSList *nm_settings_get_connections_by_type (NMSettings *settings,
+                                             const char *type);
+
+GSList *nm_settings_get_connections_by_mac (NMSettings *settings,
+                                            const GByteArray *mac);
+
+GSList *nm_settings_get_connections_by_ssid (NMSettings *settings,
+                                             const GByteArray *ssid);
+
+NMSettingsConnection *nm_settings_get_connection_by_seen_bssid (NMSettings *settings,
+                                                                const struct ether_addr *bssid);
+
 NMSettingsConnection *nm_settings_get_connection_by_path (NMSettings *settings,
                                                           const char *path);
 
@@ -101,14 +101,12 @@ nm_ifcfg_connection_new (const char *full_path,
                          GError **error,
                          gboolean *ignore_error)
 {
-	GObject *object;
-	NMIfcfgConnectionPrivate *priv;
 	NMConnection *tmp;
+	NMIfcfgConnection *connection;
 	char *unmanaged = NULL;
 	char *keyfile = NULL;
 	char *routefile = NULL;
 	char *route6file = NULL;
-	NMInotifyHelper *ih;
 
 	g_return_val_if_fail (full_path != NULL, NULL);
 
@@ -127,17 +125,45 @@ nm_ifcfg_connection_new (const char *full_path,
 			return NULL;
 	}
 
+	connection = nm_ifcfg_connection_new_parsed (full_path, tmp,
+	                                             unmanaged,
+	                                             keyfile,
+	                                             routefile,
+	                                             route6file,
+	                                             error);
+	g_object_unref (tmp);
+	return connection;
+}
+
+/* Like nm_ifcfg_connection_new() but with the results of an earlier
+ * connection_from_file(); takes ownership of the file names.
+ */
+NMIfcfgConnection *
+nm_ifcfg_connection_new_parsed (const char *full_path,
+                                NMConnection *parsed,
+                                char *unmanaged,
+                                char *keyfile,
+                                char *routefile,
+                                char *route6file,
+                                GError **error)
+{
+	GObject *object;
+	NMIfcfgConnectionPrivate *priv;
+	NMInotifyHelper *ih;
+
+	g_return_val_if_fail (full_path != NULL, NULL);
+	g_return_val_if_fail (parsed != NULL, NULL);
+
 	object = (GObject *) g_object_new (NM_TYPE_IFCFG_CONNECTION,
 	                                   NM_IFCFG_CONNECTION_UNMANAGED, unmanaged,
 	                                   NULL);
 	if (!object)
-		goto out;
+		goto error;
 
 	/* Update our settings with what was read from the file */
-	if (!nm_settings_connection_replace_settings (NM_SETTINGS_CONNECTION (object), tmp, error)) {
+	if (!nm_settings_connection_replace_settings (NM_SETTINGS_CONNECTION (object), parsed, error)) {
 		g_object_unref (object);
-		object = NULL;
-		goto out;
+		goto error;
 	}
 
 	priv = NM_IFCFG_CONNECTION_GET_PRIVATE (object);
@@ -157,9 +183,15 @@ nm_ifcfg_connection_new (const char *full_path,
 	priv->route6file = route6file;
 	priv->route6file_wd = nm_inotify_helper_add_watch (ih, route6file);
 
-out:
-	g_object_unref (tmp);
+	g_free (unmanaged);
 	return (NMIfcfgConnection *) object;
+
+error:
+	g_free (unmanaged);
+	g_free (keyfile);
+	g_free (routefile);
+	g_free (route6file);
+	return NULL;
 }
 
 const char *
@@ -50,6 +50,14 @@ NMIfcfgConnection *nm_ifcfg_connection_new (const char *filename,
                                             GError **error,
                                             gboolean *ignore_error);
 
+NMIfcfgConnection *nm_ifcfg_connection_new_parsed (const char *filename,
+                                                   NMConnection *parsed,
+                                                   char *unmanaged,
+                                                   char *keyfile,
+                                                   char *routefile,
+                                                   char *route6file,
+                                                   GError **error);
+
 const char *nm_ifcfg_connection_get_path (NMIfcfgConnection *self);
 
 const char *nm_ifcfg_connection_get_unmanaged_spec (NMIfcfgConnection *self);
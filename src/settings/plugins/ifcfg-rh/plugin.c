@@ -43,7 +43,9 @@
 #include "nm-dbus-glib-types.h"
 #include "plugin.h"
 #include "nm-system-config-interface.h"
+#include "nm-settings-utils.h"
 #include "nm-settings-error.h"
+#include "nm-connection-cache.h"
 
 #include "nm-ifcfg-connection.h"
 #include "nm-inotify-helper.h"
@@ -54,6 +56,12 @@
 #define DBUS_SERVICE_NAME "com.redhat.ifcfgrh1"
 #define DBUS_OBJECT_PATH "/com/redhat/ifcfgrh1"
 
+#define IFCFG_CACHE_FILE NMSTATEDIR "/ifcfg-rh.cache"
+#define NETWORK_FILE SYSCONFDIR "/sysconfig/network"
+
+/* How long to collect directory changes before processing them (ms) */
+#define DIR_CHANGE_DELAY 250
+
 static gboolean impl_ifcfgrh_get_ifcfg_details (SCPluginIfcfg *plugin,
                                                 const char *in_ifcfg,
                                                 const char **out_uuid,
@@ -62,9 +70,7 @@ static gboolean impl_ifcfgrh_get_ifcfg_details (SCPluginIfcfg *plugin,
 
 #include "nm-ifcfg-rh-glue.h"
 
-static void connection_new_or_changed (SCPluginIfcfg *plugin,
-                                       const char *path,
-                                       NMIfcfgConnection *existing);
+static void queue_change (SCPluginIfcfg *plugin, const char *path);
 
 static void system_config_interface_init (NMSystemConfigInterface *system_config_interface_class);
 
@@ -77,6 +83,7 @@ G_DEFINE_TYPE_EXTENDED (SCPluginIfcfg, sc_plugin_ifcfg, G_TYPE_OBJECT, 0,
 
 typedef struct {
 	GHashTable *connections;
+	NMConnectionCache *cache;
 
 	gulong ih_event_id;
 	int sc_network_wd;
@@ -86,6 +93,9 @@ typedef struct {
 
 	GFileMonitor *ifcfg_monitor;
 	guint ifcfg_monitor_id;
+	GHashTable *fingerprints;
+	GHashTable *pending;
+	guint pending_id;
 
 	DBusGConnection *bus;
 } SCPluginIfcfgPrivate;
@@ -108,13 +118,26 @@ connection_ifcfg_changed (NMIfcfgConnection *connection, gpointer user_data)
 	path = nm_ifcfg_connection_get_path (connection);
 	g_return_if_fail (path != NULL);
 
-	connection_new_or_changed (plugin, path, connection);
+	queue_change (plugin, path);
 }
 
+/* Result of reading one ifcfg file in a worker thread */
+typedef struct {
+	NMConnection *connection;
+	char *unmanaged;
+	char *keyfile;
+	char *routefile;
+	char *route6file;
+	GError *error;
+	gboolean ignore_error;
+	NMConnectionCacheStamp *stamp;  /* set if parsed from the files */
+} ParsedIfcfg;
+
 static NMIfcfgConnection *
 _internal_new_connection (SCPluginIfcfg *self,
                           const char *path,
                           NMConnection *source,
+                          ParsedIfcfg *parsed,
                           GError **error)
 {
 	SCPluginIfcfgPrivate *priv = SC_PLUGIN_IFCFG_GET_PRIVATE (self);
@@ -123,14 +146,33 @@ _internal_new_connection (SCPluginIfcfg *self,
 	GError *local = NULL;
 	gboolean ignore_error = FALSE;
 
-	if (!source) {
+	/* Connections read by read_connections() logged this from the worker */
+	if (!source && !parsed) {
 		PLUGIN_PRINT (IFCFG_PLUGIN_NAME, "parsing %s ... ", path);
 	}
 
-	connection = nm_ifcfg_connection_new (path, source, &local, &ignore_error);
+	if (parsed) {
+		/* Already read by read_connections(); the file names are handed over */
+		if (parsed->connection) {
+			connection = nm_ifcfg_connection_new_parsed (path, parsed->connection,
+			                                             parsed->unmanaged,
+			                                             parsed->keyfile,
+			                                             parsed->routefile,
+			                                             parsed->route6file,
+			                                             &local);
+			parsed->unmanaged = parsed->keyfile = NULL;
+			parsed->routefile = parsed->route6file = NULL;
+		} else {
+			connection = NULL;
+			local = parsed->error;
+			parsed->error = NULL;
+			ignore_error = parsed->ignore_error;
+		}
+	} else
+		connection = nm_ifcfg_connection_new (path, source, &local, &ignore_error);
 	if (!connection) {
 		if (!ignore_error) {
-			PLUGIN_PRINT (IFCFG_PLUGIN_NAME, "    error: %s",
+			PLUGIN_PRINT (IFCFG_PLUGIN_NAME, "    error reading %s: %s", path,
 			              (local && local->message) ? local->message : "(unknown)");
 		}
 		g_propagate_error (error, local);
@@ -143,7 +185,7 @@ _internal_new_connection (SCPluginIfcfg *self,
 	g_hash_table_insert (priv->connections,
 	                     (gpointer) nm_ifcfg_connection_get_path (connection),
 	                     connection);
-	PLUGIN_PRINT (IFCFG_PLUGIN_NAME, "    read connection '%s'", cid);
+	PLUGIN_PRINT (IFCFG_PLUGIN_NAME, "    read connection '%s' from %s", cid, path);
 
 	if (nm_ifcfg_connection_get_unmanaged_spec (connection)) {
 		PLUGIN_PRINT (IFCFG_PLUGIN_NAME, "Ignoring connection '%s' and its "
@@ -163,16 +205,121 @@ _internal_new_connection (SCPluginIfcfg *self,
 	return connection;
 }
 
+/* The cache keeps unset file names as empty strings */
+static char *
+cached_name (const char *name)
+{
+	return name[0] ? g_strdup (name) : NULL;
+}
+
+/* Stamps the ifcfg file and every file it may be read together with,
+ * before any of them are read.
+ */
+static NMConnectionCacheStamp *
+stamp_ifcfg (const char *path)
+{
+	NMConnectionCacheStamp *stamp;
+	char *deps[5];
+	guint i;
+
+	deps[0] = utils_get_keys_path (path);
+	deps[1] = utils_get_route_path (path);
+	deps[2] = utils_get_route6_path (path);
+	deps[3] = g_strdup (NETWORK_FILE);
+	deps[4] = NULL;
+
+	stamp = nm_connection_cache_stamp_new (path, (const char **) deps);
+
+	for (i = 0; deps[i]; i++)
+		g_free (deps[i]);
+	return stamp;
+}
+
+/* Runs in a worker thread */
+static gpointer
+parse_ifcfg (const char *path, gpointer user_data)
+{
+	NMConnectionCache *cache = user_data;
+	ParsedIfcfg *parsed = g_slice_new0 (ParsedIfcfg);
+	char **extra = NULL;
+
+	/* Logged here so that any warnings from the reader follow it */
+	PLUGIN_PRINT (IFCFG_PLUGIN_NAME, "parsing %s ... ", path);
+
+	parsed->connection = nm_connection_cache_lookup (cache, path, &extra);
+	if (parsed->connection && g_strv_length (extra) == 4) {
+		parsed->unmanaged = cached_name (extra[0]);
+		parsed->keyfile = cached_name (extra[1]);
+		parsed->routefile = cached_name (extra[2]);
+		parsed->route6file = cached_name (extra[3]);
+		g_strfreev (extra);
+		return parsed;
+	}
+	if (parsed->connection)
+		g_object_unref (parsed->connection);
+	g_strfreev (extra);
+
+	parsed->stamp = stamp_ifcfg (path);
+	parsed->connection = connection_from_file (path, NULL, NULL, NULL,
+	                                           &parsed->unmanaged,
+	                                           &parsed->keyfile,
+	                                           &parsed->routefile,
+	                                           &parsed->route6file,
+	                                           &parsed->error,
+	                                           &parsed->ignore_error);
+	return parsed;
+}
+
+static void
+parsed_ifcfg_free (ParsedIfcfg *parsed)
+{
+	if (parsed->connection)
+		g_object_unref (parsed->connection);
+	g_free (parsed->unmanaged);
+	g_free (parsed->keyfile);
+	g_free (parsed->routefile);
+	g_free (parsed->route6file);
+	g_clear_error (&parsed->error);
+	if (parsed->stamp)
+		nm_connection_cache_stamp_free (parsed->stamp);
+	g_slice_free (ParsedIfcfg, parsed);
+}
+
+static void
+cache_parsed (NMConnectionCache *cache, ParsedIfcfg *parsed)
+{
+	NMSettingConnection *s_con;
+	const char *extra[5];
+
+	/* iBFT connections also depend on the firmware, so they're never cached */
+	s_con = nm_connection_get_setting_connection (parsed->connection);
+	if (s_con && nm_setting_connection_get_read_only (s_con))
+		return;
+
+	extra[0] = parsed->unmanaged ? parsed->unmanaged : "";
+	extra[1] = parsed->keyfile ? parsed->keyfile : "";
+	extra[2] = parsed->routefile ? parsed->routefile : "";
+	extra[3] = parsed->route6file ? parsed->route6file : "";
+	extra[4] = NULL;
+
+	nm_connection_cache_add (cache, parsed->stamp, extra, parsed->connection);
+}
+
 static void
 read_connections (SCPluginIfcfg *plugin)
 {
+	SCPluginIfcfgPrivate *priv = SC_PLUGIN_IFCFG_GET_PRIVATE (plugin);
 	GDir *dir;
 	GError *err = NULL;
 
 	dir = g_dir_open (IFCFG_DIR, 0, &err);
 	if (dir) {
 		const char *item;
+		GPtrArray *paths;
+		gpointer *results;
+		guint i;
 
+		paths = g_ptr_array_new ();
 		while ((item = g_dir_read_name (dir))) {
 			char *full_path;
 
@@ -181,11 +328,37 @@ read_connections (SCPluginIfcfg *plugin)
 
 			full_path = g_build_filename (IFCFG_DIR, item, NULL);
 			if (utils_get_ifcfg_name (full_path, TRUE))
-				_internal_new_connection (plugin, full_path, NULL, NULL);
-			g_free (full_path);
+				g_ptr_array_add (paths, full_path);
+			else
+				g_free (full_path);
 		}
-
 		g_dir_close (dir);
+
+		/* Parse the files in parallel, unless they're unchanged since they
+		 * were cached, then create the connection objects here on the main
+		 * thread in directory order.
+		 */
+		if (!priv->cache)
+			priv->cache = nm_connection_cache_new (IFCFG_CACHE_FILE);
+		results = nm_settings_utils_parse_files ((const char **) paths->pdata, paths->len,
+		                                         parse_ifcfg, priv->cache);
+		for (i = 0; i < paths->len; i++) {
+			ParsedIfcfg *parsed = results[i];
+
+			if (parsed->connection && parsed->stamp)
+				cache_parsed (priv->cache, parsed);
+			_internal_new_connection (plugin, g_ptr_array_index (paths, i), NULL, parsed, NULL);
+			parsed_ifcfg_free (parsed);
+		}
+
+		g_free (results);
+		g_ptr_array_foreach (paths, (GFunc) g_free, NULL);
+		g_ptr_array_free (paths, TRUE);
+
+		if (!nm_connection_cache_write (priv->cache, &err)) {
+			PLUGIN_WARN (IFCFG_PLUGIN_NAME, "%s", err->message);
+			g_clear_error (&err);
+		}
 	} else {
 		PLUGIN_WARN (IFCFG_PLUGIN_NAME, "Can not read directory '%s': %s", IFCFG_DIR, err->message);
 		g_error_free (err);
@@ -243,7 +416,7 @@ connection_new_or_changed (SCPluginIfcfg *self,
 
 	if (!existing) {
 		/* Completely new connection */
-		new = _internal_new_connection (self, path, NULL, NULL);
+		new = _internal_new_connection (self, path, NULL, NULL, NULL);
 		if (new) {
 			if (nm_ifcfg_connection_get_unmanaged_spec (new)) {
 				g_signal_emit_by_name (self, NM_SYSTEM_CONFIG_INTERFACE_UNMANAGED_SPECS_CHANGED);
@@ -326,6 +499,62 @@ connection_new_or_changed (SCPluginIfcfg *self,
 	g_object_unref (new);
 }
 
+static gboolean
+process_pending (gpointer user_data)
+{
+	SCPluginIfcfg *plugin = SC_PLUGIN_IFCFG (user_data);
+	SCPluginIfcfgPrivate *priv = SC_PLUGIN_IFCFG_GET_PRIVATE (plugin);
+	GHashTable *pending = priv->pending;
+	GHashTableIter iter;
+	const char *name;
+	NMIfcfgConnection *connection;
+	GSList *changed = NULL, *elt;
+
+	priv->pending_id = 0;
+	priv->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	/* Only the current state of each ifcfg file matters, however many
+	 * events it and its keys and route files got.  Removals go first so
+	 * that a renamed file doesn't briefly show up twice.
+	 */
+	g_hash_table_iter_init (&iter, pending);
+	while (g_hash_table_iter_next (&iter, (gpointer) &name, NULL)) {
+		if (g_file_test (name, G_FILE_TEST_EXISTS)) {
+			changed = g_slist_prepend (changed, (gpointer) name);
+			continue;
+		}
+
+		connection = g_hash_table_lookup (priv->connections, name);
+		if (connection) {
+			PLUGIN_PRINT (IFCFG_PLUGIN_NAME, "removed %s.", name);
+			remove_connection (plugin, connection);
+		}
+	}
+
+	for (elt = changed; elt; elt = g_slist_next (elt)) {
+		name = elt->data;
+		connection = g_hash_table_lookup (priv->connections, name);
+		connection_new_or_changed (plugin, name, connection);
+	}
+
+	g_slist_free (changed);
+	g_hash_table_destroy (pending);
+	return FALSE;
+}
+
+/* Bulk changes generate many events, often several per connection; handle
+ * them together once things have settled.
+ */
+static void
+queue_change (SCPluginIfcfg *plugin, const char *path)
+{
+	SCPluginIfcfgPrivate *priv = SC_PLUGIN_IFCFG_GET_PRIVATE (plugin);
+
+	g_hash_table_insert (priv->pending, g_strdup (path), NULL);
+	if (!priv->pending_id)
+		priv->pending_id = g_timeout_add (DIR_CHANGE_DELAY, process_pending, plugin);
+}
+
 static void
 ifcfg_dir_changed (GFileMonitor *monitor,
                    GFile *file,
@@ -336,7 +565,15 @@ ifcfg_dir_changed (GFileMonitor *monitor,
 	SCPluginIfcfg *plugin = SC_PLUGIN_IFCFG (user_data);
 	SCPluginIfcfgPrivate *priv = SC_PLUGIN_IFCFG_GET_PRIVATE (plugin);
 	char *path, *name;
-	NMIfcfgConnection *connection;
+
+	switch (event_type) {
+	case G_FILE_MONITOR_EVENT_DELETED:
+	case G_FILE_MONITOR_EVENT_CREATED:
+	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+		break;
+	default:
+		return;
+	}
 
 	path = g_file_get_path (file);
 	if (utils_should_ignore_file (path, FALSE)) {
@@ -346,25 +583,17 @@ ifcfg_dir_changed (GFileMonitor *monitor,
 
 	/* Given any ifcfg, keys, or routes file, get the ifcfg file path */
 	name = utils_get_ifcfg_path (path);
-	g_free (path);
 	if (name) {
-		connection = g_hash_table_lookup (priv->connections, name);
-		switch (event_type) {
-		case G_FILE_MONITOR_EVENT_DELETED:
-			PLUGIN_PRINT (IFCFG_PLUGIN_NAME, "removed %s.", name);
-			if (connection)
-				remove_connection (plugin, connection);
-			break;
-		case G_FILE_MONITOR_EVENT_CREATED:
-		case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
-			/* Update or new */
-			connection_new_or_changed (plugin, name, connection);
-			break;
-		default:
-			break;
-		}
+		/* Changes to any of the connection's files make its cache entry stale */
+		if (priv->cache)
+			nm_connection_cache_remove (priv->cache, name);
+
+		/* Tools often rewrite files without actually changing them */
+		if (nm_settings_utils_file_changed (priv->fingerprints, path))
+			queue_change (plugin, name);
 		g_free (name);
 	}
+	g_free (path);
 }
 
 static void
@@ -375,6 +604,8 @@ setup_ifcfg_monitoring (SCPluginIfcfg *plugin)
 	GFileMonitor *monitor;
 
 	priv->connections = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_object_unref);
+	priv->fingerprints = nm_settings_utils_fingerprints_new ();
+	priv->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
 	file = g_file_new_for_path (IFCFG_DIR "/");
 	monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, NULL);
@@ -460,7 +691,7 @@ add_connection (NMSystemConfigInterface *config,
 
 	/* Write it out first, then add the connection to our internal list */
 	if (writer_new_connection (connection, IFCFG_DIR, &path, error)) {
-		added = _internal_new_connection (self, path, connection, error);
+		added = _internal_new_connection (self, path, connection, NULL, error);
 		g_free (path);
 	}
 	return (NMSettingsConnection *) added;
@@ -748,6 +979,11 @@ dispose (GObject *object)
 	if (priv->connections)
 		g_hash_table_destroy (priv->connections);
 
+	if (priv->cache) {
+		nm_connection_cache_free (priv->cache);
+		priv->cache = NULL;
+	}
+
 	if (priv->ifcfg_monitor) {
 		if (priv->ifcfg_monitor_id)
 			g_signal_handler_disconnect (priv->ifcfg_monitor, priv->ifcfg_monitor_id);
@@ -756,6 +992,19 @@ dispose (GObject *object)
 		g_object_unref (priv->ifcfg_monitor);
 	}
 
+	if (priv->pending_id) {
+		g_source_remove (priv->pending_id);
+		priv->pending_id = 0;
+	}
+	if (priv->pending) {
+		g_hash_table_destroy (priv->pending);
+		priv->pending = NULL;
+	}
+	if (priv->fingerprints) {
+		g_hash_table_destroy (priv->fingerprints);
+		priv->fingerprints = NULL;
+	}
+
 	G_OBJECT_CLASS (sc_plugin_ifcfg_parent_class)->dispose (object);
 }
 
@@ -38,6 +38,61 @@
 
 #include "shvar.h"
 
+/* The key of a "KEY=value" line, or NULL for comments and other lines */
+static char *
+line_get_key(const char *line)
+{
+    const char *eq = strchr(line, '=');
+
+    return eq ? g_strndup(line, eq - line) : NULL;
+}
+
+/* Point the index entry for <line>'s key at <link>, unless an earlier line
+   already sets that key; lookups always see the first line in the file. */
+static void
+index_add_line(shvarFile *s, GList *link)
+{
+    char *key = line_get_key(link->data);
+
+    if (!key)
+	return;
+
+    if (!g_hash_table_lookup(s->lineIndex, key))
+	g_hash_table_insert(s->lineIndex, key, link);
+    else
+	g_free(key);
+}
+
+/* Remove <link> from lineList, re-pointing the index at the next line for
+   the same key if there is one.  Frees the link and its line. */
+static void
+index_remove_line(shvarFile *s, GList *link)
+{
+    char *key = line_get_key(link->data);
+    GList *iter = link->next;
+
+    s->lineList = g_list_remove_link(s->lineList, link);
+
+    if (key && g_hash_table_lookup(s->lineIndex, key) == link) {
+	g_hash_table_remove(s->lineIndex, key);
+	/* <link> was the first line for <key>, so only later lines can
+	   still set it; duplicate keys are rare, so this walk is too */
+	for (; iter; iter = iter->next) {
+	    char *other = line_get_key(iter->data);
+
+	    if (other && !strcmp(other, key)) {
+		g_hash_table_insert(s->lineIndex, other, iter);
+		break;
+	    }
+	    g_free(other);
+	}
+    }
+    g_free(key);
+
+    g_free(link->data);
+    g_list_free_1(link);
+}
+
 /* Open the file <name>, returning a shvarFile on success and NULL on failure.
    Add a wrinkle to let the caller specify whether or not to create the file
    (actually, return a structure anyway) if it doesn't exist. */
@@ -48,6 +103,7 @@ svOpenFile(const char *name, gboolean create)
     int closefd = 0;
 
     s = g_malloc0(sizeof(shvarFile));
+    s->lineIndex = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
     s->fd = -1;
     if (create)
@@ -71,8 +127,13 @@ svOpenFile(const char *name, gboolean create)
 
 	/* we'd use g_strsplit() here, but we want a list, not an array */
 	for(p = s->arena; (q = strchr(p, '\n')) != NULL; p = q + 1) {
-		s->lineList = g_list_append(s->lineList, g_strndup(p, q - p));
+		s->lineList = g_list_prepend(s->lineList, g_strndup(p, q - p));
 	}
+	s->lineList = g_list_reverse(s->lineList);
+
+	/* index the lines so lookups don't have to scan the whole file */
+	for (s->current = s->lineList; s->current; s->current = s->current->next)
+	    index_add_line(s, s->current);
 
 	/* closefd is set if we opened the file read-only, so go ahead and
 	   close it, because we can't write to it anyway */
@@ -90,6 +151,7 @@ svOpenFile(const char *name, gboolean create)
 
 bail:
     if (s->fd != -1) close(s->fd);
+    g_hash_table_destroy (s->lineIndex);
     g_free (s->arena);
     g_free (s->fileName);
     g_free (s);
@@ -190,27 +252,17 @@ svGetValue(shvarFile *s, const char *key, gboolean verbatim)
 {
     char *value = NULL;
     char *line;
-    char *keyString;
-    int len;
 
     g_assert(s);
     g_assert(key);
 
-    keyString = g_malloc0(strlen(key) + 2);
-    strcpy(keyString, key);
-    keyString[strlen(key)] = '=';
-    len = strlen(keyString);
-
-    for (s->current = s->lineList; s->current; s->current = s->current->next) {
+    s->current = g_hash_table_lookup(s->lineIndex, key);
+    if (s->current) {
 	line = s->current->data;
-	if (!strncmp(keyString, line, len)) {
-	    value = g_strdup(line + len);
-	    if (!verbatim)
-	      svUnescape(value);
-	    break;
-	}
+	value = g_strdup(line + strlen(key) + 1);
+	if (!verbatim)
+	  svUnescape(value);
     }
-    g_free(keyString);
 
     if (value) {
 	if (value[0]) {
@@ -275,6 +327,21 @@ svTrueValue(shvarFile *s, const char *key, int def)
  * specific file passed on the command line.
  *
  */
+static void
+svAppendLine(shvarFile *s, char *line)
+{
+    s->lineList = g_list_append(s->lineList, line);
+    index_add_line(s, g_list_last(s->lineList));
+}
+
+/* <line> sets the same key as the current line, so the index stays valid */
+static void
+svReplaceLine(shvarFile *s, char *line)
+{
+    g_free(s->current->data);
+    s->current->data = line;
+}
+
 void
 svSetValue(shvarFile *s, const char *key, const char *value, gboolean verbatim)
 {
@@ -297,14 +364,14 @@ svSetValue(shvarFile *s, const char *key, const char *value, gboolean verbatim)
 	/* delete value somehow */
 	if (val2) {
 	    /* change/append line to get key= */
-	    if (s->current) s->current->data = keyValue;
-	    else s->lineList = g_list_append(s->lineList, keyValue);
+	    if (s->current) svReplaceLine(s, keyValue);
+	    else svAppendLine(s, keyValue);
 	    s->modified = 1;
 	    goto end;
 	} else if (val1) {
 	    /* delete line */
-	    s->lineList = g_list_remove_link(s->lineList, s->current);
-	    g_list_free_1(s->current);
+	    index_remove_line(s, s->current);
+	    s->current = NULL;
 	    s->modified = 1;
 	}
 	goto bail; /* do not need keyValue */
@@ -313,7 +380,7 @@ svSetValue(shvarFile *s, const char *key, const char *value, gboolean verbatim)
     if (!val1) {
 	if (val2 && !strcmp(val2, newval)) goto end;
 	/* append line */
-	s->lineList = g_list_append(s->lineList, keyValue);
+	svAppendLine(s, keyValue);
 	s->modified = 1;
 	goto end;
     }
@@ -324,14 +391,14 @@ svSetValue(shvarFile *s, const char *key, const char *value, gboolean verbatim)
     /* At this point, val1 && val1 != value */
     if (val2 && !strcmp(val2, newval)) {
 	/* delete line */
-	s->lineList = g_list_remove_link(s->lineList, s->current);
-	g_list_free_1(s->current);
+	index_remove_line(s, s->current);
+	s->current = NULL;
 	s->modified = 1;
 	goto bail; /* do not need keyValue */
     } else {
 	/* change line */
-	if (s->current) s->current->data = keyValue;
-	else s->lineList = g_list_append(s->lineList, keyValue);
+	if (s->current) svReplaceLine(s, keyValue);
+	else svAppendLine(s, keyValue);
 	s->modified = 1;
     }
 
@@ -391,6 +458,7 @@ svCloseFile(shvarFile *s)
 
     if (s->fd != -1) close(s->fd);
 
+    g_hash_table_destroy(s->lineIndex);
     g_free(s->arena);
     g_free(s->fileName);
     g_list_foreach (s->lineList, (GFunc) g_free, NULL);
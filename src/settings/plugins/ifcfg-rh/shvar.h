@@ -44,6 +44,8 @@ struct _shvarFile {
 	GList		*lineList;	/* read-only */
 	GList		*current;	/* set implicitly or explicitly,
 					   points to element of lineList */
+	GHashTable	*lineIndex;	/* ignore; key -> first element of
+					   lineList setting that key */
 	shvarFile	*parent;	/* set explicitly */
 	int		modified;	/* ignore */
 };
@@ -0,0 +1,173 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager system settings service - ifcfg-rh plugin
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ */
+
+/* Startup benchmark: writes a directory of synthetic ifcfg profiles (with
+ * route files) and times reading all of them, like the plugin does when
+ * NetworkManager starts.  Usage: test-ifcfg-rh-benchmark [NUM_PROFILES]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <nm-utils.h>
+
+#include "nm-test-helpers.h"
+
+#include "common.h"
+#include "reader.h"
+
+#define DEFAULT_PROFILES 2000
+
+static char *
+write_profile (const char *dir, guint i)
+{
+	char *ifcfg, *route, *uuid, *contents;
+	guint a = (i >> 8) & 0xFF, b = i & 0xFF;
+
+	uuid = nm_utils_uuid_generate ();
+	ifcfg = g_strdup_printf ("%s/ifcfg-bench%u", dir, i);
+	contents = g_strdup_printf (
+		"# Synthetic profile %u\n"
+		"TYPE=Ethernet\n"
+		"DEVICE=eth%u\n"
+		"HWADDR=00:16:41:%02x:%02x:%02x\n"
+		"BOOTPROTO=none\n"
+		"IPADDR=10.%u.%u.2\n"
+		"PREFIX=24\n"
+		"IPADDR1=10.%u.%u.3\n"
+		"PREFIX1=24\n"
+		"GATEWAY=10.%u.%u.1\n"
+		"DNS1=10.%u.%u.53\n"
+		"DNS2=192.0.2.53\n"
+		"DOMAIN=\"tenant%u.example.com example.com\"\n"
+		"DEFROUTE=no\n"
+		"PEERDNS=yes\n"
+		"PEERROUTES=yes\n"
+		"IPV4_FAILURE_FATAL=no\n"
+		"IPV6INIT=yes\n"
+		"IPV6_AUTOCONF=yes\n"
+		"IPV6_DEFROUTE=no\n"
+		"IPV6_FAILURE_FATAL=no\n"
+		"MTU=1500\n"
+		"ONBOOT=no\n"
+		"NAME=\"bench %u\"\n"
+		"UUID=%s\n",
+		i, i, (i >> 16) & 0xFF, a, b,
+		a, b, a, b, a, b, a, b, i, i, uuid);
+	ASSERT (g_file_set_contents (ifcfg, contents, -1, NULL),
+	        "ifcfg-rh-benchmark", "failed to write %s", ifcfg);
+	g_free (contents);
+	g_free (uuid);
+
+	route = g_strdup_printf ("%s/route-bench%u", dir, i);
+	contents = g_strdup_printf (
+		"ADDRESS0=172.16.%u.0\n"
+		"NETMASK0=255.255.255.0\n"
+		"GATEWAY0=10.%u.%u.1\n"
+		"METRIC0=10\n"
+		"ADDRESS1=172.17.%u.0\n"
+		"NETMASK1=255.255.255.0\n"
+		"GATEWAY1=10.%u.%u.1\n",
+		b, a, b, b, a, b);
+	ASSERT (g_file_set_contents (route, contents, -1, NULL),
+	        "ifcfg-rh-benchmark", "failed to write %s", route);
+	g_free (contents);
+	g_free (route);
+
+	return ifcfg;
+}
+
+static void
+remove_file (const char *dir, const char *prefix, guint i)
+{
+	char *path;
+
+	path = g_strdup_printf ("%s/%s-bench%u", dir, prefix, i);
+	unlink (path);
+	g_free (path);
+}
+
+int main (int argc, char **argv)
+{
+	GError *error = NULL;
+	GPtrArray *files;
+	GTimer *timer;
+	char *base, *dir;
+	guint num = DEFAULT_PROFILES, i;
+
+	g_type_init ();
+
+	if (!nm_utils_init (&error))
+		FAIL ("nm-utils-init", "failed to initialize libnm-util: %s", error->message);
+
+	if (argc > 1)
+		num = strtoul (argv[1], NULL, 10);
+
+	dir = g_strdup (TEST_SCRATCH_DIR "/benchmark-XXXXXX");
+	ASSERT (mkdtemp (dir) != NULL,
+	        "ifcfg-rh-benchmark", "failed to create scratch directory");
+
+	files = g_ptr_array_sized_new (num);
+	for (i = 0; i < num; i++)
+		g_ptr_array_add (files, write_profile (dir, i));
+
+	timer = g_timer_new ();
+	for (i = 0; i < files->len; i++) {
+		const char *ifcfg = g_ptr_array_index (files, i);
+		NMConnection *connection;
+		char *unmanaged = NULL, *keyfile = NULL, *routefile = NULL, *route6file = NULL;
+		gboolean ignore_error = FALSE;
+
+		connection = connection_from_file (ifcfg, NULL, NULL, NULL,
+		                                   &unmanaged, &keyfile, &routefile, &route6file,
+		                                   &error, &ignore_error);
+		ASSERT (connection != NULL,
+		        "ifcfg-rh-benchmark", "failed to read %s: %s", ifcfg, error->message);
+
+		g_object_unref (connection);
+		g_free (unmanaged);
+		g_free (keyfile);
+		g_free (routefile);
+		g_free (route6file);
+	}
+	g_timer_stop (timer);
+
+	base = g_path_get_basename (argv[0]);
+	fprintf (stdout, "%s: read %u profiles in %.3f s (%.1f us/profile)\n",
+	         base, num, g_timer_elapsed (timer, NULL),
+	         num ? g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC / num : 0.0);
+
+	for (i = 0; i < num; i++) {
+		remove_file (dir, "ifcfg", i);
+		remove_file (dir, "route", i);
+	}
+	rmdir (dir);
+
+	g_timer_destroy (timer);
+	g_ptr_array_foreach (files, (GFunc) g_free, NULL);
+	g_ptr_array_free (files, TRUE);
+	g_free (dir);
+
+	fprintf (stdout, "%s: SUCCESS\n", base);
+	g_free (base);
+	return 0;
+}
@@ -27,6 +27,7 @@
 
 #include "common.h"
 #include "utils.h"
+#include "shvar.h"
 
 
 static void
@@ -114,6 +115,72 @@ test_ignored (const char *desc, const char *path, gboolean expected_ignored)
 	ASSERT (result == expected_ignored, desc, "unexpected ignore result for path '%s'", path);
 }
 
+static void
+test_shvar_index (void)
+{
+	const char *contents =
+		"# comment with KEY=ignored\n"
+		"KEY=first\n"
+		"OTHER=\"quoted value\"\n"
+		"KEY=second\n"
+		"EMPTY=\n";
+	const char *expected =
+		"# comment with KEY=ignored\n"
+		"OTHER=changed\n"
+		"KEY=second\n"
+		"EMPTY=\n"
+		"NEW=added\n";
+	char *path = NULL, *written = NULL, *value;
+	shvarFile *f;
+	int fd;
+
+	fd = g_file_open_tmp ("shvar-test-XXXXXX", &path, NULL);
+	ASSERT (fd >= 0, "shvar-index", "failed to create temporary file");
+	close (fd);
+	ASSERT (g_file_set_contents (path, contents, -1, NULL),
+	        "shvar-index", "failed to write %s", path);
+
+	f = svCreateFile (path);
+	ASSERT (f != NULL, "shvar-index", "failed to open %s", path);
+
+	/* The first line setting a key wins */
+	value = svGetValue (f, "KEY", FALSE);
+	ASSERT (value && !strcmp (value, "first"), "shvar-index", "unexpected KEY '%s'", value);
+	g_free (value);
+
+	value = svGetValue (f, "OTHER", FALSE);
+	ASSERT (value && !strcmp (value, "quoted value"), "shvar-index", "unexpected OTHER '%s'", value);
+	g_free (value);
+
+	ASSERT (svGetValue (f, "EMPTY", FALSE) == NULL, "shvar-index", "unexpected EMPTY value");
+	ASSERT (svGetValue (f, "comment", FALSE) == NULL, "shvar-index", "comment parsed as a key");
+	ASSERT (svGetValue (f, "MISSING", FALSE) == NULL, "shvar-index", "unexpected MISSING value");
+
+	/* Deleting the first KEY line uncovers the second one */
+	svSetValue (f, "KEY", NULL, FALSE);
+	value = svGetValue (f, "KEY", FALSE);
+	ASSERT (value && !strcmp (value, "second"), "shvar-index", "unexpected KEY '%s' after delete", value);
+	g_free (value);
+
+	svSetValue (f, "OTHER", "changed", FALSE);
+	svSetValue (f, "NEW", "added", FALSE);
+	value = svGetValue (f, "NEW", FALSE);
+	ASSERT (value && !strcmp (value, "added"), "shvar-index", "unexpected NEW '%s'", value);
+	g_free (value);
+
+	/* Line order is preserved when writing back */
+	ASSERT (svWriteFile (f, 0644) == 0, "shvar-index", "failed to write %s", path);
+	svCloseFile (f);
+
+	ASSERT (g_file_get_contents (path, &written, NULL, NULL),
+	        "shvar-index", "failed to read back %s", path);
+	ASSERT (!strcmp (written, expected), "shvar-index", "unexpected contents:\n%s", written);
+
+	unlink (path);
+	g_free (written);
+	g_free (path);
+}
+
 int main (int argc, char **argv)
 {
 	char *base;
@@ -159,6 +226,8 @@ int main (int argc, char **argv)
 	test_ignored ("ignored-augnew", "ifcfg-FooBar" AUGNEW_TAG, TRUE);
 	test_ignored ("ignored-augtmp", "ifcfg-FooBar" AUGTMP_TAG, TRUE);
 
+	test_shvar_index ();
+
 	base = g_path_get_basename (argv[0]);
 	fprintf (stdout, "%s: SUCCESS\n", base);
 	g_free (base);
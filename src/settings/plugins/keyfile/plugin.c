@@ -38,10 +38,18 @@
 #include "plugin.h"
 #include "nm-system-config-interface.h"
 #include "nm-keyfile-connection.h"
+#include "nm-settings-utils.h"
+#include "nm-connection-cache.h"
+#include "reader.h"
 #include "writer.h"
 #include "common.h"
 #include "utils.h"
 
+#define KEYFILE_CACHE_FILE NMSTATEDIR "/keyfile.cache"
+
+/* How long to collect directory changes before processing them (ms) */
+#define DIR_CHANGE_DELAY 250
+
 static char *plugin_get_hostname (SCPluginKeyfile *plugin);
 static void system_config_interface_init (NMSystemConfigInterface *system_config_interface_class);
 
@@ -53,9 +61,14 @@ G_DEFINE_TYPE_EXTENDED (SCPluginKeyfile, sc_plugin_keyfile, G_TYPE_OBJECT, 0,
 
 typedef struct {
 	GHashTable *hash;
+	GHashTable *uuids;
+	NMConnectionCache *cache;
 
 	GFileMonitor *monitor;
 	guint monitor_id;
+	GHashTable *fingerprints;
+	GHashTable *pending;
+	guint pending_id;
 
 	char *conf_file;
 	GFileMonitor *conf_file_monitor;
@@ -66,34 +79,113 @@ typedef struct {
 	gboolean disposed;
 } SCPluginKeyfilePrivate;
 
+#define INDEXED_UUID_TAG "keyfile-indexed-uuid"
+
+static void
+uuid_index_remove (SCPluginKeyfile *self, NMKeyfileConnection *connection)
+{
+	SCPluginKeyfilePrivate *priv = SC_PLUGIN_KEYFILE_GET_PRIVATE (self);
+	const char *uuid;
+
+	uuid = g_object_get_data (G_OBJECT (connection), INDEXED_UUID_TAG);
+	if (uuid && g_hash_table_lookup (priv->uuids, uuid) == connection)
+		g_hash_table_remove (priv->uuids, uuid);
+	g_object_set_data (G_OBJECT (connection), INDEXED_UUID_TAG, NULL);
+}
+
+static void
+uuid_index_add (SCPluginKeyfile *self, NMKeyfileConnection *connection)
+{
+	SCPluginKeyfilePrivate *priv = SC_PLUGIN_KEYFILE_GET_PRIVATE (self);
+	const char *uuid;
+
+	uuid_index_remove (self, connection);
+
+	uuid = nm_connection_get_uuid (NM_CONNECTION (connection));
+	if (uuid) {
+		g_hash_table_insert (priv->uuids, g_strdup (uuid), connection);
+		g_object_set_data_full (G_OBJECT (connection), INDEXED_UUID_TAG, g_strdup (uuid), g_free);
+	}
+}
+
+/* Every change to a connection's settings, whether it came from the file
+ * or from D-Bus, ends up here; the UUID may have changed.
+ */
+static void
+connection_updated (NMKeyfileConnection *connection, gpointer user_data)
+{
+	SCPluginKeyfile *self = SC_PLUGIN_KEYFILE (user_data);
+
+	if (SC_PLUGIN_KEYFILE_GET_PRIVATE (self)->uuids)
+		uuid_index_add (self, connection);
+}
+
+static void
+track_connection (SCPluginKeyfile *self, NMKeyfileConnection *connection)
+{
+	SCPluginKeyfilePrivate *priv = SC_PLUGIN_KEYFILE_GET_PRIVATE (self);
+
+	g_hash_table_insert (priv->hash,
+	                     (gpointer) nm_keyfile_connection_get_path (connection),
+	                     connection);
+	uuid_index_add (self, connection);
+	g_signal_connect (connection, NM_SETTINGS_CONNECTION_UPDATED,
+	                  G_CALLBACK (connection_updated), self);
+}
+
 static NMSettingsConnection *
 _internal_new_connection (SCPluginKeyfile *self,
                           const char *full_path,
                           NMConnection *source,
                           GError **error)
 {
-	SCPluginKeyfilePrivate *priv = SC_PLUGIN_KEYFILE_GET_PRIVATE (self);
 	NMKeyfileConnection *connection;
 
 	g_return_val_if_fail (full_path != NULL, NULL);
 
 	connection = nm_keyfile_connection_new (full_path, source, error);
-	if (connection) {
-		g_hash_table_insert (priv->hash,
-		                     (gpointer) nm_keyfile_connection_get_path (connection),
-		                     connection);
-	}
+	if (connection)
+		track_connection (self, connection);
 
 	return (NMSettingsConnection *) connection;
 }
 
+typedef struct {
+	NMConnection *connection;
+	NMConnectionCacheStamp *stamp;  /* set if parsed from the file */
+	GError *error;
+} ParsedKeyfile;
+
+/* Runs in a worker thread */
+static gpointer
+parse_keyfile (const char *path, gpointer user_data)
+{
+	NMConnectionCache *cache = user_data;
+	ParsedKeyfile *parsed = g_slice_new0 (ParsedKeyfile);
+
+	/* Logged here so that any warnings from the reader follow it */
+	PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "parsing %s ... ", path);
+
+	parsed->connection = nm_connection_cache_lookup (cache, path, NULL);
+	if (!parsed->connection) {
+		/* Stamp the file first, so changes made while parsing aren't missed */
+		parsed->stamp = nm_connection_cache_stamp_new (path, NULL);
+		parsed->connection = nm_keyfile_plugin_connection_from_file (path, &parsed->error);
+	}
+	return parsed;
+}
+
 static void
 read_connections (NMSystemConfigInterface *config)
 {
 	SCPluginKeyfile *self = SC_PLUGIN_KEYFILE (config);
+	SCPluginKeyfilePrivate *priv = SC_PLUGIN_KEYFILE_GET_PRIVATE (self);
 	GDir *dir;
 	GError *error = NULL;
 	const char *item;
+	GPtrArray *paths;
+	gpointer *results;
+	guint i;
 
 	dir = g_dir_open (KEYFILE_DIR, 0, &error);
 	if (!dir) {
@@ -105,28 +197,59 @@ read_connections (NMSystemConfigInterface *config)
 		return;
 	}
 
+	paths = g_ptr_array_new ();
 	while ((item = g_dir_read_name (dir))) {
-		NMSettingsConnection *connection;
-		char *full_path;
-
 		if (nm_keyfile_plugin_utils_should_ignore_file (item))
 			continue;
+		g_ptr_array_add (paths, g_build_filename (KEYFILE_DIR, item, NULL));
+	}
+	g_dir_close (dir);
 
-		full_path = g_build_filename (KEYFILE_DIR, item, NULL);
-		PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "parsing %s ... ", item);
+	/* Parse the files in parallel, unless they're unchanged since they were
+	 * cached; the connection objects themselves are created here on the main
+	 * thread, in directory order.
+	 */
+	if (!priv->cache)
+		priv->cache = nm_connection_cache_new (KEYFILE_CACHE_FILE);
+	results = nm_settings_utils_parse_files ((const char **) paths->pdata, paths->len,
+	                                         parse_keyfile, priv->cache);
+
+	for (i = 0; i < paths->len; i++) {
+		const char *full_path = g_ptr_array_index (paths, i);
+		ParsedKeyfile *parsed = results[i];
+		NMSettingsConnection *connection = NULL;
+
+		if (parsed->connection) {
+			connection = _internal_new_connection (self, full_path, parsed->connection, &error);
+			if (connection && parsed->stamp)
+				nm_connection_cache_add (priv->cache, parsed->stamp, NULL, parsed->connection);
+			g_object_unref (parsed->connection);
+		} else
+			error = parsed->error;
 
-		connection = _internal_new_connection (self, full_path, NULL, &error);
 		if (connection) {
-			PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "    read connection '%s'",
-			              nm_connection_get_id (NM_CONNECTION (connection)));
+			PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "    read connection '%s' from %s",
+			              nm_connection_get_id (NM_CONNECTION (connection)),
+			              full_path);
 		} else {
-			PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "    error: %s",
+			PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "    error reading %s: %s",
+			              full_path,
 				          (error && error->message) ? error->message : "(unknown)");
 		}
 		g_clear_error (&error);
-		g_free (full_path);
+		if (parsed->stamp)
+			nm_connection_cache_stamp_free (parsed->stamp);
+		g_slice_free (ParsedKeyfile, parsed);
+	}
+
+	g_free (results);
+	g_ptr_array_foreach (paths, (GFunc) g_free, NULL);
+	g_ptr_array_free (paths, TRUE);
+
+	if (!nm_connection_cache_write (priv->cache, &error)) {
+		PLUGIN_WARN (KEYFILE_PLUGIN_NAME, "%s", error->message);
+		g_clear_error (&error);
 	}
-	g_dir_close (dir);
 }
 
 static void
@@ -163,6 +286,9 @@ remove_connection (SCPluginKeyfile *self,
 	g_return_if_fail (connection != NULL);
 	g_return_if_fail (name != NULL);
 
+	g_signal_handlers_disconnect_by_func (connection, connection_updated, self);
+	uuid_index_remove (self, connection);
+
 	/* Removing from the hash table should drop the last reference */
 	g_object_ref (connection);
 	g_hash_table_remove (SC_PLUGIN_KEYFILE_GET_PRIVATE (self)->hash, name);
@@ -172,21 +298,133 @@ remove_connection (SCPluginKeyfile *self,
 
 static NMKeyfileConnection *
 find_by_uuid (SCPluginKeyfile *self, const char *uuid)
+{
+	g_return_val_if_fail (uuid != NULL, NULL);
+
+	return g_hash_table_lookup (SC_PLUGIN_KEYFILE_GET_PRIVATE (self)->uuids, uuid);
+}
+
+static void
+file_changed (SCPluginKeyfile *self, const char *full_path)
 {
 	SCPluginKeyfilePrivate *priv = SC_PLUGIN_KEYFILE_GET_PRIVATE (self);
-	GHashTableIter iter;
-	gpointer data = NULL;
+	NMKeyfileConnection *connection;
+	GError *error = NULL;
 
-	g_return_val_if_fail (uuid != NULL, NULL);
+	connection = g_hash_table_lookup (priv->hash, full_path);
+	if (connection) {
+		/* Update */
+		NMKeyfileConnection *tmp;
+
+		tmp = nm_keyfile_connection_new (full_path, NULL, &error);
+		if (tmp) {
+			if (!nm_connection_compare (NM_CONNECTION (connection),
+			                            NM_CONNECTION (tmp),
+			                            NM_SETTING_COMPARE_FLAG_IGNORE_AGENT_OWNED_SECRETS |
+			                              NM_SETTING_COMPARE_FLAG_IGNORE_NOT_SAVED_SECRETS)) {
+				PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "updating %s", full_path);
+				update_connection_settings (connection, tmp);
+			}
+			g_object_unref (tmp);
+		} else {
+			/* Error; remove the connection */
+			PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "    error: %s",
+			              (error && error->message) ? error->message : "(unknown)");
+			g_clear_error (&error);
+			remove_connection (self, connection, full_path);
+		}
+		return;
+	}
 
-	g_hash_table_iter_init (&iter, priv->hash);
-	while (g_hash_table_iter_next (&iter, NULL, &data)) {
-		NMConnection *candidate = NM_CONNECTION (data);
+	PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "updating %s", full_path);
+
+	/* New */
+	connection = nm_keyfile_connection_new (full_path, NULL, &error);
+	if (connection) {
+		NMKeyfileConnection *found = NULL;
+
+		/* Connection renames will show up as different files but with
+		 * the same UUID.  Try to find the original connection.
+		 * A connection rename is treated just like an update except
+		 * there's a bit more housekeeping with the hash table.
+		 */
+		found = find_by_uuid (self, nm_connection_get_uuid (NM_CONNECTION (connection)));
+		if (found) {
+			const char *old_path = nm_keyfile_connection_get_path (found);
+
+			/* Removing from the hash table should drop the last reference,
+			 * but of course we want to keep the connection around.
+			 */
+			g_object_ref (found);
+			g_hash_table_remove (priv->hash, old_path);
+
+			/* Updating settings should update the NMKeyfileConnection's
+			 * filename property too.
+			 */
+			update_connection_settings (found, connection);
+			/* However, when connections are the same and only the filename changed
+			 * we need to update the path manually (commit_changes() is not called.
+			 */
+			nm_keyfile_connection_set_path (found, full_path);
+
+			/* Re-insert the connection back into the hash with the new filename */
+			g_hash_table_insert (priv->hash,
+			                     (gpointer) nm_keyfile_connection_get_path (found),
+			                     found);
+
+			/* Get rid of the temporary connection */
+			g_object_unref (connection);
+		} else {
+			track_connection (self, connection);
+			g_signal_emit_by_name (self, NM_SYSTEM_CONFIG_INTERFACE_CONNECTION_ADDED, connection);
+		}
+	} else {
+		PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "    error: %s",
+		              (error && error->message) ? error->message : "(unknown)");
+		g_clear_error (&error);
+	}
+}
+
+static gboolean
+process_pending (gpointer user_data)
+{
+	SCPluginKeyfile *self = SC_PLUGIN_KEYFILE (user_data);
+	SCPluginKeyfilePrivate *priv = SC_PLUGIN_KEYFILE_GET_PRIVATE (self);
+	GHashTable *pending = priv->pending;
+	GHashTableIter iter;
+	const char *full_path;
+	GSList *removed = NULL, *elt;
+
+	priv->pending_id = 0;
+	priv->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	/* Only the current state of each file matters, however many events it
+	 * got.  New and changed files go first so that renames, which show up
+	 * as a new file and a deleted one in either order, find the original
+	 * connection.
+	 */
+	g_hash_table_iter_init (&iter, pending);
+	while (g_hash_table_iter_next (&iter, (gpointer) &full_path, NULL)) {
+		if (g_file_test (full_path, G_FILE_TEST_EXISTS))
+			file_changed (self, full_path);
+		else
+			removed = g_slist_prepend (removed, (gpointer) full_path);
+	}
+
+	for (elt = removed; elt; elt = g_slist_next (elt)) {
+		NMKeyfileConnection *connection;
 
-		if (strcmp (uuid, nm_connection_get_uuid (candidate)) == 0)
-			return NM_KEYFILE_CONNECTION (candidate);
+		full_path = elt->data;
+		connection = g_hash_table_lookup (priv->hash, full_path);
+		if (connection) {
+			PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "removed %s.", full_path);
+			remove_connection (self, connection, full_path);
+		}
 	}
-	return NULL;
+
+	g_slist_free (removed);
+	g_hash_table_destroy (pending);
+	return FALSE;
 }
 
 static void
@@ -196,12 +434,18 @@ dir_changed (GFileMonitor *monitor,
              GFileMonitorEvent event_type,
              gpointer user_data)
 {
-	NMSystemConfigInterface *config = NM_SYSTEM_CONFIG_INTERFACE (user_data);
-	SCPluginKeyfile *self = SC_PLUGIN_KEYFILE (config);
+	SCPluginKeyfile *self = SC_PLUGIN_KEYFILE (user_data);
 	SCPluginKeyfilePrivate *priv = SC_PLUGIN_KEYFILE_GET_PRIVATE (self);
 	char *full_path;
-	NMKeyfileConnection *connection;
-	GError *error = NULL;
+
+	switch (event_type) {
+	case G_FILE_MONITOR_EVENT_DELETED:
+	case G_FILE_MONITOR_EVENT_CREATED:
+	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+		break;
+	default:
+		return;
+	}
 
 	full_path = g_file_get_path (file);
 	if (nm_keyfile_plugin_utils_should_ignore_file (full_path)) {
@@ -209,95 +453,22 @@ dir_changed (GFileMonitor *monitor,
 		return;
 	}
 
-	connection = g_hash_table_lookup (priv->hash, full_path);
+	/* Whatever happened to the file, its cache entry is stale now */
+	if (priv->cache)
+		nm_connection_cache_remove (priv->cache, full_path);
 
-	switch (event_type) {
-	case G_FILE_MONITOR_EVENT_DELETED:
-		if (connection) {
-			PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "removed %s.", full_path);
-			remove_connection (SC_PLUGIN_KEYFILE (config), connection, full_path);
-		}
-		break;
-	case G_FILE_MONITOR_EVENT_CREATED:
-	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
-		if (connection) {
-			/* Update */
-			NMKeyfileConnection *tmp;
-
-			tmp = nm_keyfile_connection_new (full_path, NULL, &error);
-			if (tmp) {
-				if (!nm_connection_compare (NM_CONNECTION (connection),
-				                            NM_CONNECTION (tmp),
-				                            NM_SETTING_COMPARE_FLAG_IGNORE_AGENT_OWNED_SECRETS |
-				                              NM_SETTING_COMPARE_FLAG_IGNORE_NOT_SAVED_SECRETS)) {
-					PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "updating %s", full_path);
-					update_connection_settings (connection, tmp);
-				}
-				g_object_unref (tmp);
-			} else {
-				/* Error; remove the connection */
-				PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "    error: %s",
-						      (error && error->message) ? error->message : "(unknown)");
-				g_clear_error (&error);
-				remove_connection (SC_PLUGIN_KEYFILE (config), connection, full_path);
-			}
-		} else {
-			PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "updating %s", full_path);
-
-			/* New */
-			connection = nm_keyfile_connection_new (full_path, NULL, &error);
-			if (connection) {
-				NMKeyfileConnection *found = NULL;
-
-				/* Connection renames will show up as different files but with
-				 * the same UUID.  Try to find the original connection.
-				 * A connection rename is treated just like an update except
-				 * there's a bit more housekeeping with the hash table.
-				 */
-				found = find_by_uuid (self, nm_connection_get_uuid (NM_CONNECTION (connection)));
-				if (found) {
-					const char *old_path = nm_keyfile_connection_get_path (connection);
-
-					/* Removing from the hash table should drop the last reference,
-					 * but of course we want to keep the connection around.
-					 */
-					g_object_ref (found);
-					g_hash_table_remove (priv->hash, old_path);
-
-					/* Updating settings should update the NMKeyfileConnection's
-					 * filename property too.
-					 */
-					update_connection_settings (found, connection);
-					/* However, when connections are the same and only the filename changed
-					 * we need to update the path manually (commit_changes() is not called.
-					 */
-					nm_keyfile_connection_set_path (found, full_path);
-
-					/* Re-insert the connection back into the hash with the new filename */
-					g_hash_table_insert (priv->hash,
-					                     (gpointer) nm_keyfile_connection_get_path (found),
-					                     found);
-
-					/* Get rid of the temporary connection */
-					g_object_unref (connection);
-				} else {
-					g_hash_table_insert (priv->hash,
-					                     (gpointer) nm_keyfile_connection_get_path (connection),
-					                     connection);
-					g_signal_emit_by_name (config, NM_SYSTEM_CONFIG_INTERFACE_CONNECTION_ADDED, connection);
-				}
-			} else {
-				PLUGIN_PRINT (KEYFILE_PLUGIN_NAME, "    error: %s",
-						      (error && error->message) ? error->message : "(unknown)");
-				g_clear_error (&error);
-			}
-		}
-		break;
-	default:
-		break;
+	/* Tools often rewrite files without actually changing them */
+	if (!nm_settings_utils_file_changed (priv->fingerprints, full_path)) {
+		g_free (full_path);
+		return;
 	}
 
-	g_free (full_path);
+	/* Bulk changes generate many events, often several per file; handle
+	 * them together once things have settled.
+	 */
+	g_hash_table_insert (priv->pending, full_path, NULL);
+	if (!priv->pending_id)
+		priv->pending_id = g_timeout_add (DIR_CHANGE_DELAY, process_pending, self);
 }
 
 static void
@@ -345,6 +516,9 @@ setup_monitoring (NMSystemConfigInterface *config)
 	GFileMonitor *monitor;
 
 	priv->hash = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_object_unref);
+	priv->uuids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->fingerprints = nm_settings_utils_fingerprints_new ();
+	priv->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
 	file = g_file_new_for_path (KEYFILE_DIR);
 	monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, NULL);
@@ -594,6 +768,13 @@ dispose (GObject *object)
 		g_object_unref (priv->monitor);
 	}
 
+	if (priv->pending_id)
+		g_source_remove (priv->pending_id);
+	if (priv->pending)
+		g_hash_table_destroy (priv->pending);
+	if (priv->fingerprints)
+		g_hash_table_destroy (priv->fingerprints);
+
 	if (priv->conf_file_monitor) {
 		if (priv->conf_file_monitor_id)
 			g_signal_handler_disconnect (priv->conf_file_monitor, priv->conf_file_monitor_id);
@@ -605,9 +786,17 @@ dispose (GObject *object)
 	g_free (priv->hostname);
 	g_free (priv->conf_file);
 
+	if (priv->uuids) {
+		g_hash_table_destroy (priv->uuids);
+		priv->uuids = NULL;
+	}
+
 	if (priv->hash)
 		g_hash_table_destroy (priv->hash);
 
+	if (priv->cache)
+		nm_connection_cache_free (priv->cache);
+
 	G_OBJECT_CLASS (sc_plugin_keyfile_parent_class)->dispose (object);
 }
 
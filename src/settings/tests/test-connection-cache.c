@@ -0,0 +1,625 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <nm-connection.h>
+#include <nm-setting-connection.h>
+#include <nm-setting-wired.h>
+#include <nm-setting-wireless.h>
+#include <nm-setting-ip4-config.h>
+#include <nm-setting-ip6-config.h>
+#include <nm-setting-vpn.h>
+#include <nm-utils.h>
+#include "nm-connection-cache.h"
+#include "plugins/keyfile/reader.h"
+#ifdef WITH_IFCFG_RH
+#include "plugins/ifcfg-rh/reader.h"
+#include "plugins/ifcfg-rh/utils.h"
+#endif
+
+static char *scratch_dir = NULL;
+
+static char *
+scratch_file (const char *name, const char *contents)
+{
+	char *path;
+
+	path = g_build_filename (scratch_dir, name, NULL);
+	if (contents)
+		g_assert (g_file_set_contents (path, contents, -1, NULL));
+	return path;
+}
+
+/* Copies a fixture into the scratch directory, so that the test can touch
+ * it and so that it has the permissions the keyfile reader insists on.
+ */
+static char *
+scratch_fixture (const char *dir, const char *name)
+{
+	char *src, *contents = NULL, *path;
+	gsize len = 0;
+
+	src = g_build_filename (dir, name, NULL);
+	g_assert (g_file_get_contents (src, &contents, &len, NULL));
+	path = g_build_filename (scratch_dir, name, NULL);
+	g_assert (g_file_set_contents (path, contents, len, NULL));
+	g_assert (chmod (path, 0600) == 0);
+
+	g_free (contents);
+	g_free (src);
+	return path;
+}
+
+/* Rewrites a file with the same contents plus a trailing newline, which
+ * doesn't change what is parsed from it.
+ */
+static void
+touch_file (const char *path)
+{
+	char *contents = NULL, *changed;
+
+	g_assert (g_file_get_contents (path, &contents, NULL, NULL));
+	changed = g_strconcat (contents, "\n", NULL);
+	g_assert (g_file_set_contents (path, changed, -1, NULL));
+	g_free (changed);
+	g_free (contents);
+}
+
+static NMConnection *
+new_connection (const char *id, const char *type)
+{
+	NMConnection *connection;
+	NMSetting *setting;
+	char *uuid;
+
+	connection = nm_connection_new ();
+
+	setting = nm_setting_connection_new ();
+	uuid = nm_utils_uuid_generate ();
+	g_object_set (setting,
+	              NM_SETTING_CONNECTION_ID, id,
+	              NM_SETTING_CONNECTION_UUID, uuid,
+	              NM_SETTING_CONNECTION_TYPE, type,
+	              NM_SETTING_CONNECTION_AUTOCONNECT, FALSE,
+	              NULL);
+	g_free (uuid);
+	nm_connection_add_setting (connection, setting);
+
+	return connection;
+}
+
+static NMConnection *
+new_wired_connection (void)
+{
+	NMConnection *connection;
+	NMSetting *setting;
+	NMIP4Address *addr4;
+	NMIP6Address *addr6;
+	struct in6_addr in6;
+	GByteArray *mac;
+	const guint8 mac_data[] = { 0x00, 0x16, 0x41, 0x11, 0x22, 0x33 };
+
+	connection = new_connection ("wired cache", NM_SETTING_WIRED_SETTING_NAME);
+
+	setting = nm_setting_wired_new ();
+	mac = g_byte_array_sized_new (sizeof (mac_data));
+	g_byte_array_append (mac, mac_data, sizeof (mac_data));
+	g_object_set (setting,
+	              NM_SETTING_WIRED_MAC_ADDRESS, mac,
+	              NM_SETTING_WIRED_MTU, 1400,
+	              NULL);
+	g_byte_array_free (mac, TRUE);
+	nm_connection_add_setting (connection, setting);
+
+	setting = nm_setting_ip4_config_new ();
+	g_object_set (setting,
+	              NM_SETTING_IP4_CONFIG_METHOD, NM_SETTING_IP4_CONFIG_METHOD_MANUAL,
+	              NM_SETTING_IP4_CONFIG_MAY_FAIL, FALSE,
+	              NULL);
+	addr4 = nm_ip4_address_new ();
+	nm_ip4_address_set_address (addr4, inet_addr ("192.168.1.5"));
+	nm_ip4_address_set_prefix (addr4, 24);
+	nm_ip4_address_set_gateway (addr4, inet_addr ("192.168.1.1"));
+	nm_setting_ip4_config_add_address (NM_SETTING_IP4_CONFIG (setting), addr4);
+	nm_ip4_address_unref (addr4);
+	nm_setting_ip4_config_add_dns (NM_SETTING_IP4_CONFIG (setting), inet_addr ("192.168.1.53"));
+	nm_setting_ip4_config_add_dns_search (NM_SETTING_IP4_CONFIG (setting), "example.com");
+	nm_connection_add_setting (connection, setting);
+
+	setting = nm_setting_ip6_config_new ();
+	g_object_set (setting,
+	              NM_SETTING_IP6_CONFIG_METHOD, NM_SETTING_IP6_CONFIG_METHOD_MANUAL,
+	              NULL);
+	addr6 = nm_ip6_address_new ();
+	g_assert (inet_pton (AF_INET6, "2001:db8::5", &in6) == 1);
+	nm_ip6_address_set_address (addr6, &in6);
+	nm_ip6_address_set_prefix (addr6, 64);
+	nm_setting_ip6_config_add_address (NM_SETTING_IP6_CONFIG (setting), addr6);
+	nm_ip6_address_unref (addr6);
+	nm_connection_add_setting (connection, setting);
+
+	g_assert (nm_connection_verify (connection, NULL));
+	return connection;
+}
+
+static NMConnection *
+new_vpn_connection (void)
+{
+	NMConnection *connection;
+	NMSetting *setting;
+
+	connection = new_connection ("vpn cache", NM_SETTING_VPN_SETTING_NAME);
+
+	setting = nm_setting_vpn_new ();
+	g_object_set (setting,
+	              NM_SETTING_VPN_SERVICE_TYPE, "org.freedesktop.NetworkManager.openvpn",
+	              NULL);
+	nm_setting_vpn_add_data_item (NM_SETTING_VPN (setting), "remote", "vpn.example.com");
+	nm_setting_vpn_add_data_item (NM_SETTING_VPN (setting), "port", "1194");
+	nm_setting_vpn_add_secret (NM_SETTING_VPN (setting), "password", "s3cret");
+	nm_connection_add_setting (connection, setting);
+
+	setting = nm_setting_ip4_config_new ();
+	g_object_set (setting,
+	              NM_SETTING_IP4_CONFIG_METHOD, NM_SETTING_IP4_CONFIG_METHOD_AUTO,
+	              NULL);
+	nm_connection_add_setting (connection, setting);
+
+	g_assert (nm_connection_verify (connection, NULL));
+	return connection;
+}
+
+static NMConnection *
+new_wifi_connection (void)
+{
+	NMConnection *connection;
+	NMSetting *setting;
+	GByteArray *ssid;
+
+	connection = new_connection ("wifi cache", NM_SETTING_WIRELESS_SETTING_NAME);
+
+	setting = nm_setting_wireless_new ();
+	ssid = g_byte_array_new ();
+	g_byte_array_append (ssid, (const guint8 *) "cache-ssid", strlen ("cache-ssid"));
+	g_object_set (setting,
+	              NM_SETTING_WIRELESS_SSID, ssid,
+	              NM_SETTING_WIRELESS_MODE, NM_SETTING_WIRELESS_MODE_INFRA,
+	              NULL);
+	g_byte_array_free (ssid, TRUE);
+	nm_connection_add_setting (connection, setting);
+
+	g_assert (nm_connection_verify (connection, NULL));
+	return connection;
+}
+
+static void
+assert_cached (NMConnectionCache *cache, const char *path, NMConnection *expected)
+{
+	NMConnection *connection;
+
+	connection = nm_connection_cache_lookup (cache, path, NULL);
+	g_assert (connection);
+	g_assert (nm_connection_compare (connection, expected, NM_SETTING_COMPARE_FLAG_EXACT));
+	g_object_unref (connection);
+}
+
+/*******************************************/
+
+static void
+cache_add (NMConnectionCache *cache,
+           const char *path,
+           const char **deps,
+           const char **extra,
+           NMConnection *connection)
+{
+	NMConnectionCacheStamp *stamp;
+
+	stamp = nm_connection_cache_stamp_new (path, deps);
+	nm_connection_cache_add (cache, stamp, extra, connection);
+	nm_connection_cache_stamp_free (stamp);
+}
+
+static void
+test_cache_roundtrip (void)
+{
+	NMConnectionCache *cache;
+	NMConnection *wired, *vpn, *wifi, *connection;
+	char *cache_file, *wired_path, *vpn_path, *wifi_path, *route_path, **extra = NULL;
+	const char *deps[] = { NULL, NULL };
+	const char *extra_in[] = { "", "unmanaged", NULL };
+
+	cache_file = scratch_file ("roundtrip.cache", NULL);
+	wired_path = scratch_file ("wired", "wired contents");
+	vpn_path = scratch_file ("vpn", "vpn contents");
+	wifi_path = scratch_file ("wifi", "wifi contents");
+	route_path = scratch_file ("route", "route contents");
+
+	wired = new_wired_connection ();
+	vpn = new_vpn_connection ();
+	wifi = new_wifi_connection ();
+
+	cache = nm_connection_cache_new (cache_file);
+	g_assert (nm_connection_cache_lookup (cache, wired_path, NULL) == NULL);
+
+	deps[0] = route_path;
+	cache_add (cache, wired_path, deps, extra_in, wired);
+	cache_add (cache, vpn_path, NULL, NULL, vpn);
+	cache_add (cache, wifi_path, NULL, NULL, wifi);
+	g_assert (nm_connection_cache_write (cache, NULL));
+	nm_connection_cache_free (cache);
+
+	/* Read back from the file; all of it including secrets must survive */
+	cache = nm_connection_cache_new (cache_file);
+	assert_cached (cache, wired_path, wired);
+	assert_cached (cache, vpn_path, vpn);
+	assert_cached (cache, wifi_path, wifi);
+
+	connection = nm_connection_cache_lookup (cache, wired_path, &extra);
+	g_assert (connection);
+	g_object_unref (connection);
+	g_assert_cmpuint (g_strv_length (extra), ==, 2);
+	g_assert_cmpstr (extra[0], ==, "");
+	g_assert_cmpstr (extra[1], ==, "unmanaged");
+	g_strfreev (extra);
+
+	/* Changing the file or one of its dependencies invalidates the entry */
+	g_assert (g_file_set_contents (route_path, "changed route contents", -1, NULL));
+	g_assert (nm_connection_cache_lookup (cache, wired_path, NULL) == NULL);
+	g_assert (g_file_set_contents (wifi_path, "changed wifi contents", -1, NULL));
+	g_assert (nm_connection_cache_lookup (cache, wifi_path, NULL) == NULL);
+	unlink (vpn_path);
+	g_assert (nm_connection_cache_lookup (cache, vpn_path, NULL) == NULL);
+
+	nm_connection_cache_free (cache);
+
+	g_object_unref (wired);
+	g_object_unref (vpn);
+	g_object_unref (wifi);
+	unlink (wired_path);
+	unlink (wifi_path);
+	unlink (route_path);
+	unlink (cache_file);
+	g_free (wired_path);
+	g_free (vpn_path);
+	g_free (wifi_path);
+	g_free (route_path);
+	g_free (cache_file);
+}
+
+static void
+test_cache_remove (void)
+{
+	NMConnectionCache *cache;
+	NMConnection *wifi;
+	char *cache_file, *path;
+
+	cache_file = scratch_file ("remove.cache", NULL);
+	path = scratch_file ("wifi", "wifi contents");
+	wifi = new_wifi_connection ();
+
+	cache = nm_connection_cache_new (cache_file);
+	cache_add (cache, path, NULL, NULL, wifi);
+	g_assert (nm_connection_cache_write (cache, NULL));
+	nm_connection_cache_free (cache);
+
+	cache = nm_connection_cache_new (cache_file);
+	nm_connection_cache_remove (cache, path);
+	g_assert (nm_connection_cache_lookup (cache, path, NULL) == NULL);
+	g_assert (nm_connection_cache_write (cache, NULL));
+	nm_connection_cache_free (cache);
+
+	/* Entries that weren't used since the cache was read are dropped */
+	cache = nm_connection_cache_new (cache_file);
+	cache_add (cache, path, NULL, NULL, wifi);
+	g_assert (nm_connection_cache_write (cache, NULL));
+	nm_connection_cache_free (cache);
+
+	cache = nm_connection_cache_new (cache_file);
+	g_assert (nm_connection_cache_write (cache, NULL));
+	nm_connection_cache_free (cache);
+
+	cache = nm_connection_cache_new (cache_file);
+	g_assert (nm_connection_cache_lookup (cache, path, NULL) == NULL);
+	nm_connection_cache_free (cache);
+
+	g_object_unref (wifi);
+	unlink (path);
+	unlink (cache_file);
+	g_free (path);
+	g_free (cache_file);
+}
+
+static void
+test_cache_invalid (void)
+{
+	NMConnectionCache *cache;
+	NMConnection *wifi;
+	char *cache_file, *path, *contents;
+	gsize len;
+
+	cache_file = scratch_file ("invalid.cache", NULL);
+	path = scratch_file ("wifi", "wifi contents");
+	wifi = new_wifi_connection ();
+
+	cache = nm_connection_cache_new (cache_file);
+	cache_add (cache, path, NULL, NULL, wifi);
+	g_assert (nm_connection_cache_write (cache, NULL));
+	nm_connection_cache_free (cache);
+
+	/* A truncated cache is ignored */
+	g_assert (g_file_get_contents (cache_file, &contents, &len, NULL));
+	g_assert (g_file_set_contents (cache_file, contents, len - 10, NULL));
+	cache = nm_connection_cache_new (cache_file);
+	g_assert (nm_connection_cache_lookup (cache, path, NULL) == NULL);
+	nm_connection_cache_free (cache);
+
+	/* So is one from a different version */
+	contents[8]++;
+	g_assert (g_file_set_contents (cache_file, contents, len, NULL));
+	cache = nm_connection_cache_new (cache_file);
+	g_assert (nm_connection_cache_lookup (cache, path, NULL) == NULL);
+	nm_connection_cache_free (cache);
+	contents[8]--;
+
+	/* Or from another NetworkManager release; the release follows the
+	 * 16-byte header and the string's length.
+	 */
+	contents[20]++;
+	g_assert (g_file_set_contents (cache_file, contents, len, NULL));
+	cache = nm_connection_cache_new (cache_file);
+	g_assert (nm_connection_cache_lookup (cache, path, NULL) == NULL);
+	nm_connection_cache_free (cache);
+
+	g_free (contents);
+	g_object_unref (wifi);
+	unlink (path);
+	unlink (cache_file);
+	g_free (path);
+	g_free (cache_file);
+}
+
+static void
+test_cache_changed_while_parsing (void)
+{
+	NMConnectionCache *cache;
+	NMConnectionCacheStamp *stamp;
+	NMConnection *wifi;
+	char *cache_file, *path;
+
+	cache_file = scratch_file ("parsing.cache", NULL);
+	path = scratch_file ("wifi", "wifi contents");
+	wifi = new_wifi_connection ();
+
+	/* The file changes after it was stamped but before the connection read
+	 * from it gets cached; the entry must not match the new contents.
+	 */
+	stamp = nm_connection_cache_stamp_new (path, NULL);
+	g_assert (g_file_set_contents (path, "changed wifi contents", -1, NULL));
+
+	cache = nm_connection_cache_new (cache_file);
+	nm_connection_cache_add (cache, stamp, NULL, wifi);
+	nm_connection_cache_stamp_free (stamp);
+	g_assert (nm_connection_cache_lookup (cache, path, NULL) == NULL);
+	nm_connection_cache_free (cache);
+
+	g_object_unref (wifi);
+	unlink (path);
+	unlink (cache_file);
+	g_free (path);
+	g_free (cache_file);
+}
+
+static void
+test_cache_keyfile (void)
+{
+	NMConnectionCache *cache;
+	NMConnectionCacheStamp *stamp;
+	NMConnection *parsed, *fresh;
+	char *cache_file, *path;
+	GError *error = NULL;
+
+	cache_file = scratch_file ("keyfile.cache", NULL);
+	path = scratch_fixture (TEST_KEYFILES_DIR, "Test_Wired_Connection");
+
+	/* Stamp before parsing, like the keyfile plugin does */
+	stamp = nm_connection_cache_stamp_new (path, NULL);
+	parsed = nm_keyfile_plugin_connection_from_file (path, &error);
+	g_assert_no_error (error);
+	g_assert (parsed);
+
+	cache = nm_connection_cache_new (cache_file);
+	nm_connection_cache_add (cache, stamp, NULL, parsed);
+	nm_connection_cache_stamp_free (stamp);
+	g_assert (nm_connection_cache_write (cache, NULL));
+	nm_connection_cache_free (cache);
+
+	/* The cached copy must be exactly what parsing the file gives */
+	fresh = nm_keyfile_plugin_connection_from_file (path, &error);
+	g_assert_no_error (error);
+	g_assert (fresh);
+
+	cache = nm_connection_cache_new (cache_file);
+	assert_cached (cache, path, fresh);
+
+	touch_file (path);
+	g_assert (nm_connection_cache_lookup (cache, path, NULL) == NULL);
+	nm_connection_cache_free (cache);
+
+	g_object_unref (parsed);
+	g_object_unref (fresh);
+	unlink (path);
+	unlink (cache_file);
+	g_free (path);
+	g_free (cache_file);
+}
+
+#ifdef WITH_IFCFG_RH
+static NMConnectionCacheStamp *
+stamp_ifcfg (const char *path)
+{
+	NMConnectionCacheStamp *stamp;
+	char *deps[4];
+	guint i;
+
+	deps[0] = utils_get_keys_path (path);
+	deps[1] = utils_get_route_path (path);
+	deps[2] = utils_get_route6_path (path);
+	deps[3] = NULL;
+
+	stamp = nm_connection_cache_stamp_new (path, (const char **) deps);
+
+	for (i = 0; deps[i]; i++)
+		g_free (deps[i]);
+	return stamp;
+}
+
+static NMConnection *
+parse_ifcfg (const char *path, const char *type)
+{
+	NMConnection *connection;
+	char *unmanaged = NULL, *keyfile = NULL, *routefile = NULL, *route6file = NULL;
+	gboolean ignore_error = FALSE;
+	GError *error = NULL;
+
+	connection = connection_from_file (path, NULL, type, NULL,
+	                                   &unmanaged, &keyfile, &routefile, &route6file,
+	                                   &error, &ignore_error);
+	g_assert_no_error (error);
+	g_assert (connection);
+
+	g_free (unmanaged);
+	g_free (keyfile);
+	g_free (routefile);
+	g_free (route6file);
+	return connection;
+}
+
+static void
+test_cache_ifcfg (void)
+{
+	NMConnectionCache *cache;
+	NMConnectionCacheStamp *stamp;
+	NMConnection *wired, *wifi, *fresh;
+	char *cache_file, *wired_path, *route_path, *wifi_path, *keys_path;
+
+	cache_file = scratch_file ("ifcfg.cache", NULL);
+	wired_path = scratch_fixture (TEST_IFCFG_DIR, "ifcfg-test-wired-static-routes");
+	route_path = scratch_fixture (TEST_IFCFG_DIR, "route-test-wired-static-routes");
+	wifi_path = scratch_fixture (TEST_IFCFG_DIR, "ifcfg-test-wifi-wep");
+	keys_path = scratch_fixture (TEST_IFCFG_DIR, "keys-test-wifi-wep");
+
+	cache = nm_connection_cache_new (cache_file);
+
+	stamp = stamp_ifcfg (wired_path);
+	wired = parse_ifcfg (wired_path, TYPE_ETHERNET);
+	nm_connection_cache_add (cache, stamp, NULL, wired);
+	nm_connection_cache_stamp_free (stamp);
+
+	stamp = stamp_ifcfg (wifi_path);
+	wifi = parse_ifcfg (wifi_path, TYPE_WIRELESS);
+	nm_connection_cache_add (cache, stamp, NULL, wifi);
+	nm_connection_cache_stamp_free (stamp);
+
+	g_assert (nm_connection_cache_write (cache, NULL));
+	nm_connection_cache_free (cache);
+
+	/* The cached copies, routes and WEP keys included, must be exactly
+	 * what parsing the files gives.
+	 */
+	cache = nm_connection_cache_new (cache_file);
+
+	fresh = parse_ifcfg (wired_path, TYPE_ETHERNET);
+	assert_cached (cache, wired_path, fresh);
+	g_object_unref (fresh);
+
+	fresh = parse_ifcfg (wifi_path, TYPE_WIRELESS);
+	assert_cached (cache, wifi_path, fresh);
+	g_object_unref (fresh);
+
+	/* Touching the route or keys file invalidates only its connection */
+	touch_file (route_path);
+	g_assert (nm_connection_cache_lookup (cache, wired_path, NULL) == NULL);
+	fresh = nm_connection_cache_lookup (cache, wifi_path, NULL);
+	g_assert (fresh);
+	g_object_unref (fresh);
+
+	touch_file (keys_path);
+	g_assert (nm_connection_cache_lookup (cache, wifi_path, NULL) == NULL);
+
+	nm_connection_cache_free (cache);
+
+	g_object_unref (wired);
+	g_object_unref (wifi);
+	unlink (wired_path);
+	unlink (route_path);
+	unlink (wifi_path);
+	unlink (keys_path);
+	unlink (cache_file);
+	g_free (wired_path);
+	g_free (route_path);
+	g_free (wifi_path);
+	g_free (keys_path);
+	g_free (cache_file);
+}
+#endif
+
+#if GLIB_CHECK_VERSION(2,25,12)
+typedef GTestFixtureFunc TCFunc;
+#else
+typedef void (*TCFunc)(void);
+#endif
+
+#define TESTCASE(t, d) g_test_create_case (#t, 0, d, NULL, (TCFunc) t, NULL)
+
+int main (int argc, char **argv)
+{
+	GTestSuite *suite;
+	int ret;
+
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	scratch_dir = g_build_filename (g_get_tmp_dir (), "test-connection-cache-XXXXXX", NULL);
+	g_assert (mkdtemp (scratch_dir) != NULL);
+
+	suite = g_test_get_root ();
+
+	g_test_suite_add (suite, TESTCASE (test_cache_roundtrip, NULL));
+	g_test_suite_add (suite, TESTCASE (test_cache_remove, NULL));
+	g_test_suite_add (suite, TESTCASE (test_cache_invalid, NULL));
+	g_test_suite_add (suite, TESTCASE (test_cache_changed_while_parsing, NULL));
+	g_test_suite_add (suite, TESTCASE (test_cache_keyfile, NULL));
+#ifdef WITH_IFCFG_RH
+	g_test_suite_add (suite, TESTCASE (test_cache_ifcfg, NULL));
+#endif
+
+	ret = g_test_run ();
+
+	rmdir (scratch_dir);
+	g_free (scratch_dir);
+	return ret;
+}
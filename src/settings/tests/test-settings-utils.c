@@ -0,0 +1,122 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include "nm-settings-utils.h"
+
+static gpointer
+parse_number (const char *path, gpointer user_data)
+{
+	guint num = (guint) strtoul (path, NULL, 10);
+
+	/* Finish out of order */
+	if (num % 3 == 0)
+		g_usleep (100);
+	return GUINT_TO_POINTER (num + 1);
+}
+
+static void
+test_parse_files_order (void)
+{
+	const guint num = 200;
+	char **paths;
+	gpointer *results;
+	guint i;
+
+	paths = g_new0 (char *, num + 1);
+	for (i = 0; i < num; i++)
+		paths[i] = g_strdup_printf ("%u", i);
+
+	results = nm_settings_utils_parse_files ((const char **) paths, num, parse_number, NULL);
+	g_assert (results);
+
+	/* Results come back in input order, whatever order the workers ran in */
+	for (i = 0; i < num; i++)
+		g_assert_cmpuint (GPOINTER_TO_UINT (results[i]), ==, i + 1);
+
+	g_free (results);
+	g_strfreev (paths);
+}
+
+/*******************************************/
+
+static void
+test_file_changed (void)
+{
+	GHashTable *fingerprints;
+	char *dir, *path;
+
+	dir = g_build_filename (g_get_tmp_dir (), "test-file-changed-XXXXXX", NULL);
+	g_assert (mkdtemp (dir) != NULL);
+	path = g_build_filename (dir, "connection", NULL);
+	g_assert (g_file_set_contents (path, "contents", -1, NULL));
+
+	fingerprints = nm_settings_utils_fingerprints_new ();
+
+	/* Unknown files always count as changed */
+	g_assert (nm_settings_utils_file_changed (fingerprints, path));
+	g_assert (!nm_settings_utils_file_changed (fingerprints, path));
+
+	/* Rewriting the same contents isn't a change */
+	unlink (path);
+	g_assert (g_file_set_contents (path, "contents", -1, NULL));
+	g_assert (!nm_settings_utils_file_changed (fingerprints, path));
+
+	g_assert (g_file_set_contents (path, "new contents", -1, NULL));
+	g_assert (nm_settings_utils_file_changed (fingerprints, path));
+	g_assert (!nm_settings_utils_file_changed (fingerprints, path));
+
+	unlink (path);
+	g_assert (nm_settings_utils_file_changed (fingerprints, path));
+
+	g_hash_table_destroy (fingerprints);
+	rmdir (dir);
+	g_free (path);
+	g_free (dir);
+}
+
+#if GLIB_CHECK_VERSION(2,25,12)
+typedef GTestFixtureFunc TCFunc;
+#else
+typedef void (*TCFunc)(void);
+#endif
+
+#define TESTCASE(t, d) g_test_create_case (#t, 0, d, NULL, (TCFunc) t, NULL)
+
+int main (int argc, char **argv)
+{
+	GTestSuite *suite;
+
+	if (!g_thread_supported ())
+		g_thread_init (NULL);
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	suite = g_test_get_root ();
+
+	g_test_suite_add (suite, TESTCASE (test_parse_files_order, NULL));
+	g_test_suite_add (suite, TESTCASE (test_file_changed, NULL));
+
+	return g_test_run ();
+}
@@ -104,7 +104,11 @@ typedef struct {
 	DBusGProxy *          props_proxy;
 	char *                net_path;
 	guint32               blobs_left;
-	GHashTable *          bss_proxies;
+	GHashTable *          bss;          /* object path -> BssInfo */
+	GSList *              bss_matches;  /* bus match rules for BSS signals */
+	gboolean              bss_filter;
+	char *                wpas_owner;   /* unique name of the supplicant */
+	guint                 bss_fetch_id;
 
 	time_t                last_scan;
 
@@ -113,26 +117,37 @@ typedef struct {
 	gboolean              disposed;
 } NMSupplicantInterfacePrivate;
 
-/* FIXME: remove this and just store the standard D-Bus properties
- * proxy object in bss_proxies when we drop support for wpa_supplicant
- * 0.7.x.
+/* Lightweight record of a BSS the supplicant has told us about.  Its
+ * PropertiesChanged signals are picked out of the single interface-wide
+ * subscription by bss_filter(), so no per-BSS proxies are needed.
  */
 typedef struct {
-	/* Proxy for standard D-Bus Properties interface */
-	DBusGProxy *props;
-	/* Proxy for old wpa_supplicant-specific PropertiesChanged signal */
-	DBusGProxy *old_props;
-} BssProxies;
+	NMSupplicantInterface *self;
+	char *path;
+	gboolean need_props;       /* properties wanted in the next GetAll batch */
+	DBusPendingCall *get_all;  /* GetAll request in flight */
+} BssInfo;
 
 static void
-bss_proxies_free (gpointer data)
+destroy_gvalue (gpointer data)
 {
-	BssProxies *proxies = data;
+	GValue *value = (GValue *) data;
 
-	g_object_unref (proxies->props);
-	g_object_unref (proxies->old_props);
-	memset (proxies, 0, sizeof (*proxies));
-	g_free (proxies);
+	g_value_unset (value);
+	g_slice_free (GValue, value);
+}
+
+static void
+bss_info_free (gpointer data)
+{
+	BssInfo *bss = data;
+
+	if (bss->get_all) {
+		dbus_pending_call_cancel (bss->get_all);
+		dbus_pending_call_unref (bss->get_all);
+	}
+	g_free (bss->path);
+	g_slice_free (BssInfo, bss);
 }
 
 static gboolean
@@ -234,56 +249,417 @@ signal_new_bss (NMSupplicantInterface *self,
 	g_signal_emit (self, signals[NEW_BSS], 0, object_path, props);
 }
 
-static void
-bssid_properties_cb  (DBusGProxy *proxy, DBusGProxyCall *call_id, gpointer user_data)
+/* Demarshal a D-Bus value into a GValue using the same GTypes dbus-glib
+ * would use.  Returns FALSE for types BSS properties never use.
+ */
+static gboolean iter_to_gvalue (DBusMessageIter *iter, GValue *value);
+
+static GHashTable *
+iter_to_hash (DBusMessageIter *iter)
 {
-	NMSupplicantInfo *info = (NMSupplicantInfo *) user_data;
-	GError *error = NULL;
-	GHashTable *props = NULL;
+	DBusMessageIter array, entry;
+	GHashTable *hash;
+	const char *key;
+	GValue *value;
 
-	if (dbus_g_proxy_end_call (proxy, call_id, &error,
-	                           DBUS_TYPE_G_MAP_OF_VARIANT, &props,
-	                           G_TYPE_INVALID)) {
-		signal_new_bss (info->interface, dbus_g_proxy_get_path (proxy), props);
-		g_hash_table_destroy (props);
-	} else {
-		if (!strstr (error->message, "The BSSID requested was invalid")) {
-			nm_log_warn (LOGD_SUPPLICANT, "Couldn't retrieve BSSID properties: %s.",
-			             error->message);
+	if (   dbus_message_iter_get_arg_type (iter) != DBUS_TYPE_ARRAY
+	    || dbus_message_iter_get_element_type (iter) != DBUS_TYPE_DICT_ENTRY)
+		return NULL;
+
+	hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, destroy_gvalue);
+
+	dbus_message_iter_recurse (iter, &array);
+	while (dbus_message_iter_get_arg_type (&array) == DBUS_TYPE_DICT_ENTRY) {
+		dbus_message_iter_recurse (&array, &entry);
+		if (dbus_message_iter_get_arg_type (&entry) == DBUS_TYPE_STRING) {
+			dbus_message_iter_get_basic (&entry, &key);
+			dbus_message_iter_next (&entry);
+
+			value = g_slice_new0 (GValue);
+			if (iter_to_gvalue (&entry, value))
+				g_hash_table_insert (hash, g_strdup (key), value);
+			else
+				g_slice_free (GValue, value);
 		}
-		g_error_free (error);
+		dbus_message_iter_next (&array);
 	}
+
+	return hash;
 }
 
-static void
-bss_properties_changed (DBusGProxy *proxy,
-                        const char *interface,
-                        GHashTable *props,
-                        const char **unused,
-                        gpointer user_data)
+static gboolean
+array_to_gvalue (DBusMessageIter *iter, GValue *value)
+{
+	DBusMessageIter sub;
+	GArray *array;
+	GPtrArray *ptrs;
+	GHashTable *hash;
+	const void *data;
+	const char *str;
+	int elt_type, len;
+
+	elt_type = dbus_message_iter_get_element_type (iter);
+	switch (elt_type) {
+	case DBUS_TYPE_BYTE:
+	case DBUS_TYPE_UINT32:
+		dbus_message_iter_recurse (iter, &sub);
+		dbus_message_iter_get_fixed_array (&sub, &data, &len);
+		if (elt_type == DBUS_TYPE_BYTE) {
+			array = g_array_sized_new (FALSE, FALSE, sizeof (guchar), len);
+			g_value_init (value, DBUS_TYPE_G_UCHAR_ARRAY);
+		} else {
+			array = g_array_sized_new (FALSE, FALSE, sizeof (guint32), len);
+			g_value_init (value, DBUS_TYPE_G_UINT_ARRAY);
+		}
+		g_array_append_vals (array, data, len);
+		g_value_take_boxed (value, array);
+		return TRUE;
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		ptrs = g_ptr_array_new ();
+		dbus_message_iter_recurse (iter, &sub);
+		while (dbus_message_iter_get_arg_type (&sub) == elt_type) {
+			dbus_message_iter_get_basic (&sub, &str);
+			g_ptr_array_add (ptrs, g_strdup (str));
+			dbus_message_iter_next (&sub);
+		}
+		if (elt_type == DBUS_TYPE_STRING) {
+			g_ptr_array_add (ptrs, NULL);
+			g_value_init (value, G_TYPE_STRV);
+			g_value_take_boxed (value, g_ptr_array_free (ptrs, FALSE));
+		} else {
+			g_value_init (value, DBUS_TYPE_G_ARRAY_OF_OBJECT_PATH);
+			g_value_take_boxed (value, ptrs);
+		}
+		return TRUE;
+	case DBUS_TYPE_DICT_ENTRY:
+		hash = iter_to_hash (iter);
+		if (!hash)
+			return FALSE;
+		g_value_init (value, DBUS_TYPE_G_MAP_OF_VARIANT);
+		g_value_take_boxed (value, hash);
+		return TRUE;
+	default:
+		break;
+	}
+	return FALSE;
+}
+
+static gboolean
+iter_to_gvalue (DBusMessageIter *iter, GValue *value)
+{
+	DBusMessageIter sub;
+	union {
+		dbus_bool_t b;
+		guchar y;
+		gint16 n;
+		guint16 q;
+		gint32 i;
+		guint32 u;
+		gint64 x;
+		guint64 t;
+		double d;
+		const char *s;
+	} v;
+
+	switch (dbus_message_iter_get_arg_type (iter)) {
+	case DBUS_TYPE_VARIANT:
+		dbus_message_iter_recurse (iter, &sub);
+		return iter_to_gvalue (&sub, value);
+	case DBUS_TYPE_ARRAY:
+		return array_to_gvalue (iter, value);
+	case DBUS_TYPE_BOOLEAN:
+		dbus_message_iter_get_basic (iter, &v.b);
+		g_value_init (value, G_TYPE_BOOLEAN);
+		g_value_set_boolean (value, v.b);
+		return TRUE;
+	case DBUS_TYPE_BYTE:
+		dbus_message_iter_get_basic (iter, &v.y);
+		g_value_init (value, G_TYPE_UCHAR);
+		g_value_set_uchar (value, v.y);
+		return TRUE;
+	case DBUS_TYPE_INT16:
+		dbus_message_iter_get_basic (iter, &v.n);
+		g_value_init (value, G_TYPE_INT);
+		g_value_set_int (value, v.n);
+		return TRUE;
+	case DBUS_TYPE_UINT16:
+		dbus_message_iter_get_basic (iter, &v.q);
+		g_value_init (value, G_TYPE_UINT);
+		g_value_set_uint (value, v.q);
+		return TRUE;
+	case DBUS_TYPE_INT32:
+		dbus_message_iter_get_basic (iter, &v.i);
+		g_value_init (value, G_TYPE_INT);
+		g_value_set_int (value, v.i);
+		return TRUE;
+	case DBUS_TYPE_UINT32:
+		dbus_message_iter_get_basic (iter, &v.u);
+		g_value_init (value, G_TYPE_UINT);
+		g_value_set_uint (value, v.u);
+		return TRUE;
+	case DBUS_TYPE_INT64:
+		dbus_message_iter_get_basic (iter, &v.x);
+		g_value_init (value, G_TYPE_INT64);
+		g_value_set_int64 (value, v.x);
+		return TRUE;
+	case DBUS_TYPE_UINT64:
+		dbus_message_iter_get_basic (iter, &v.t);
+		g_value_init (value, G_TYPE_UINT64);
+		g_value_set_uint64 (value, v.t);
+		return TRUE;
+	case DBUS_TYPE_DOUBLE:
+		dbus_message_iter_get_basic (iter, &v.d);
+		g_value_init (value, G_TYPE_DOUBLE);
+		g_value_set_double (value, v.d);
+		return TRUE;
+	case DBUS_TYPE_STRING:
+		dbus_message_iter_get_basic (iter, &v.s);
+		g_value_init (value, G_TYPE_STRING);
+		g_value_set_string (value, v.s);
+		return TRUE;
+	case DBUS_TYPE_OBJECT_PATH:
+		dbus_message_iter_get_basic (iter, &v.s);
+		g_value_init (value, DBUS_TYPE_G_OBJECT_PATH);
+		g_value_set_boxed (value, v.s);
+		return TRUE;
+	default:
+		break;
+	}
+	return FALSE;
+}
+
+static DBusHandlerResult
+bss_filter (DBusConnection *connection, DBusMessage *message, void *user_data)
 {
 	NMSupplicantInterface *self = NM_SUPPLICANT_INTERFACE (user_data);
 	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
+	DBusMessageIter iter;
+	const char *path, *interface = NULL;
+	GHashTable *props;
+
+	if (dbus_message_get_type (message) != DBUS_MESSAGE_TYPE_SIGNAL)
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	path = dbus_message_get_path (message);
+	if (!path || !g_hash_table_lookup (priv->bss, path))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	if (priv->wpas_owner && g_strcmp0 (dbus_message_get_sender (message), priv->wpas_owner))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	dbus_message_iter_init (message, &iter);
+	if (dbus_message_is_signal (message, DBUS_INTERFACE_PROPERTIES, "PropertiesChanged")) {
+		/* Standard D-Bus PropertiesChanged signal */
+		if (dbus_message_iter_get_arg_type (&iter) != DBUS_TYPE_STRING)
+			return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+		dbus_message_iter_get_basic (&iter, &interface);
+		dbus_message_iter_next (&iter);
+	} else if (dbus_message_is_signal (message, WPAS_DBUS_IFACE_BSS, "PropertiesChanged")) {
+		/* Old wpa_supplicant-specific PropertiesChanged signal */
+		interface = WPAS_DBUS_IFACE_BSS;
+	} else
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 
 	if (priv->scanning)
 		priv->last_scan = time (NULL);
 
-	if (g_strcmp0 (interface, WPAS_DBUS_IFACE_BSS) == 0)
-		g_signal_emit (self, signals[BSS_UPDATED], 0, dbus_g_proxy_get_path (proxy), props);
+	if (strcmp (interface, WPAS_DBUS_IFACE_BSS) == 0) {
+		props = iter_to_hash (&iter);
+		if (props) {
+			g_signal_emit (self, signals[BSS_UPDATED], 0, path, props);
+			g_hash_table_destroy (props);
+		}
+	}
+
+	/* Other interfaces of this supplicant may want the signal too */
+	return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 }
 
 static void
-old_bss_properties_changed (DBusGProxy *proxy,
-                            GHashTable *props,
-                            gpointer user_data)
+bss_add_match (NMSupplicantInterface *self, DBusConnection *connection, char *rule)
 {
-	NMSupplicantInterface *self = NM_SUPPLICANT_INTERFACE (user_data);
 	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
+	DBusError error;
+
+	dbus_error_init (&error);
+	dbus_bus_add_match (connection, rule, &error);
+	if (dbus_error_is_set (&error)) {
+		nm_log_warn (LOGD_SUPPLICANT, "(%s): couldn't add BSS match rule: %s",
+		             priv->dev, error.message);
+		dbus_error_free (&error);
+		g_free (rule);
+	} else
+		priv->bss_matches = g_slist_prepend (priv->bss_matches, rule);
+}
 
-	if (priv->scanning)
-		priv->last_scan = time (NULL);
+static void
+bss_tracking_start (NMSupplicantInterface *self)
+{
+	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
+	DBusConnection *connection;
+	DBusError error;
+	char *rule;
+
+	connection = nm_dbus_manager_get_dbus_connection (priv->dbus_mgr);
+	g_return_if_fail (connection != NULL);
+
+	g_free (priv->wpas_owner);
+	priv->wpas_owner = nm_dbus_manager_get_name_owner (priv->dbus_mgr, WPAS_DBUS_SERVICE, NULL);
+
+	/* One rule covers the PropertiesChanged signals of every BSS object
+	 * below the interface's path.
+	 */
+	rule = g_strdup_printf ("type='signal',sender='" WPAS_DBUS_SERVICE "',path_namespace='%s'",
+	                        priv->object_path);
+	dbus_error_init (&error);
+	dbus_bus_add_match (connection, rule, &error);
+	if (dbus_error_is_set (&error)) {
+		/* dbus-daemon before 1.5 doesn't know path_namespace; fall back to
+		 * the PropertiesChanged signals of all supplicant objects.
+		 */
+		nm_log_dbg (LOGD_SUPPLICANT, "(%s): path_namespace match not supported (%s)",
+		            priv->dev, error.message);
+		dbus_error_free (&error);
+		g_free (rule);
+
+		bss_add_match (self, connection,
+		               g_strdup ("type='signal',sender='" WPAS_DBUS_SERVICE "',"
+		                         "interface='" DBUS_INTERFACE_PROPERTIES "',"
+		                         "member='PropertiesChanged'"));
+		bss_add_match (self, connection,
+		               g_strdup ("type='signal',sender='" WPAS_DBUS_SERVICE "',"
+		                         "interface='" WPAS_DBUS_IFACE_BSS "',"
+		                         "member='PropertiesChanged'"));
+	} else
+		priv->bss_matches = g_slist_prepend (priv->bss_matches, rule);
+
+	if (!priv->bss_filter)
+		priv->bss_filter = dbus_connection_add_filter (connection, bss_filter, self, NULL);
+}
+
+static void
+bss_tracking_stop (NMSupplicantInterface *self)
+{
+	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
+	DBusConnection *connection;
+	GSList *iter;
+
+	if (priv->bss_fetch_id) {
+		g_source_remove (priv->bss_fetch_id);
+		priv->bss_fetch_id = 0;
+	}
+
+	/* Drops any GetAll requests still in flight */
+	g_hash_table_remove_all (priv->bss);
+
+	connection = nm_dbus_manager_get_dbus_connection (priv->dbus_mgr);
+	if (connection) {
+		for (iter = priv->bss_matches; iter; iter = g_slist_next (iter))
+			dbus_bus_remove_match (connection, iter->data, NULL);
+		if (priv->bss_filter)
+			dbus_connection_remove_filter (connection, bss_filter, self);
+	}
+	priv->bss_filter = FALSE;
+
+	g_slist_foreach (priv->bss_matches, (GFunc) g_free, NULL);
+	g_slist_free (priv->bss_matches);
+	priv->bss_matches = NULL;
+}
+
+static guint
+bss_count_pending (NMSupplicantInterface *self)
+{
+	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
+	GHashTableIter iter;
+	BssInfo *bss;
+	guint count = 0;
 
-	g_signal_emit (self, signals[BSS_UPDATED], 0, dbus_g_proxy_get_path (proxy), props);
+	g_hash_table_iter_init (&iter, priv->bss);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &bss)) {
+		if (bss->need_props || bss->get_all)
+			count++;
+	}
+	return count;
+}
+
+static void
+bss_get_all_cb (DBusPendingCall *pending, void *user_data)
+{
+	BssInfo *bss = user_data;
+	DBusMessage *reply;
+	DBusMessageIter iter;
+	DBusError error;
+	GHashTable *props;
+
+	reply = dbus_pending_call_steal_reply (pending);
+	dbus_pending_call_unref (bss->get_all);
+	bss->get_all = NULL;
+	if (!reply)
+		return;
+
+	dbus_error_init (&error);
+	if (dbus_set_error_from_message (&error, reply)) {
+		if (!error.message || !strstr (error.message, "The BSSID requested was invalid")) {
+			nm_log_warn (LOGD_SUPPLICANT, "Couldn't retrieve BSSID properties: %s.",
+			             error.message);
+		}
+		dbus_error_free (&error);
+	} else {
+		dbus_message_iter_init (reply, &iter);
+		props = iter_to_hash (&iter);
+		if (props) {
+			signal_new_bss (bss->self, bss->path, props);
+			g_hash_table_destroy (props);
+		}
+	}
+	dbus_message_unref (reply);
+}
+
+/* wpa_supplicant has no call returning the properties of several BSSs, so
+ * the GetAll requests for all BSSs reported by one scan are sent back to
+ * back from an idle handler instead of one proxy call per BSS.
+ */
+static gboolean
+bss_fetch_props (gpointer user_data)
+{
+	NMSupplicantInterface *self = NM_SUPPLICANT_INTERFACE (user_data);
+	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
+	const char *interface = WPAS_DBUS_IFACE_BSS;
+	DBusConnection *connection;
+	DBusMessage *message;
+	GHashTableIter iter;
+	BssInfo *bss;
+	guint count = 0;
+
+	priv->bss_fetch_id = 0;
+
+	connection = nm_dbus_manager_get_dbus_connection (priv->dbus_mgr);
+	g_return_val_if_fail (connection != NULL, FALSE);
+
+	g_hash_table_iter_init (&iter, priv->bss);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer) &bss)) {
+		if (!bss->need_props)
+			continue;
+		bss->need_props = FALSE;
+
+		message = dbus_message_new_method_call (WPAS_DBUS_SERVICE,
+		                                        bss->path,
+		                                        DBUS_INTERFACE_PROPERTIES,
+		                                        "GetAll");
+		dbus_message_append_args (message, DBUS_TYPE_STRING, &interface, DBUS_TYPE_INVALID);
+		if (   dbus_connection_send_with_reply (connection, message, &bss->get_all, -1)
+		    && bss->get_all) {
+			dbus_pending_call_set_notify (bss->get_all, bss_get_all_cb, bss, NULL);
+			count++;
+		} else
+			nm_log_warn (LOGD_SUPPLICANT, "(%s): couldn't request BSS %s properties",
+			             priv->dev, bss->path);
+		dbus_message_unref (message);
+	}
+
+	nm_log_dbg (LOGD_SUPPLICANT, "(%s): requested properties of %u BSSs", priv->dev, count);
+	return FALSE;
 }
 
 static void
@@ -292,65 +668,24 @@ handle_new_bss (NMSupplicantInterface *self,
                 GHashTable *props)
 {
 	NMSupplicantInterfacePrivate *priv = NM_SUPPLICANT_INTERFACE_GET_PRIVATE (self);
-	NMSupplicantInfo *info;
-	DBusGProxyCall *call;
-	BssProxies *proxies;
+	BssInfo *bss;
 
 	g_return_if_fail (object_path != NULL);
 
-	if (g_hash_table_lookup (priv->bss_proxies, object_path))
+	if (g_hash_table_lookup (priv->bss, object_path))
 		return;
 
-	proxies = g_malloc0 (sizeof (*proxies));
-	proxies->props = dbus_g_proxy_new_for_name (nm_dbus_manager_get_connection (priv->dbus_mgr),
-	                                            WPAS_DBUS_SERVICE,
-	                                            object_path,
-	                                            DBUS_INTERFACE_PROPERTIES);
-	proxies->old_props = dbus_g_proxy_new_for_name (nm_dbus_manager_get_connection (priv->dbus_mgr),
-	                                                WPAS_DBUS_SERVICE,
-	                                                object_path,
-	                                                WPAS_DBUS_IFACE_BSS);
-	g_hash_table_insert (priv->bss_proxies,
-	                     (gpointer) dbus_g_proxy_get_path (proxies->props),
-	                     proxies);
-
-	/* Standard D-Bus PropertiesChanged signal */
-	dbus_g_object_register_marshaller (_nm_marshal_VOID__STRING_BOXED_BOXED,
-	                                   G_TYPE_NONE,
-	                                   G_TYPE_STRING, DBUS_TYPE_G_MAP_OF_VARIANT, G_TYPE_STRV,
-	                                   G_TYPE_INVALID);
-	dbus_g_proxy_add_signal (proxies->props, "PropertiesChanged",
-	                         G_TYPE_STRING, DBUS_TYPE_G_MAP_OF_VARIANT, G_TYPE_STRV,
-	                         G_TYPE_INVALID);
-	dbus_g_proxy_connect_signal (proxies->props, "PropertiesChanged",
-	                             G_CALLBACK (bss_properties_changed),
-	                             self, NULL);
-
-	/* Old wpa_supplicant-specific PropertiesChanged signal; since it's using
-	 * a different interface, we have to use a different DBusGProxy
-	 */
-	dbus_g_object_register_marshaller (g_cclosure_marshal_VOID__BOXED,
-	                                   G_TYPE_NONE,
-	                                   DBUS_TYPE_G_MAP_OF_VARIANT,
-	                                   G_TYPE_INVALID);
-	dbus_g_proxy_add_signal (proxies->old_props, "PropertiesChanged",
-	                         DBUS_TYPE_G_MAP_OF_VARIANT,
-	                         G_TYPE_INVALID);
-	dbus_g_proxy_connect_signal (proxies->old_props, "PropertiesChanged",
-	                             G_CALLBACK (old_bss_properties_changed),
-	                             self, NULL);
+	bss = g_slice_new0 (BssInfo);
+	bss->self = self;
+	bss->path = g_strdup (object_path);
+	g_hash_table_insert (priv->bss, bss->path, bss);
 
 	if (props) {
 		signal_new_bss (self, object_path, props);
 	} else {
-		info = nm_supplicant_info_new (self, proxies->props, priv->other_pcalls);
-		call = dbus_g_proxy_begin_call (proxies->props, "GetAll",
-		                                bssid_properties_cb,
-		                                info,
-		                                nm_supplicant_info_destroy,
-		                                G_TYPE_STRING, WPAS_DBUS_IFACE_BSS,
-		                                G_TYPE_INVALID);
-		nm_supplicant_info_set_call (info, call);
+		bss->need_props = TRUE;
+		if (!priv->bss_fetch_id)
+			priv->bss_fetch_id = g_idle_add (bss_fetch_props, self);
 	}
 }
 
@@ -379,7 +714,7 @@ wpas_iface_bss_removed (DBusGProxy *proxy,
 
 	g_signal_emit (self, signals[BSS_REMOVED], 0, object_path);
 
-	g_hash_table_remove (priv->bss_proxies, object_path);
+	g_hash_table_remove (priv->bss, object_path);
 }
 
 static int
@@ -438,6 +773,8 @@ set_state (NMSupplicantInterface *self, guint32 new_state)
 		cancel_all_callbacks (priv->other_pcalls);
 		cancel_all_callbacks (priv->assoc_pcalls);
 
+		bss_tracking_stop (self);
+
 		/* Disconnect supplicant manager state listeners since we're done */
 		if (priv->smgr_avail_id) {
 			g_signal_handler_disconnect (priv->smgr, priv->smgr_avail_id);
@@ -538,6 +875,14 @@ wpas_iface_scan_done (DBusGProxy *proxy,
 
 	/* Cache last scan completed time */
 	priv->last_scan = time (NULL);
+
+	nm_log_dbg (LOGD_SUPPLICANT, "(%s): scan done; tracking %u BSSs with %u match rules, "
+	            "%u property requests pending",
+	            priv->dev,
+	            g_hash_table_size (priv->bss),
+	            g_slist_length (priv->bss_matches),
+	            bss_count_pending (self));
+
 	g_signal_emit (self, signals[SCAN_DONE], 0, success);
 }
 
@@ -908,6 +1253,8 @@ interface_add_done (NMSupplicantInterface *self, char *path)
 	                             self,
 	                             NULL);
 
+	bss_tracking_start (self);
+
 	priv->props_proxy = dbus_g_proxy_new_for_name (nm_dbus_manager_get_connection (priv->dbus_mgr),
 	                                               WPAS_DBUS_SERVICE,
 	                                               path,
@@ -1333,15 +1680,6 @@ scan_request_cb (DBusGProxy *proxy, DBusGProxyCall *call_id, gpointer user_data)
 	g_clear_error (&err);
 }
 
-static void
-destroy_gvalue (gpointer data)
-{
-	GValue *value = (GValue *) data;
-
-	g_value_unset (value);
-	g_slice_free (GValue, value);
-}
-
 static GValue *
 string_to_gvalue (const char *str)
 {
@@ -1532,7 +1870,7 @@ nm_supplicant_interface_init (NMSupplicantInterface * self)
 	                                              WPAS_DBUS_PATH,
 	                                              WPAS_DBUS_INTERFACE);
 
-	priv->bss_proxies = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, bss_proxies_free);
+	priv->bss = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, bss_info_free);
 }
 
 static void
@@ -1593,7 +1931,9 @@ dispose (GObject *object)
 	if (priv->wpas_proxy)
 		g_object_unref (priv->wpas_proxy);
 
-	g_hash_table_destroy (priv->bss_proxies);
+	bss_tracking_stop (NM_SUPPLICANT_INTERFACE (object));
+	g_hash_table_destroy (priv->bss);
+	g_free (priv->wpas_owner);
 
 	if (priv->smgr) {
 		if (priv->smgr_avail_id)
@@ -0,0 +1,392 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2013 Red Hat, Inc.
+ *
+ */
+
+#include <glib.h>
+#include <dbus/dbus.h>
+#include <dbus/dbus-glib-lowlevel.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <signal.h>
+
+#include "nm-ip4-config.h"
+#include "nm-ip6-config.h"
+#include "nm-dns-dnsmasq.h"
+
+#define DNSMASQ_DBUS_SERVICE   "org.freedesktop.NetworkManager.dnsmasq"
+#define DNSMASQ_DBUS_PATH      "/uk/org/thekelleys/dnsmasq"
+#define DNSMASQ_DBUS_INTERFACE "uk.org.thekelleys.dnsmasq"
+
+static GPid spid = 0;
+static DBusConnection *bus = NULL;
+static GMainLoop *loop = NULL;
+
+/*******************************************************************/
+
+static void
+cleanup (void)
+{
+	if (spid)
+		kill (spid, SIGTERM);
+}
+
+#define test_assert(condition) \
+do { \
+	if (!G_LIKELY (condition)) \
+		cleanup (); \
+	g_assert (condition); \
+} while (0)
+
+static guint32
+addr4 (const char *str)
+{
+	struct in_addr addr;
+
+	test_assert (inet_pton (AF_INET, str, &addr) == 1);
+	return addr.s_addr;
+}
+
+static NMIP4Config *
+ip4_config (const char *ns1, const char *ns2, const char *search)
+{
+	NMIP4Config *config = nm_ip4_config_new ();
+
+	if (ns1)
+		nm_ip4_config_add_nameserver (config, addr4 (ns1));
+	if (ns2)
+		nm_ip4_config_add_nameserver (config, addr4 (ns2));
+	if (search)
+		nm_ip4_config_add_search (config, search);
+	return config;
+}
+
+static NMIP6Config *
+ip6_config (const char *ns, const char *iface)
+{
+	NMIP6Config *config = nm_ip6_config_new ();
+	struct in6_addr addr;
+
+	test_assert (inet_pton (AF_INET6, ns, &addr) == 1);
+	nm_ip6_config_add_nameserver (config, &addr);
+	g_object_set_data_full (G_OBJECT (config), IP_CONFIG_IFACE_TAG, g_strdup (iface), g_free);
+	return config;
+}
+
+/* Compare the servers the stand-in service decoded with 'expected' */
+static void
+check_get_servers (const char **expected)
+{
+	DBusMessage *msg, *reply;
+	DBusError error;
+	char **servers = NULL;
+	int num = 0, i;
+
+	dbus_error_init (&error);
+
+	msg = dbus_message_new_method_call (DNSMASQ_DBUS_SERVICE,
+	                                    DNSMASQ_DBUS_PATH,
+	                                    DNSMASQ_DBUS_INTERFACE,
+	                                    "GetServers");
+	reply = dbus_connection_send_with_reply_and_block (bus, msg, 5000, &error);
+	test_assert (reply != NULL);
+	test_assert (dbus_message_get_args (reply, &error,
+	                                    DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &servers, &num,
+	                                    DBUS_TYPE_INVALID));
+	dbus_message_unref (reply);
+	dbus_message_unref (msg);
+
+	test_assert (num == g_strv_length ((char **) expected));
+	for (i = 0; i < num; i++) {
+		if (strcmp (servers[i], expected[i]) != 0)
+			g_warning ("server %d: expected '%s', got '%s'", i, expected[i], servers[i]);
+		test_assert (strcmp (servers[i], expected[i]) == 0);
+	}
+	dbus_free_string_array (servers);
+}
+
+/* Push the configs to the stand-in service and compare what it decoded */
+static void
+check_servers (GSList *vpn, GSList *dev, GSList *other, const char **expected)
+{
+	DBusMessage *msg, *reply;
+	DBusError error;
+
+	dbus_error_init (&error);
+
+	msg = nm_dns_dnsmasq_test_build_set_servers (vpn, dev, other);
+	test_assert (msg != NULL);
+	reply = dbus_connection_send_with_reply_and_block (bus, msg, 5000, &error);
+	if (!reply)
+		g_warning ("SetServers failed: %s", error.message);
+	test_assert (reply != NULL);
+	dbus_message_unref (reply);
+	dbus_message_unref (msg);
+
+	check_get_servers (expected);
+}
+
+static void
+free_configs (GSList *list)
+{
+	g_slist_foreach (list, (GFunc) g_object_unref, NULL);
+	g_slist_free (list);
+}
+
+/*******************************************************************/
+
+static void
+test_device_servers (void)
+{
+	GSList *dev;
+	const char *expected[] = { "192.168.1.1", "192.168.1.2", NULL };
+
+	dev = g_slist_append (NULL, ip4_config ("192.168.1.1", "192.168.1.2", "example.com"));
+	check_servers (NULL, dev, NULL, expected);
+	free_configs (dev);
+}
+
+static void
+test_split_dns (void)
+{
+	GSList *vpn, *dev;
+	const char *expected[] = { "10.0.0.1/corp.example.com", "192.168.1.1", NULL };
+
+	/* Only the first VPN nameserver is used for the split domain */
+	vpn = g_slist_append (NULL, ip4_config ("10.0.0.1", "10.0.0.2", "corp.example.com"));
+	dev = g_slist_append (NULL, ip4_config ("192.168.1.1", NULL, NULL));
+	check_servers (vpn, dev, NULL, expected);
+	free_configs (vpn);
+	free_configs (dev);
+}
+
+static void
+test_ip6_servers (void)
+{
+	GSList *dev;
+	const char *expected[] = { "2001:db8::1", "192.0.2.53", "192.168.1.1", NULL };
+
+	/* v4-mapped addresses are passed to dnsmasq as IPv4 */
+	dev = g_slist_append (NULL, ip6_config ("2001:db8::1", "eth0"));
+	dev = g_slist_append (dev, ip6_config ("::ffff:192.0.2.53", "eth0"));
+	dev = g_slist_append (dev, ip4_config ("192.168.1.1", NULL, NULL));
+	check_servers (NULL, dev, NULL, expected);
+	free_configs (dev);
+}
+
+static void
+test_clear_servers (void)
+{
+	const char *expected[] = { NULL };
+
+	/* An update with no servers must clear the previous ones */
+	check_servers (NULL, NULL, NULL, expected);
+}
+
+static void
+plugin_ready (NMDnsPlugin *plugin, gpointer user_data)
+{
+	gboolean *ready = user_data;
+
+	*ready = TRUE;
+	g_main_loop_quit (loop);
+}
+
+static gboolean
+ready_timeout (gpointer user_data)
+{
+	g_main_loop_quit (loop);
+	return FALSE;
+}
+
+/* Run the main loop until the plugin emits 'ready' */
+static void
+wait_ready (gboolean *ready)
+{
+	guint id;
+
+	if (!*ready) {
+		id = g_timeout_add_seconds (10, ready_timeout, NULL);
+		g_main_loop_run (loop);
+		if (*ready)
+			g_source_remove (id);
+	}
+	test_assert (*ready);
+	*ready = FALSE;
+}
+
+static void
+update_plugin (NMDnsPlugin *plugin, const char *ns)
+{
+	GSList *dev;
+
+	dev = g_slist_append (NULL, ip4_config (ns, NULL, NULL));
+	test_assert (nm_dns_plugin_update (plugin, NULL, dev, NULL, NULL));
+	free_configs (dev);
+}
+
+static void
+check_conf (NMDnsDnsmasq *dnsmasq, const char *expected)
+{
+	char *contents = NULL;
+
+	test_assert (g_file_get_contents (nm_dns_dnsmasq_test_get_conffile (dnsmasq),
+	                                  &contents, NULL, NULL));
+	if (strcmp (contents, expected) != 0)
+		g_warning ("config file: expected '%s', got '%s'", expected, contents);
+	test_assert (strcmp (contents, expected) == 0);
+	g_free (contents);
+}
+
+static void
+test_plugin_restart (const char *binary)
+{
+	NMDnsDnsmasq *dnsmasq;
+	NMDnsPlugin *plugin;
+	gboolean ready = FALSE;
+	char *rundir;
+	GPid pid;
+	int i = 100;
+	const char *expected1[] = { "192.168.1.1", NULL };
+	const char *expected2[] = { "192.168.1.2", NULL };
+
+	/* The plugin's dnsmasq takes the service name over */
+	cleanup ();
+	spid = 0;
+	while (i > 0 && dbus_bus_name_has_owner (bus, DNSMASQ_DBUS_SERVICE, NULL)) {
+		g_usleep (G_USEC_PER_SEC / 50);
+		i--;
+	}
+	test_assert (i > 0);
+
+	rundir = g_build_filename (g_get_tmp_dir (), "test-dns-dnsmasq-XXXXXX", NULL);
+	test_assert (mkdtemp (rundir) != NULL);
+
+	dnsmasq = nm_dns_dnsmasq_test_new (binary, rundir, bus);
+	plugin = NM_DNS_PLUGIN (dnsmasq);
+	g_signal_connect (plugin, NM_DNS_PLUGIN_READY, G_CALLBACK (plugin_ready), &ready);
+
+	/* A fresh dnsmasq gets its servers over D-Bus; the update succeeds
+	 * but is pending until dnsmasq has accepted them.
+	 */
+	update_plugin (plugin, "192.168.1.1");
+	pid = nm_dns_plugin_child_pid (plugin);
+	test_assert (pid != 0);
+	test_assert (nm_dns_plugin_is_pending (plugin));
+	check_conf (dnsmasq, "");
+	wait_ready (&ready);
+	test_assert (!nm_dns_plugin_is_pending (plugin));
+	check_get_servers (expected1);
+
+	/* Later changes go to the same dnsmasq and take effect at once */
+	update_plugin (plugin, "192.168.1.2");
+	test_assert (!nm_dns_plugin_is_pending (plugin));
+	test_assert (nm_dns_plugin_child_pid (plugin) == pid);
+	check_get_servers (expected2);
+
+	/* A rejected SetServers restarts dnsmasq with the servers in its
+	 * config file, and 'ready' redoes the update.
+	 */
+	update_plugin (plugin, "198.51.100.1");
+	wait_ready (&ready);
+	test_assert (!nm_dns_plugin_is_pending (plugin));
+	test_assert (nm_dns_plugin_child_pid (plugin) != 0);
+	test_assert (nm_dns_plugin_child_pid (plugin) != pid);
+	check_conf (dnsmasq, "server=198.51.100.1\n");
+
+	/* From then on changes restart dnsmasq, which is usable right away */
+	pid = nm_dns_plugin_child_pid (plugin);
+	update_plugin (plugin, "192.168.1.3");
+	test_assert (!nm_dns_plugin_is_pending (plugin));
+	test_assert (nm_dns_plugin_child_pid (plugin) != 0);
+	test_assert (nm_dns_plugin_child_pid (plugin) != pid);
+	check_conf (dnsmasq, "server=192.168.1.3\n");
+
+	g_object_unref (dnsmasq);
+	rmdir (rundir);
+	g_free (rundir);
+}
+
+/*******************************************************************/
+
+#if GLIB_CHECK_VERSION(2,25,12)
+typedef GTestFixtureFunc TCFunc;
+#else
+typedef void (*TCFunc)(void);
+#endif
+
+#define TESTCASE(t, d) g_test_create_case (#t, 0, d, NULL, (TCFunc) t, NULL)
+
+int main (int argc, char **argv)
+{
+	GTestSuite *suite;
+	char *service_argv[2] = { NULL, NULL };
+	int ret;
+	GError *error = NULL;
+	DBusError dbus_error;
+	int i = 100;
+
+	g_assert (argc == 3);
+
+	g_type_init ();
+
+	g_test_init (&argc, &argv, NULL);
+
+	dbus_error_init (&dbus_error);
+	bus = dbus_bus_get (DBUS_BUS_SESSION, &dbus_error);
+	if (!bus) {
+		g_warning ("Error connecting to D-Bus: %s", dbus_error.message);
+		g_assert (bus != NULL);
+	}
+	loop = g_main_loop_new (NULL, FALSE);
+	dbus_connection_setup_with_g_main (bus, NULL);
+
+	service_argv[0] = g_strdup_printf ("%s/%s", argv[1], argv[2]);
+	if (!g_spawn_async (argv[1], service_argv, NULL, 0, NULL, NULL, &spid, &error)) {
+		g_warning ("Error spawning %s: %s", argv[2], error->message);
+		g_assert (error == NULL);
+	}
+
+	/* Wait until the service is registered on the bus */
+	while (i > 0) {
+		g_usleep (G_USEC_PER_SEC / 50);
+		if (dbus_bus_name_has_owner (bus, DNSMASQ_DBUS_SERVICE, NULL))
+			break;
+		i--;
+	}
+	test_assert (i > 0);
+
+	suite = g_test_get_root ();
+
+	g_test_suite_add (suite, TESTCASE (test_device_servers, NULL));
+	g_test_suite_add (suite, TESTCASE (test_split_dns, NULL));
+	g_test_suite_add (suite, TESTCASE (test_ip6_servers, NULL));
+	g_test_suite_add (suite, TESTCASE (test_clear_servers, NULL));
+	g_test_suite_add (suite, TESTCASE (test_plugin_restart, service_argv[0]));
+
+	ret = g_test_run ();
+
+	cleanup ();
+	g_free (service_argv[0]);
+	g_main_loop_unref (loop);
+
+	return ret;
+}
@@ -0,0 +1,97 @@
+#!/usr/bin/env python
+# -*- Mode: python; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+
+# Stand-in for dnsmasq's D-Bus interface; decodes SetServers arguments the
+# same way dnsmasq does and hands them back through GetServers.
+#
+# Given dnsmasq's command line it also stands in for the dnsmasq binary: it
+# answers --version, only takes the bus name passed with --enable-dbus, and
+# rejects SetServers for servers in 198.51.100.0/24 so the test can make the
+# D-Bus update fail.
+
+import gobject
+import sys
+import socket
+import struct
+import dbus
+import dbus.service
+import dbus.mainloop.glib
+
+SERVICE = 'org.freedesktop.NetworkManager.dnsmasq'
+PATH = '/uk/org/thekelleys/dnsmasq'
+IFACE = 'uk.org.thekelleys.dnsmasq'
+REJECT = '198.51.100.'
+
+mainloop = gobject.MainLoop()
+
+class Dnsmasq(dbus.service.Object):
+    def __init__(self, bus, object_path):
+        dbus.service.Object.__init__(self, bus, object_path)
+        self.servers = []
+
+    @dbus.service.method(dbus_interface=IFACE, out_signature='')
+    def SetServers(self, *args):
+        servers = []
+        args = list(args)
+        while args:
+            arg = args.pop(0)
+            if isinstance(arg, dbus.UInt32):
+                servers.append([socket.inet_ntoa(struct.pack('!I', arg))])
+            elif isinstance(arg, dbus.Byte):
+                # IPv6 addresses are 16 consecutive BYTE arguments
+                addr = [arg] + args[:15]
+                del args[:15]
+                if len(addr) != 16 or [b for b in addr if not isinstance(b, dbus.Byte)]:
+                    raise dbus.DBusException('truncated IPv6 address')
+                servers.append([socket.inet_ntop(socket.AF_INET6, ''.join([chr(b) for b in addr]))])
+            elif isinstance(arg, dbus.String):
+                if not servers:
+                    raise dbus.DBusException('domain without a server')
+                servers[-1].append(str(arg))
+            else:
+                raise dbus.DBusException('unexpected argument %s' % repr(arg))
+        if [s for s in servers if s[0].startswith(REJECT)]:
+            raise dbus.DBusException('rejected server')
+        self.servers = ['/'.join(s) for s in servers]
+
+    @dbus.service.method(dbus_interface=IFACE, in_signature='', out_signature='as')
+    def GetServers(self):
+        return self.servers
+
+def quit_cb(user_data):
+    mainloop.quit()
+
+def main():
+    service = SERVICE
+    if len(sys.argv) > 1:
+        if '--version' in sys.argv:
+            print "Dnsmasq version 2.66  Copyright (c) 2000-2013 Simon Kelley"
+            print "Compile time options: IPv6 GNU-getopt DBus no-i18n"
+            sys.exit(0)
+        service = None
+        for arg in sys.argv[1:]:
+            if arg.startswith('--enable-dbus='):
+                service = arg[len('--enable-dbus='):]
+
+    dbus.mainloop.glib.DBusGMainLoop(set_as_default=True)
+
+    if service:
+        bus = dbus.SessionBus()
+        obj = Dnsmasq(bus, PATH)
+        if not bus.request_name(service):
+            sys.exit(1)
+
+    print "Service started"
+
+    gobject.timeout_add_seconds(20, quit_cb, None)
+
+    try:
+        mainloop.run()
+    except Exception, e:
+        pass
+
+    print "Service stopped"
+    sys.exit(0)
+
+if __name__ == '__main__':
+    main()
@@ -49,8 +49,17 @@ typedef struct {
 	struct nl_cb *nl_cb;
 	guint32 *freqs;
 	int num_freqs;
+
+	/* Link event monitoring */
+	struct nl_sock *event_sock;
+	GIOChannel *event_channel;
+	guint event_id;
+	WifiLinkEventFunc event_func;
+	gpointer event_data;
 } WifiDataNl80211;
 
+static void wifi_nl80211_unwatch_link_events (WifiData *data);
+
 static int ack_handler (struct nl_msg *msg, void *arg)
 {
 	int *done = arg;
@@ -160,6 +169,8 @@ wifi_nl80211_deinit (WifiData *parent)
 {
 	WifiDataNl80211 *nl80211 = (WifiDataNl80211 *) parent;
 
+	wifi_nl80211_unwatch_link_events (parent);
+
 	if (nl80211->nl_sock)
 		nl_socket_free (nl80211->nl_sock);
 	if (nl80211->nl_cb)
@@ -504,26 +515,25 @@ static int nl80211_station_handler (struct nl_msg *msg, void *arg)
 	return NL_SKIP;
 }
 
-static void nl80211_get_ap_info (WifiDataNl80211 *nl80211,
-				 struct nl80211_station_info *sta_info)
+static void nl80211_get_station_info (WifiDataNl80211 *nl80211,
+				      const struct nl80211_bss_info *bss_info,
+				      struct nl80211_station_info *sta_info)
 {
 	struct nl_msg *msg;
-	struct nl80211_bss_info bss_info;
 
 	memset(sta_info, 0, sizeof(*sta_info));
 
-	nl80211_get_bss_info (nl80211, &bss_info);
-	if (!bss_info.valid)
+	if (!bss_info->valid)
 		return;
 
 	msg = nl80211_alloc_msg (nl80211, NL80211_CMD_GET_STATION, 0);
 	if (msg) {
-		NLA_PUT (msg, NL80211_ATTR_MAC, ETH_ALEN, bss_info.bssid);
+		NLA_PUT (msg, NL80211_ATTR_MAC, ETH_ALEN, bss_info->bssid);
 
 		nl80211_send_and_recv (nl80211, msg, nl80211_station_handler, sta_info);
 		if (!sta_info->signal_valid) {
 			/* Fall back to bss_info signal quality (both are in percent) */
-			sta_info->signal = bss_info.beacon_signal;
+			sta_info->signal = bss_info->beacon_signal;
 		}
 	}
 
@@ -534,6 +544,15 @@ static void nl80211_get_ap_info (WifiDataNl80211 *nl80211,
 	return;
 }
 
+static void nl80211_get_ap_info (WifiDataNl80211 *nl80211,
+				 struct nl80211_station_info *sta_info)
+{
+	struct nl80211_bss_info bss_info;
+
+	nl80211_get_bss_info (nl80211, &bss_info);
+	nl80211_get_station_info (nl80211, &bss_info, sta_info);
+}
+
 static guint32
 wifi_nl80211_get_rate (WifiData *data)
 {
@@ -555,6 +574,240 @@ wifi_nl80211_get_qual (WifiData *data)
 	return sta_info.signal;
 }
 
+/* One scan dump and one station request instead of one or two of each
+ * per value.
+ */
+static gboolean
+wifi_nl80211_get_link_snapshot (WifiData *data, WifiLinkSnapshot *out_link)
+{
+	WifiDataNl80211 *nl80211 = (WifiDataNl80211 *) data;
+	struct nl80211_bss_info bss_info;
+	struct nl80211_station_info sta_info;
+
+	nl80211_get_bss_info (nl80211, &bss_info);
+	if (!bss_info.valid) {
+		out_link->qual = -1;
+		return FALSE;
+	}
+
+	nl80211_get_station_info (nl80211, &bss_info, &sta_info);
+
+	memcpy (out_link->bssid.ether_addr_octet, bss_info.bssid, ETH_ALEN);
+	memcpy (out_link->ssid, bss_info.ssid, bss_info.ssid_len);
+	out_link->ssid_len = bss_info.ssid_len;
+	out_link->freq = bss_info.freq;
+	out_link->rate = sta_info.txrate;
+	out_link->qual = sta_info.signal;
+	return TRUE;
+}
+
+/* Link event monitoring: connect/disconnect/roam notifications from the
+ * "mlme" multicast group.  The interface has a single connection quality
+ * monitor (CQM) threshold, which belongs to wpa_supplicant (bgscan uses it
+ * to drive roaming), so we never program it ourselves; CQM notifications
+ * are still passed on when the supplicant has enabled them.
+ */
+
+struct nl80211_mcast_group {
+	const char *name;
+	int id;
+};
+
+static int nl80211_family_handler (struct nl_msg *msg, void *arg)
+{
+	struct nl80211_mcast_group *group = arg;
+	struct genlmsghdr *gnlh = nlmsg_data (nlmsg_hdr (msg));
+	struct nlattr *tb[CTRL_ATTR_MAX + 1];
+	struct nlattr *tb_grp[CTRL_ATTR_MCAST_GRP_MAX + 1];
+	struct nlattr *mcgrp;
+	int rem;
+
+	if (nla_parse (tb, CTRL_ATTR_MAX, genlmsg_attrdata (gnlh, 0),
+		       genlmsg_attrlen (gnlh, 0), NULL) < 0)
+		return NL_SKIP;
+
+	if (!tb[CTRL_ATTR_MCAST_GROUPS])
+		return NL_SKIP;
+
+	nla_for_each_nested (mcgrp, tb[CTRL_ATTR_MCAST_GROUPS], rem) {
+		nla_parse (tb_grp, CTRL_ATTR_MCAST_GRP_MAX,
+			   nla_data (mcgrp), nla_len (mcgrp), NULL);
+
+		if (   !tb_grp[CTRL_ATTR_MCAST_GRP_NAME]
+		    || !tb_grp[CTRL_ATTR_MCAST_GRP_ID])
+			continue;
+		if (strncmp (nla_data (tb_grp[CTRL_ATTR_MCAST_GRP_NAME]), group->name,
+			     nla_len (tb_grp[CTRL_ATTR_MCAST_GRP_NAME])))
+			continue;
+
+		group->id = nla_get_u32 (tb_grp[CTRL_ATTR_MCAST_GRP_ID]);
+		break;
+	}
+
+	return NL_SKIP;
+}
+
+static int
+nl80211_get_multicast_id (WifiDataNl80211 *nl80211, const char *name)
+{
+	struct nl80211_mcast_group group = { name, -ENOENT };
+	struct nl_msg *msg;
+	int ctrl_id;
+
+	ctrl_id = genl_ctrl_resolve (nl80211->nl_sock, "nlctrl");
+	if (ctrl_id < 0)
+		return ctrl_id;
+
+	msg = nlmsg_alloc ();
+	if (!msg)
+		return -ENOMEM;
+
+	genlmsg_put (msg, 0, 0, ctrl_id, 0, 0, CTRL_CMD_GETFAMILY, 0);
+	NLA_PUT_STRING (msg, CTRL_ATTR_FAMILY_NAME, "nl80211");
+
+	if (nl80211_send_and_recv (nl80211, msg, nl80211_family_handler, &group) < 0)
+		return -ENOENT;
+	return group.id;
+
+ nla_put_failure:
+	nlmsg_free (msg);
+	return -ENOMEM;
+}
+
+static int nl80211_event_handler (struct nl_msg *msg, void *arg)
+{
+	WifiDataNl80211 *nl80211 = arg;
+	struct genlmsghdr *gnlh = nlmsg_data (nlmsg_hdr (msg));
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	WifiLinkEvent event;
+
+	if (nla_parse (tb, NL80211_ATTR_MAX, genlmsg_attrdata (gnlh, 0),
+		       genlmsg_attrlen (gnlh, 0), NULL) < 0)
+		return NL_SKIP;
+
+	/* The group carries events for every wireless interface */
+	if (   !tb[NL80211_ATTR_IFINDEX]
+	    || nla_get_u32 (tb[NL80211_ATTR_IFINDEX]) != nl80211->parent.ifindex)
+		return NL_SKIP;
+
+	switch (gnlh->cmd) {
+	case NL80211_CMD_CONNECT:
+		event = WIFI_LINK_EVENT_CONNECT;
+		break;
+	case NL80211_CMD_DISCONNECT:
+		event = WIFI_LINK_EVENT_DISCONNECT;
+		break;
+	case NL80211_CMD_ROAM:
+	case NL80211_CMD_JOIN_IBSS:
+		event = WIFI_LINK_EVENT_ROAM;
+		break;
+	case NL80211_CMD_NOTIFY_CQM:
+		event = WIFI_LINK_EVENT_SIGNAL;
+		break;
+	default:
+		return NL_SKIP;
+	}
+
+	nm_log_dbg (LOGD_WIFI, "(%s): nl80211 link event %d (command %d)",
+	            nl80211->parent.iface, event, gnlh->cmd);
+	nl80211->event_func ((WifiData *) nl80211, event, nl80211->event_data);
+	return NL_SKIP;
+}
+
+static gboolean
+nl80211_event_cb (GIOChannel *channel, GIOCondition condition, gpointer user_data)
+{
+	WifiDataNl80211 *nl80211 = user_data;
+	int err;
+
+	if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) {
+		nm_log_warn (LOGD_WIFI, "(%s): nl80211 event socket failed; link events stopped",
+		             nl80211->parent.iface);
+		nl80211->event_id = 0;
+		return FALSE;
+	}
+
+	err = nl_recvmsgs_default (nl80211->event_sock);
+	if (err < 0 && err != -NLE_AGAIN) {
+		nm_log_dbg (LOGD_WIFI, "(%s): error reading nl80211 events: (%d) %s",
+		            nl80211->parent.iface, err, nl_geterror (err));
+	}
+	return TRUE;
+}
+
+static gboolean
+wifi_nl80211_watch_link_events (WifiData *data,
+                                WifiLinkEventFunc callback,
+                                gpointer user_data)
+{
+	WifiDataNl80211 *nl80211 = (WifiDataNl80211 *) data;
+	int group;
+
+	g_return_val_if_fail (nl80211->event_sock == NULL, FALSE);
+
+	group = nl80211_get_multicast_id (nl80211, "mlme");
+	if (group < 0) {
+		nm_log_dbg (LOGD_WIFI, "(%s): nl80211 mlme events not available",
+		            data->iface);
+		return FALSE;
+	}
+
+	nl80211->event_sock = nl_socket_alloc ();
+	if (nl80211->event_sock == NULL)
+		return FALSE;
+
+	if (genl_connect (nl80211->event_sock))
+		goto error;
+
+	nl_socket_disable_seq_check (nl80211->event_sock);
+	nl_socket_modify_cb (nl80211->event_sock, NL_CB_VALID, NL_CB_CUSTOM,
+	                     nl80211_event_handler, nl80211);
+	if (nl_socket_add_membership (nl80211->event_sock, group) < 0)
+		goto error;
+	if (nl_socket_set_nonblocking (nl80211->event_sock) < 0)
+		goto error;
+
+	nl80211->event_func = callback;
+	nl80211->event_data = user_data;
+
+	nl80211->event_channel = g_io_channel_unix_new (nl_socket_get_fd (nl80211->event_sock));
+	nl80211->event_id = g_io_add_watch (nl80211->event_channel,
+	                                    G_IO_IN | G_IO_ERR | G_IO_HUP | G_IO_NVAL,
+	                                    nl80211_event_cb,
+	                                    nl80211);
+
+	return TRUE;
+
+error:
+	nm_log_dbg (LOGD_WIFI, "(%s): failed to set up nl80211 event socket",
+	            data->iface);
+	nl_socket_free (nl80211->event_sock);
+	nl80211->event_sock = NULL;
+	return FALSE;
+}
+
+static void
+wifi_nl80211_unwatch_link_events (WifiData *data)
+{
+	WifiDataNl80211 *nl80211 = (WifiDataNl80211 *) data;
+
+	if (nl80211->event_id) {
+		g_source_remove (nl80211->event_id);
+		nl80211->event_id = 0;
+	}
+	if (nl80211->event_channel) {
+		/* The socket owns the file descriptor */
+		g_io_channel_unref (nl80211->event_channel);
+		nl80211->event_channel = NULL;
+	}
+	if (nl80211->event_sock) {
+		nl_socket_free (nl80211->event_sock);
+		nl80211->event_sock = NULL;
+	}
+	nl80211->event_func = NULL;
+	nl80211->event_data = NULL;
+}
+
 struct nl80211_device_info {
 	guint32 *freqs;
 	int num_freqs;
@@ -742,6 +995,9 @@ wifi_nl80211_init (const char *iface, int ifindex)
 	nl80211->parent.get_bssid = wifi_nl80211_get_bssid;
 	nl80211->parent.get_rate = wifi_nl80211_get_rate;
 	nl80211->parent.get_qual = wifi_nl80211_get_qual;
+	nl80211->parent.get_link_snapshot = wifi_nl80211_get_link_snapshot;
+	nl80211->parent.watch_link_events = wifi_nl80211_watch_link_events;
+	nl80211->parent.unwatch_link_events = wifi_nl80211_unwatch_link_events;
 	nl80211->parent.deinit = wifi_nl80211_deinit;
 
 	nl80211->nl_sock = nl_socket_alloc ();
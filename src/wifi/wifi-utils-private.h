@@ -55,6 +55,15 @@ struct WifiData {
 	 */
 	int (*get_qual) (WifiData *data);
 
+	/* Optional; return all of the above for the current link at once */
+	gboolean (*get_link_snapshot) (WifiData *data, WifiLinkSnapshot *out_link);
+
+	/* Optional; report link changes instead of being polled */
+	gboolean (*watch_link_events) (WifiData *data,
+	                               WifiLinkEventFunc callback,
+	                               gpointer user_data);
+	void (*unwatch_link_events) (WifiData *data);
+
 	void (*deinit) (WifiData *data);
 
 	/* OLPC Mesh-only functions */
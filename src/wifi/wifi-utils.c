@@ -150,6 +150,59 @@ wifi_utils_get_qual (WifiData *data)
 	return data->get_qual (data);
 }
 
+gboolean
+wifi_utils_get_link_snapshot (WifiData *data, WifiLinkSnapshot *out_link)
+{
+	GByteArray *ssid;
+	gboolean associated;
+
+	g_return_val_if_fail (data != NULL, FALSE);
+	g_return_val_if_fail (out_link != NULL, FALSE);
+
+	memset (out_link, 0, sizeof (*out_link));
+	if (data->get_link_snapshot)
+		return data->get_link_snapshot (data, out_link);
+
+	associated = data->get_bssid (data, &out_link->bssid);
+	if (!associated) {
+		out_link->qual = -1;
+		return FALSE;
+	}
+
+	ssid = data->get_ssid (data);
+	if (ssid) {
+		out_link->ssid_len = MIN (ssid->len, sizeof (out_link->ssid));
+		memcpy (out_link->ssid, ssid->data, out_link->ssid_len);
+		g_byte_array_free (ssid, TRUE);
+	}
+	out_link->freq = data->get_freq (data);
+	out_link->rate = data->get_rate (data);
+	out_link->qual = data->get_qual (data);
+	return TRUE;
+}
+
+gboolean
+wifi_utils_watch_link_events (WifiData *data,
+                              WifiLinkEventFunc callback,
+                              gpointer user_data)
+{
+	g_return_val_if_fail (data != NULL, FALSE);
+	g_return_val_if_fail (callback != NULL, FALSE);
+
+	if (!data->watch_link_events)
+		return FALSE;
+	return data->watch_link_events (data, callback, user_data);
+}
+
+void
+wifi_utils_unwatch_link_events (WifiData *data)
+{
+	g_return_if_fail (data != NULL);
+
+	if (data->unwatch_link_events)
+		data->unwatch_link_events (data);
+}
+
 void
 wifi_utils_deinit (WifiData *data)
 {
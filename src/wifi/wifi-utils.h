@@ -61,6 +61,40 @@ guint32 wifi_utils_get_rate (WifiData *data);
 /* Returns quality 0 - 100% on succes, or -1 on error */
 int wifi_utils_get_qual (WifiData *data);
 
+typedef struct {
+	struct ether_addr bssid;
+	guint8 ssid[32];
+	guint32 ssid_len;
+	guint32 freq;  /* MHz */
+	guint32 rate;  /* Kbps */
+	int qual;      /* 0 - 100%, or -1 on error */
+} WifiLinkSnapshot;
+
+/* Fills @out_link with the BSSID, SSID, frequency, bitrate and signal
+ * quality of the current link using as few driver requests as possible.
+ * Returns FALSE if the device isn't associated.
+ */
+gboolean wifi_utils_get_link_snapshot (WifiData *data, WifiLinkSnapshot *out_link);
+
+typedef enum {
+	WIFI_LINK_EVENT_CONNECT = 0,
+	WIFI_LINK_EVENT_DISCONNECT,
+	WIFI_LINK_EVENT_ROAM,
+	WIFI_LINK_EVENT_SIGNAL,  /* signal crossed the supplicant's CQM threshold */
+} WifiLinkEvent;
+
+typedef void (*WifiLinkEventFunc) (WifiData *data, WifiLinkEvent event, gpointer user_data);
+
+/* Calls @callback from the main loop when the link changes.  Returns FALSE
+ * if the driver can't report link changes, in which case callers must poll.
+ * Signal and bitrate drift on a stable link is not reported.
+ */
+gboolean wifi_utils_watch_link_events (WifiData *data,
+                                       WifiLinkEventFunc callback,
+                                       gpointer user_data);
+
+void wifi_utils_unwatch_link_events (WifiData *data);
+
 
 /* OLPC Mesh-only functions */
 guint32 wifi_utils_get_mesh_channel (WifiData *data);
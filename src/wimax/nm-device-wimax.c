@@ -182,6 +182,16 @@ impl_device_get_nsp_list (NMDeviceWimax *self, GPtrArray **nsps, GError **error)
 	return TRUE;
 }
 
+static GPtrArray *
+get_exported_children (NMDevice *device, const char **out_name)
+{
+	GPtrArray *nsps = NULL;
+
+	*out_name = "NspList";
+	impl_device_get_nsp_list (NM_DEVICE_WIMAX (device), &nsps, NULL);
+	return nsps;
+}
+
 static void
 set_current_nsp (NMDeviceWimax *self, NMWimaxNsp *new_nsp)
 {
@@ -242,7 +252,7 @@ remove_all_nsps (NMDeviceWimax *self)
 		g_object_unref (nsp);
 	}
 
-	nm_device_recheck_available_connections (NM_DEVICE (self));
+	nm_device_update_available_connections (NM_DEVICE (self), NULL, NULL);
 
 	g_slist_free (priv->nsp_list);
 	priv->nsp_list = NULL;
@@ -1056,7 +1066,7 @@ remove_outdated_nsps (NMDeviceWimax *self,
 	}
 
 	if (g_slist_length(to_remove) > 0)
-	    nm_device_recheck_available_connections (NM_DEVICE (self));
+		nm_device_update_available_connections (NM_DEVICE (self), NULL, NULL);
 
 	g_slist_free (to_remove);
 }
@@ -1105,7 +1115,7 @@ wmx_scan_result_cb (struct wmxsdk *wmxsdk,
 			priv->nsp_list = g_slist_append (priv->nsp_list, nsp);
 			nm_wimax_nsp_export_to_dbus (nsp);
 			g_signal_emit (self, signals[NSP_ADDED], 0, nsp);
-			nm_device_recheck_available_connections (NM_DEVICE (self));
+			nm_device_update_available_connections (NM_DEVICE (self), NULL, NULL);
 		}
 	}
 }
@@ -1498,6 +1508,7 @@ nm_device_wimax_class_init (NMDeviceWimaxClass *klass)
 	device_class->deactivate = deactivate;
 	device_class->set_enabled = set_enabled;
 	device_class->hwaddr_matches = hwaddr_matches;
+	device_class->get_exported_children = get_exported_children;
 
 	device_class->state_changed = device_state_changed;
 